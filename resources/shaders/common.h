@@ -32,3 +32,11 @@ cbuffer PerObject : register(b2)
 {
 	float4x4 g_world;
 };
+
+//-- Root constants. See MeshResource::VertexFormat.
+cbuffer PerDraw : register(b3)
+{
+	float3 g_positionScale;
+	uint g_tangentFrame;
+	float3 g_positionOffset;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+//-- Layout of the meshlet buffers. See mesh::MeshletData and MeshResource::MeshletRepresentation.
+
+struct Meshlet
+{
+	uint vertexOffset;
+	uint triangleOffset;
+	uint numVertices;
+	uint numTriangles;
+};
+
+struct MeshletBounds
+{
+	float3 center;
+	float radius;
+	float3 coneApex;
+	float coneCutoff;
+	float3 coneAxis;
+	float padding;
+};
+
+uint3 unpackMeshletTriangle(uint packed)
+{
+	return uint3(packed & 0xff, (packed >> 8) & 0xff, (packed >> 16) & 0xff);
+}
+
+//-- The camera position is in the object space of the mesh.
+bool isMeshletBackfacing(MeshletBounds bounds, float3 cameraPosition)
+{
+	return dot(normalize(bounds.coneApex - cameraPosition), bounds.coneAxis) >= bounds.coneCutoff;
+}
@@ -1,14 +1,25 @@
+//-- Variants are compiled for the streams meshes have, see ShaderPermutations.
+// @keywords TANGENT_FRAME UV1 VERTEX_COLOR
+
 #include "common.h"
+#include "vertex_format.h"
 
 struct VSInput
 {
 	float3 pos : POSITION;
-	float3 tangent : TANGENT;
+#if TANGENT_FRAME
+	float4 tangent : TANGENT;
 	float3 bitangent : BITANGENT;
 	float3 normal : NORMAL;
+#endif
 	float2 uv0 : TEXCOORD0;
+#if UV1
 	float2 uv1 : TEXCOORD1;
+#endif
+#if VERTEX_COLOR
 	float4 color : COLOR;
+#endif
+	uint instanceId : SV_InstanceID;
 };
 
 struct PSInput
@@ -20,15 +31,22 @@ struct PSInput
 
 Texture2D g_texture : register(t0);
 SamplerState g_sampler : register(s0);
+//-- Geometry to world transforms of the instances of the mesh. See MeshResource::Mesh::instanceTransforms.
+StructuredBuffer<row_major float4x4> g_instances : register(t1);
 
 PSInput vs_main(VSInput i)
 {
 	PSInput o;
 
-	o.pos = mul(float4(i.pos, 1.0f), g_world);
+	o.pos = mul(float4(decodePosition(i.pos), 1.0f), g_instances[i.instanceId]);
+	o.pos = mul(o.pos, g_world);
 	o.pos = mul(o.pos, g_view);
 	o.pos = mul(o.pos, g_proj);
+#if VERTEX_COLOR
 	o.color = i.color;
+#else
+	o.color = float4(1.0f, 1.0f, 1.0f, 1.0f);
+#endif
 	o.uv = i.uv0;
 
 	return o;
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "common.h"
+
+//-- Decoding of the compact vertex formats. See MeshResource::VertexFormat.
+//-- The input assembler already converts UNORM, SNORM and half formats to float.
+
+static const uint TANGENT_FRAME_FLOAT = 0;
+static const uint TANGENT_FRAME_OCTAHEDRAL = 1;
+static const uint TANGENT_FRAME_QTANGENT = 2;
+
+struct TangentFrame
+{
+	float3 tangent;
+	float3 bitangent;
+	float3 normal;
+};
+
+float3 decodePosition(float3 position)
+{
+	return position * g_positionScale + g_positionOffset;
+}
+
+float3 decodeOctahedral(float2 value)
+{
+	float3 n = float3(value, 1.0f - abs(value.x) - abs(value.y));
+	float t = saturate(-n.z);
+	n.xy += (1.0f - 2.0f * step(0.0f, n.xy)) * t;
+	return normalize(n);
+}
+
+//-- The bitangent is restored from the handedness stored in the sign of w.
+TangentFrame decodeQTangent(float4 q)
+{
+	q = normalize(q);
+
+	TangentFrame frame;
+	frame.tangent = float3(1.0f - 2.0f * (q.y * q.y + q.z * q.z), 2.0f * (q.x * q.y + q.w * q.z), 2.0f * (q.x * q.z - q.w * q.y));
+	frame.normal = float3(2.0f * (q.x * q.z + q.w * q.y), 2.0f * (q.y * q.z - q.w * q.x), 1.0f - 2.0f * (q.x * q.x + q.y * q.y));
+	frame.bitangent = cross(frame.normal, frame.tangent) * (q.w < 0.0f ? -1.0f : 1.0f);
+	return frame;
+}
+
+//-- The branch is uniform for the whole draw.
+TangentFrame decodeTangentFrame(float4 tangent, float3 bitangent, float3 normal)
+{
+	TangentFrame frame;
+	if (g_tangentFrame == TANGENT_FRAME_QTANGENT)
+	{
+		frame = decodeQTangent(tangent);
+	}
+	else if (g_tangentFrame == TANGENT_FRAME_OCTAHEDRAL)
+	{
+		frame.tangent = decodeOctahedral(tangent.xy);
+		frame.bitangent = decodeOctahedral(bitangent.xy);
+		frame.normal = decodeOctahedral(normal.xy);
+	}
+	else
+	{
+		frame.tangent = tangent.xyz;
+		frame.bitangent = bitangent;
+		frame.normal = normal;
+	}
+
+	return frame;
+}
@@ -1,13 +1,16 @@
 #include <engine/engine.h>
 #include <engine/helpers.h>
 #include <engine/services/assert_service.h>
+#include <engine/services/cache_service.h>
 #include <engine/services/cli_service.h>
 #include <engine/services/editor_service.h>
 #include <engine/services/imgui_service.h>
 #include <engine/services/input_service.h>
+#include <engine/services/job_service.h>
 #include <engine/services/log_service.h>
 #include <engine/services/renderdoc_service.h>
 #include <engine/services/render_service.h>
+#include <engine/services/shader_compiler_service.h>
 #include <engine/services/vfs_service.h>
 #include <engine/services/windows_service.h>
 #include <engine/services/world_service.h>
@@ -25,13 +28,7 @@ Engine& Engine::instance()
 
 bool Engine::initialize(const Config& config)
 {
-	bool initialized = true;
-
-	//-- Some utility stuff.
-	initialized &= m_serviceManager.add<AssertService>();
-	initialized &= m_serviceManager.add<CLIService>(config.cliParams);
-	initialized &= m_serviceManager.add<LogService>();
-	initialized &= m_serviceManager.add<VFSService>(config.vfsParams);
+	bool initialized = initializeCore(config);
 
 	//-- ECS stuff.
 	initialized &= m_serviceManager.add<WorldService>();
@@ -42,6 +39,7 @@ bool Engine::initialize(const Config& config)
 
 	//-- Render stuff.
 	initialized &= m_serviceManager.add<render::RenderDocService>(); //-- Should be initialized before any GAPI initialization.
+	initialized &= m_serviceManager.add<render::ShaderCompilerService>(); //-- Should be before RenderService, because backends compile shaders on initialization.
 	initialized &= m_serviceManager.add<RenderService>(config.renderParams);
 
 	//-- Other (?) stuff.
@@ -52,6 +50,22 @@ bool Engine::initialize(const Config& config)
 }
 
 
+bool Engine::initializeCore(const Config& config)
+{
+	bool initialized = true;
+
+	//-- Some utility stuff.
+	initialized &= m_serviceManager.add<AssertService>();
+	initialized &= m_serviceManager.add<CLIService>(config.cliParams);
+	initialized &= m_serviceManager.add<LogService>();
+	initialized &= m_serviceManager.add<JobService>();
+	initialized &= m_serviceManager.add<VFSService>(config.vfsParams);
+	initialized &= m_serviceManager.add<CacheService>();
+
+	return initialized;
+}
+
+
 void Engine::run()
 {
 	m_run = true;
@@ -49,16 +49,18 @@ public:
 	ENGINE_API static Engine& instance();
 
 	ENGINE_API bool initialize(const Config& config);
+	//-- Only the services which need neither a window nor a GPU, e.g. for tests and tools.
+	ENGINE_API bool initializeCore(const Config& config);
 	ENGINE_API void run();
 	ENGINE_API void stop() { m_run = false; }
+	//-- Called by run() when it stops.
+	ENGINE_API void release();
 
 	ENGINE_API ServiceManager& serviceManager() { return m_serviceManager; }
 
 private:
 	Engine() = default;
 
-	void release();
-
 private:
 	ServiceManager m_serviceManager;
 	bool m_run = false;
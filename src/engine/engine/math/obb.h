@@ -0,0 +1,22 @@
+#pragma once
+
+#include <engine/math.h>
+
+namespace engine::math
+{
+
+//-- Oriented bounding box: a point p is inside if `abs(dot(p - m_center, m_axes[i])) <= m_extents[i]` for every axis.
+class OBB
+{
+public:
+	OBB() = default;
+	explicit OBB(const vec3& min, const vec3& max) : m_center((min + max) * 0.5f), m_extents((max - min) * 0.5f) {}
+
+public:
+	vec3 m_center;
+	vec3 m_extents; //-- Half sizes along the axes.
+	//-- Orthonormal, right-handed.
+	std::array<vec3, 3> m_axes = { vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f), vec3(0.0f, 0.0f, 1.0f) };
+};
+
+} //-- engine::math.
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <engine/math.h>
+
+namespace engine::math
+{
+
+class Sphere
+{
+public:
+	Sphere() = default;
+	explicit Sphere(const vec3& center, const float radius) : m_center(center), m_radius(radius) {}
+
+public:
+	vec3 m_center;
+	float m_radius = 0.0f;
+};
+
+} //-- engine::math.
@@ -2,14 +2,21 @@
 
 #include <array>
 #include <assert.h>
+#include <atomic>
 #include <concepts>
+#include <condition_variable>
+#include <deque>
 #include <intrin.h>
 #include <filesystem>
+#include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
+#include <span>
 #include <vector>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <type_traits>
 
 //-- fmt.
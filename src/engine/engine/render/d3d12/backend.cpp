@@ -2,6 +2,9 @@
 #include <engine/assert.h>
 #include <engine/helpers.h>
 #include <engine/math.h>
+#include <engine/services/shader_compiler_service.h>
+
+#include <bit>
 
 using Microsoft::WRL::ComPtr;
 using namespace std::string_view_literals;
@@ -83,10 +86,34 @@ D3D_FEATURE_LEVEL getHardwareAdapter(
 	return maxFeatureLevel;
 }
 
+constexpr std::string_view kTestMesh = "/meshes/max7_blend_cube_24.obj";
+//-- The animation advances by a fixed step per frame like the rotation of the test scene.
+constexpr float kAnimationFrameTime = 1.0f / 60.0f;
+
 constexpr uint32_t kWidth = 256;
 constexpr uint32_t kHeight = 256;
 constexpr uint32_t kPixelSize = 4;
 
+//-- Vertex inputs of test_shader.hlsl. Every keyword of the shader adds the inputs of its streams.
+using StreamMask = resources::MeshResource::StreamMask;
+using Stream = resources::MeshResource::Stream;
+constexpr StreamMask kTestShaderStreams = resources::MeshResource::streamBit(Stream::Position)
+	| resources::MeshResource::streamBit(Stream::UV0);
+
+struct ShaderKeyword
+{
+	std::string_view name;
+	StreamMask streams;
+};
+
+constexpr std::array kTestShaderKeywords =
+{
+	ShaderKeyword{ "TANGENT_FRAME", static_cast<StreamMask>(resources::MeshResource::streamBit(Stream::Tangent)
+		| resources::MeshResource::streamBit(Stream::Bitangent) | resources::MeshResource::streamBit(Stream::Normal)) },
+	ShaderKeyword{ "UV1", resources::MeshResource::streamBit(Stream::UV1) },
+	ShaderKeyword{ "VERTEX_COLOR", resources::MeshResource::streamBit(Stream::VertexColor) },
+};
+
 //-- Generate a simple black and white checkerboard texture.
 [[maybe_unused]] std::vector<UINT8> generateTextureData()
 {
@@ -144,8 +171,6 @@ bool Backend::initialize(const Desc& desc)
 	};
 #endif
 
-	m_shaderCompiler.initialize();
-
 	uint32_t dxgiFactoryFlags = 0;
 
 	//-- Enable the debug layer (requires the Graphics Tools "optional feature").
@@ -312,7 +337,7 @@ bool Backend::initialize(const Desc& desc)
 	//-- Create a root signature.
 	{
 		CD3DX12_DESCRIPTOR_RANGE1 ranges[2];
-		CD3DX12_ROOT_PARAMETER1 rootParameters[4];
+		CD3DX12_ROOT_PARAMETER1 rootParameters[6];
 
 		//-- Global.
 		rootParameters[0].InitAsConstantBufferView(0, 0);
@@ -330,6 +355,12 @@ bool Backend::initialize(const Desc& desc)
 		ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
 		rootParameters[3].InitAsDescriptorTable(1, &ranges[1], D3D12_SHADER_VISIBILITY_PIXEL);
 
+		//-- Per draw. Vertex decoding constants of the submesh.
+		rootParameters[4].InitAsConstants(sizeof(PerDrawConstants) / sizeof(uint32_t), 3, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+
+		//-- Per mesh. Transforms of the instances, see MeshResource::Mesh::instanceTransforms.
+		rootParameters[5].InitAsShaderResourceView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC, D3D12_SHADER_VISIBILITY_VERTEX);
+
 		//-- static samplers are part of a root signature, but do not count towards the 64 DWORD limit.
 		D3D12_STATIC_SAMPLER_DESC sampler = {};
 		sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_POINT;
@@ -381,49 +412,25 @@ bool Backend::initialize(const Desc& desc)
 		ENGINE_ASSERT(SUCCEEDED(ok));
 	}
 
-	//-- Create the pipeline state, which includes compiling and loading shaders.
+	//-- The input layout depends on the vertex format of the mesh, so load it before the pipeline state.
+	//-- Its buffers are uploaded below with the rest of the initial GPU setup.
+	m_meshResource = std::make_shared<resources::MeshResource>();
+	m_meshResource->load(kTestMesh);
+
+	//-- Animations are imported only from FBX files.
+	if (std::filesystem::path(kTestMesh).extension() == ".fbx")
 	{
-		auto shader = m_shaderCompiler.compile("/shaders/test_shader.hlsl"sv);
-		if (!shader->ready())
-		{
-			ENGINE_FAIL("Can't load the test shader");
-		}
+		m_animationResource = std::make_shared<resources::AnimationResource>();
+		m_animationResource->load(kTestMesh);
+	}
 
-		//-- Define the vertex input layout.
-		D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
-		{
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "BITANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 2, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 3, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 4, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "TEXCOORD", 1, DXGI_FORMAT_R32G32_FLOAT, 5, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 6, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-		};
-		auto vertexShader = shader->shader(resources::ShaderResource::Type::Vertex);
-		auto pixelShader = shader->shader(resources::ShaderResource::Type::Pixel);
-
-		//-- Describe and create the graphics pipeline state object (PSO).
-		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-		psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
-		psoDesc.pRootSignature = m_rootSignature.Get();
-		psoDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.first, vertexShader.second);
-		psoDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.first, pixelShader.second);
-		psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-		psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-		psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
-		psoDesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
-		psoDesc.SampleMask = UINT_MAX;
-		psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-		psoDesc.NumRenderTargets = 1;
-		psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
-		psoDesc.SampleDesc.Count = 1;
-
-		ok = m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pipelineState));
-		ENGINE_ASSERT(SUCCEEDED(ok), "Can't create a PSO.");
-
-		shader->release(); //-- release IDxcBlob memory. Todo: Reconsider later.
+	//-- Compile the base variant of the shader, the variants for the streams of meshes and pipeline states
+	//-- for their vertex layouts are created on the first draw. The bundle doesn't need a pipeline state.
+	if (!m_testShader.load("/shaders/test_shader.hlsl"sv))
+	{
+		ENGINE_FAIL("Can't load the test shader");
 	}
+	ID3D12PipelineState* meshPipelineState = pipelineState(*m_meshResource);
 
 	//-- Create the constant buffers.
 	{
@@ -453,9 +460,38 @@ bool Backend::initialize(const Desc& desc)
 		m_perObjectConstantsAddress = m_perObjectConstants->GetGPUVirtualAddress();
 	}
 
+	//-- Animated data of the mesh, a region per frame.
+	if (m_meshResource->ready())
+	{
+		const bool animated = m_animationResource && m_animationResource->ready() && !m_animationResource->clips().empty();
+		m_animatedInstancesSize = animated ? calculateConstantBufferByteSize(m_meshResource->numInstances() * sizeof(math::matrix)) : 0;
+
+		const auto& vertexFormat = m_meshResource->vertexFormat();
+		const UINT positionStride = resources::MeshResource::streamStride(vertexFormat, Stream::Position);
+		const UINT normalStride = resources::MeshResource::streamStride(vertexFormat, resources::MeshResource::normalStream(vertexFormat));
+		UINT64 blendedVerticesSize = 0;
+		for (const auto& submesh : m_meshResource->m_subMeshes)
+		{
+			blendedVerticesSize += submesh.basePositions.size() * positionStride + submesh.baseNormals.size() * normalStride;
+		}
+		m_blendWeights.assign(m_meshResource->blendChannelWeights().begin(), m_meshResource->blendChannelWeights().end());
+
+		m_animatedDataFrameSize = calculateConstantBufferByteSize(m_animatedInstancesSize + blendedVerticesSize);
+	}
+	if (m_animatedDataFrameSize > 0)
+	{
+		const D3D12_HEAP_PROPERTIES uploadHeapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+		const D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(desc.numBuffers * m_animatedDataFrameSize);
+		assertIfFailed(m_device->CreateCommittedResource(&uploadHeapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(m_animatedData.ReleaseAndGetAddressOf())));
+
+		assertIfFailed(m_animatedData->Map(0, nullptr, &m_animatedDataMapped));
+		m_animatedDataAddress = m_animatedData->GetGPUVirtualAddress();
+	}
+
 	//-- Create and record the bundle.
 	{
-		ok = m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_BUNDLE, m_bundleAllocator.Get(), m_pipelineState.Get(), IID_PPV_ARGS(&m_bundleCommands));
+		ok = m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_BUNDLE, m_bundleAllocator.Get(), meshPipelineState, IID_PPV_ARGS(&m_bundleCommands));
 		ENGINE_ASSERT(SUCCEEDED(ok), "Can't create a bundle command list");
 
 		/*m_bundleCommands->SetGraphicsRootSignature(m_rootSignature.Get());
@@ -548,30 +584,29 @@ bool Backend::initialize(const Desc& desc)
 		m_projectionMatrix = math::matrix::CreatePerspectiveFieldOfView(DirectX::XM_PIDIV4, desc.width / static_cast<float>(desc.height), 0.01f, 100.0f); //-- LH?
 	}
 
-	m_meshResource = std::make_shared<resources::MeshResource>();
-	m_meshResource->load("/meshes/max7_blend_cube_24.obj");
 	{
-		std::array<D3D12_RESOURCE_BARRIER, static_cast<size_t>(resources::MeshResource::Stream::Count) + 1> barriers;
+		const auto& uploads = m_meshResource->m_uploads;
+
+		std::vector<D3D12_RESOURCE_BARRIER> barriers;
+		barriers.reserve(uploads.size());
 		//-- Prepare buffers for copying.
-		for (size_t i = 0; i < barriers.size() - 1; ++i)
+		for (const auto& upload : uploads)
 		{
-			barriers[i] = CD3DX12_RESOURCE_BARRIER::Transition(m_meshResource->m_streams[i].Get(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST);
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(upload.destination, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST));
 		}
-		barriers[7] = CD3DX12_RESOURCE_BARRIER::Transition(m_meshResource->m_indexBuffer.Get(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST);
 		m_commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
 
-		for (size_t i = 0; i < barriers.size() - 1; ++i)
+		for (const auto& upload : uploads)
 		{
-			m_commandList->CopyBufferRegion(m_meshResource->m_streams[i].Get(), 0, m_meshResource->m_uploadBuffers[i].Get(), 0, m_meshResource->m_streamsSize[i]);
+			m_commandList->CopyBufferRegion(upload.destination, 0, upload.source, 0, upload.size);
 		}
-		m_commandList->CopyBufferRegion(m_meshResource->m_indexBuffer.Get(), 0, m_meshResource->m_uploadIndexBuffer.Get(), 0, m_meshResource->m_indexBufferSize);
 
 		//-- Set buffers to the right state.
-		for (size_t i = 0; i < barriers.size() - 1; ++i)
+		barriers.clear();
+		for (const auto& upload : uploads)
 		{
-			barriers[i] = CD3DX12_RESOURCE_BARRIER::Transition(m_meshResource->m_streams[i].Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(upload.destination, D3D12_RESOURCE_STATE_COPY_DEST, upload.state));
 		}
-		barriers[7] = CD3DX12_RESOURCE_BARRIER::Transition(m_meshResource->m_indexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER);
 		m_commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
 	}
 
@@ -614,8 +649,12 @@ void Backend::release()
 	m_testTexture.Reset();
 	m_perCameraConstants.Reset();
 	m_perObjectConstants.Reset();
+	m_animatedData.Reset();
 	m_renderTargets.clear();
 	m_meshResource.reset();
+	m_animationResource.reset();
+	m_pipelineStates.clear();
+	m_testShader.release();
 
 	m_swapChain.Reset();
 	m_memoryAllocator->Release();
@@ -659,6 +698,100 @@ void Backend::moveToNextFrame()
 }
 
 
+ID3D12PipelineState* Backend::pipelineState(const resources::MeshResource& mesh)
+{
+	//-- The mesh enables the keywords whose streams it has. While its variant compiles, a variant with fewer keywords is used.
+	ShaderPermutations::Key key = 0;
+	for (const auto& keyword : kTestShaderKeywords)
+	{
+		if ((mesh.streamMask() & keyword.streams) == keyword.streams)
+		{
+			key |= m_testShader.keywordBit(keyword.name);
+		}
+	}
+
+	ShaderPermutations::Key resolvedKey = 0;
+	const auto shader = m_testShader.variant(key, resolvedKey);
+	if (!shader)
+	{
+		return nullptr;
+	}
+
+	const uint64_t pipelineKey = (static_cast<uint64_t>(std::bit_cast<uint32_t>(mesh.vertexFormat())) << 32)
+		| (static_cast<uint64_t>(resolvedKey) << 16) | mesh.streamMask();
+	auto& pipelineState = m_pipelineStates[pipelineKey];
+	if (pipelineState)
+	{
+		return pipelineState.Get();
+	}
+
+	//-- Define the vertex input layout of the variant. The input assembler converts compact formats to float.
+	StreamMask shaderStreams = kTestShaderStreams;
+	for (const auto& keyword : kTestShaderKeywords)
+	{
+		if (resolvedKey & m_testShader.keywordBit(keyword.name))
+		{
+			shaderStreams |= keyword.streams;
+		}
+	}
+
+	const auto inputLayout = mesh.inputLayout(shaderStreams);
+	auto vertexShader = shader->shader(resources::ShaderResource::Type::Vertex);
+	auto pixelShader = shader->shader(resources::ShaderResource::Type::Pixel);
+
+	//-- Describe and create the graphics pipeline state object (PSO).
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+	psoDesc.InputLayout = { inputLayout.elements.data(), inputLayout.numElements };
+	psoDesc.pRootSignature = m_rootSignature.Get();
+	psoDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.first, vertexShader.second);
+	psoDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.first, pixelShader.second);
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+	psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+	psoDesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	psoDesc.SampleMask = UINT_MAX;
+	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	psoDesc.NumRenderTargets = 1;
+	psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	psoDesc.SampleDesc.Count = 1;
+
+	const HRESULT ok = m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineState));
+	ENGINE_ASSERT(SUCCEEDED(ok), "Can't create a PSO.");
+
+	return pipelineState.Get();
+}
+
+
+void Backend::updateAnimation()
+{
+	ENGINE_CPU_ZONE;
+
+	//-- The first clip loops.
+	if (m_animatedInstancesSize > 0)
+	{
+		const auto& clip = m_animationResource->clips().front();
+		m_animationTime += kAnimationFrameTime;
+		if (m_animationTime > clip.duration)
+		{
+			m_animationTime = clip.duration > 0.0f ? std::fmod(m_animationTime, clip.duration) : 0.0f;
+		}
+
+		m_poseSampler.sample(clip, m_animationTime, m_pose);
+		m_meshResource->applyPose(m_pose);
+
+		auto* instances = reinterpret_cast<math::matrix*>(static_cast<uint8_t*>(m_animatedDataMapped) + m_frameIndex * m_animatedDataFrameSize);
+		m_meshResource->writeInstanceTransforms({ instances, m_meshResource->numInstances() });
+	}
+
+	//-- Clips don't carry weight curves, so every channel sweeps between zero and one with its own phase.
+	m_blendTime = std::fmod(m_blendTime + kAnimationFrameTime, math::k2Pi);
+	for (size_t i = 0; i < m_blendWeights.size(); ++i)
+	{
+		m_blendWeights[i] = 0.5f - 0.5f * std::cos(m_blendTime + static_cast<float>(i));
+	}
+}
+
+
 void Backend::present()
 {
 	ENGINE_CPU_ZONE;
@@ -682,6 +815,14 @@ void Backend::present()
 
 	//-- RENDER PART. TODO: MOVE OUT TO THE SYSTEMS.
 	{
+		//-- A variant of the shader is hot reloaded, the old pipeline states are released once the GPU is done with them.
+		if (m_testShader.version() != m_testShaderVersion)
+		{
+			waitForGPU();
+			m_pipelineStates.clear();
+			m_testShaderVersion = m_testShader.version();
+		}
+
 		//-- We use a single command allocator to manage the memory space where drawing commands for both buffers in the swap chain are recorded.
 		//-- This implies that we need to flush the command queue before recording the commands to create and present a new frame,
 		//-- as all commands are recorded in the same memory space regardless of the frame we are creating
@@ -697,7 +838,6 @@ void Backend::present()
 		//-- that command list can then be reset at any time and must be before re-recording.
 		ok = m_commandList->Reset(m_frameCommandAllocators[m_frameIndex].Get(), nullptr);
 		ENGINE_ASSERT_DEBUG(SUCCEEDED(ok));
-		m_commandList->SetPipelineState(m_pipelineState.Get()); //-- Or we can reset to this PSO.
 
 		//-- Root Signature.
 		m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
@@ -773,15 +913,93 @@ void Backend::present()
 		m_commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
 
 		//m_commandList->ExecuteBundle(m_bundleCommands.Get());
-		if (m_meshResource->ready())
+		ID3D12PipelineState* meshPipelineState = m_meshResource->ready() ? pipelineState(*m_meshResource) : nullptr;
+		if (meshPipelineState)
 		{
+			m_commandList->SetPipelineState(meshPipelineState);
 			m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			for (auto& submesh : m_meshResource->m_subMeshes)
+
+			//-- Projected size of one object space unit is `height / 2 * cot(fov / 2) * scale / distance`.
+			const math::matrix worldView = m_worldMatrix * m_viewMatrix;
+			const float worldScale = math::vec3(m_worldMatrix._11, m_worldMatrix._12, m_worldMatrix._13).Length();
+			const float pixelsPerUnitAtOne = m_viewport.Height * 0.5f * m_projectionMatrix._22 * worldScale;
+
+			updateAnimation();
+			const UINT64 animatedDataOffset = m_frameIndex * m_animatedDataFrameSize;
+			UINT64 blendedVerticesOffset = animatedDataOffset + m_animatedInstancesSize;
+
+			//-- Every mesh is drawn with a single instanced draw per submesh, no matter how many nodes refer to it.
+			const auto& nodes = m_meshResource->nodes();
+			for (const auto& mesh : m_meshResource->meshes())
 			{
-				//-- ToDo: We may store streamviews and indexbuffer outside of submesh and setup it once, instead of per submesh.
-				m_commandList->IASetVertexBuffers(0, static_cast<UINT>(submesh.renderPart.streamViews.size()), submesh.renderPart.streamViews.data());
-				m_commandList->IASetIndexBuffer(&submesh.renderPart.indexBufferView);
-				m_commandList->DrawIndexedInstanced(submesh.renderPart.numIndices, 1, submesh.renderPart.startIndex, submesh.renderPart.baseVertex, 0);
+				if (mesh.instances.empty())
+				{
+					continue;
+				}
+
+				m_commandList->SetGraphicsRootShaderResourceView(5, m_animatedInstancesSize > 0
+					? m_animatedDataAddress + animatedDataOffset + mesh.firstInstance * sizeof(math::matrix) : mesh.instanceTransforms);
+
+				//-- All instances share the levels of the nearest one.
+				const math::vec3 center = (mesh.aabb.m_min + mesh.aabb.m_max) * 0.5f;
+				float distance = std::numeric_limits<float>::max();
+				for (uint32_t node : mesh.instances)
+				{
+					distance = std::min(distance, math::vec3::Transform(center, nodes[node].geometryToWorld * worldView).Length());
+				}
+				distance = std::max(distance, 0.01f);
+
+				for (uint32_t submeshId = mesh.firstSubmesh; submeshId < mesh.firstSubmesh + mesh.numSubmeshes; ++submeshId)
+				{
+					const auto& submesh = m_meshResource->m_subMeshes[submeshId];
+
+					//-- Submeshes with blend shapes read the positions and the normals blended for the frame. The region holds only
+					//-- the vertices of the submesh, so all its views start at the base vertex and the draw doesn't offset them.
+					auto streamViews = submesh.renderPart.streamViews;
+					UINT baseVertex = submesh.renderPart.baseVertex;
+					if (!submesh.basePositions.empty())
+					{
+						for (auto& view : streamViews)
+						{
+							if (view.BufferLocation != 0)
+							{
+								view.BufferLocation += baseVertex * view.StrideInBytes;
+								view.SizeInBytes -= baseVertex * view.StrideInBytes;
+							}
+						}
+
+						//-- Points the view to the next part of the frame region and returns the part.
+						auto blendedView = [this, &blendedVerticesOffset, numVertices = static_cast<UINT>(submesh.basePositions.size())](D3D12_VERTEX_BUFFER_VIEW& view)
+							{
+								const UINT size = numVertices * view.StrideInBytes;
+								const std::span<uint8_t> bytes(static_cast<uint8_t*>(m_animatedDataMapped) + blendedVerticesOffset, size);
+								view = { .BufferLocation = m_animatedDataAddress + blendedVerticesOffset, .SizeInBytes = size, .StrideInBytes = view.StrideInBytes };
+								blendedVerticesOffset += size;
+								return bytes;
+							};
+
+						const auto positions = blendedView(streamViews[static_cast<size_t>(Stream::Position)]);
+						const auto normalStream = resources::MeshResource::normalStream(m_meshResource->vertexFormat());
+						const auto normals = submesh.baseNormals.empty() ? std::span<uint8_t>() : blendedView(streamViews[static_cast<size_t>(normalStream)]);
+						m_meshResource->blendVertices(submesh, m_blendWeights, positions, normals);
+						baseVertex = 0;
+					}
+
+					//-- ToDo: We may store streamviews and indexbuffer outside of submesh and setup it once, instead of per submesh.
+					m_commandList->IASetVertexBuffers(0, static_cast<UINT>(streamViews.size()), streamViews.data());
+					m_commandList->IASetIndexBuffer(&submesh.renderPart.indexBufferView);
+
+					const PerDrawConstants perDraw =
+					{
+						.positionScale = submesh.renderPart.positionScale,
+						.tangentFrame = static_cast<uint32_t>(m_meshResource->vertexFormat().tangentFrame),
+						.positionOffset = submesh.renderPart.positionOffset
+					};
+					m_commandList->SetGraphicsRoot32BitConstants(4, sizeof(perDraw) / sizeof(uint32_t), &perDraw, 0);
+
+					const auto& lod = submesh.lods[resources::MeshResource::selectLod(submesh, pixelsPerUnitAtOne / distance)];
+					m_commandList->DrawIndexedInstanced(lod.numIndices, static_cast<UINT>(mesh.instances.size()), lod.startIndex, baseVertex, 0);
+				}
 			}
 		}
 
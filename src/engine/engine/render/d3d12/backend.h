@@ -1,10 +1,11 @@
 #pragma once
 
 #include <engine/render/render_backend.h>
-#include <engine/render/d3d12/shader_compiler.h>
 #include <engine/integration/d3d12/integration.h>
 #include <engine/math.h>
+#include <engine/resources/animation_resource.h>
 #include <engine/resources/mesh_resource.h>
+#include <engine/render/shader_permutations.h>
 
 namespace engine::render::d3d12
 {
@@ -27,6 +28,12 @@ private:
 	//-- Only waits until the GPU finishes drawing at least (the oldest) one of the frames queued.
 	//-- In other words, it checks if we can continue creating frames on the CPU timeline.
 	void moveToNextFrame();
+	//-- The pipeline state matching the vertex format and the streams of the mesh, created on the first use.
+	//-- Null until a variant of the shader for the mesh is compiled.
+	ID3D12PipelineState* pipelineState(const resources::MeshResource& mesh);
+	//-- Advances the animation of the mesh: the first clip of its scene moves the nodes, whose instance transforms are written
+	//-- to the animated data of the frame, and the blend channels sweep their weights.
+	void updateAnimation();
 
 private:
 	struct PerCameraCB
@@ -41,6 +48,14 @@ private:
 		math::matrix world;
 	};
 
+	//-- Root constants, see PerDraw in common.h.
+	struct PerDrawConstants
+	{
+		math::vec3 positionScale;
+		uint32_t tangentFrame;
+		math::vec3 positionOffset;
+	};
+
 	using Resources = std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>;
 	using CommandAllocators = std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>>;
 
@@ -58,7 +73,10 @@ private:
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_bundleCommands;
 
 	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_rootSignature;
-	Microsoft::WRL::ComPtr<ID3D12PipelineState> m_pipelineState;
+	//-- Keyed by the vertex format in bits 32-63, the resolved variant in bits 16-31 and the stream mask in bits 0-15.
+	std::unordered_map<uint64_t, Microsoft::WRL::ComPtr<ID3D12PipelineState>> m_pipelineStates;
+	ShaderPermutations m_testShader;
+	uint32_t m_testShaderVersion = 0; //-- Of the variants which the pipeline states are made of.
 
 	CD3DX12_VIEWPORT m_viewport;
 	CD3DX12_RECT m_scissorRect;
@@ -72,6 +90,21 @@ private:
 	Microsoft::WRL::ComPtr<ID3D12Resource> m_testTexture;
 
 	resources::MeshResourcePtr m_meshResource;
+	//-- Animation of the scene of the mesh. Null if the source format has none.
+	resources::AnimationResourcePtr m_animationResource;
+	resources::animation::PoseSampler m_poseSampler;
+	resources::animation::Pose m_pose;
+	float m_animationTime = 0.0f;
+	std::vector<float> m_blendWeights;
+	float m_blendTime = 0.0f;
+
+	//-- Per frame copies of the animated data of the mesh in the upload heap, like the constant buffers: the instance transforms
+	//-- if the scene has an animation, then the blended positions and normals of the submeshes with blend shapes.
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_animatedData;
+	D3D12_GPU_VIRTUAL_ADDRESS m_animatedDataAddress = 0;
+	void* m_animatedDataMapped = nullptr;
+	UINT64 m_animatedDataFrameSize = 0;
+	UINT64 m_animatedInstancesSize = 0; //-- Zero if the instances aren't animated.
 
 	//-- Should be part of ContanstBufferResource.
 	Microsoft::WRL::ComPtr<ID3D12Resource> m_perCameraConstants;
@@ -89,9 +122,6 @@ private:
 	HANDLE m_fenceEvent = NULL;
 	std::vector<UINT64> m_fenceValues;
 
-	//-- ToDo: Reconsider later. Perhaps it should be part of ShaderResourceManager.
-	ShaderCompiler m_shaderCompiler;
-
 	//-- TODO REMOVE
 	// Scene constants, updated per-frame
 	float m_curRotationAngleRad = 0.0f;
@@ -0,0 +1,114 @@
+#include <engine/render/d3d12/shader_cache.h>
+#include <engine/helpers.h>
+
+#include <fstream>
+
+namespace engine::render::d3d12::shader_cache
+{
+
+bool write(const std::filesystem::path& path, std::span<const Include> includes, std::span<const uint8_t> bytecode)
+{
+	ENGINE_CPU_ZONE;
+
+	Header header;
+	header.numIncludes = static_cast<uint32_t>(includes.size());
+	header.bytecodeSize = static_cast<uint32_t>(bytecode.size());
+
+	//-- Several compilers may store the same entry at once, so every thread writes its own temporary file.
+	std::filesystem::path tmpPath = path;
+	tmpPath += fmt::format(".{:x}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+	{
+		std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			logger().warning(fmt::format("[shader_cache]: Can't create the file '{}'", tmpPath.string()));
+			return false;
+		}
+
+		//-- Every include is the length of the path, the path and the content hash.
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		for (const auto& include : includes)
+		{
+			const uint32_t length = static_cast<uint32_t>(include.path.size());
+			file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+			file.write(include.path.data(), length);
+			file.write(reinterpret_cast<const char*>(&include.hash), sizeof(include.hash));
+		}
+		file.write(reinterpret_cast<const char*>(bytecode.data()), static_cast<std::streamsize>(bytecode.size()));
+
+		if (!file)
+		{
+			logger().warning(fmt::format("[shader_cache]: Can't write the file '{}'", tmpPath.string()));
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tmpPath, path, error);
+	if (error)
+	{
+		logger().warning(fmt::format("[shader_cache]: Can't rename '{}' to '{}': {}", tmpPath.string(), path.string(), error.message()));
+		std::filesystem::remove(tmpPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+
+bool read(std::span<const uint8_t> file, std::vector<Include>& includes, std::span<const uint8_t>& bytecode)
+{
+	ENGINE_CPU_ZONE;
+
+	Header header;
+	if (file.size() < sizeof(Header))
+	{
+		return false;
+	}
+
+	std::memcpy(&header, file.data(), sizeof(header));
+	const size_t minIncludeSize = sizeof(uint32_t) + sizeof(utils::ContentHash);
+	if (header.magic != kMagic || header.version != kVersion || header.numIncludes > (file.size() - sizeof(Header)) / minIncludeSize)
+	{
+		return false;
+	}
+
+	size_t offset = sizeof(Header);
+	auto readBytes = [&file, &offset](void* bytes, const size_t size)
+		{
+			if (size > file.size() - offset)
+			{
+				return false;
+			}
+
+			std::memcpy(bytes, file.data() + offset, size);
+			offset += size;
+			return true;
+		};
+
+	includes.resize(header.numIncludes);
+	for (auto& include : includes)
+	{
+		uint32_t length = 0;
+		if (!readBytes(&length, sizeof(length)) || length > file.size() - offset)
+		{
+			return false;
+		}
+
+		include.path.resize(length);
+		if (!readBytes(include.path.data(), length) || !readBytes(&include.hash, sizeof(include.hash)))
+		{
+			return false;
+		}
+	}
+
+	if (header.bytecodeSize == 0 || header.bytecodeSize != file.size() - offset)
+	{
+		return false;
+	}
+
+	bytecode = file.subspan(offset, header.bytecodeSize);
+	return true;
+}
+
+} //-- engine::render::d3d12::shader_cache.
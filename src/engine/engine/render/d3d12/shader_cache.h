@@ -0,0 +1,39 @@
+#pragma once
+
+#include <engine/utils/content_hash.h>
+
+//-- Cached compiled shader stage (.ashader).
+//-- The file is a header, the includes the stage was compiled with and the bytecode. Entries are keyed by the source,
+//-- the compiler arguments and the compiler version, the includes can't be known before compiling, so they are stored
+//-- with their content hashes and validated on load.
+namespace engine::render::d3d12::shader_cache
+{
+
+inline constexpr uint32_t kMagic = 0x53485341; //-- "ASHS".
+//-- Bump every time the layout of the file changes.
+inline constexpr uint32_t kVersion = 1;
+inline constexpr std::string_view kExtension = ".ashader";
+
+struct Header
+{
+	uint32_t magic = kMagic;
+	uint32_t version = kVersion;
+	uint32_t numIncludes = 0;
+	uint32_t bytecodeSize = 0;
+};
+static_assert(std::is_trivially_copyable_v<Header>);
+
+struct Include
+{
+	std::string path; //-- Absolute.
+	utils::ContentHash hash;
+};
+
+//-- Writes the entry. The file is written to a temporary file first and renamed,
+//-- so a reader never observes a partially written file.
+bool write(const std::filesystem::path& path, std::span<const Include> includes, std::span<const uint8_t> bytecode);
+
+//-- Validates the file contents and points the bytecode into them. The bytecode is valid while the contents are alive.
+bool read(std::span<const uint8_t> file, std::vector<Include>& includes, std::span<const uint8_t>& bytecode);
+
+} //-- engine::render::d3d12::shader_cache.
@@ -2,57 +2,68 @@
 #include <engine/assert.h>
 #include <engine/helpers.h>
 #include <engine/render/d3d12/shader_resource.h>
+#include <engine/services/cache_service.h>
 #include <engine/services/vfs_service.h>
+#include <engine/utils/mapped_file.h>
 #include <engine/utils/string.h>
 
 namespace engine::render::d3d12
 {
 
-namespace
+using Microsoft::WRL::ComPtr;
+
+ShaderCompiler::ShaderCompiler(ShaderIncludeCache& includeCache)
+	: m_includeHandler(includeCache)
 {
+}
+
 
-//-- https://simoncoenen.com/blog/programming/graphics/DxcCompiling
-//-- This is useful if you want to add some custom include logic or if you want to know
-//-- which files were included to do some kind of shader hot-reloading.
-//-- Here's an example implementation that correctly loads include sources and
-//-- makes sure not to include the same file twice.
-//-- To add include directories, use the -I argument like for example -I /Resources/Shaders.
-/*class CustomIncludeHandler : public IDxcIncludeHandler
+HRESULT ShaderCompiler::IncludeHandler::LoadSource(LPCWSTR filename, IDxcBlob** includeSource)
 {
-public:
-	HRESULT STDMETHODCALLTYPE LoadSource(_In_ LPCWSTR pFilename, _COM_Outptr_result_maybenull_ IDxcBlob** ppIncludeSource) override
+	*includeSource = nullptr;
+
+	//-- The compiler probes the folder of the shader and every include folder, missing candidates are fine.
+	const auto file = m_cache.load(filename);
+	if (!file)
 	{
-		ComPtr<IDxcBlobEncoding> pEncoding;
-		std::string path = Paths::Normalize(UNICODE_TO_MULTIBYTE(pFilename));
-		if (IncludedFiles.find(path) != IncludedFiles.end())
-		{
-			// Return empty string blob if this file has been included before
-			static const char nullStr[] = " ";
-			pUtils->CreateBlobFromPinned(nullStr, ARRAYSIZE(nullStr), DXC_CP_ACP, pEncoding.GetAddressOf());
-			*ppIncludeSource = pEncoding.Detach();
-			return S_OK;
-		}
+		return E_FAIL;
+	}
 
-		HRESULT hr = pUtils->LoadFile(pFilename, nullptr, pEncoding.GetAddressOf());
-		if (SUCCEEDED(hr))
+	ComPtr<IDxcBlobEncoding> blob;
+	const HRESULT ok = m_utils->CreateBlob(file->bytes.data(), static_cast<UINT32>(file->bytes.size()), DXC_CP_ACP, &blob);
+	if (FAILED(ok))
+	{
+		return ok;
+	}
+
+	std::string path = ShaderIncludeCache::normalize(filename);
+	const bool recorded = std::any_of(m_includes.begin(), m_includes.end(), [&path](const shader_cache::Include& include)
 		{
-			IncludedFiles.insert(path);
-			*ppIncludeSource = pEncoding.Detach();
-		}
-		return hr;
+			return include.path == path;
+		});
+
+	if (!recorded)
+	{
+		m_includes.push_back({ .path = std::move(path), .hash = file->hash });
 	}
 
-	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, _COM_Outptr_ void __RPC_FAR* __RPC_FAR* ppvObject) override { return E_NOINTERFACE; }
-	ULONG STDMETHODCALLTYPE AddRef(void) override { return 0; }
-	ULONG STDMETHODCALLTYPE Release(void) override { return 0; }
+	*includeSource = blob.Detach();
+	return S_OK;
+}
 
-	std::unordered_set<std::string> IncludedFiles;
-};*/
 
-} //-- unnamed.
+HRESULT ShaderCompiler::IncludeHandler::QueryInterface(REFIID riid, void** object)
+{
+	if (riid == __uuidof(IDxcIncludeHandler) || riid == __uuidof(IUnknown))
+	{
+		*object = static_cast<IDxcIncludeHandler*>(this);
+		return S_OK;
+	}
 
+	*object = nullptr;
+	return E_NOINTERFACE;
+}
 
-using Microsoft::WRL::ComPtr;
 
 bool ShaderCompiler::initialize()
 {
@@ -60,12 +71,34 @@ bool ShaderCompiler::initialize()
 	ok = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(m_utils.ReleaseAndGetAddressOf()));
 	ENGINE_ASSERT(SUCCEEDED(ok), "[ShaderCompiler]: Can't create an instance of dxc utils.");
 
-	ok = m_utils->CreateDefaultIncludeHandler(m_includeHandler.ReleaseAndGetAddressOf());
-	ENGINE_ASSERT(SUCCEEDED(ok), "[ShaderCompiler]: Can't create an instance of dxc include handler.");
+	m_includeHandler.initialize(m_utils.Get());
 
 	ok = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&m_compiler));
 	ENGINE_ASSERT(SUCCEEDED(ok), "[ShaderCompiler]: Can't create an instance of dxc compiler.");
 
+	//-- The version and the commit of the compiler, cached bytecode of other compilers is never reused.
+	{
+		UINT32 major = 0;
+		UINT32 minor = 0;
+		ComPtr<IDxcVersionInfo> versionInfo;
+		if (SUCCEEDED(m_compiler.As(&versionInfo)))
+		{
+			versionInfo->GetVersion(&major, &minor);
+		}
+
+		UINT32 commitCount = 0;
+		char* commitHash = nullptr;
+		ComPtr<IDxcVersionInfo2> versionInfo2;
+		if (SUCCEEDED(m_compiler.As(&versionInfo2)))
+		{
+			versionInfo2->GetCommitInfo(&commitCount, &commitHash);
+		}
+
+		m_compilerVersion = fmt::format("{}.{}.{}-{}", major, minor, commitCount, commitHash ? commitHash : "unknown");
+		CoTaskMemFree(commitHash);
+		logger().info(fmt::format("[ShaderCompiler]: dxc {}", m_compilerVersion));
+	}
+
 	//-- default arguments for compiler.
 	{
 		//-- -Fc <file>
@@ -108,97 +141,57 @@ bool ShaderCompiler::initialize()
 }
 
 
-resources::ShaderResourcePtr ShaderCompiler::compile(std::string_view path)
+bool ShaderCompiler::readSource(std::string_view path, Blob& blob, std::string& absolutePath)
 {
-	using ShaderType = resources::ShaderResource::Type;
-
-	auto resource = std::make_shared<ShaderResource>();
-	resource->m_shaders.resize(static_cast<size_t>(ShaderType::Count));
-
-	logger().info(fmt::format("[ShaderCompiler]: load the shader '{}'", path));
-
-	Blob blob;
 	auto& vfs = service<VFSService>();
-	std::bitset<static_cast<size_t>(ShaderType::Count)> enabledShaders;
-	//-- Preparse the file, read existed entry points and compile only them.
-	{
-		if (auto file = vfs.openFile(path))
-		{
-			blob.initialize(file->Size());
-			file->Read(blob.m_data, blob.size());
-		}
-		else
-		{
-			logger().error(fmt::format("[ShaderCompiler]: can't open the file '{}'", path));
-			return resource;
-		}
-
-		std::string_view shader(reinterpret_cast<const char*>(blob.m_data.data()), blob.size());
-		size_t offset = 0;
-		while (true)
-		{
-			size_t pos = shader.find("_main", offset);
-			if (pos == shader.npos)
-			{
-				break;
-			}
-
-			//-- ToDo: Reconsider later.
-			if (shader.compare(pos - 2, 2, "vs"))
-			{
-				enabledShaders.set(static_cast<uint8_t>(ShaderType::Vertex), true);
-			}
-			else if (shader.compare(pos - 2, 2, "ps"))
-			{
-				enabledShaders.set(static_cast<uint8_t>(ShaderType::Pixel), true);
-			}
-			else if (shader.compare(pos - 2, 2, "cs"))
-			{
-				enabledShaders.set(static_cast<uint8_t>(ShaderType::Compute), true);
-			}
-			else if (shader.compare(pos - 2, 2, "as"))
-			{
-				enabledShaders.set(static_cast<uint8_t>(ShaderType::Amplification), true);
-			}
-			else if (shader.compare(pos - 2, 2, "ms"))
-			{
-				enabledShaders.set(static_cast<uint8_t>(ShaderType::Mesh), true);
-			}
-			offset = pos + 1;
-		}
-
-		ENGINE_ASSERT(enabledShaders.any(), "Shader doesn't include any entry points (vs_main, ps_main, cs_main, ms_main)");
-	}
-	std::string absolutePath = vfs.absolutePath(path);
-
-	bool compiled = true;
-	for (uint8_t i = 0; i < static_cast<uint8_t>(ShaderType::Count); ++i)
+	if (auto file = vfs.openFile(path))
 	{
-		if (enabledShaders.test(i))
-		{
-			compiled &= compile(blob, absolutePath, static_cast<ShaderType>(i), *resource);
-		}
+		blob.initialize(file->Size());
+		file->Read(blob.m_data, blob.size());
 	}
-
-	if (compiled)
+	else
 	{
-		resource->setStatus(resources::IResource::Status::Ready);
+		logger().error(fmt::format("[ShaderCompiler]: can't open the file '{}'", path));
+		return false;
 	}
 
-	return resource;
+	absolutePath = vfs.absolutePath(path);
+	return true;
 }
 
-bool ShaderCompiler::compile(const Blob& blob, const std::string& absolutePath, resources::ShaderResource::Type type, ShaderResource& resource)
+
+bool ShaderCompiler::compile(const Blob& blob, const std::string& absolutePath, const ShaderPrescan& prescan, resources::ShaderResource::Type type,
+	std::span<const std::string> defines, ShaderResource& resource)
 {
+	static constexpr std::array<std::string_view, static_cast<uint8_t>(resources::ShaderResource::Type::Count)> kStages = { "vertex", "pixel", "compute", "amplification", "mesh" };
 	static constexpr std::array<LPCWSTR, static_cast<uint8_t>(resources::ShaderResource::Type::Count)> kPostfixes = { L".vs", L".ps", L".cs", L".as", L".ms"};
 	static constexpr std::array<LPCWSTR, static_cast<uint8_t>(resources::ShaderResource::Type::Count)> kEntryPoints = { L"vs_main", L"ps_main", L"cs_main", L"as_main", L"ms_main"};
 	//-- Agility SDK 615 supports 6_8. Without it we have to switch to 6_5.
 	static constexpr std::array<LPCWSTR, static_cast<uint8_t>(resources::ShaderResource::Type::Count)> kTargets = { L"vs_6_8", L"ps_6_8", L"cs_6_8", L"as_6_8", L"ms_6_8"};
 
+	m_skipped = false;
 	std::wstring wPath = utils::convertToWideString(absolutePath.data());
 
 	std::wstring wShaderFolder = utils::convertToWideString(service<VFSService>().absolutePath("/shaders"));
-	std::wstring postfixesPath = wPath + kPostfixes[static_cast<uint8_t>(type)];
+	std::vector<std::wstring> wDefines;
+	wDefines.reserve(defines.size());
+	for (const auto& define : defines)
+	{
+		wDefines.push_back(utils::convertToWideString(define));
+	}
+
+	//-- Variants with defines get their own outputs.
+	std::wstring postfixesPath = wPath;
+	if (!defines.empty())
+	{
+		utils::ContentHasher hasher;
+		for (const auto& define : defines)
+		{
+			hasher.update(define);
+		}
+		postfixesPath += utils::convertToWideString(fmt::format(".{}", hasher.digest().toString().substr(0, 8)));
+	}
+	postfixesPath += kPostfixes[static_cast<uint8_t>(type)];
 	std::wstring pdbPath = postfixesPath + L".pdb";
 	std::wstring reflectionPath = postfixesPath + L".rfl";
 	std::wstring rootSignaturePath = postfixesPath + L".rs";
@@ -209,9 +202,18 @@ bool ShaderCompiler::compile(const Blob& blob, const std::string& absolutePath,
 
 		m_shaderArguments = m_commonArguments;
 
+		//-- The name of the source, so relative includes are resolved against its folder.
+		m_shaderArguments.push_back(wPath.data());
+
 		m_shaderArguments.push_back(L"-I");
 		m_shaderArguments.push_back(wShaderFolder.data()); //-- ToDo: Reconsider later.
 
+		for (const auto& define : wDefines)
+		{
+			m_shaderArguments.push_back(L"-D");
+			m_shaderArguments.push_back(define.data());
+		}
+
 		//-- Strip all info.
 		//-- Debug.
 		{
@@ -221,7 +223,8 @@ bool ShaderCompiler::compile(const Blob& blob, const std::string& absolutePath,
 		{
 			m_shaderArguments.push_back(L"-Qstrip_priv");
 		}
-		//-- Root signature.
+		//-- Root signature. Only entry points with the attribute have one to extract.
+		if (!prescan.entryPoints[static_cast<uint8_t>(type)].rootSignature.empty())
 		{
 			m_shaderArguments.push_back(L"-Qstrip_rootsignature");
 			m_shaderArguments.push_back(L"-Frs");
@@ -255,6 +258,33 @@ bool ShaderCompiler::compile(const Blob& blob, const std::string& absolutePath,
 		m_shaderArguments.push_back(kTargets[static_cast<uint8_t>(type)]);
 	}
 
+	//-- Entries are keyed by the tokens of the source with the includes the prescan found, so edits of comments and spaces
+	//-- which keep the lines reuse them, and by the arguments, which cover the defines, the entry point and the target. Includes the compiler
+	//-- actually opens are known only after compiling, so they are stored in the entry and validated on load.
+	auto& cache = service<CacheService>();
+	std::filesystem::path entryPath;
+	if (cache.enabled())
+	{
+		ENGINE_CPU_ZONE_NAMED("ShaderCompiler::lookupCache");
+
+		utils::ContentHasher hasher;
+		hasher.update({ reinterpret_cast<const uint8_t*>(&prescan.hash), sizeof(prescan.hash) })
+			.update(m_compilerVersion).update(shader_cache::kVersion);
+		for (LPCWSTR argument : m_shaderArguments)
+		{
+			//-- With the terminator, so consecutive arguments are separated.
+			hasher.update({ reinterpret_cast<const uint8_t*>(argument), (std::wcslen(argument) + 1) * sizeof(wchar_t) });
+		}
+		entryPath = cache.entryPath("shaders", hasher.digest(), shader_cache::kExtension);
+
+		if (loadCached(entryPath, resource.m_shaders[static_cast<uint8_t>(type)]))
+		{
+			logger().info(fmt::format("[ShaderCompiler]: The {} stage of '{}' is loaded from the cache entry '{}'.",
+				kStages[static_cast<uint8_t>(type)], absolutePath, entryPath.filename().string()));
+			return true;
+		}
+	}
+
 	HRESULT ok = S_OK;
 #if 1
 	//-- Open source file.
@@ -277,21 +307,36 @@ bool ShaderCompiler::compile(const Blob& blob, const std::string& absolutePath,
 	sourceBuffer.Encoding = 0;
 #endif
 
+	m_includeHandler.reset();
+
 	ComPtr<IDxcResult> result;
 	ok = m_compiler->Compile(&sourceBuffer, m_shaderArguments.data(), static_cast<UINT32>(m_shaderArguments.size()),
-		m_includeHandler.Get(), IID_PPV_ARGS(&result));
-	result->GetStatus(&ok);
+		&m_includeHandler, IID_PPV_ARGS(&result));
+	HRESULT status = S_OK;
+	result->GetStatus(&status);
 
-	//-- Errors.
+	//-- Errors. The prescan doesn't evaluate conditional blocks, so an entry point inside them may be gone after preprocessing.
 	{
 		ComPtr<IDxcBlobUtf8> errorMsgs;
 		result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&errorMsgs), nullptr);
-		if (errorMsgs && errorMsgs->GetStringLength())
+		const std::string_view errors = errorMsgs ? std::string_view(errorMsgs->GetStringPointer(), errorMsgs->GetStringLength()) : std::string_view();
+		if (FAILED(status) && prescan.entryPoints[static_cast<uint8_t>(type)].conditional && errors.find("missing entry point definition") != errors.npos)
 		{
-			logger().error(fmt::format("[ShaderCompiler]: Can't compile the shader '{}'. Errors: {}", absolutePath, errorMsgs->GetStringPointer()));
+			logger().info(fmt::format("[ShaderCompiler]: The {} stage of '{}' is disabled by the preprocessor.", kStages[static_cast<uint8_t>(type)], absolutePath));
+			m_skipped = true;
+			return true;
+		}
+		if (!errors.empty())
+		{
+			logger().error(fmt::format("[ShaderCompiler]: Can't compile the shader '{}'. Errors: {}", absolutePath, errors));
 		}
 	}
 
+	if (FAILED(status))
+	{
+		return false;
+	}
+
 	//-- Output object.
 	{
 		auto& shader = resource.m_shaders[static_cast<uint8_t>(type)];
@@ -309,6 +354,12 @@ bool ShaderCompiler::compile(const Blob& blob, const std::string& absolutePath,
 			fwrite(shader->GetBufferPointer(), shader->GetBufferSize(), 1, fp);
 			fclose(fp);
 		}
+
+		if (shader != nullptr && !entryPath.empty())
+		{
+			const auto* bytecode = static_cast<const uint8_t*>(shader->GetBufferPointer());
+			shader_cache::write(entryPath, m_includeHandler.includes(), { bytecode, shader->GetBufferSize() });
+		}
 	}
 
 	//-- Debug.
@@ -440,4 +491,39 @@ bool ShaderCompiler::compile(const Blob& blob, const std::string& absolutePath,
 	return true;
 }
 
+
+bool ShaderCompiler::loadCached(const std::filesystem::path& entryPath, ComPtr<IDxcBlob>& shader)
+{
+	ENGINE_CPU_ZONE;
+
+	utils::MappedFile entry;
+	std::vector<shader_cache::Include> includes;
+	std::span<const uint8_t> bytecode;
+	if (!entry.open(entryPath) || !shader_cache::read({ entry.data(), entry.size() }, includes, bytecode))
+	{
+		return false;
+	}
+
+	//-- Any changed or removed include invalidates the entry.
+	for (const auto& include : includes)
+	{
+		const auto file = m_includeHandler.cache().load(include.path);
+		if (!file || file->hash != include.hash)
+		{
+			return false;
+		}
+	}
+
+	//-- The blob owns a copy, so the entry isn't kept mapped.
+	ComPtr<IDxcBlobEncoding> cached;
+	if (FAILED(m_utils->CreateBlob(bytecode.data(), static_cast<UINT32>(bytecode.size()), DXC_CP_ACP, &cached)))
+	{
+		return false;
+	}
+
+	shader = cached;
+	m_includeHandler.reset(std::move(includes));
+	return true;
+}
+
 } //-- engine::render::d3d12.
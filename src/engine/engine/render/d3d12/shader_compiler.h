@@ -2,22 +2,18 @@
 
 #include <engine/integration/d3d12/integration.h>
 #include <engine/render/shader_compiler.h>
+#include <engine/render/shader_include_cache.h>
+#include <engine/render/shader_prescan.h>
+#include <engine/render/d3d12/shader_cache.h>
 #include <engine/render/d3d12/shader_resource.h>
 
 namespace engine::render::d3d12
 {
 
-//-- This is instance should be per-thread to achieve multithreading safe.
+//-- This is instance should be per-thread to achieve multithreading safe, see ShaderCompilerService.
 class ShaderCompiler : public IShaderCompiler
 {
 public:
-	~ShaderCompiler() = default;
-
-	ENGINE_API bool initialize() override;
-
-	ENGINE_API resources::ShaderResourcePtr compile(std::string_view path) override;
-
-private:
 	struct Blob
 	{
 		void initialize(const size_t size)
@@ -31,14 +27,61 @@ private:
 		std::vector<uint8_t> m_data;
 	};
 
-	bool compile(const Blob& blob, const std::string& absolutePath, resources::ShaderResource::Type type, ShaderResource& resource);
+public:
+	explicit ShaderCompiler(ShaderIncludeCache& includeCache);
+	~ShaderCompiler() = default;
+
+	ENGINE_API bool initialize() override;
+
+	//-- Compiles a single stage of the source with the additional defines ("NAME" or "NAME=VALUE") into the resource.
+	//-- The prescan of the source provides the cache key and the attributes of the entry point.
+	bool compile(const Blob& blob, const std::string& absolutePath, const ShaderPrescan& prescan, resources::ShaderResource::Type type,
+		std::span<const std::string> defines, ShaderResource& resource);
+	//-- The last stage is defined only in conditional blocks which the preprocessor removed, so compile succeeded without it.
+	bool skipped() const { return m_skipped; }
+
+	//-- Includes of the last compiled stage, whether it was compiled or loaded from the cache.
+	const std::vector<shader_cache::Include>& includes() const { return m_includeHandler.includes(); }
+
+	//-- Reads the source through the VFS. It doesn't touch the compiler, so any thread may call it.
+	static bool readSource(std::string_view path, Blob& blob, std::string& absolutePath);
+
+private:
+	//-- Loads includes from the shared cache and records them, so cache entries can be validated by their includes
+	//-- and shaders are reloaded when their includes change.
+	class IncludeHandler : public IDxcIncludeHandler
+	{
+	public:
+		explicit IncludeHandler(ShaderIncludeCache& cache) : m_cache(cache) { }
+
+		void initialize(IDxcUtils* utils) { m_utils = utils; }
+		void reset(std::vector<shader_cache::Include> includes = {}) { m_includes = std::move(includes); }
+
+		ShaderIncludeCache& cache() { return m_cache; }
+		const std::vector<shader_cache::Include>& includes() const { return m_includes; }
+
+		HRESULT STDMETHODCALLTYPE LoadSource(_In_ LPCWSTR filename, _COM_Outptr_result_maybenull_ IDxcBlob** includeSource) override;
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, _COM_Outptr_ void __RPC_FAR* __RPC_FAR* object) override;
+		//-- Owned by the compiler, not by references.
+		ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+		ULONG STDMETHODCALLTYPE Release() override { return 1; }
+
+	private:
+		ShaderIncludeCache& m_cache;
+		IDxcUtils* m_utils = nullptr;
+		std::vector<shader_cache::Include> m_includes;
+	};
+
+	bool loadCached(const std::filesystem::path& entryPath, Microsoft::WRL::ComPtr<IDxcBlob>& shader);
 
 private:
 	std::vector<LPCWSTR> m_commonArguments;
 	std::vector<LPCWSTR> m_shaderArguments;
+	std::string m_compilerVersion; //-- A part of cache keys.
 	Microsoft::WRL::ComPtr<IDxcUtils> m_utils;
-	Microsoft::WRL::ComPtr<IDxcIncludeHandler> m_includeHandler;
+	IncludeHandler m_includeHandler;
 	Microsoft::WRL::ComPtr<IDxcCompiler3> m_compiler;
+	bool m_skipped = false;
 };
 
 } //-- engine::render::d3d12.
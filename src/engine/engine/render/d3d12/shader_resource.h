@@ -10,6 +10,11 @@ namespace engine::render::d3d12
 class ShaderResource : public resources::ShaderResource
 {
 public:
+	ShaderResource()
+	{
+		m_shaders.resize(static_cast<size_t>(Type::Count));
+	}
+
 	[[nodiscard]] Shader shader(const Type type) override
 	{
 		auto& shader = m_shaders[static_cast<uint8_t>(type)];
@@ -26,6 +31,13 @@ public:
 		}
 	}
 
+	//-- Takes the shaders of the reloaded resource.
+	void swap(ShaderResource& reloaded)
+	{
+		m_shaders.swap(reloaded.m_shaders);
+		++m_version;
+	}
+
 public:
 #if 0
 	//-- std::array isn't compiled.
@@ -11,7 +11,6 @@ public:
 	ENGINE_API virtual ~IShaderCompiler() = default;
 
 	ENGINE_API virtual bool initialize() = 0;
-	ENGINE_API virtual resources::ShaderResourcePtr compile(std::string_view path) = 0;
 };
 
 } //-- engine::render.
@@ -0,0 +1,67 @@
+#include <engine/render/shader_include_cache.h>
+#include <engine/helpers.h>
+#include <engine/services/vfs_service.h>
+
+namespace engine::render
+{
+
+bool ShaderIncludeCache::initialize(std::string_view vfsFolder)
+{
+	m_vfsFolder = vfsFolder;
+	m_folder = normalize(service<VFSService>().absolutePath(vfsFolder));
+	return !m_folder.empty();
+}
+
+
+ShaderIncludeCache::FilePtr ShaderIncludeCache::load(const std::filesystem::path& path)
+{
+	ENGINE_CPU_ZONE;
+
+	const std::string key = normalize(path);
+	{
+		std::lock_guard lock(m_mutex);
+		if (auto it = m_files.find(key); it != m_files.end())
+		{
+			return it->second;
+		}
+	}
+
+	//-- The compiler probes every include folder, so misses are expected and aren't cached.
+	const std::filesystem::path relativePath = std::filesystem::path(key).lexically_relative(m_folder);
+	if (relativePath.empty() || *relativePath.begin() == "..")
+	{
+		return nullptr;
+	}
+
+	auto file = service<VFSService>().openFile(fmt::format("{}/{}", m_vfsFolder, relativePath.generic_string()));
+	if (!file || !file->IsOpened())
+	{
+		return nullptr;
+	}
+
+	auto result = std::make_shared<File>();
+	result->bytes.resize(file->Size());
+	result->bytes.resize(file->Read(result->bytes.data(), result->bytes.size()));
+	result->hash = utils::ContentHasher().update(result->bytes).digest();
+
+	//-- Another thread may have read it meanwhile, both contents are the same.
+	std::lock_guard lock(m_mutex);
+	return m_files.try_emplace(key, std::move(result)).first->second;
+}
+
+
+void ShaderIncludeCache::invalidate(const std::filesystem::path& path)
+{
+	std::lock_guard lock(m_mutex);
+	m_files.erase(normalize(path));
+}
+
+
+std::string ShaderIncludeCache::normalize(const std::filesystem::path& path)
+{
+	std::error_code error;
+	const auto absolutePath = std::filesystem::absolute(path, error);
+	return error ? std::string() : absolutePath.lexically_normal().string();
+}
+
+} //-- engine::render.
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <engine/utils/content_hash.h>
+#include <engine/utils/noncopyable.h>
+
+namespace engine::render
+{
+
+//-- Contents of shader sources and includes shared by all shader compilers, so a header included by hundreds of shaders
+//-- is read once. Files are read through the VFS and stay cached until they are invalidated. Thread safe.
+class ShaderIncludeCache : public utils::NonCopyable
+{
+public:
+	struct File
+	{
+		std::vector<uint8_t> bytes;
+		utils::ContentHash hash;
+	};
+
+	using FilePtr = std::shared_ptr<const File>;
+
+	//-- Files are looked up inside the VFS folder, e.g. "/shaders".
+	bool initialize(std::string_view vfsFolder);
+
+	//-- Absolute path of the file, as the compiler resolves includes. Null if the file is outside the folder or missing.
+	FilePtr load(const std::filesystem::path& path);
+	//-- The next load reads the file again.
+	void invalidate(const std::filesystem::path& path);
+
+	//-- Absolute path of the VFS folder, the include folder of the compiler.
+	const std::filesystem::path& folder() const { return m_folder; }
+
+	//-- The form of absolute paths which the cache, the dependencies and the file watcher agree on.
+	static std::string normalize(const std::filesystem::path& path);
+
+private:
+	std::string m_vfsFolder;
+	std::filesystem::path m_folder;
+	std::unordered_map<std::string, FilePtr> m_files;
+	std::mutex m_mutex;
+};
+
+} //-- engine::render.
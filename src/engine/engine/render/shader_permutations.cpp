@@ -0,0 +1,145 @@
+#include <engine/render/shader_permutations.h>
+#include <engine/helpers.h>
+#include <engine/services/shader_compiler_service.h>
+
+#include <algorithm>
+#include <bit>
+
+namespace engine::render
+{
+
+bool ShaderPermutations::load(std::string_view path)
+{
+	ENGINE_CPU_ZONE;
+
+	release();
+	m_path = path;
+
+	ShaderPrescan prescan;
+	if (!service<ShaderCompilerService>().prescan(path, prescan))
+	{
+		logger().error(fmt::format("[ShaderPermutations]: Can't scan the shader '{}'.", path));
+		return false;
+	}
+	m_keywords = std::move(prescan.keywords);
+
+	if (m_keywords.size() > kMaxKeywords)
+	{
+		logger().error(fmt::format("[ShaderPermutations]: The shader '{}' declares {} keywords, at most {} are supported.",
+			path, m_keywords.size(), kMaxKeywords));
+		return false;
+	}
+
+	logger().info(fmt::format("[ShaderPermutations]: The shader '{}' has keywords {}", path, describe(static_cast<Key>(~0u))));
+
+	Key resolved = 0;
+	auto& base = m_variants[0];
+	base.compiling = service<ShaderCompilerService>().compile(m_path, {});
+	base.compiling.wait();
+
+	return variant(0, resolved) != nullptr;
+}
+
+
+void ShaderPermutations::release()
+{
+	//-- Variants which are still compiling are finished by the service, the results are dropped.
+	m_variants.clear();
+	m_keywords.clear();
+}
+
+
+ShaderPermutations::Key ShaderPermutations::keywordBit(std::string_view keyword) const
+{
+	const auto it = std::find(m_keywords.begin(), m_keywords.end(), keyword);
+	return it != m_keywords.end() ? static_cast<Key>(1u << (it - m_keywords.begin())) : Key(0);
+}
+
+
+resources::ShaderResourcePtr ShaderPermutations::variant(Key key, Key& resolved)
+{
+	//-- Keywords which the shader doesn't declare don't make new variants.
+	key &= static_cast<Key>((1u << m_keywords.size()) - 1);
+
+	auto [it, inserted] = m_variants.try_emplace(key);
+	if (inserted)
+	{
+		std::vector<std::string> defines;
+		defines.reserve(m_keywords.size());
+		for (size_t i = 0; i < m_keywords.size(); ++i)
+		{
+			defines.push_back(fmt::format("{}={}", m_keywords[i], (key >> i) & 1));
+		}
+
+		logger().info(fmt::format("[ShaderPermutations]: Compile the variant {} of '{}'", describe(key), m_path));
+		it->second.compiling = service<ShaderCompilerService>().compile(m_path, std::move(defines));
+	}
+
+	if (poll(key, it->second))
+	{
+		resolved = key;
+		return it->second.resource;
+	}
+
+	//-- Inputs of a subset are a subset of the requested inputs, so it can be drawn with the same vertex streams.
+	resources::ShaderResourcePtr fallback;
+	int fallbackKeywords = -1;
+	for (auto& [otherKey, other] : m_variants)
+	{
+		const int numKeywords = std::popcount(otherKey);
+		if ((otherKey & ~key) == 0 && numKeywords > fallbackKeywords && poll(otherKey, other))
+		{
+			fallback = other.resource;
+			fallbackKeywords = numKeywords;
+			resolved = otherKey;
+		}
+	}
+
+	return fallback;
+}
+
+
+uint32_t ShaderPermutations::version() const
+{
+	uint32_t version = 0;
+	for (const auto& [key, variant] : m_variants)
+	{
+		version += variant.resource ? variant.resource->version() : 0;
+	}
+
+	return version;
+}
+
+
+bool ShaderPermutations::poll(Key key, Variant& variant)
+{
+	if (variant.compiling.valid() && variant.compiling.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		variant.resource = variant.compiling.get();
+		if (!variant.resource->ready())
+		{
+			logger().error(fmt::format("[ShaderPermutations]: Can't compile the variant {} of '{}'.", describe(key), m_path));
+		}
+	}
+
+	//-- Failed variants get ready once they are fixed and hot reloaded.
+	return variant.resource && variant.resource->ready();
+}
+
+
+std::string ShaderPermutations::describe(Key key) const
+{
+	std::string result = "[";
+	for (size_t i = 0; i < m_keywords.size(); ++i)
+	{
+		if ((key >> i) & 1)
+		{
+			result += result.size() > 1 ? " " : "";
+			result += m_keywords[i];
+		}
+	}
+
+	return result + "]";
+}
+
+} //-- engine::render.
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <engine/resources/shader_resource.h>
+#include <engine/utils/noncopyable.h>
+
+#include <unordered_map>
+
+namespace engine::render
+{
+
+//-- Variants of a shader which declares feature keywords in a comment, e.g. `// @keywords VERTEX_COLOR SKINNED`.
+//-- A variant is identified by the mask of its enabled keywords, every keyword is defined to 1 or 0 for it.
+//-- Variants are compiled by ShaderCompilerService the first time they are requested, so only the used ones are ever built.
+//-- Not thread safe, variants are requested from the render thread.
+class ShaderPermutations : public utils::NonCopyable
+{
+public:
+	using Key = uint16_t;
+	static constexpr size_t kMaxKeywords = sizeof(Key) * 8;
+
+	//-- Reads the keywords and compiles the base variant without any of them, which is the last resort of fallbacks. Blocking.
+	bool load(std::string_view path);
+	void release();
+
+	const std::vector<std::string>& keywords() const { return m_keywords; }
+	//-- 0 if the shader doesn't declare the keyword.
+	Key keywordBit(std::string_view keyword) const;
+
+	//-- The variant of the key, or the ready one with the most keywords among the subsets of the key while it's compiling.
+	//-- The key of the returned variant is written to resolved. Null if no such variant is ready.
+	resources::ShaderResourcePtr variant(Key key, Key& resolved);
+
+	//-- Grows every time one of the variants is reloaded, see resources::ShaderResource::version.
+	uint32_t version() const;
+
+private:
+	struct Variant
+	{
+		std::future<resources::ShaderResourcePtr> compiling;
+		resources::ShaderResourcePtr resource;
+	};
+
+	//-- Takes the result of the finished compilation. Returns true if the variant is ready.
+	bool poll(Key key, Variant& variant);
+	std::string describe(Key key) const;
+
+private:
+	std::string m_path;
+	std::vector<std::string> m_keywords;
+	std::unordered_map<Key, Variant> m_variants;
+};
+
+} //-- engine::render.
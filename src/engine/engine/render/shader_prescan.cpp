@@ -0,0 +1,525 @@
+#include <engine/render/shader_prescan.h>
+#include <engine/helpers.h>
+
+#include <algorithm>
+#include <cctype>
+
+namespace engine::render
+{
+
+namespace
+{
+
+using namespace std::string_view_literals;
+
+inline constexpr std::string_view kKeywordsDirective = "@keywords";
+inline constexpr std::array<std::string_view, static_cast<size_t>(ShaderPrescan::Stage::Count)> kEntryPoints = { "vs_main", "ps_main", "cs_main", "as_main", "ms_main" };
+//-- Longest first. Operators must stay whole, otherwise `a ++ b` and `a + + b` would hash the same.
+inline constexpr std::array kPunctuators = { ">>="sv, "<<="sv, "..."sv, "->"sv, "++"sv, "--"sv, "<<"sv, ">>"sv, "<="sv, ">="sv, "=="sv, "!="sv,
+	"&&"sv, "||"sv, "+="sv, "-="sv, "*="sv, "/="sv, "%="sv, "&="sv, "|="sv, "^="sv, "::"sv, "##"sv };
+
+
+bool isIdentifierStart(char c)
+{
+	return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+}
+
+
+bool isIdentifierChar(char c)
+{
+	return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+
+bool isIdentifier(std::string_view token)
+{
+	return !token.empty() && isIdentifierStart(token.front()) && std::all_of(token.begin(), token.end(), isIdentifierChar);
+}
+
+
+//-- HLSL attributes are case insensitive.
+bool equalsNoCase(std::string_view lhs, std::string_view rhs)
+{
+	return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](char a, char b)
+		{
+			return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+		});
+}
+
+
+//-- Splits a file into preprocessing tokens, skipping whitespaces, comments and line continuations.
+class Lexer
+{
+public:
+	explicit Lexer(std::string_view source) : m_source(source) { }
+
+	//-- False at the end of the file or on an unterminated comment or literal, see failed.
+	bool next(std::string_view& token);
+	//-- `"path"` or `<path>` right after `#include`, with the delimiters. False for includes of macros.
+	bool nextHeaderName(std::string_view& header);
+
+	//-- The last token starts a line, so `#` starts a directive.
+	bool firstOnLine() const { return m_firstOnLine; }
+	//-- Of the last token, starting with 1. Continued lines count too, like the compiler counts them.
+	uint32_t line() const { return m_line; }
+	bool failed() const { return m_failed; }
+	//-- Text after `//` of all line comments read so far.
+	const std::vector<std::string_view>& lineComments() const { return m_lineComments; }
+
+private:
+	void skipWhitespaces();
+	bool skipLiteral(char quote);
+	char peek(size_t offset = 0) const { return m_offset + offset < m_source.size() ? m_source[m_offset + offset] : '\0'; }
+
+private:
+	std::string_view m_source;
+	size_t m_offset = 0;
+	uint32_t m_line = 1;
+	bool m_firstOnLine = true;
+	bool m_failed = false;
+	std::vector<std::string_view> m_lineComments;
+};
+
+
+bool Lexer::next(std::string_view& token)
+{
+	skipWhitespaces();
+	if (m_failed || m_offset >= m_source.size())
+	{
+		return false;
+	}
+
+	const size_t start = m_offset;
+	const char c = peek();
+	if (isIdentifierStart(c))
+	{
+		while (isIdentifierChar(peek()))
+		{
+			++m_offset;
+		}
+	}
+	else if (std::isdigit(static_cast<unsigned char>(c)) || (c == '.' && std::isdigit(static_cast<unsigned char>(peek(1)))))
+	{
+		//-- pp-number, e.g. 1.0e-5f or 0x1Fu. The first character is a digit or a dot, so there is always a previous one.
+		++m_offset;
+		while (isIdentifierChar(peek()) || peek() == '.'
+			|| ((peek() == '+' || peek() == '-') && (m_source[m_offset - 1] == 'e' || m_source[m_offset - 1] == 'E')))
+		{
+			++m_offset;
+		}
+	}
+	else if (c == '"' || c == '\'')
+	{
+		if (!skipLiteral(c))
+		{
+			return false;
+		}
+	}
+	else
+	{
+		const std::string_view rest = m_source.substr(m_offset);
+		const auto punctuator = std::find_if(kPunctuators.begin(), kPunctuators.end(), [&rest](std::string_view candidate)
+			{
+				return rest.starts_with(candidate);
+			});
+		m_offset += punctuator != kPunctuators.end() ? punctuator->size() : 1;
+	}
+
+	token = m_source.substr(start, m_offset - start);
+	return true;
+}
+
+
+bool Lexer::nextHeaderName(std::string_view& header)
+{
+	while (peek() == ' ' || peek() == '\t')
+	{
+		++m_offset;
+	}
+
+	const char open = peek();
+	const char close = open == '<' ? '>' : '"';
+	if (open != '<' && open != '"')
+	{
+		return false;
+	}
+
+	const size_t end = m_source.find_first_of(close == '>' ? ">\n"sv : "\"\n"sv, m_offset + 1);
+	if (end == m_source.npos || m_source[end] != close)
+	{
+		m_failed = true;
+		return false;
+	}
+
+	header = m_source.substr(m_offset, end + 1 - m_offset);
+	m_offset = end + 1;
+	m_firstOnLine = false;
+	return true;
+}
+
+
+void Lexer::skipWhitespaces()
+{
+	bool newLine = m_offset == 0;
+	while (m_offset < m_source.size())
+	{
+		const char c = peek();
+		if (c == '\n')
+		{
+			newLine = true;
+			++m_offset;
+			++m_line;
+		}
+		else if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v')
+		{
+			++m_offset;
+		}
+		else if (c == '\\' && (peek(1) == '\n' || (peek(1) == '\r' && peek(2) == '\n')))
+		{
+			m_offset += peek(1) == '\n' ? 2 : 3;
+			++m_line;
+		}
+		else if (c == '/' && peek(1) == '/')
+		{
+			const size_t end = std::min(m_source.find('\n', m_offset), m_source.size());
+			m_lineComments.push_back(m_source.substr(m_offset + 2, end - m_offset - 2));
+			m_offset = end;
+		}
+		else if (c == '/' && peek(1) == '*')
+		{
+			//-- A block comment is a space, even if it spans lines.
+			const size_t end = m_source.find("*/", m_offset + 2);
+			if (end == m_source.npos)
+			{
+				m_failed = true;
+				return;
+			}
+			m_line += static_cast<uint32_t>(std::count(m_source.begin() + m_offset, m_source.begin() + end, '\n'));
+			m_offset = end + 2;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	m_firstOnLine = newLine;
+}
+
+
+bool Lexer::skipLiteral(char quote)
+{
+	for (++m_offset; m_offset < m_source.size(); ++m_offset)
+	{
+		const char c = peek();
+		if (c == '\\')
+		{
+			++m_offset;
+		}
+		else if (c == quote)
+		{
+			++m_offset;
+			return true;
+		}
+		else if (c == '\n')
+		{
+			break;
+		}
+	}
+
+	m_failed = true;
+	return false;
+}
+
+
+//-- Tokenizes the source with its includes, hashes them and finds the entry points among the declarations.
+class Scanner
+{
+public:
+	Scanner(ShaderIncludeCache& includes, ShaderPrescan& result) : m_includes(includes), m_result(result) { }
+
+	bool scanFile(std::string_view source, const std::string& path, bool root);
+	void findEntryPoints();
+	utils::ContentHash digest() const { return m_hasher.digest(); }
+
+private:
+	bool expand(std::string_view header, const std::filesystem::path& folder);
+	bool parseKeywords(std::string_view comment, const std::string& path);
+	//-- Index of the closing bracket of the one at the index, or the number of tokens.
+	size_t closing(size_t open, std::string_view opening, std::string_view closing) const;
+	static void parseAttribute(std::span<const std::string_view> tokens, ShaderPrescan::EntryPoint& entryPoint);
+
+private:
+	ShaderIncludeCache& m_includes;
+	ShaderPrescan& m_result;
+	utils::ContentHasher m_hasher;
+	std::vector<ShaderIncludeCache::FilePtr> m_files; //-- Tokens refer to them.
+	std::vector<std::string_view> m_tokens; //-- Outside of directives.
+	std::vector<bool> m_conditional; //-- Whether the tokens are inside conditional blocks.
+	uint32_t m_conditionalDepth = 0; //-- Of the blocks open at the current token, includes are inside the blocks of their directives.
+};
+
+
+bool Scanner::scanFile(std::string_view source, const std::string& path, bool root)
+{
+	const std::filesystem::path folder = std::filesystem::path(path).parent_path();
+
+	Lexer lexer(source);
+	std::string_view token;
+	std::string_view previous;
+	bool directive = false;
+	while (lexer.next(token))
+	{
+		//-- Lines are kept, since they end directives, and so are their numbers. The spaces inside them are not.
+		if (lexer.firstOnLine())
+		{
+			m_hasher.update("\n"sv).update(lexer.line());
+		}
+		else
+		{
+			m_hasher.update(" "sv);
+		}
+		m_hasher.update(token);
+
+		if (lexer.firstOnLine())
+		{
+			directive = token == "#";
+		}
+
+		if (!directive)
+		{
+			m_tokens.push_back(token);
+			m_conditional.push_back(m_conditionalDepth > 0);
+		}
+		else if (previous == "#" && (token == "if" || token == "ifdef" || token == "ifndef"))
+		{
+			++m_conditionalDepth;
+		}
+		else if (previous == "#" && token == "endif")
+		{
+			m_conditionalDepth -= m_conditionalDepth > 0 ? 1 : 0;
+		}
+		else if (token == "include" && previous == "#")
+		{
+			std::string_view header;
+			if (lexer.nextHeaderName(header))
+			{
+				m_hasher.update(" "sv).update(header);
+				if (!expand(header, folder))
+				{
+					return false;
+				}
+			}
+		}
+		previous = token;
+	}
+
+	if (lexer.failed())
+	{
+		logger().error(fmt::format("[ShaderPrescan]: '{}' has an unterminated comment, literal or include.", path));
+		return false;
+	}
+
+	if (root)
+	{
+		for (const auto comment : lexer.lineComments())
+		{
+			if (!parseKeywords(comment, path))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+bool Scanner::expand(std::string_view header, const std::filesystem::path& folder)
+{
+	const std::string_view name = header.substr(1, header.size() - 2);
+
+	//-- As the compiler resolves them: quoted ones against the folder of the including file first, then the include folder.
+	std::string path;
+	ShaderIncludeCache::FilePtr file;
+	if (header.front() == '"')
+	{
+		path = ShaderIncludeCache::normalize(folder / name);
+		file = m_includes.load(path);
+	}
+	if (!file)
+	{
+		path = ShaderIncludeCache::normalize(m_includes.folder() / name);
+		file = m_includes.load(path);
+	}
+
+	//-- Missing includes may be in disabled branches, the compiler reports the others.
+	//-- Every file is expanded once, as if it had include guards.
+	if (!file || std::find(m_result.files.begin(), m_result.files.end(), path) != m_result.files.end())
+	{
+		return true;
+	}
+
+	m_result.files.push_back(path);
+	m_files.push_back(file);
+	return scanFile({ reinterpret_cast<const char*>(file->bytes.data()), file->bytes.size() }, path, false);
+}
+
+
+bool Scanner::parseKeywords(std::string_view comment, const std::string& path)
+{
+	constexpr std::string_view kWhitespaces = " \t\r";
+
+	comment.remove_prefix(std::min(comment.find_first_not_of(kWhitespaces), comment.size()));
+	if (!comment.starts_with(kKeywordsDirective))
+	{
+		return true;
+	}
+	comment.remove_prefix(kKeywordsDirective.size());
+
+	while (true)
+	{
+		const size_t tokenStart = comment.find_first_not_of(kWhitespaces);
+		if (tokenStart == comment.npos)
+		{
+			return true;
+		}
+
+		const size_t tokenEnd = std::min(comment.find_first_of(kWhitespaces, tokenStart), comment.size());
+		const std::string_view keyword = comment.substr(tokenStart, tokenEnd - tokenStart);
+		comment.remove_prefix(tokenEnd);
+
+		if (!isIdentifier(keyword))
+		{
+			logger().error(fmt::format("[ShaderPrescan]: '{}' of the shader '{}' isn't a valid keyword.", keyword, path));
+			return false;
+		}
+
+		if (std::find(m_result.keywords.begin(), m_result.keywords.end(), keyword) == m_result.keywords.end())
+		{
+			m_result.keywords.emplace_back(keyword);
+		}
+	}
+}
+
+
+void Scanner::findEntryPoints()
+{
+	//-- Attributes precede the declaration at the global scope, e.g. `[numthreads(8, 8, 1)] void cs_main(...) { ... }`.
+	ShaderPrescan::EntryPoint attributes;
+	size_t depth = 0;
+	for (size_t i = 0; i < m_tokens.size(); ++i)
+	{
+		const std::string_view token = m_tokens[i];
+		if (token == "{")
+		{
+			++depth;
+			attributes = {};
+		}
+		else if (token == "}")
+		{
+			depth -= depth > 0 ? 1 : 0;
+		}
+		else if (depth > 0)
+		{
+			continue;
+		}
+		else if (token == ";")
+		{
+			attributes = {};
+		}
+		else if (token == "[")
+		{
+			const size_t end = closing(i, "[", "]");
+			parseAttribute(std::span(m_tokens).subspan(i + 1, std::min(end, m_tokens.size()) - i - 1), attributes);
+			i = end;
+		}
+		else if (const auto entryPoint = std::find(kEntryPoints.begin(), kEntryPoints.end(), token);
+			entryPoint != kEntryPoints.end() && i + 1 < m_tokens.size() && m_tokens[i + 1] == "(")
+		{
+			//-- A definition has a body, maybe after the semantic of the result. Declarations and calls don't.
+			size_t next = closing(i + 1, "(", ")") + 1;
+			if (next < m_tokens.size() && m_tokens[next] == ":")
+			{
+				next += 2;
+			}
+
+			if (next < m_tokens.size() && m_tokens[next] == "{")
+			{
+				//-- A single unconditional definition is enough for the stage to exist.
+				const size_t stage = entryPoint - kEntryPoints.begin();
+				const bool conditional = m_conditional[i] && (!m_result.stages.test(stage) || m_result.entryPoints[stage].conditional);
+				m_result.stages.set(stage);
+				m_result.entryPoints[stage] = attributes;
+				m_result.entryPoints[stage].conditional = conditional;
+			}
+		}
+	}
+}
+
+
+size_t Scanner::closing(size_t open, std::string_view opening, std::string_view closing) const
+{
+	size_t depth = 0;
+	for (size_t i = open; i < m_tokens.size(); ++i)
+	{
+		if (m_tokens[i] == opening)
+		{
+			++depth;
+		}
+		else if (m_tokens[i] == closing && --depth == 0)
+		{
+			return i;
+		}
+	}
+
+	return m_tokens.size();
+}
+
+
+void Scanner::parseAttribute(std::span<const std::string_view> tokens, ShaderPrescan::EntryPoint& entryPoint)
+{
+	if (tokens.size() < 3 || tokens[1] != "(" || tokens.back() != ")")
+	{
+		return;
+	}
+
+	std::string arguments;
+	for (const auto token : tokens.subspan(2, tokens.size() - 3))
+	{
+		arguments += token;
+	}
+
+	if (equalsNoCase(tokens[0], "numthreads"))
+	{
+		entryPoint.numThreads = std::move(arguments);
+	}
+	else if (equalsNoCase(tokens[0], "RootSignature"))
+	{
+		entryPoint.rootSignature = std::move(arguments);
+	}
+}
+
+} //-- unnamed.
+
+
+bool ShaderPrescan::scan(std::string_view source, const std::string& absolutePath, ShaderIncludeCache& includes, ShaderPrescan& result)
+{
+	ENGINE_CPU_ZONE;
+
+	result = {};
+	const std::string path = ShaderIncludeCache::normalize(absolutePath);
+	result.files.push_back(path);
+
+	Scanner scanner(includes, result);
+	if (!scanner.scanFile(source, path, true))
+	{
+		return false;
+	}
+
+	scanner.findEntryPoints();
+	result.hash = scanner.digest();
+	return true;
+}
+
+} //-- engine::render.
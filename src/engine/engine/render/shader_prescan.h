@@ -0,0 +1,44 @@
+#pragma once
+
+#include <engine/render/shader_include_cache.h>
+#include <engine/resources/shader_resource.h>
+#include <engine/utils/content_hash.h>
+
+#include <bitset>
+
+namespace engine::render
+{
+
+//-- What is known about a shader source before compiling it, found by a light tokenizer instead of the compiler.
+//-- Comments are skipped and includes are expanded from ShaderIncludeCache. Conditional compilation isn't evaluated,
+//-- so entry points and includes of all branches are reported, and entry points inside conditional blocks are marked.
+struct ShaderPrescan
+{
+	using Stage = resources::ShaderResource::Type;
+	using Stages = std::bitset<static_cast<size_t>(Stage::Count)>;
+
+	struct EntryPoint
+	{
+		//-- Arguments of the attributes as written without spaces, e.g. "8,8,1". Empty if the attribute is absent.
+		std::string numThreads;
+		std::string rootSignature;
+		//-- Defined only inside #if, #ifdef or #ifndef blocks, so the preprocessor may remove it.
+		bool conditional = false;
+	};
+
+	//-- Definitions of vs_main, ps_main, cs_main, as_main and ms_main.
+	Stages stages;
+	std::array<EntryPoint, static_cast<size_t>(Stage::Count)> entryPoints;
+	//-- Of `// @keywords A B C` comments of the source itself, in the order of declaration. See ShaderPermutations.
+	std::vector<std::string> keywords;
+	//-- The source and the includes found, see ShaderIncludeCache::normalize.
+	std::vector<std::string> files;
+	//-- Of the tokens of the source with the includes expanded and the numbers of the lines they start, so comments and spaces
+	//-- don't change it. Moving lines does, since __LINE__ and the debug info depend on them.
+	utils::ContentHash hash;
+
+	//-- Fails only on malformed sources, e.g. an unterminated comment or an invalid keyword.
+	static bool scan(std::string_view source, const std::string& absolutePath, ShaderIncludeCache& includes, ShaderPrescan& result);
+};
+
+} //-- engine::render.
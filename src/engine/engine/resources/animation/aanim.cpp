@@ -0,0 +1,250 @@
+#include <engine/resources/animation/aanim.h>
+#include <engine/helpers.h>
+
+#include <fstream>
+
+namespace engine::resources::aanim
+{
+
+namespace
+{
+
+using Channel = animation::AnimationClip::Channel;
+
+template<typename T>
+void append(std::vector<uint8_t>& bytes, std::span<const T> values)
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+	const auto* data = reinterpret_cast<const uint8_t*>(values.data());
+	bytes.insert(bytes.end(), data, data + values.size_bytes());
+}
+
+
+//-- Sequential reads with bounds checks. The file has no alignment guarantees, so values are copied out.
+class Reader
+{
+public:
+	explicit Reader(std::span<const uint8_t> bytes) : m_bytes(bytes) {}
+
+	template<typename T>
+	bool read(std::span<T> values)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		if (values.size_bytes() > m_bytes.size() - m_offset)
+		{
+			return false;
+		}
+
+		if (!values.empty())
+		{
+			memcpy(values.data(), m_bytes.data() + m_offset, values.size_bytes());
+		}
+		m_offset += values.size_bytes();
+		return true;
+	}
+
+	template<typename T>
+	bool read(T& value)
+	{
+		return read(std::span<T>(&value, 1));
+	}
+
+	bool finished() const { return m_offset == m_bytes.size(); }
+
+private:
+	std::span<const uint8_t> m_bytes;
+	size_t m_offset = 0;
+};
+
+
+//-- The sampler binary searches the frames and indexes the keys directly, so a broken file must not point outside of them.
+bool validClip(const animation::AnimationClip& clip)
+{
+	if (clip.numFrames == 0 || clip.numFrames > 65536 || !(clip.framerate > 0.0f))
+	{
+		return false;
+	}
+
+	for (size_t channel = 0; channel < clip.tracks.size(); ++channel)
+	{
+		const auto& frames = clip.frames[channel];
+		for (const auto& track : clip.tracks[channel])
+		{
+			if (track.numKeys == 0 || static_cast<uint64_t>(track.firstKey) + track.numKeys > frames.size())
+			{
+				return false;
+			}
+
+			const uint16_t* keys = frames.data() + track.firstKey;
+			if (track.numKeys > 1 && (keys[0] != 0 || keys[track.numKeys - 1] != clip.numFrames - 1))
+			{
+				return false;
+			}
+			for (uint32_t i = 1; i < track.numKeys; ++i)
+			{
+				if (keys[i] <= keys[i - 1])
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+} //-- unnamed.
+
+
+bool write(const std::filesystem::path& path, uint32_t settingsHash, std::span<const animation::AnimationClip> clips)
+{
+	ENGINE_CPU_ZONE;
+
+	std::vector<uint8_t> bytes;
+	{
+		size_t size = sizeof(Header);
+		for (const auto& clip : clips)
+		{
+			size += sizeof(ClipHeader) + clip.name.size() + clip.sizeBytes();
+		}
+		bytes.reserve(size);
+	}
+
+	const Header header = { .settingsHash = settingsHash, .numClips = static_cast<uint32_t>(clips.size()) };
+	append(bytes, std::span(&header, 1));
+
+	for (const auto& clip : clips)
+	{
+		ClipHeader clipHeader = {
+			.duration = clip.duration,
+			.framerate = clip.framerate,
+			.numFrames = clip.numFrames,
+			.numTracks = clip.numTracks,
+			.nameLength = static_cast<uint32_t>(clip.name.size())
+		};
+		for (size_t channel = 0; channel < clipHeader.numKeys.size(); ++channel)
+		{
+			clipHeader.numKeys[channel] = static_cast<uint32_t>(clip.frames[channel].size());
+		}
+
+		append(bytes, std::span<const ClipHeader>(&clipHeader, 1));
+		append(bytes, std::span(clip.name));
+		for (const auto& tracks : clip.tracks)
+		{
+			append(bytes, std::span(tracks));
+		}
+		for (const auto& frames : clip.frames)
+		{
+			append(bytes, std::span(frames));
+		}
+		append(bytes, std::span(clip.rotations));
+		append(bytes, std::span(clip.translations));
+		append(bytes, std::span(clip.scales));
+	}
+
+	std::filesystem::path tmpPath = path;
+	tmpPath += ".tmp";
+	{
+		std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		if (!file)
+		{
+			logger().warning(fmt::format("[aanim]: Can't write the file '{}'", tmpPath.string()));
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tmpPath, path, error);
+	if (error)
+	{
+		logger().warning(fmt::format("[aanim]: Can't rename '{}' to '{}': {}", tmpPath.string(), path.string(), error.message()));
+		std::filesystem::remove(tmpPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+
+bool read(std::span<const uint8_t> file, uint32_t settingsHash, std::vector<animation::AnimationClip>& clips)
+{
+	ENGINE_CPU_ZONE;
+
+	Reader reader(file);
+	Header header;
+	if (!reader.read(header) || header.magic != kMagic || header.version != kVersion || header.settingsHash != settingsHash)
+	{
+		return false;
+	}
+
+	//-- Every clip takes at least its header, so a broken count can't trigger a huge allocation.
+	if (header.numClips > file.size() / sizeof(ClipHeader))
+	{
+		return false;
+	}
+
+	std::vector<animation::AnimationClip> result(header.numClips);
+	for (auto& clip : result)
+	{
+		ClipHeader clipHeader;
+		if (!reader.read(clipHeader))
+		{
+			return false;
+		}
+
+		//-- Sizes are checked against the file before anything is allocated.
+		uint64_t size = clipHeader.nameLength + uint64_t(3) * clipHeader.numTracks * sizeof(animation::AnimationClip::Track);
+		for (uint32_t numKeys : clipHeader.numKeys)
+		{
+			size += uint64_t(numKeys) * sizeof(uint16_t);
+		}
+		size += uint64_t(clipHeader.numKeys[static_cast<size_t>(Channel::Rotation)]) * sizeof(animation::PackedQuat);
+		size += uint64_t(clipHeader.numKeys[static_cast<size_t>(Channel::Translation)]) * sizeof(math::vec3);
+		size += uint64_t(clipHeader.numKeys[static_cast<size_t>(Channel::Scale)]) * sizeof(math::vec3);
+		if (size > file.size())
+		{
+			return false;
+		}
+
+		clip.duration = clipHeader.duration;
+		clip.framerate = clipHeader.framerate;
+		clip.numFrames = clipHeader.numFrames;
+		clip.numTracks = clipHeader.numTracks;
+		clip.name.resize(clipHeader.nameLength);
+		for (size_t channel = 0; channel < clip.tracks.size(); ++channel)
+		{
+			clip.tracks[channel].resize(clipHeader.numTracks);
+			clip.frames[channel].resize(clipHeader.numKeys[channel]);
+		}
+		clip.rotations.resize(clipHeader.numKeys[static_cast<size_t>(Channel::Rotation)]);
+		clip.translations.resize(clipHeader.numKeys[static_cast<size_t>(Channel::Translation)]);
+		clip.scales.resize(clipHeader.numKeys[static_cast<size_t>(Channel::Scale)]);
+
+		bool valid = reader.read(std::span(clip.name));
+		for (auto& tracks : clip.tracks)
+		{
+			valid = valid && reader.read(std::span(tracks));
+		}
+		for (auto& frames : clip.frames)
+		{
+			valid = valid && reader.read(std::span(frames));
+		}
+		valid = valid && reader.read(std::span(clip.rotations)) && reader.read(std::span(clip.translations)) && reader.read(std::span(clip.scales));
+
+		if (!valid || !validClip(clip))
+		{
+			return false;
+		}
+	}
+
+	if (!reader.finished())
+	{
+		return false;
+	}
+
+	clips = std::move(result);
+	return true;
+}
+
+} //-- engine::resources::aanim.
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <engine/resources/animation/animation_clip.h>
+
+//-- Cooked animation container (.aanim).
+//-- The file is a header followed by the clips. A clip is a ClipHeader, its name and the arrays of AnimationClip in the order
+//-- of declaration. Clips are small, so they are copied out of the file instead of being used in place.
+namespace engine::resources::aanim
+{
+
+inline constexpr uint32_t kMagic = 0x4D4E4141; //-- "AANM".
+//-- Bump every time the layout of the file or the produced data changes.
+inline constexpr uint32_t kVersion = 2;
+inline constexpr std::string_view kExtension = ".aanim";
+
+struct Header
+{
+	uint32_t magic = kMagic;
+	uint32_t version = kVersion;
+	uint32_t settingsHash = 0; //-- AnimationResource::ImportSettings::hash() of the import.
+	uint32_t numClips = 0;
+};
+static_assert(std::is_trivially_copyable_v<Header>);
+
+struct ClipHeader
+{
+	float duration = 0.0f;
+	float framerate = 0.0f;
+	uint32_t numFrames = 0;
+	uint32_t numTracks = 0;
+	uint32_t nameLength = 0;
+	std::array<uint32_t, static_cast<size_t>(animation::AnimationClip::Channel::Count)> numKeys = {};
+};
+static_assert(std::is_trivially_copyable_v<ClipHeader>);
+
+//-- Returns the path of the cooked file for the source asset.
+inline std::string cookedPath(std::string_view sourcePath)
+{
+	return std::string(sourcePath) + kExtension.data();
+}
+
+//-- Writes the cooked file through a temporary file, see amesh::write.
+bool write(const std::filesystem::path& path, uint32_t settingsHash, std::span<const animation::AnimationClip> clips);
+
+//-- Validates the file contents and copies the clips out of them. Files cooked with other import settings are rejected.
+bool read(std::span<const uint8_t> file, uint32_t settingsHash, std::vector<animation::AnimationClip>& clips);
+
+} //-- engine::resources::aanim.
@@ -0,0 +1,457 @@
+#include <engine/resources/animation/animation_clip.h>
+#include <engine/assert.h>
+
+#include <algorithm>
+
+namespace engine::resources::animation
+{
+
+namespace
+{
+
+inline constexpr float kSmallestThreeRange = 0.70710678f; //-- 1 / sqrt(2).
+inline constexpr float kUnorm15Scale = 32767.0f;
+inline constexpr uint32_t kMaxFrames = 65536;
+
+inline size_t alignTo4(const size_t value)
+{
+	return (value + 3) & ~size_t(3);
+}
+
+
+float dot(const math::quat& lhs, const math::quat& rhs)
+{
+	return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z + lhs.w * rhs.w;
+}
+
+
+//-- Matches the SIMD path of the sampler: the shortest path and normalization of the linear blend.
+math::quat nlerp(const math::quat& from, const math::quat& to, float alpha)
+{
+	const float sign = dot(from, to) < 0.0f ? -1.0f : 1.0f;
+	math::quat result(
+		from.x + (sign * to.x - from.x) * alpha,
+		from.y + (sign * to.y - from.y) * alpha,
+		from.z + (sign * to.z - from.z) * alpha,
+		from.w + (sign * to.w - from.w) * alpha);
+
+	const float invLength = 1.0f / std::sqrt(std::max(dot(result, result), 1e-20f));
+	return math::quat(result.x * invLength, result.y * invLength, result.z * invLength, result.w * invLength);
+}
+
+
+//-- Squared distance between the unit quaternion and the closest of the expected one and its negation.
+float chordSquared(const math::quat& value, const math::quat& expected)
+{
+	const float invLength = 1.0f / std::sqrt(std::max(dot(expected, expected), 1e-20f));
+	const float sign = dot(value, expected) < 0.0f ? -invLength : invLength;
+	const float x = value.x - expected.x * sign;
+	const float y = value.y - expected.y * sign;
+	const float z = value.z - expected.z * sign;
+	const float w = value.w - expected.w * sign;
+	return x * x + y * y + z * z + w * w;
+}
+
+
+math::vec3 lerp(const math::vec3& from, const math::vec3& to, float alpha)
+{
+	return math::vec3(from.x + (to.x - from.x) * alpha, from.y + (to.y - from.y) * alpha, from.z + (to.z - from.z) * alpha);
+}
+
+
+float distanceSquared(const math::vec3& lhs, const math::vec3& rhs)
+{
+	const float x = lhs.x - rhs.x;
+	const float y = lhs.y - rhs.y;
+	const float z = lhs.z - rhs.z;
+	return x * x + y * y + z * z;
+}
+
+
+//-- Segments are checked frame by frame on every extension, so bounding their length keeps the reduction linear in the clip length.
+inline constexpr uint32_t kMaxSegmentFrames = 128;
+
+//-- Greedy key reduction. fits(from, to, frame) tells if interpolation of the keys at from and to reproduces the frame.
+//-- A channel which fits its first key everywhere is constant. Otherwise every segment is extended while it reproduces
+//-- all frames inside of it and is shorter than kMaxSegmentFrames, so the first and the last frames are always keys.
+template<typename Fits>
+void reduceKeys(const uint32_t numFrames, Fits&& fits, std::vector<uint16_t>& keys)
+{
+	keys.clear();
+	keys.push_back(0);
+
+	bool constant = true;
+	for (uint32_t frame = 1; frame < numFrames && constant; ++frame)
+	{
+		constant = fits(0, 0, frame);
+	}
+	if (constant)
+	{
+		return;
+	}
+
+	auto segmentFits = [&fits](uint32_t from, uint32_t to)
+		{
+			for (uint32_t frame = from + 1; frame < to; ++frame)
+			{
+				if (!fits(from, to, frame))
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+
+	uint32_t from = 0;
+	while (from + 1 < numFrames)
+	{
+		uint32_t to = from + 1;
+		while (to + 1 < numFrames && to + 1 - from <= kMaxSegmentFrames && segmentFits(from, to + 1))
+		{
+			++to;
+		}
+
+		keys.push_back(static_cast<uint16_t>(to));
+		from = to;
+	}
+}
+
+
+float segmentAlpha(uint32_t from, uint32_t to, uint32_t frame)
+{
+	return to > from ? static_cast<float>(frame - from) / static_cast<float>(to - from) : 0.0f;
+}
+
+
+//-- The keys around the frame position and the interpolation factor between them.
+//-- Constant tracks return the same key twice.
+FORCE_INLINE void findKeys(const uint16_t* frames, const uint32_t numKeys, const float frame, uint32_t& from, uint32_t& to, float& alpha)
+{
+	if (numKeys == 1)
+	{
+		from = 0;
+		to = 0;
+		alpha = 0.0f;
+		return;
+	}
+
+	//-- The first key greater than the frame, the last one if the frame is at the end of the clip.
+	const uint16_t* next = std::upper_bound(frames + 1, frames + numKeys - 1, frame, [](float value, uint16_t key) { return value < key; });
+	to = static_cast<uint32_t>(next - frames);
+	from = to - 1;
+	alpha = std::clamp((frame - frames[from]) / static_cast<float>(frames[to] - frames[from]), 0.0f, 1.0f);
+}
+
+
+FORCE_INLINE __m128 select(__m128 mask, __m128 lhs, __m128 rhs)
+{
+	return _mm_or_ps(_mm_and_ps(mask, lhs), _mm_andnot_ps(mask, rhs));
+}
+
+
+//-- Decodes four smallest three quaternions into SoA registers.
+FORCE_INLINE void unpackQuats(const PackedQuat* packed, __m128& x, __m128& y, __m128& z, __m128& w)
+{
+	const __m128i a = _mm_setr_epi32(packed[0].x, packed[1].x, packed[2].x, packed[3].x);
+	const __m128i b = _mm_setr_epi32(packed[0].y, packed[1].y, packed[2].y, packed[3].y);
+	const __m128i c = _mm_setr_epi32(packed[0].z, packed[1].z, packed[2].z, packed[3].z);
+
+	const __m128i payloadMask = _mm_set1_epi32(0x7FFF);
+	const __m128 scale = _mm_set1_ps(2.0f * kSmallestThreeRange / kUnorm15Scale);
+	const __m128 bias = _mm_set1_ps(-kSmallestThreeRange);
+	const __m128 va = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(a, payloadMask)), scale), bias);
+	const __m128 vb = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(b, payloadMask)), scale), bias);
+	const __m128 vc = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(c, payloadMask)), scale), bias);
+
+	const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(va, va), _mm_mul_ps(vb, vb)), _mm_mul_ps(vc, vc));
+	const __m128 largest = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(1.0f), sum), _mm_setzero_ps()));
+
+	//-- Stored components are the remaining ones in order, so the component i is v[i] before the dropped one and v[i - 1] after it.
+	const __m128i index = _mm_or_si128(_mm_srli_epi32(a, 15), _mm_slli_epi32(_mm_srli_epi32(b, 15), 1));
+	const __m128 is0 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_setzero_si128()));
+	const __m128 is1 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(1)));
+	const __m128 is2 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(2)));
+	const __m128 is3 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(3)));
+
+	x = select(is0, largest, va);
+	y = select(is1, largest, select(is0, va, vb));
+	z = select(is2, largest, select(is3, vc, vb));
+	w = select(is3, largest, vc);
+}
+
+
+FORCE_INLINE __m128 lerp4(__m128 from, __m128 to, __m128 alpha)
+{
+	return _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(to, from), alpha));
+}
+
+
+void sampleVectors(std::span<const AnimationClip::Track> tracks, std::span<const uint16_t> frames, std::span<const math::vec3> keys,
+	const float frame, std::array<std::vector<float>, 3>& from, std::array<std::vector<float>, 3>& to, std::vector<float>& alpha,
+	std::array<std::vector<float>, 3>& result)
+{
+	//-- Gather. The padding keeps the values from the previous calls, they are never read back.
+	for (size_t i = 0; i < tracks.size(); ++i)
+	{
+		const auto& track = tracks[i];
+		uint32_t fromKey = 0;
+		uint32_t toKey = 0;
+		findKeys(frames.data() + track.firstKey, track.numKeys, frame, fromKey, toKey, alpha[i]);
+
+		const math::vec3& fromValue = keys[track.firstKey + fromKey];
+		const math::vec3& toValue = keys[track.firstKey + toKey];
+		from[0][i] = fromValue.x;
+		from[1][i] = fromValue.y;
+		from[2][i] = fromValue.z;
+		to[0][i] = toValue.x;
+		to[1][i] = toValue.y;
+		to[2][i] = toValue.z;
+	}
+
+	//-- Interpolate.
+	for (size_t i = 0; i < alignTo4(tracks.size()); i += 4)
+	{
+		const __m128 t = _mm_loadu_ps(alpha.data() + i);
+		for (size_t c = 0; c < 3; ++c)
+		{
+			_mm_storeu_ps(result[c].data() + i, lerp4(_mm_loadu_ps(from[c].data() + i), _mm_loadu_ps(to[c].data() + i), t));
+		}
+	}
+}
+
+} //-- unnamed.
+
+
+PackedQuat packQuat(const math::quat& rotation)
+{
+	std::array<float, 4> components = { rotation.x, rotation.y, rotation.z, rotation.w };
+
+	size_t largest = 0;
+	for (size_t i = 1; i < components.size(); ++i)
+	{
+		if (std::abs(components[i]) > std::abs(components[largest]))
+		{
+			largest = i;
+		}
+	}
+
+	//-- q and -q are the same rotation, so the dropped component is always positive.
+	const float length = std::sqrt(dot(rotation, rotation));
+	const float scale = (components[largest] < 0.0f ? -1.0f : 1.0f) / std::max(length, 1e-20f);
+
+	std::array<uint16_t, 3> quantized;
+	for (size_t i = 0, j = 0; i < components.size(); ++i)
+	{
+		if (i != largest)
+		{
+			const float normalized = (components[i] * scale + kSmallestThreeRange) / (2.0f * kSmallestThreeRange);
+			quantized[j++] = static_cast<uint16_t>(std::lround(std::clamp(normalized, 0.0f, 1.0f) * kUnorm15Scale));
+		}
+	}
+
+	return PackedQuat{
+		.x = static_cast<uint16_t>(quantized[0] | ((largest & 1) << 15)),
+		.y = static_cast<uint16_t>(quantized[1] | ((largest >> 1) << 15)),
+		.z = quantized[2]
+	};
+}
+
+
+math::quat unpackQuat(const PackedQuat& packed)
+{
+	const std::array<PackedQuat, 4> batch = { packed, packed, packed, packed };
+	__m128 x, y, z, w;
+	unpackQuats(batch.data(), x, y, z, w);
+	return math::quat(_mm_cvtss_f32(x), _mm_cvtss_f32(y), _mm_cvtss_f32(z), _mm_cvtss_f32(w));
+}
+
+
+size_t AnimationClip::sizeBytes() const
+{
+	size_t size = 0;
+	for (size_t i = 0; i < tracks.size(); ++i)
+	{
+		size += tracks[i].size() * sizeof(Track) + frames[i].size() * sizeof(uint16_t);
+	}
+	return size + rotations.size() * sizeof(PackedQuat) + (translations.size() + scales.size()) * sizeof(math::vec3);
+}
+
+
+AnimationClip compress(const RawClip& raw, const CompressionSettings& settings)
+{
+	ENGINE_CPU_ZONE;
+
+	ENGINE_ASSERT(raw.numFrames > 0 && raw.numFrames <= kMaxFrames, "Clips must have from 1 to 65536 frames.", raw.numFrames);
+
+	AnimationClip clip;
+	clip.name = raw.name;
+	clip.duration = raw.duration;
+	clip.framerate = raw.framerate;
+	clip.numFrames = raw.numFrames;
+	clip.numTracks = static_cast<uint32_t>(raw.tracks.size());
+	for (auto& tracks : clip.tracks)
+	{
+		tracks.resize(raw.tracks.size());
+	}
+
+	//-- Rotations are compared by the chord between the unit quaternions, 2 * sin(angle / 4), which keeps its precision
+	//-- for small angles unlike the dot product.
+	const float maxRotationChord = 2.0f * std::sin(settings.rotationTolerance * 0.25f);
+	const float maxRotationError = maxRotationChord * maxRotationChord;
+	const float maxTranslationError = settings.translationTolerance * settings.translationTolerance;
+	const float maxScaleError = settings.scaleTolerance * settings.scaleTolerance;
+
+	std::vector<PackedQuat> packed(raw.numFrames);
+	std::vector<math::quat> decoded(raw.numFrames);
+	std::vector<uint16_t> keys;
+	keys.reserve(raw.numFrames);
+
+	auto emitKeys = [&clip, &keys](AnimationClip::Channel channel, size_t trackId)
+		{
+			auto& frames = clip.frames[static_cast<size_t>(channel)];
+			clip.tracks[static_cast<size_t>(channel)][trackId] = { static_cast<uint32_t>(frames.size()), static_cast<uint32_t>(keys.size()) };
+			frames.insert(frames.end(), keys.begin(), keys.end());
+		};
+
+	for (size_t trackId = 0; trackId < raw.tracks.size(); ++trackId)
+	{
+		const auto& track = raw.tracks[trackId];
+		ENGINE_ASSERT_DEBUG(track.rotations.size() == raw.numFrames && track.translations.size() == raw.numFrames
+			&& track.scales.size() == raw.numFrames);
+
+		//-- Rotations are reduced with their quantized values, so the tolerance covers the quantization error too.
+		for (uint32_t frame = 0; frame < raw.numFrames; ++frame)
+		{
+			packed[frame] = packQuat(track.rotations[frame]);
+			decoded[frame] = unpackQuat(packed[frame]);
+		}
+
+		reduceKeys(raw.numFrames, [&](uint32_t from, uint32_t to, uint32_t frame)
+			{
+				const math::quat value = nlerp(decoded[from], decoded[to], segmentAlpha(from, to, frame));
+				return chordSquared(value, track.rotations[frame]) <= maxRotationError;
+			}, keys);
+		for (uint16_t key : keys)
+		{
+			clip.rotations.push_back(packed[key]);
+		}
+		emitKeys(AnimationClip::Channel::Rotation, trackId);
+
+		auto reduceVectors = [&](const std::vector<math::vec3>& values, float maxError, std::vector<math::vec3>& result)
+			{
+				reduceKeys(raw.numFrames, [&](uint32_t from, uint32_t to, uint32_t frame)
+					{
+						return distanceSquared(lerp(values[from], values[to], segmentAlpha(from, to, frame)), values[frame]) <= maxError;
+					}, keys);
+				for (uint16_t key : keys)
+				{
+					result.push_back(values[key]);
+				}
+			};
+
+		reduceVectors(track.translations, maxTranslationError, clip.translations);
+		emitKeys(AnimationClip::Channel::Translation, trackId);
+
+		reduceVectors(track.scales, maxScaleError, clip.scales);
+		emitKeys(AnimationClip::Channel::Scale, trackId);
+	}
+
+	return clip;
+}
+
+
+void Pose::resize(size_t tracks)
+{
+	numTracks = tracks;
+	const size_t padded = alignTo4(tracks);
+	for (auto& values : rotations)
+	{
+		values.resize(padded);
+	}
+	for (auto& values : translations)
+	{
+		values.resize(padded);
+	}
+	for (auto& values : scales)
+	{
+		values.resize(padded);
+	}
+}
+
+
+void PoseSampler::sample(const AnimationClip& clip, float time, Pose& pose)
+{
+	ENGINE_CPU_ZONE;
+
+	pose.resize(clip.numTracks);
+
+	const size_t padded = alignTo4(clip.numTracks);
+	if (m_alpha.size() < padded)
+	{
+		//-- Padding is filled with valid data once, so SIMD lanes past the tracks never see garbage.
+		m_fromRotations.resize(padded, packQuat(math::quat(0.0f, 0.0f, 0.0f, 1.0f)));
+		m_toRotations.resize(padded, packQuat(math::quat(0.0f, 0.0f, 0.0f, 1.0f)));
+		for (size_t c = 0; c < 3; ++c)
+		{
+			m_from[c].resize(padded);
+			m_to[c].resize(padded);
+		}
+		m_alpha.resize(padded);
+	}
+
+	const float frame = std::clamp(time * clip.framerate, 0.0f, static_cast<float>(clip.numFrames - 1));
+
+	//-- Rotations.
+	{
+		const auto& tracks = clip.tracks[static_cast<size_t>(AnimationClip::Channel::Rotation)];
+		const auto& frames = clip.frames[static_cast<size_t>(AnimationClip::Channel::Rotation)];
+		for (size_t i = 0; i < tracks.size(); ++i)
+		{
+			const auto& track = tracks[i];
+			uint32_t fromKey = 0;
+			uint32_t toKey = 0;
+			findKeys(frames.data() + track.firstKey, track.numKeys, frame, fromKey, toKey, m_alpha[i]);
+			m_fromRotations[i] = clip.rotations[track.firstKey + fromKey];
+			m_toRotations[i] = clip.rotations[track.firstKey + toKey];
+		}
+
+		for (size_t i = 0; i < padded; i += 4)
+		{
+			__m128 fromX, fromY, fromZ, fromW;
+			__m128 toX, toY, toZ, toW;
+			unpackQuats(m_fromRotations.data() + i, fromX, fromY, fromZ, fromW);
+			unpackQuats(m_toRotations.data() + i, toX, toY, toZ, toW);
+
+			//-- Take the shortest path: flip the target if the quaternions are in the different hemispheres.
+			const __m128 cosAngle = _mm_add_ps(_mm_add_ps(_mm_mul_ps(fromX, toX), _mm_mul_ps(fromY, toY)),
+				_mm_add_ps(_mm_mul_ps(fromZ, toZ), _mm_mul_ps(fromW, toW)));
+			const __m128 sign = _mm_and_ps(cosAngle, _mm_set1_ps(-0.0f));
+			toX = _mm_xor_ps(toX, sign);
+			toY = _mm_xor_ps(toY, sign);
+			toZ = _mm_xor_ps(toZ, sign);
+			toW = _mm_xor_ps(toW, sign);
+
+			const __m128 t = _mm_loadu_ps(m_alpha.data() + i);
+			const __m128 x = lerp4(fromX, toX, t);
+			const __m128 y = lerp4(fromY, toY, t);
+			const __m128 z = lerp4(fromZ, toZ, t);
+			const __m128 w = lerp4(fromW, toW, t);
+
+			const __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+			const __m128 invLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(lengthSquared, _mm_set1_ps(1e-20f))));
+
+			_mm_storeu_ps(pose.rotations[0].data() + i, _mm_mul_ps(x, invLength));
+			_mm_storeu_ps(pose.rotations[1].data() + i, _mm_mul_ps(y, invLength));
+			_mm_storeu_ps(pose.rotations[2].data() + i, _mm_mul_ps(z, invLength));
+			_mm_storeu_ps(pose.rotations[3].data() + i, _mm_mul_ps(w, invLength));
+		}
+	}
+
+	//-- Translations and scales.
+	sampleVectors(clip.tracks[static_cast<size_t>(AnimationClip::Channel::Translation)],
+		clip.frames[static_cast<size_t>(AnimationClip::Channel::Translation)], clip.translations, frame, m_from, m_to, m_alpha, pose.translations);
+	sampleVectors(clip.tracks[static_cast<size_t>(AnimationClip::Channel::Scale)],
+		clip.frames[static_cast<size_t>(AnimationClip::Channel::Scale)], clip.scales, frame, m_from, m_to, m_alpha, pose.scales);
+}
+
+} //-- engine::resources::animation.
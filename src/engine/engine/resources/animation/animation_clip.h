@@ -0,0 +1,125 @@
+#pragma once
+
+#include <engine/math.h>
+
+//-- Compressed animation clips and the SIMD pose sampler.
+//-- A clip animates the local transforms of tracks, one track per node of the source scene in the order of the scene nodes.
+namespace engine::resources::animation
+{
+
+//-- Output of importers: every track is sampled at the same fixed framerate.
+struct RawTrack
+{
+	std::vector<math::quat> rotations;
+	std::vector<math::vec3> translations;
+	std::vector<math::vec3> scales;
+};
+
+struct RawClip
+{
+	std::string name;
+	float duration = 0.0f;
+	float framerate = 30.0f;
+	uint32_t numFrames = 0;
+	std::vector<RawTrack> tracks; //-- Every channel of every track has numFrames values.
+};
+
+struct CompressionSettings
+{
+	//-- The largest deviation of the decoded rotations from the source ones, in radians.
+	float rotationTolerance = 0.0005f;
+	//-- The largest deviation of the decoded translations in scene units (meters).
+	float translationTolerance = 0.0001f;
+	float scaleTolerance = 0.0001f;
+
+	bool operator==(const CompressionSettings&) const = default;
+};
+
+//-- Smallest three: the largest component is dropped and restored from the unit length, the other three are 15-bit UNORM
+//-- in [-1/sqrt(2), 1/sqrt(2)]. The index of the dropped component is stored in the high bits of x and y.
+struct PackedQuat
+{
+	uint16_t x = 0;
+	uint16_t y = 0;
+	uint16_t z = 0;
+};
+static_assert(sizeof(PackedQuat) == 6, "PackedQuat is stored in cooked files as is!");
+
+PackedQuat packQuat(const math::quat& rotation);
+math::quat unpackQuat(const PackedQuat& packed);
+
+//-- Channels are compressed independently: a constant channel keeps a single key, an animated one keeps only the keys
+//-- which linear interpolation of the neighbours can't reproduce within the tolerance.
+struct AnimationClip
+{
+	enum class Channel : uint8_t
+	{
+		Rotation,
+		Translation,
+		Scale,
+		Count
+	};
+
+	//-- Range of the keys of a track in the channel arrays.
+	struct Track
+	{
+		uint32_t firstKey = 0;
+		uint32_t numKeys = 0; //-- One for constant tracks.
+	};
+
+	std::string name;
+	float duration = 0.0f;
+	float framerate = 30.0f;
+	uint32_t numFrames = 0;
+	uint32_t numTracks = 0;
+
+	//-- Per channel: numTracks ranges and the frame of every key. The first and the last keys of animated tracks are
+	//-- always at the first and the last frames of the clip, so sampling never extrapolates.
+	std::array<std::vector<Track>, static_cast<size_t>(Channel::Count)> tracks;
+	std::array<std::vector<uint16_t>, static_cast<size_t>(Channel::Count)> frames;
+
+	std::vector<PackedQuat> rotations;
+	std::vector<math::vec3> translations;
+	std::vector<math::vec3> scales;
+
+	size_t numKeys(Channel channel) const { return frames[static_cast<size_t>(channel)].size(); }
+	//-- Size of the compressed data without the name.
+	size_t sizeBytes() const;
+};
+
+//-- Clips have at most 65536 frames, longer raw clips have to be resampled by the importer.
+AnimationClip compress(const RawClip& raw, const CompressionSettings& settings);
+
+//-- Local transforms of all tracks in SoA layout. Arrays are padded to a multiple of 4, so SIMD loops have no tails.
+struct Pose
+{
+	void resize(size_t tracks);
+
+	size_t numTracks = 0;
+	std::array<std::vector<float>, 4> rotations; //-- x, y, z, w.
+	std::array<std::vector<float>, 3> translations;
+	std::array<std::vector<float>, 3> scales;
+
+	math::quat rotation(size_t track) const { return math::quat(rotations[0][track], rotations[1][track], rotations[2][track], rotations[3][track]); }
+	math::vec3 translation(size_t track) const { return math::vec3(translations[0][track], translations[1][track], translations[2][track]); }
+	math::vec3 scale(size_t track) const { return math::vec3(scales[0][track], scales[1][track], scales[2][track]); }
+};
+
+//-- Samples clips into poses: the keys around the time are gathered into SoA scratch arrays, then four tracks at a time
+//-- are decoded and interpolated with SSE (nlerp for rotations, lerp for translations and scales).
+//-- Keeps the scratch between calls, so sampling doesn't allocate once it's warmed up. Not thread safe, use one per thread.
+class PoseSampler
+{
+public:
+	//-- time is in seconds and clamped to the clip. The pose is resized to the tracks of the clip.
+	void sample(const AnimationClip& clip, float time, Pose& pose);
+
+private:
+	std::vector<PackedQuat> m_fromRotations;
+	std::vector<PackedQuat> m_toRotations;
+	std::array<std::vector<float>, 3> m_from;
+	std::array<std::vector<float>, 3> m_to;
+	std::vector<float> m_alpha;
+};
+
+} //-- engine::resources::animation.
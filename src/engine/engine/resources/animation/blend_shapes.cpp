@@ -0,0 +1,77 @@
+#include <engine/resources/animation/blend_shapes.h>
+#include <engine/assert.h>
+
+namespace engine::resources::animation
+{
+
+namespace
+{
+
+//-- target[vertices[i]] += deltas[i] * weight with SSE. Four deltas are twelve contiguous floats, so they are scaled with three
+//-- multiply-adds against the targets gathered into the same layout. SSE has no gather and scatter, so those are scalar moves.
+//-- Vertices of a target are unique, so the scattered lanes never overlap.
+void applyDeltas(std::span<const uint32_t> vertices, std::span<const math::vec3> deltas, const float weight, math::vec3* values)
+{
+	const size_t count = vertices.size();
+	const float* source = reinterpret_cast<const float*>(deltas.data());
+	float* target = reinterpret_cast<float*>(values);
+	const __m128 w = _mm_set1_ps(weight);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		alignas(16) float gathered[12];
+		for (size_t lane = 0; lane < 4; ++lane)
+		{
+			memcpy(gathered + lane * 3, target + vertices[i + lane] * 3, sizeof(math::vec3));
+		}
+
+		const float* delta = source + i * 3;
+		_mm_store_ps(gathered, _mm_add_ps(_mm_load_ps(gathered), _mm_mul_ps(_mm_loadu_ps(delta), w)));
+		_mm_store_ps(gathered + 4, _mm_add_ps(_mm_load_ps(gathered + 4), _mm_mul_ps(_mm_loadu_ps(delta + 4), w)));
+		_mm_store_ps(gathered + 8, _mm_add_ps(_mm_load_ps(gathered + 8), _mm_mul_ps(_mm_loadu_ps(delta + 8), w)));
+
+		for (size_t lane = 0; lane < 4; ++lane)
+		{
+			memcpy(target + vertices[i + lane] * 3, gathered + lane * 3, sizeof(math::vec3));
+		}
+	}
+
+	for (; i < count; ++i)
+	{
+		float* value = target + vertices[i] * 3;
+		value[0] += source[i * 3] * weight;
+		value[1] += source[i * 3 + 1] * weight;
+		value[2] += source[i * 3 + 2] * weight;
+	}
+}
+
+} //-- unnamed.
+
+
+void applyBlendShapes(std::span<const BlendShapeTarget> targets, std::span<const float> weights, std::span<math::vec3> positions,
+	std::span<math::vec3> normals, float epsilon)
+{
+	ENGINE_CPU_ZONE;
+
+	for (const auto& target : targets)
+	{
+		ENGINE_ASSERT_DEBUG(target.channel < weights.size(), "Blend channel is out of range!");
+		ENGINE_ASSERT_DEBUG(target.positionDeltas.size() == target.vertices.size(), "Blend shape deltas don't match the vertices!");
+		ENGINE_ASSERT_DEBUG(target.vertices.empty() || target.vertices.back() < positions.size(), "Blend shape vertex is out of range!");
+
+		const float weight = weights[target.channel];
+		if (std::abs(weight) <= epsilon)
+		{
+			continue;
+		}
+
+		applyDeltas(target.vertices, target.positionDeltas, weight, positions.data());
+		if (!normals.empty() && !target.normalDeltas.empty())
+		{
+			applyDeltas(target.vertices, target.normalDeltas, weight, normals.data());
+		}
+	}
+}
+
+} //-- engine::resources::animation.
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <engine/math.h>
+
+//-- CPU blend shape (morph target) evaluator. Targets store only the vertices they move, so the cost follows the number
+//-- of deltas of the active channels rather than the size of the mesh.
+namespace engine::resources::animation
+{
+
+//-- Sparse deltas of a single channel. Vertices are unique and sorted.
+struct BlendShapeTarget
+{
+	uint32_t channel = 0; //-- Index in the weights passed to applyBlendShapes.
+	std::span<const uint32_t> vertices;
+	std::span<const math::vec3> positionDeltas;
+	std::span<const math::vec3> normalDeltas; //-- Empty if the target doesn't change normals.
+};
+
+//-- Adds the weighted deltas of the targets to the float positions and normals, which usually hold a copy of the bind pose.
+//-- Targets whose weight is within epsilon from zero are skipped. Normals aren't renormalized, the skinning kernels do it.
+void applyBlendShapes(std::span<const BlendShapeTarget> targets, std::span<const float> weights, std::span<math::vec3> positions,
+	std::span<math::vec3> normals, float epsilon = 1e-4f);
+
+} //-- engine::resources::animation.
@@ -0,0 +1,325 @@
+#include <engine/resources/animation/skinning.h>
+#include <engine/assert.h>
+#include <engine/helpers.h>
+#include <engine/services/job_service.h>
+
+namespace engine::resources::animation
+{
+
+namespace
+{
+
+//-- Large enough to amortize the scheduling, small enough to balance the workers on meshes of a few thousand vertices.
+inline constexpr size_t kBatchSize = 2048;
+
+FORCE_INLINE __m128 loadRow(const math::matrix& matrix, size_t row)
+{
+	return _mm_loadu_ps(reinterpret_cast<const float*>(&matrix) + row * 4);
+}
+
+
+FORCE_INLINE __m128 loadQuat(const math::quat& quat)
+{
+	return _mm_loadu_ps(reinterpret_cast<const float*>(&quat));
+}
+
+
+FORCE_INLINE void store3(math::vec3& destination, __m128 value)
+{
+	alignas(16) float values[4];
+	_mm_store_ps(values, value);
+	destination = math::vec3(values[0], values[1], values[2]);
+}
+
+
+//-- Four 8-bit UNORM weights.
+FORCE_INLINE __m128 unpackWeights(uint32_t packed)
+{
+	const __m128i bytes = _mm_cvtsi32_si128(static_cast<int>(packed));
+	const __m128i values = _mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, _mm_setzero_si128()), _mm_setzero_si128());
+	return _mm_mul_ps(_mm_cvtepi32_ps(values), _mm_set1_ps(1.0f / 255.0f));
+}
+
+
+FORCE_INLINE __m128 madd(__m128 a, __m128 b, __m128 c)
+{
+	return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+
+
+//-- Dot product of all four lanes broadcasted to every lane.
+FORCE_INLINE __m128 dot4(__m128 a, __m128 b)
+{
+	const __m128 products = _mm_mul_ps(a, b);
+	const __m128 pairs = _mm_add_ps(products, _mm_shuffle_ps(products, products, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_add_ps(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+
+//-- Cross product of xyz, w of the result is zero.
+FORCE_INLINE __m128 cross(__m128 a, __m128 b)
+{
+	const __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+	const __m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+	const __m128 result = _mm_sub_ps(_mm_mul_ps(a, bYZX), _mm_mul_ps(aYZX, b)); //-- z x y.
+	return _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+
+FORCE_INLINE __m128 normalize3(__m128 value)
+{
+	const __m128 squared = _mm_mul_ps(value, value);
+	__m128 sum = _mm_add_ss(squared, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(1, 1, 1, 1)));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(2, 2, 2, 2)));
+	const __m128 length = _mm_sqrt_ss(_mm_max_ss(sum, _mm_set_ss(1e-20f)));
+	return _mm_div_ps(value, _mm_shuffle_ps(length, length, _MM_SHUFFLE(0, 0, 0, 0)));
+}
+
+
+FORCE_INLINE __m128 loadVector(const math::vec3& value)
+{
+	return _mm_setr_ps(value.x, value.y, value.z, 0.0f);
+}
+
+
+void checkStreams(const SkinningSource& source, const SkinningTarget& target, size_t first, size_t count)
+{
+	ENGINE_ASSERT_DEBUG(first + count <= source.positions.size() && source.positions.size() <= target.positions.size()
+		&& source.boneIndices.size() == source.positions.size() && source.boneWeights.size() == source.positions.size());
+}
+
+
+template<typename Kernel>
+void skinParallel(const SkinningSource& source, Kernel&& kernel)
+{
+	const size_t numVertices = source.positions.size();
+	const size_t numBatches = (numVertices + kBatchSize - 1) / kBatchSize;
+	service<JobService>().parallelFor(numBatches, [&kernel, numVertices](size_t batch)
+		{
+			ENGINE_CPU_ZONE_NAMED("animation::skinBatch");
+
+			const size_t first = batch * kBatchSize;
+			kernel(first, std::min(kBatchSize, numVertices - first));
+		});
+}
+
+} //-- unnamed.
+
+
+void toDualQuats(std::span<const math::matrix> matrices, std::span<DualQuat> result)
+{
+	ENGINE_ASSERT_DEBUG(result.size() >= matrices.size());
+
+	for (size_t i = 0; i < matrices.size(); ++i)
+	{
+		const float* m = reinterpret_cast<const float*>(&matrices[i]);
+
+		//-- Rows are the images of the basis vectors, so r(i, j) is the rotation matrix for column vectors without scale.
+		std::array<float, 3> invScale;
+		for (size_t row = 0; row < 3; ++row)
+		{
+			const float* basis = m + row * 4;
+			invScale[row] = 1.0f / std::sqrt(std::max(basis[0] * basis[0] + basis[1] * basis[1] + basis[2] * basis[2], 1e-20f));
+		}
+		auto r = [m, &invScale](size_t i, size_t j) { return m[j * 4 + i] * invScale[j]; };
+
+		//-- See Shoemake, "Quaternion calculus and fast animation", 1987.
+		float x, y, z, w;
+		const float trace = r(0, 0) + r(1, 1) + r(2, 2);
+		if (trace > 0.0f)
+		{
+			const float s = 2.0f * std::sqrt(trace + 1.0f);
+			w = 0.25f * s;
+			x = (r(2, 1) - r(1, 2)) / s;
+			y = (r(0, 2) - r(2, 0)) / s;
+			z = (r(1, 0) - r(0, 1)) / s;
+		}
+		else if (r(0, 0) > r(1, 1) && r(0, 0) > r(2, 2))
+		{
+			const float s = 2.0f * std::sqrt(1.0f + r(0, 0) - r(1, 1) - r(2, 2));
+			w = (r(2, 1) - r(1, 2)) / s;
+			x = 0.25f * s;
+			y = (r(0, 1) + r(1, 0)) / s;
+			z = (r(0, 2) + r(2, 0)) / s;
+		}
+		else if (r(1, 1) > r(2, 2))
+		{
+			const float s = 2.0f * std::sqrt(1.0f + r(1, 1) - r(0, 0) - r(2, 2));
+			w = (r(0, 2) - r(2, 0)) / s;
+			x = (r(0, 1) + r(1, 0)) / s;
+			y = 0.25f * s;
+			z = (r(1, 2) + r(2, 1)) / s;
+		}
+		else
+		{
+			const float s = 2.0f * std::sqrt(1.0f + r(2, 2) - r(0, 0) - r(1, 1));
+			w = (r(1, 0) - r(0, 1)) / s;
+			x = (r(0, 2) + r(2, 0)) / s;
+			y = (r(1, 2) + r(2, 1)) / s;
+			z = 0.25f * s;
+		}
+
+		const float invLength = 1.0f / std::sqrt(x * x + y * y + z * z + w * w);
+		x *= invLength;
+		y *= invLength;
+		z *= invLength;
+		w *= invLength;
+
+		//-- dual = 0.5 * (t, 0) * real.
+		const float tx = m[12];
+		const float ty = m[13];
+		const float tz = m[14];
+		result[i].real = math::quat(x, y, z, w);
+		result[i].dual = math::quat(
+			0.5f * (w * tx + ty * z - tz * y),
+			0.5f * (w * ty + tz * x - tx * z),
+			0.5f * (w * tz + tx * y - ty * x),
+			-0.5f * (tx * x + ty * y + tz * z));
+	}
+}
+
+
+void skinLinear(std::span<const math::matrix> palette, const SkinningSource& source, const SkinningTarget& target, size_t first, size_t count)
+{
+	checkStreams(source, target, first, count);
+
+	const bool hasNormals = !source.normals.empty() && !target.normals.empty();
+	const __m128 identityX = _mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f);
+	const __m128 identityY = _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f);
+	const __m128 identityZ = _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+
+	for (size_t i = first; i < first + count; ++i)
+	{
+		const uint32_t indices = source.boneIndices[i];
+		const __m128 weights = unpackWeights(source.boneWeights[i]);
+
+		//-- The weight missing to one goes to the identity. Its translation row is zero.
+		const __m128 rest = _mm_sub_ps(_mm_set1_ps(1.0f), dot4(weights, _mm_set1_ps(1.0f)));
+		__m128 row0 = _mm_mul_ps(identityX, rest);
+		__m128 row1 = _mm_mul_ps(identityY, rest);
+		__m128 row2 = _mm_mul_ps(identityZ, rest);
+		__m128 row3 = _mm_setzero_ps();
+
+		alignas(16) float boneWeights[4];
+		_mm_store_ps(boneWeights, weights);
+		for (size_t bone = 0; bone < 4; ++bone)
+		{
+			const uint32_t index = (indices >> (bone * 8)) & 0xFF;
+			ENGINE_ASSERT_DEBUG(index < palette.size());
+
+			const math::matrix& matrix = palette[index];
+			const __m128 weight = _mm_set1_ps(boneWeights[bone]);
+			row0 = madd(loadRow(matrix, 0), weight, row0);
+			row1 = madd(loadRow(matrix, 1), weight, row1);
+			row2 = madd(loadRow(matrix, 2), weight, row2);
+			row3 = madd(loadRow(matrix, 3), weight, row3);
+		}
+
+		//-- Row vectors: v * M.
+		const math::vec3& position = source.positions[i];
+		const __m128 skinnedPosition = madd(row0, _mm_set1_ps(position.x), madd(row1, _mm_set1_ps(position.y), madd(row2, _mm_set1_ps(position.z), row3)));
+		store3(target.positions[i], skinnedPosition);
+
+		if (hasNormals)
+		{
+			const math::vec3& normal = source.normals[i];
+			const __m128 skinnedNormal = madd(row0, _mm_set1_ps(normal.x), _mm_add_ps(_mm_mul_ps(row1, _mm_set1_ps(normal.y)), _mm_mul_ps(row2, _mm_set1_ps(normal.z))));
+			store3(target.normals[i], normalize3(skinnedNormal));
+		}
+	}
+}
+
+
+void skinDualQuaternion(std::span<const DualQuat> palette, const SkinningSource& source, const SkinningTarget& target, size_t first, size_t count)
+{
+	checkStreams(source, target, first, count);
+
+	const bool hasNormals = !source.normals.empty() && !target.normals.empty();
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 identity = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+	for (size_t i = first; i < first + count; ++i)
+	{
+		const uint32_t indices = source.boneIndices[i];
+		const __m128 weights = unpackWeights(source.boneWeights[i]);
+		alignas(16) float boneWeights[4];
+		_mm_store_ps(boneWeights, weights);
+
+		//-- All quaternions are blended in the hemisphere of the first weighted one, otherwise the blend takes the longer path.
+		//-- Bones without weight don't touch the palette, so vertices without weights keep the rest pose whatever their indices are.
+		size_t pivot = 0;
+		while (pivot < 4 && boneWeights[pivot] == 0.0f)
+		{
+			++pivot;
+		}
+		const __m128 pivotReal = pivot < 4 ? loadQuat(palette[(indices >> (pivot * 8)) & 0xFF].real) : identity;
+
+		__m128 real = _mm_setzero_ps();
+		__m128 dual = _mm_setzero_ps();
+		for (size_t bone = 0; bone < 4; ++bone)
+		{
+			if (boneWeights[bone] == 0.0f)
+			{
+				continue;
+			}
+
+			const uint32_t index = (indices >> (bone * 8)) & 0xFF;
+			ENGINE_ASSERT_DEBUG(index < palette.size());
+
+			const DualQuat& transform = palette[index];
+			const __m128 boneReal = loadQuat(transform.real);
+			const __m128 weight = _mm_xor_ps(_mm_set1_ps(boneWeights[bone]), _mm_and_ps(dot4(pivotReal, boneReal), signMask));
+			real = madd(boneReal, weight, real);
+			dual = madd(loadQuat(transform.dual), weight, dual);
+		}
+
+		const __m128 rest = _mm_sub_ps(_mm_set1_ps(1.0f), dot4(weights, _mm_set1_ps(1.0f)));
+		const __m128 restSign = _mm_and_ps(dot4(pivotReal, identity), signMask);
+		real = madd(identity, _mm_xor_ps(rest, restSign), real);
+
+		const __m128 invLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(dot4(real, real), _mm_set1_ps(1e-20f))));
+		real = _mm_mul_ps(real, invLength);
+		dual = _mm_mul_ps(dual, invLength);
+
+		const __m128 realW = _mm_shuffle_ps(real, real, _MM_SHUFFLE(3, 3, 3, 3));
+		const __m128 dualW = _mm_shuffle_ps(dual, dual, _MM_SHUFFLE(3, 3, 3, 3));
+		const __m128 two = _mm_set1_ps(2.0f);
+
+		//-- Rotation: v + 2 * r x (r x v + w * v). Translation: 2 * (w * d - d.w * r + r x d).
+		const __m128 position = loadVector(source.positions[i]);
+		const __m128 rotated = _mm_add_ps(position, _mm_mul_ps(two, cross(real, madd(realW, position, cross(real, position)))));
+		const __m128 translation = _mm_mul_ps(two, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(realW, dual), _mm_mul_ps(dualW, real)), cross(real, dual)));
+		store3(target.positions[i], _mm_add_ps(rotated, translation));
+
+		if (hasNormals)
+		{
+			const __m128 normal = loadVector(source.normals[i]);
+			const __m128 skinnedNormal = _mm_add_ps(normal, _mm_mul_ps(two, cross(real, madd(realW, normal, cross(real, normal)))));
+			store3(target.normals[i], normalize3(skinnedNormal));
+		}
+	}
+}
+
+
+void skinLinear(std::span<const math::matrix> palette, const SkinningSource& source, const SkinningTarget& target)
+{
+	ENGINE_CPU_ZONE;
+
+	skinParallel(source, [&](size_t first, size_t count)
+		{
+			skinLinear(palette, source, target, first, count);
+		});
+}
+
+
+void skinDualQuaternion(std::span<const DualQuat> palette, const SkinningSource& source, const SkinningTarget& target)
+{
+	ENGINE_CPU_ZONE;
+
+	skinParallel(source, [&](size_t first, size_t count)
+		{
+			skinDualQuaternion(palette, source, target, first, count);
+		});
+}
+
+} //-- engine::resources::animation.
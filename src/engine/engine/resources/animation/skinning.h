@@ -0,0 +1,48 @@
+#pragma once
+
+#include <engine/math.h>
+
+//-- CPU skinning kernels. They are the fallback for hardware without GPU skinning and the reference to validate it against.
+//-- Vertices carry up to four bones as packed 8-bit palette indices and 8-bit UNORM weights, see MeshResource::Stream::BoneIndices.
+namespace engine::resources::animation
+{
+
+//-- Rigid transform as a unit dual quaternion: real is the rotation, dual is 0.5 * translation * real.
+struct DualQuat
+{
+	math::quat real = math::quat(0.0f, 0.0f, 0.0f, 1.0f);
+	math::quat dual = math::quat(0.0f, 0.0f, 0.0f, 0.0f);
+};
+
+//-- Float streams of the bind pose. Normals are optional.
+struct SkinningSource
+{
+	std::span<const math::vec3> positions;
+	std::span<const math::vec3> normals;
+	std::span<const uint32_t> boneIndices;
+	std::span<const uint32_t> boneWeights;
+};
+
+//-- Normals are written only if both the source and the target have them.
+struct SkinningTarget
+{
+	std::span<math::vec3> positions;
+	std::span<math::vec3> normals;
+};
+
+//-- Converts skinning matrices (bone to world multiplied by geometry to bone) to dual quaternions. Scale and shear are dropped.
+ENGINE_API void toDualQuats(std::span<const math::matrix> matrices, std::span<DualQuat> result);
+
+//-- Linear blend skinning of the vertices [first, first + count) with SSE. Normals are transformed by the blended matrix and renormalized.
+//-- Weights which don't sum up to one are completed with the identity, so vertices without bones keep the bind pose.
+ENGINE_API void skinLinear(std::span<const math::matrix> palette, const SkinningSource& source, const SkinningTarget& target, size_t first, size_t count);
+
+//-- Dual quaternion skinning (Kavan et al. 2007) of the vertices [first, first + count) with SSE.
+//-- Keeps the volume around twisting joints, but supports only rigid bone transforms. Missing weight is completed like in skinLinear.
+ENGINE_API void skinDualQuaternion(std::span<const DualQuat> palette, const SkinningSource& source, const SkinningTarget& target, size_t first, size_t count);
+
+//-- Skin all vertices in parallel batches with the job service.
+ENGINE_API void skinLinear(std::span<const math::matrix> palette, const SkinningSource& source, const SkinningTarget& target);
+ENGINE_API void skinDualQuaternion(std::span<const DualQuat> palette, const SkinningSource& source, const SkinningTarget& target);
+
+} //-- engine::resources::animation.
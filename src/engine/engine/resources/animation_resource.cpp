@@ -0,0 +1,212 @@
+#include <engine/resources/animation_resource.h>
+#include <engine/helpers.h>
+#include <engine/resources/animation/aanim.h>
+#include <engine/resources/mesh/ufbx_nodes.h>
+#include <engine/resources/mesh/ufbx_vfs.h>
+#include <engine/services/job_service.h>
+#include <engine/services/vfs_service.h>
+#include <engine/utils/mapped_file.h>
+#include <engine/utils/string.h>
+
+#include <ufbx/ufbx.h>
+
+namespace engine::resources
+{
+
+namespace
+{
+
+//-- Samples the transforms of all nodes evenly for the whole duration of the stack. Tracks follow nodeOrder, see mesh::flattenNodes.
+//-- See https://github.com/ufbx/ufbx/blob/master/examples/viewer/viewer.c
+void readAnimStack(animation::RawClip& clip, const ufbx_anim_stack* stack, const ufbx_scene* scene, std::span<const uint32_t> nodeOrder,
+	const AnimationResource::ImportSettings& settings)
+{
+	ENGINE_CPU_ZONE;
+
+	//-- Sample at the target framerate if possible, while limiting the number of frames by dropping the framerate.
+	const double duration = stack->time_end - stack->time_begin;
+	const uint32_t maxFrames = std::clamp(settings.maxFrames, 2u, 65536u);
+	const uint32_t numFrames = duration > 0.0 ? std::clamp(static_cast<uint32_t>(duration * settings.framerate) + 1, 2u, maxFrames) : 1;
+
+	clip.name.assign(stack->name.data, stack->name.length);
+	clip.duration = static_cast<float>(std::max(duration, 0.0));
+	clip.framerate = numFrames > 1 ? static_cast<float>((numFrames - 1) / duration) : settings.framerate;
+	clip.numFrames = numFrames;
+	clip.tracks.resize(nodeOrder.size());
+
+	for (size_t trackId = 0; trackId < nodeOrder.size(); ++trackId)
+	{
+		const ufbx_node* node = scene->nodes.data[nodeOrder[trackId]];
+		auto& track = clip.tracks[trackId];
+		track.rotations.resize(numFrames);
+		track.translations.resize(numFrames);
+		track.scales.resize(numFrames);
+
+		for (uint32_t frame = 0; frame < numFrames; ++frame)
+		{
+			const double time = stack->time_begin + frame / static_cast<double>(clip.framerate);
+			const ufbx_transform transform = ufbx_evaluate_transform(stack->anim, node, time);
+
+			//-- Negated quaternions are equivalent, but interpolating between ones of different polarity takes the longer path.
+			math::quat rotation(static_cast<float>(transform.rotation.x), static_cast<float>(transform.rotation.y),
+				static_cast<float>(transform.rotation.z), static_cast<float>(transform.rotation.w));
+			if (frame > 0 && rotation.Dot(track.rotations[frame - 1]) < 0.0f)
+			{
+				rotation = -rotation;
+			}
+
+			track.rotations[frame] = rotation;
+			track.translations[frame] = math::vec3(static_cast<float>(transform.translation.x), static_cast<float>(transform.translation.y),
+				static_cast<float>(transform.translation.z));
+			track.scales[frame] = math::vec3(static_cast<float>(transform.scale.x), static_cast<float>(transform.scale.y),
+				static_cast<float>(transform.scale.z));
+		}
+	}
+}
+
+} //-- unnamed.
+
+
+uint32_t AnimationResource::ImportSettings::hash() const
+{
+	//-- Format fields explicitly, so neither padding nor the layout of the struct affect the result.
+	const std::string key = fmt::format("{}|{}|{}|{}|{}", framerate, maxFrames, compression.rotationTolerance,
+		compression.translationTolerance, compression.scaleTolerance);
+	return utils::fnv1a_32(key.data(), key.size());
+}
+
+
+void AnimationResource::load(std::string_view path, const ImportSettings& settings)
+{
+	ENGINE_CPU_ZONE;
+
+	auto& vfs = service<VFSService>();
+	const std::string cookedPath = aanim::cookedPath(path);
+	const uint32_t settingsHash = settings.hash();
+
+	//-- Prefer the cooked file if it's newer than the source one. MeshResource::load does the same when its content cache misses
+	//-- or is disabled, animations aren't cached.
+	{
+		std::error_code error;
+		const auto sourceTime = std::filesystem::last_write_time(vfs.absolutePath(path), error);
+		const bool sourceExists = !error;
+		const auto cookedTime = std::filesystem::last_write_time(vfs.absolutePath(cookedPath), error);
+		const bool cookedExists = !error;
+
+		if (!sourceExists || (cookedExists && cookedTime >= sourceTime))
+		{
+			if (loadCooked(cookedPath, settingsHash))
+			{
+				return;
+			}
+
+			logger().warning(fmt::format("[AnimationResource]: The cooked file '{}' is invalid or outdated. Reimport '{}'.", cookedPath, path));
+		}
+	}
+
+	if (!import(path, settings))
+	{
+		m_status = Status::Failed;
+		return;
+	}
+
+	if (!aanim::write(vfs.absolutePath(cookedPath), settingsHash, m_clips))
+	{
+		logger().warning(fmt::format("[AnimationResource]: Can't cook the animations '{}'.", path));
+	}
+
+	m_status = Status::Ready;
+}
+
+
+const animation::AnimationClip* AnimationResource::findClip(std::string_view name) const
+{
+	auto it = std::find_if(m_clips.begin(), m_clips.end(), [name](const animation::AnimationClip& clip) { return clip.name == name; });
+	return it != m_clips.end() ? &*it : nullptr;
+}
+
+
+bool AnimationResource::loadCooked(std::string_view cookedPath, uint32_t settingsHash)
+{
+	ENGINE_CPU_ZONE;
+
+	auto& vfs = service<VFSService>();
+	utils::MappedFile mapping;
+	std::vector<uint8_t> buffer;
+	std::span<const uint8_t> bytes;
+	if (vfs.mapFile(cookedPath, mapping))
+	{
+		bytes = { mapping.data(), mapping.size() };
+	}
+	else if (vfs.readFile(cookedPath, buffer))
+	{
+		bytes = buffer;
+	}
+	else
+	{
+		return false;
+	}
+
+	if (!aanim::read(bytes, settingsHash, m_clips))
+	{
+		return false;
+	}
+
+	m_status = Status::Ready;
+	return true;
+}
+
+
+bool AnimationResource::import(std::string_view path, const ImportSettings& settings)
+{
+	ENGINE_CPU_ZONE;
+
+	ufbx_load_opts opts = {
+		.target_axes = ufbx_axes_right_handed_y_up,
+		.target_unit_meters = 1.0f,
+	};
+
+	ufbx_error error;
+	ufbx_scene* ufbxScene = mesh::loadScene(path, opts, error);
+	if (!ufbxScene)
+	{
+		logger().error(fmt::format("[AnimationResource]: Can't load the file '{}'. Error: {}", path, error.description.data));
+		return false;
+	}
+
+	if (ufbxScene->anim_stacks.count == 0)
+	{
+		logger().error(fmt::format("[AnimationResource]: The file '{}' doesn't contain any animation.", path));
+		ufbx_free_scene(ufbxScene);
+		return false;
+	}
+
+	//-- Evaluation only reads the scene, so stacks are sampled and compressed in parallel. The raw clip is released right after
+	//-- its compression, so at most one raw clip per thread is alive.
+	const std::vector<uint32_t> nodeOrder = mesh::flattenNodes(ufbxScene);
+	std::vector<animation::AnimationClip> clips(ufbxScene->anim_stacks.count);
+	service<JobService>().parallelFor(clips.size(), [&clips, &settings, &nodeOrder, ufbxScene](size_t stackId)
+		{
+			ENGINE_CPU_ZONE_NAMED("AnimationResource::compressClip");
+
+			animation::RawClip raw;
+			readAnimStack(raw, ufbxScene->anim_stacks.data[stackId], ufbxScene, nodeOrder, settings);
+			clips[stackId] = animation::compress(raw, settings.compression);
+		});
+
+	ufbx_free_scene(ufbxScene);
+
+	for (const auto& clip : clips)
+	{
+		const size_t rawSize = static_cast<size_t>(clip.numFrames) * clip.numTracks * (sizeof(math::quat) + 2 * sizeof(math::vec3));
+		logger().info(fmt::format("[AnimationResource]: '{}' clip '{}': {} frames, {} tracks, {} / {} / {} rotation / translation / scale keys, {} KiB of {} KiB raw.",
+			path, clip.name, clip.numFrames, clip.numTracks, clip.numKeys(animation::AnimationClip::Channel::Rotation),
+			clip.numKeys(animation::AnimationClip::Channel::Translation), clip.numKeys(animation::AnimationClip::Channel::Scale),
+			clip.sizeBytes() / 1024, rawSize / 1024));
+	}
+
+	m_clips = std::move(clips);
+	return true;
+}
+
+} //-- engine::resources.
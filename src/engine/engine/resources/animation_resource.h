@@ -0,0 +1,44 @@
+#pragma once
+
+#include <engine/resources/resource.h>
+#include <engine/resources/animation/animation_clip.h>
+
+namespace engine::resources
+{
+
+//-- Animation stacks of a scene file as compressed clips. Tracks follow the flattened nodes of the scene, see MeshResource::nodes().
+class AnimationResource : public IResource
+{
+public:
+	struct ImportSettings
+	{
+		//-- Stacks are sampled evenly at this rate, long ones drop it to fit into maxFrames.
+		float framerate = 30.0f;
+		uint32_t maxFrames = 4096;
+		animation::CompressionSettings compression;
+
+		//-- Cooked files store it to detect that they were produced with other settings.
+		uint32_t hash() const;
+	};
+
+public:
+	~AnimationResource() = default;
+
+	//-- Loads the cooked version of the clips if it's up to date, otherwise imports the source asset and cooks it.
+	void load(std::string_view path, const ImportSettings& settings = {});
+
+	const std::vector<animation::AnimationClip>& clips() const { return m_clips; }
+	//-- Returns nullptr if there is no clip with the name.
+	const animation::AnimationClip* findClip(std::string_view name) const;
+
+private:
+	bool loadCooked(std::string_view cookedPath, uint32_t settingsHash);
+	bool import(std::string_view path, const ImportSettings& settings);
+
+private:
+	std::vector<animation::AnimationClip> m_clips;
+};
+
+using AnimationResourcePtr = std::shared_ptr<AnimationResource>;
+
+} //-- engine::resources.
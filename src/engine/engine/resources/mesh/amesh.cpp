@@ -0,0 +1,320 @@
+#include <engine/resources/mesh/amesh.h>
+#include <engine/helpers.h>
+
+#include <fstream>
+
+namespace engine::resources::amesh
+{
+
+namespace
+{
+
+inline uint64_t alignUp(const uint64_t value)
+{
+	return (value + (kChunkAlignment - 1)) & ~(kChunkAlignment - 1);
+}
+
+
+bool validChunk(const Chunk& chunk, const size_t fileSize, const uint64_t expectedSize)
+{
+	return chunk.size == expectedSize
+		&& chunk.offset % kChunkAlignment == 0
+		&& chunk.offset <= fileSize
+		&& chunk.size <= fileSize - chunk.offset;
+}
+
+} //-- unnamed.
+
+
+bool write(const std::filesystem::path& path, uint32_t settingsHash, const MeshDataView& data)
+{
+	ENGINE_CPU_ZONE;
+
+	Header header;
+	header.settingsHash = settingsHash;
+	header.vertexFormat = data.vertexFormat;
+	header.numVertices = data.numVertices;
+	header.numIndices = static_cast<uint32_t>(data.indices.size());
+	header.numSubmeshes = static_cast<uint32_t>(data.submeshes.size());
+	header.numLods = static_cast<uint32_t>(data.lods.size());
+	header.numBones = static_cast<uint32_t>(data.bones.size());
+	header.numNodes = static_cast<uint32_t>(data.nodes.size());
+	header.numMeshes = static_cast<uint32_t>(data.meshes.size());
+	header.numMeshInstances = static_cast<uint32_t>(data.meshInstances.size());
+	header.numBlendShapes = static_cast<uint32_t>(data.blendShapes.size());
+	header.numBlendShapeDeltas = static_cast<uint32_t>(data.blendShapeVertices.size());
+	header.numBlendChannels = static_cast<uint32_t>(data.blendChannelWeights.size());
+	header.numMeshlets = static_cast<uint32_t>(data.meshlets.size());
+	header.numMeshletVertices = static_cast<uint32_t>(data.meshletVertices.size());
+	header.numMeshletTriangles = static_cast<uint32_t>(data.meshletTriangles.size());
+	header.combinedAABB = data.combinedAABB;
+
+	//-- Layout chunks.
+	uint64_t offset = alignUp(sizeof(Header));
+	auto placeChunk = [&offset](Chunk& chunk, const uint64_t size)
+		{
+			chunk.offset = offset;
+			chunk.size = size;
+			offset = alignUp(offset + size);
+		};
+
+	for (size_t i = 0; i < data.streams.size(); ++i)
+	{
+		placeChunk(header.streams[i], data.streams[i].size_bytes());
+	}
+	placeChunk(header.indices, data.indices.size_bytes());
+	placeChunk(header.submeshes, data.submeshes.size_bytes());
+	placeChunk(header.nodes, data.nodes.size_bytes());
+	placeChunk(header.meshes, data.meshes.size_bytes());
+	placeChunk(header.meshInstances, data.meshInstances.size_bytes());
+	placeChunk(header.lods, data.lods.size_bytes());
+	placeChunk(header.bones, data.bones.size_bytes());
+	placeChunk(header.blendShapes, data.blendShapes.size_bytes());
+	placeChunk(header.blendShapeVertices, data.blendShapeVertices.size_bytes());
+	placeChunk(header.blendShapePositionDeltas, data.blendShapePositionDeltas.size_bytes());
+	placeChunk(header.blendShapeNormalDeltas, data.blendShapeNormalDeltas.size_bytes());
+	placeChunk(header.blendChannelWeights, data.blendChannelWeights.size_bytes());
+	placeChunk(header.meshlets, data.meshlets.size_bytes());
+	placeChunk(header.meshletBounds, data.meshletBounds.size_bytes());
+	placeChunk(header.meshletVertices, data.meshletVertices.size_bytes());
+	placeChunk(header.meshletTriangles, data.meshletTriangles.size_bytes());
+
+	std::filesystem::path tmpPath = path;
+	tmpPath += ".tmp";
+	{
+		std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			logger().warning(fmt::format("[amesh]: Can't create the file '{}'", tmpPath.string()));
+			return false;
+		}
+
+		static constexpr std::array<char, kChunkAlignment> kPadding = {};
+		uint64_t written = 0;
+		auto writeChunk = [&file, &written](const Chunk& chunk, const void* bytes)
+			{
+				file.write(kPadding.data(), static_cast<std::streamsize>(chunk.offset - written));
+				file.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(chunk.size));
+				written = chunk.offset + chunk.size;
+			};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		written = sizeof(header);
+		for (size_t i = 0; i < data.streams.size(); ++i)
+		{
+			writeChunk(header.streams[i], data.streams[i].data());
+		}
+		writeChunk(header.indices, data.indices.data());
+		writeChunk(header.submeshes, data.submeshes.data());
+		writeChunk(header.nodes, data.nodes.data());
+		writeChunk(header.meshes, data.meshes.data());
+		writeChunk(header.meshInstances, data.meshInstances.data());
+		writeChunk(header.lods, data.lods.data());
+		writeChunk(header.bones, data.bones.data());
+		writeChunk(header.blendShapes, data.blendShapes.data());
+		writeChunk(header.blendShapeVertices, data.blendShapeVertices.data());
+		writeChunk(header.blendShapePositionDeltas, data.blendShapePositionDeltas.data());
+		writeChunk(header.blendShapeNormalDeltas, data.blendShapeNormalDeltas.data());
+		writeChunk(header.blendChannelWeights, data.blendChannelWeights.data());
+		writeChunk(header.meshlets, data.meshlets.data());
+		writeChunk(header.meshletBounds, data.meshletBounds.data());
+		writeChunk(header.meshletVertices, data.meshletVertices.data());
+		writeChunk(header.meshletTriangles, data.meshletTriangles.data());
+
+		if (!file)
+		{
+			logger().warning(fmt::format("[amesh]: Can't write the file '{}'", tmpPath.string()));
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tmpPath, path, error);
+	if (error)
+	{
+		logger().warning(fmt::format("[amesh]: Can't rename '{}' to '{}': {}", tmpPath.string(), path.string(), error.message()));
+		std::filesystem::remove(tmpPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+
+bool read(std::span<const uint8_t> file, uint32_t settingsHash, MeshDataView& data)
+{
+	ENGINE_CPU_ZONE;
+
+	if (file.size() < sizeof(Header) || reinterpret_cast<uintptr_t>(file.data()) % kChunkAlignment != 0)
+	{
+		return false;
+	}
+
+	//-- The contents are aligned, so the header and all aligned chunks can be used in place.
+	const auto& header = *reinterpret_cast<const Header*>(file.data());
+	if (header.magic != kMagic || header.version != kVersion || header.settingsHash != settingsHash
+		|| header.vertexFormat.tangentFrame >= MeshResource::TangentFrame::Count)
+	{
+		return false;
+	}
+
+	//-- Streams which the mesh doesn't have are empty chunks.
+	for (size_t i = 0; i < header.streams.size(); ++i)
+	{
+		const UINT stride = MeshResource::streamStride(header.vertexFormat, static_cast<MeshResource::Stream>(i));
+		const uint64_t expectedSize = header.streams[i].size > 0 ? static_cast<uint64_t>(stride) * header.numVertices : 0;
+		if (!validChunk(header.streams[i], file.size(), expectedSize))
+		{
+			return false;
+		}
+	}
+	if (!validChunk(header.indices, file.size(), sizeof(uint32_t) * header.numIndices)
+		|| !validChunk(header.submeshes, file.size(), sizeof(SubmeshDesc) * header.numSubmeshes)
+		|| !validChunk(header.nodes, file.size(), sizeof(NodeDesc) * header.numNodes)
+		|| !validChunk(header.meshes, file.size(), sizeof(MeshDesc) * header.numMeshes)
+		|| !validChunk(header.meshInstances, file.size(), sizeof(uint32_t) * header.numMeshInstances)
+		|| !validChunk(header.lods, file.size(), sizeof(LodDesc) * header.numLods)
+		|| !validChunk(header.bones, file.size(), sizeof(BoneDesc) * header.numBones)
+		|| !validChunk(header.blendShapes, file.size(), sizeof(BlendShapeDesc) * header.numBlendShapes)
+		|| !validChunk(header.blendShapeVertices, file.size(), sizeof(uint32_t) * header.numBlendShapeDeltas)
+		|| !validChunk(header.blendShapePositionDeltas, file.size(), sizeof(math::vec3) * header.numBlendShapeDeltas)
+		|| !validChunk(header.blendShapeNormalDeltas, file.size(), sizeof(math::vec3) * header.numBlendShapeDeltas)
+		|| !validChunk(header.blendChannelWeights, file.size(), sizeof(float) * header.numBlendChannels)
+		|| !validChunk(header.meshlets, file.size(), sizeof(mesh::Meshlet) * header.numMeshlets)
+		|| !validChunk(header.meshletBounds, file.size(), sizeof(mesh::MeshletBounds) * header.numMeshlets)
+		|| !validChunk(header.meshletVertices, file.size(), sizeof(uint32_t) * header.numMeshletVertices)
+		|| !validChunk(header.meshletTriangles, file.size(), sizeof(uint32_t) * header.numMeshletTriangles))
+	{
+		return false;
+	}
+
+	//-- Pointer fixups.
+	for (size_t i = 0; i < header.streams.size(); ++i)
+	{
+		data.streams[i] = { file.data() + header.streams[i].offset, header.streams[i].size };
+	}
+	data.indices = { reinterpret_cast<const uint32_t*>(file.data() + header.indices.offset), header.numIndices };
+	data.submeshes = { reinterpret_cast<const SubmeshDesc*>(file.data() + header.submeshes.offset), header.numSubmeshes };
+	data.nodes = { reinterpret_cast<const NodeDesc*>(file.data() + header.nodes.offset), header.numNodes };
+	data.meshes = { reinterpret_cast<const MeshDesc*>(file.data() + header.meshes.offset), header.numMeshes };
+	data.meshInstances = { reinterpret_cast<const uint32_t*>(file.data() + header.meshInstances.offset), header.numMeshInstances };
+	data.lods = { reinterpret_cast<const LodDesc*>(file.data() + header.lods.offset), header.numLods };
+	data.bones = { reinterpret_cast<const BoneDesc*>(file.data() + header.bones.offset), header.numBones };
+	data.blendShapes = { reinterpret_cast<const BlendShapeDesc*>(file.data() + header.blendShapes.offset), header.numBlendShapes };
+	data.blendShapeVertices = { reinterpret_cast<const uint32_t*>(file.data() + header.blendShapeVertices.offset), header.numBlendShapeDeltas };
+	data.blendShapePositionDeltas = { reinterpret_cast<const math::vec3*>(file.data() + header.blendShapePositionDeltas.offset), header.numBlendShapeDeltas };
+	data.blendShapeNormalDeltas = { reinterpret_cast<const math::vec3*>(file.data() + header.blendShapeNormalDeltas.offset), header.numBlendShapeDeltas };
+	data.blendChannelWeights = { reinterpret_cast<const float*>(file.data() + header.blendChannelWeights.offset), header.numBlendChannels };
+	data.meshlets = { reinterpret_cast<const mesh::Meshlet*>(file.data() + header.meshlets.offset), header.numMeshlets };
+	data.meshletBounds = { reinterpret_cast<const mesh::MeshletBounds*>(file.data() + header.meshletBounds.offset), header.numMeshlets };
+	data.meshletVertices = { reinterpret_cast<const uint32_t*>(file.data() + header.meshletVertices.offset), header.numMeshletVertices };
+	data.meshletTriangles = { reinterpret_cast<const uint32_t*>(file.data() + header.meshletTriangles.offset), header.numMeshletTriangles };
+
+	//-- Draw ranges are used directly, so a broken file must not point outside of the chunks.
+	for (const auto& submesh : data.submeshes)
+	{
+		if (static_cast<uint64_t>(submesh.baseVertex) + submesh.numVertices > header.numVertices
+			|| static_cast<uint64_t>(submesh.meshletOffset) + submesh.numMeshlets > header.numMeshlets
+			|| static_cast<uint64_t>(submesh.lodOffset) + submesh.numLods > header.numLods
+			|| static_cast<uint64_t>(submesh.boneOffset) + submesh.numBones > header.numBones
+			|| static_cast<uint64_t>(submesh.blendShapeOffset) + submesh.numBlendShapes > header.numBlendShapes
+			|| static_cast<uint64_t>(submesh.startIndex) + submesh.numIndices > header.numIndices)
+		{
+			return false;
+		}
+	}
+	for (const auto& lod : data.lods)
+	{
+		if (static_cast<uint64_t>(lod.startIndex) + lod.numIndices > header.numIndices)
+		{
+			return false;
+		}
+	}
+
+	//-- World transforms are accumulated in the node order, so parents must precede their children.
+	for (size_t i = 0; i < data.nodes.size(); ++i)
+	{
+		if (data.nodes[i].parent >= static_cast<int32_t>(i) || data.nodes[i].parent < -1)
+		{
+			return false;
+		}
+	}
+	for (const auto& mesh : data.meshes)
+	{
+		if (static_cast<uint64_t>(mesh.submeshOffset) + mesh.numSubmeshes > header.numSubmeshes
+			|| static_cast<uint64_t>(mesh.instanceOffset) + mesh.numInstances > header.numMeshInstances)
+		{
+			return false;
+		}
+	}
+	for (uint32_t node : data.meshInstances)
+	{
+		if (node >= header.numNodes)
+		{
+			return false;
+		}
+	}
+	for (const auto& bone : data.bones)
+	{
+		if (bone.node >= header.numNodes)
+		{
+			return false;
+		}
+	}
+
+	//-- The blend shape evaluator writes to the vertices directly, so they have to stay inside of their submesh,
+	//-- and it starts from the decoded positions, so these have to be there.
+	for (const auto& submesh : data.submeshes)
+	{
+		if (submesh.numBlendShapes > 0 && data.streams[static_cast<size_t>(MeshResource::Stream::Position)].empty())
+		{
+			return false;
+		}
+
+		for (const auto& blendShape : data.blendShapes.subspan(submesh.blendShapeOffset, submesh.numBlendShapes))
+		{
+			if (blendShape.channel >= header.numBlendChannels
+				|| static_cast<uint64_t>(blendShape.deltaOffset) + blendShape.numDeltas > header.numBlendShapeDeltas)
+			{
+				return false;
+			}
+
+			for (uint32_t vertex : data.blendShapeVertices.subspan(blendShape.deltaOffset, blendShape.numDeltas))
+			{
+				if (vertex >= submesh.numVertices)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	//-- Skinning reads the bone palette of the submesh by the packed 8-bit indices without checks.
+	const auto boneIndices = data.streams[static_cast<size_t>(MeshResource::Stream::BoneIndices)];
+	if (!boneIndices.empty())
+	{
+		for (const auto& submesh : data.submeshes)
+		{
+			if (submesh.numBones == 0)
+			{
+				continue;
+			}
+
+			for (const uint8_t index : boneIndices.subspan(submesh.baseVertex * sizeof(uint32_t), submesh.numVertices * sizeof(uint32_t)))
+			{
+				if (index >= submesh.numBones)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	data.combinedAABB = header.combinedAABB;
+	data.numVertices = header.numVertices;
+	data.vertexFormat = header.vertexFormat;
+
+	return true;
+}
+
+} //-- engine::resources::amesh.
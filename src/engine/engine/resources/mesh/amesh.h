@@ -0,0 +1,79 @@
+#pragma once
+
+#include <engine/resources/mesh/mesh_data.h>
+
+//-- Cooked mesh container (.amesh).
+//-- The file is a header followed by chunks which are already in the GPU-ready layout,
+//-- so loading is one mapping and a couple of pointer fixups. All chunks are 16-byte aligned.
+namespace engine::resources::amesh
+{
+
+inline constexpr uint32_t kMagic = 0x48534D41; //-- "AMSH".
+//-- Bump every time the layout of the file or the produced data changes.
+inline constexpr uint32_t kVersion = 19;
+inline constexpr std::string_view kExtension = ".amesh";
+inline constexpr uint64_t kChunkAlignment = 16;
+
+struct Chunk
+{
+	uint64_t offset = 0;
+	uint64_t size = 0;
+};
+
+struct Header
+{
+	uint32_t magic = kMagic;
+	uint32_t version = kVersion;
+	uint32_t numVertices = 0;
+	uint32_t numIndices = 0;
+	uint32_t numSubmeshes = 0;
+	uint32_t settingsHash = 0; //-- MeshResource::ImportSettings::hash() of the import.
+	MeshResource::VertexFormat vertexFormat;
+	uint32_t numMeshlets = 0;
+	uint32_t numMeshletVertices = 0;
+	uint32_t numMeshletTriangles = 0;
+	uint32_t numLods = 0;
+	uint32_t numBones = 0;
+	uint32_t numNodes = 0;
+	uint32_t numMeshes = 0;
+	uint32_t numMeshInstances = 0;
+	uint32_t numBlendShapes = 0;
+	uint32_t numBlendShapeDeltas = 0;
+	uint32_t numBlendChannels = 0;
+	math::AABB combinedAABB;
+
+	std::array<Chunk, static_cast<size_t>(MeshResource::Stream::Count)> streams;
+	Chunk indices;
+	Chunk submeshes;
+	Chunk nodes;
+	Chunk meshes;
+	Chunk meshInstances;
+	Chunk lods;
+	Chunk bones;
+	Chunk blendShapes;
+	Chunk blendShapeVertices;
+	Chunk blendShapePositionDeltas;
+	Chunk blendShapeNormalDeltas;
+	Chunk blendChannelWeights;
+	Chunk meshlets;
+	Chunk meshletBounds;
+	Chunk meshletVertices;
+	Chunk meshletTriangles;
+};
+static_assert(std::is_trivially_copyable_v<Header>);
+
+//-- Returns the path of the cooked file for the source asset.
+inline std::string cookedPath(std::string_view sourcePath)
+{
+	return std::string(sourcePath) + kExtension.data();
+}
+
+//-- Writes the cooked file. The file is written to a temporary file first and renamed,
+//-- so a reader never observes a partially written file.
+bool write(const std::filesystem::path& path, uint32_t settingsHash, const MeshDataView& data);
+
+//-- Validates the file contents and points the view into them. The view is valid while the contents are alive.
+//-- Contents must be at least 16-byte aligned, which both mappings and heap buffers are. Files cooked with other import settings are rejected.
+bool read(std::span<const uint8_t> file, uint32_t settingsHash, MeshDataView& data);
+
+} //-- engine::resources::amesh.
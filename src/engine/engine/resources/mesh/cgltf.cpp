@@ -0,0 +1,3 @@
+//-- The implementation of the single header glTF loader.
+#define CGLTF_IMPLEMENTATION
+#include <cgltf.h>
@@ -0,0 +1,483 @@
+#include <engine/resources/mesh/mesh_bounds.h>
+#include <engine/resources/mesh/simd.h>
+
+namespace engine::resources::mesh
+{
+
+namespace
+{
+
+//-- Directions of EPOS-14, not normalized: only the order of projections along each of them matters.
+inline constexpr size_t kNumDirections = 7;
+inline constexpr std::array<std::array<float, 3>, kNumDirections> kDirections =
+{{
+	{ 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f },
+	{ 1.0f, 1.0f, 1.0f }, { 1.0f, 1.0f, -1.0f }, { 1.0f, -1.0f, 1.0f }, { 1.0f, -1.0f, -1.0f }
+}};
+
+//-- Keeps values where the mask is set, SSE2 has no blend.
+FORCE_INLINE __m128 select(__m128 mask, __m128 whenTrue, __m128 whenFalse)
+{
+	return _mm_or_ps(_mm_and_ps(mask, whenTrue), _mm_andnot_ps(mask, whenFalse));
+}
+
+
+FORCE_INLINE __m128i select(__m128i mask, __m128i whenTrue, __m128i whenFalse)
+{
+	return _mm_or_si128(_mm_and_si128(mask, whenTrue), _mm_andnot_si128(mask, whenFalse));
+}
+
+
+FORCE_INLINE float dot(const math::vec3& lhs, const std::array<float, 3>& rhs)
+{
+	return lhs.x * rhs[0] + lhs.y * rhs[1] + lhs.z * rhs[2];
+}
+
+
+//-- Indices of the vertices with the smallest and the largest projection along every direction.
+void findExtremePoints(std::span<const math::vec3> positions, std::array<uint32_t, kNumDirections>& minIndices,
+	std::array<uint32_t, kNumDirections>& maxIndices)
+{
+	std::array<float, kNumDirections> minValues;
+	std::array<float, kNumDirections> maxValues;
+	minValues.fill(std::numeric_limits<float>::max());
+	maxValues.fill(std::numeric_limits<float>::lowest());
+	minIndices.fill(0);
+	maxIndices.fill(0);
+
+	const float* source = reinterpret_cast<const float*>(positions.data());
+	size_t i = 0;
+	if (positions.size() >= 4)
+	{
+		//-- Every lane tracks its own extremes, they are reduced after the loop.
+		__m128 laneMin[kNumDirections];
+		__m128 laneMax[kNumDirections];
+		__m128i laneMinIndex[kNumDirections];
+		__m128i laneMaxIndex[kNumDirections];
+		for (size_t d = 0; d < kNumDirections; ++d)
+		{
+			laneMin[d] = _mm_set1_ps(std::numeric_limits<float>::max());
+			laneMax[d] = _mm_set1_ps(std::numeric_limits<float>::lowest());
+			laneMinIndex[d] = _mm_setzero_si128();
+			laneMaxIndex[d] = _mm_setzero_si128();
+		}
+
+		__m128i index = _mm_setr_epi32(0, 1, 2, 3);
+		const __m128i step = _mm_set1_epi32(4);
+		for (; i + 4 <= positions.size(); i += 4)
+		{
+			__m128 x, y, z;
+			loadVec3x4(source + i * 3, x, y, z);
+
+			const __m128 projections[kNumDirections] =
+			{
+				x, y, z,
+				_mm_add_ps(_mm_add_ps(x, y), z),
+				_mm_sub_ps(_mm_add_ps(x, y), z),
+				_mm_add_ps(_mm_sub_ps(x, y), z),
+				_mm_sub_ps(_mm_sub_ps(x, y), z)
+			};
+
+			for (size_t d = 0; d < kNumDirections; ++d)
+			{
+				const __m128 less = _mm_cmplt_ps(projections[d], laneMin[d]);
+				laneMin[d] = select(less, projections[d], laneMin[d]);
+				laneMinIndex[d] = select(_mm_castps_si128(less), index, laneMinIndex[d]);
+
+				const __m128 greater = _mm_cmpgt_ps(projections[d], laneMax[d]);
+				laneMax[d] = select(greater, projections[d], laneMax[d]);
+				laneMaxIndex[d] = select(_mm_castps_si128(greater), index, laneMaxIndex[d]);
+			}
+			index = _mm_add_epi32(index, step);
+		}
+
+		for (size_t d = 0; d < kNumDirections; ++d)
+		{
+			alignas(16) float mins[4];
+			alignas(16) float maxs[4];
+			alignas(16) uint32_t minIds[4];
+			alignas(16) uint32_t maxIds[4];
+			_mm_store_ps(mins, laneMin[d]);
+			_mm_store_ps(maxs, laneMax[d]);
+			_mm_store_si128(reinterpret_cast<__m128i*>(minIds), laneMinIndex[d]);
+			_mm_store_si128(reinterpret_cast<__m128i*>(maxIds), laneMaxIndex[d]);
+			for (size_t lane = 0; lane < 4; ++lane)
+			{
+				if (mins[lane] < minValues[d])
+				{
+					minValues[d] = mins[lane];
+					minIndices[d] = minIds[lane];
+				}
+				if (maxs[lane] > maxValues[d])
+				{
+					maxValues[d] = maxs[lane];
+					maxIndices[d] = maxIds[lane];
+				}
+			}
+		}
+	}
+
+	for (; i < positions.size(); ++i)
+	{
+		for (size_t d = 0; d < kNumDirections; ++d)
+		{
+			const float projection = dot(positions[i], kDirections[d]);
+			if (projection < minValues[d])
+			{
+				minValues[d] = projection;
+				minIndices[d] = static_cast<uint32_t>(i);
+			}
+			if (projection > maxValues[d])
+			{
+				maxValues[d] = projection;
+				maxIndices[d] = static_cast<uint32_t>(i);
+			}
+		}
+	}
+}
+
+
+//-- Ritter's growth step: the new sphere touches the outlier and contains the old sphere.
+FORCE_INLINE void growSphere(math::vec3& center, float& radius, const math::vec3& position)
+{
+	const math::vec3 offset = position - center;
+	const float distance = offset.Length();
+	if (distance > radius)
+	{
+		const float newRadius = (radius + distance) * 0.5f;
+		center += offset * ((newRadius - radius) / distance);
+		radius = newRadius;
+	}
+}
+
+
+//-- Eigenvectors of a symmetric 3x3 matrix with cyclic Jacobi rotations. Columns of the result are the vectors.
+std::array<std::array<float, 3>, 3> eigenVectors(std::array<std::array<float, 3>, 3> a)
+{
+	static constexpr size_t kMaxSweeps = 32;
+
+	std::array<std::array<float, 3>, 3> v = {{ { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } }};
+	for (size_t sweep = 0; sweep < kMaxSweeps; ++sweep)
+	{
+		const float offDiagonal = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+		const float diagonal = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+		if (offDiagonal <= diagonal * 1e-12f)
+		{
+			break;
+		}
+
+		for (size_t p = 0; p < 2; ++p)
+		{
+			for (size_t q = p + 1; q < 3; ++q)
+			{
+				if (a[p][q] == 0.0f)
+				{
+					continue;
+				}
+
+				//-- The rotation which zeroes a[p][q], see Numerical Recipes 11.1.
+				const float theta = (a[q][q] - a[p][p]) / (2.0f * a[p][q]);
+				const float t = (theta >= 0.0f ? 1.0f : -1.0f) / (std::abs(theta) + std::sqrt(theta * theta + 1.0f));
+				const float c = 1.0f / std::sqrt(t * t + 1.0f);
+				const float s = t * c;
+
+				for (size_t k = 0; k < 3; ++k)
+				{
+					const float akp = a[k][p];
+					const float akq = a[k][q];
+					a[k][p] = c * akp - s * akq;
+					a[k][q] = s * akp + c * akq;
+				}
+				for (size_t k = 0; k < 3; ++k)
+				{
+					const float apk = a[p][k];
+					const float aqk = a[q][k];
+					a[p][k] = c * apk - s * aqk;
+					a[q][k] = s * apk + c * aqk;
+				}
+				for (size_t k = 0; k < 3; ++k)
+				{
+					const float vkp = v[k][p];
+					const float vkq = v[k][q];
+					v[k][p] = c * vkp - s * vkq;
+					v[k][q] = s * vkp + c * vkq;
+				}
+			}
+		}
+	}
+
+	return v;
+}
+
+} //-- unnamed.
+
+
+math::AABB computeAABB(std::span<const math::vec3> positions)
+{
+	ENGINE_CPU_ZONE;
+
+	math::AABB result;
+	const float* source = reinterpret_cast<const float*>(positions.data());
+	size_t i = 0;
+	if (positions.size() >= 4)
+	{
+		__m128 minX = _mm_set1_ps(std::numeric_limits<float>::max());
+		__m128 minY = minX;
+		__m128 minZ = minX;
+		__m128 maxX = _mm_set1_ps(std::numeric_limits<float>::lowest());
+		__m128 maxY = maxX;
+		__m128 maxZ = maxX;
+		for (; i + 4 <= positions.size(); i += 4)
+		{
+			__m128 x, y, z;
+			loadVec3x4(source + i * 3, x, y, z);
+			minX = _mm_min_ps(minX, x);
+			minY = _mm_min_ps(minY, y);
+			minZ = _mm_min_ps(minZ, z);
+			maxX = _mm_max_ps(maxX, x);
+			maxY = _mm_max_ps(maxY, y);
+			maxZ = _mm_max_ps(maxZ, z);
+		}
+
+		result.m_min = math::vec3(horizontalMin(minX), horizontalMin(minY), horizontalMin(minZ));
+		result.m_max = math::vec3(horizontalMax(maxX), horizontalMax(maxY), horizontalMax(maxZ));
+	}
+
+	for (; i < positions.size(); ++i)
+	{
+		result.extend(positions[i]);
+	}
+
+	return result;
+}
+
+
+math::Sphere computeBoundingSphere(std::span<const math::vec3> positions)
+{
+	ENGINE_CPU_ZONE;
+
+	if (positions.empty())
+	{
+		return math::Sphere();
+	}
+
+	//-- Step 1. The most distant pair of the extreme points spans the initial sphere.
+	std::array<uint32_t, kNumDirections> minIndices;
+	std::array<uint32_t, kNumDirections> maxIndices;
+	findExtremePoints(positions, minIndices, maxIndices);
+
+	size_t bestDirection = 0;
+	float bestDistance = -1.0f;
+	for (size_t d = 0; d < kNumDirections; ++d)
+	{
+		const float distance = (positions[maxIndices[d]] - positions[minIndices[d]]).LengthSquared();
+		if (distance > bestDistance)
+		{
+			bestDistance = distance;
+			bestDirection = d;
+		}
+	}
+
+	math::vec3 center = (positions[minIndices[bestDirection]] + positions[maxIndices[bestDirection]]) * 0.5f;
+	float radius = std::sqrt(bestDistance) * 0.5f;
+
+	//-- Step 2. Grow it to include outliers. They are rare after a good initial sphere, so four vertices are tested at once
+	//-- and only the batches with outliers take the scalar path.
+	const float* source = reinterpret_cast<const float*>(positions.data());
+	size_t i = 0;
+	for (; i + 4 <= positions.size(); i += 4)
+	{
+		__m128 x, y, z;
+		loadVec3x4(source + i * 3, x, y, z);
+		const __m128 dx = _mm_sub_ps(x, _mm_set1_ps(center.x));
+		const __m128 dy = _mm_sub_ps(y, _mm_set1_ps(center.y));
+		const __m128 dz = _mm_sub_ps(z, _mm_set1_ps(center.z));
+		const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		int outliers = _mm_movemask_ps(_mm_cmpgt_ps(distance, _mm_set1_ps(radius * radius)));
+		for (size_t lane = 0; outliers != 0; ++lane, outliers >>= 1)
+		{
+			if (outliers & 1)
+			{
+				growSphere(center, radius, positions[i + lane]);
+			}
+		}
+	}
+
+	for (; i < positions.size(); ++i)
+	{
+		growSphere(center, radius, positions[i]);
+	}
+
+	//-- Compensate the rounding of the growth steps, so the sphere stays conservative.
+	return math::Sphere(center, radius * (1.0f + 1e-5f));
+}
+
+
+math::OBB computeOBB(std::span<const math::vec3> positions, const math::AABB& aabb)
+{
+	ENGINE_CPU_ZONE;
+
+	if (positions.size() < 4)
+	{
+		return positions.empty() ? math::OBB() : math::OBB(aabb.m_min, aabb.m_max);
+	}
+
+	//-- Step 1. Covariance of the vertices. Values are taken relative to the AABB center to keep float sums precise,
+	//-- per lane sums are reduced in double.
+	const math::vec3 origin = (aabb.m_min + aabb.m_max) * 0.5f;
+	const __m128 originX = _mm_set1_ps(origin.x);
+	const __m128 originY = _mm_set1_ps(origin.y);
+	const __m128 originZ = _mm_set1_ps(origin.z);
+
+	//-- x, y, z, xx, yy, zz, xy, xz, yz.
+	__m128 sums[9];
+	std::fill(std::begin(sums), std::end(sums), _mm_setzero_ps());
+	const float* source = reinterpret_cast<const float*>(positions.data());
+	size_t i = 0;
+	for (; i + 4 <= positions.size(); i += 4)
+	{
+		__m128 x, y, z;
+		loadVec3x4(source + i * 3, x, y, z);
+		x = _mm_sub_ps(x, originX);
+		y = _mm_sub_ps(y, originY);
+		z = _mm_sub_ps(z, originZ);
+
+		sums[0] = _mm_add_ps(sums[0], x);
+		sums[1] = _mm_add_ps(sums[1], y);
+		sums[2] = _mm_add_ps(sums[2], z);
+		sums[3] = _mm_add_ps(sums[3], _mm_mul_ps(x, x));
+		sums[4] = _mm_add_ps(sums[4], _mm_mul_ps(y, y));
+		sums[5] = _mm_add_ps(sums[5], _mm_mul_ps(z, z));
+		sums[6] = _mm_add_ps(sums[6], _mm_mul_ps(x, y));
+		sums[7] = _mm_add_ps(sums[7], _mm_mul_ps(x, z));
+		sums[8] = _mm_add_ps(sums[8], _mm_mul_ps(y, z));
+	}
+
+	std::array<double, 9> total = {};
+	for (size_t k = 0; k < total.size(); ++k)
+	{
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, sums[k]);
+		total[k] = static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+	}
+	for (; i < positions.size(); ++i)
+	{
+		const math::vec3 p = positions[i] - origin;
+		const std::array<double, 9> values = { p.x, p.y, p.z, p.x * p.x, p.y * p.y, p.z * p.z, p.x * p.y, p.x * p.z, p.y * p.z };
+		for (size_t k = 0; k < values.size(); ++k)
+		{
+			total[k] += values[k];
+		}
+	}
+
+	const double n = static_cast<double>(positions.size());
+	const double mx = total[0] / n;
+	const double my = total[1] / n;
+	const double mz = total[2] / n;
+	const float cxx = static_cast<float>(total[3] / n - mx * mx);
+	const float cyy = static_cast<float>(total[4] / n - my * my);
+	const float czz = static_cast<float>(total[5] / n - mz * mz);
+	const float cxy = static_cast<float>(total[6] / n - mx * my);
+	const float cxz = static_cast<float>(total[7] / n - mx * mz);
+	const float cyz = static_cast<float>(total[8] / n - my * mz);
+
+	//-- Step 2. Principal axes.
+	const auto vectors = eigenVectors({{ { cxx, cxy, cxz }, { cxy, cyy, cyz }, { cxz, cyz, czz } }});
+	std::array<math::vec3, 3> axes;
+	for (size_t k = 0; k < 3; ++k)
+	{
+		axes[k] = math::vec3(vectors[0][k], vectors[1][k], vectors[2][k]);
+		axes[k].Normalize();
+	}
+	//-- Re-orthogonalize and make the basis right-handed.
+	axes[2] = axes[0].Cross(axes[1]);
+	axes[2].Normalize();
+	axes[1] = axes[2].Cross(axes[0]);
+
+	//-- Step 3. Extents along the axes.
+	__m128 laneMin[3];
+	__m128 laneMax[3];
+	__m128 axisLanes[3][3];
+	for (size_t k = 0; k < 3; ++k)
+	{
+		laneMin[k] = _mm_set1_ps(std::numeric_limits<float>::max());
+		laneMax[k] = _mm_set1_ps(std::numeric_limits<float>::lowest());
+		axisLanes[k][0] = _mm_set1_ps(axes[k].x);
+		axisLanes[k][1] = _mm_set1_ps(axes[k].y);
+		axisLanes[k][2] = _mm_set1_ps(axes[k].z);
+	}
+
+	i = 0;
+	for (; i + 4 <= positions.size(); i += 4)
+	{
+		__m128 x, y, z;
+		loadVec3x4(source + i * 3, x, y, z);
+		x = _mm_sub_ps(x, originX);
+		y = _mm_sub_ps(y, originY);
+		z = _mm_sub_ps(z, originZ);
+		for (size_t k = 0; k < 3; ++k)
+		{
+			const __m128 projection = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, axisLanes[k][0]), _mm_mul_ps(y, axisLanes[k][1])), _mm_mul_ps(z, axisLanes[k][2]));
+			laneMin[k] = _mm_min_ps(laneMin[k], projection);
+			laneMax[k] = _mm_max_ps(laneMax[k], projection);
+		}
+	}
+
+	std::array<float, 3> mins;
+	std::array<float, 3> maxs;
+	for (size_t k = 0; k < 3; ++k)
+	{
+		mins[k] = horizontalMin(laneMin[k]);
+		maxs[k] = horizontalMax(laneMax[k]);
+	}
+	for (; i < positions.size(); ++i)
+	{
+		const math::vec3 p = positions[i] - origin;
+		for (size_t k = 0; k < 3; ++k)
+		{
+			const float projection = p.Dot(axes[k]);
+			mins[k] = std::min(mins[k], projection);
+			maxs[k] = std::max(maxs[k], projection);
+		}
+	}
+
+	math::OBB result;
+	result.m_axes = axes;
+	result.m_center = origin;
+	for (size_t k = 0; k < 3; ++k)
+	{
+		result.m_center += axes[k] * ((mins[k] + maxs[k]) * 0.5f);
+	}
+	result.m_extents = math::vec3(maxs[0] - mins[0], maxs[1] - mins[1], maxs[2] - mins[2]) * 0.5f;
+
+	//-- PCA isn't optimal, e.g. for boxes with uniform vertex distribution, so keep the AABB if it's tighter.
+	const math::vec3 aabbSize = aabb.m_max - aabb.m_min;
+	const math::vec3 obbSize = result.m_extents * 2.0f;
+	if (obbSize.x * obbSize.y * obbSize.z >= aabbSize.x * aabbSize.y * aabbSize.z)
+	{
+		return math::OBB(aabb.m_min, aabb.m_max);
+	}
+
+	return result;
+}
+
+
+math::AABB transformAABB(const math::AABB& aabb, const math::matrix& transform)
+{
+	if (aabb.m_min.x > aabb.m_max.x)
+	{
+		return aabb;
+	}
+
+	//-- The center is transformed as a point, the extents along every axis sum up the absolute contributions of the rows.
+	const math::vec3 center = math::vec3::Transform((aabb.m_min + aabb.m_max) * 0.5f, transform);
+	const math::vec3 extents = (aabb.m_max - aabb.m_min) * 0.5f;
+	const math::vec3 worldExtents(
+		std::abs(transform._11) * extents.x + std::abs(transform._21) * extents.y + std::abs(transform._31) * extents.z,
+		std::abs(transform._12) * extents.x + std::abs(transform._22) * extents.y + std::abs(transform._32) * extents.z,
+		std::abs(transform._13) * extents.x + std::abs(transform._23) * extents.y + std::abs(transform._33) * extents.z);
+
+	return math::AABB(center - worldExtents, center + worldExtents);
+}
+
+} //-- engine::resources::mesh.
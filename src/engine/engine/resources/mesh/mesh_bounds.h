@@ -0,0 +1,25 @@
+#pragma once
+
+#include <engine/math/aabb.h>
+#include <engine/math/obb.h>
+#include <engine/math/sphere.h>
+
+//-- Bounding volumes of vertex streams for culling and levels of detail.
+//-- Vertices are processed four at a time with SSE min/max reductions, tails are handled by the scalar path.
+namespace engine::resources::mesh
+{
+
+//-- Exact AABB. Empty positions give an empty (inverted) box.
+math::AABB computeAABB(std::span<const math::vec3> positions);
+
+//-- Near-minimal bounding sphere: the initial sphere spans the most distant pair of extreme points along 7 directions (EPOS-14,
+//-- Larsson 2008), then it grows to include outliers like in Ritter's algorithm. Usually within a few percent of the minimal one.
+math::Sphere computeBoundingSphere(std::span<const math::vec3> positions);
+
+//-- Box along the principal axes of the vertices. Falls back to the AABB if that one is smaller, so it's never worse.
+math::OBB computeOBB(std::span<const math::vec3> positions, const math::AABB& aabb);
+
+//-- AABB of the transformed box. Empty boxes stay empty.
+math::AABB transformAABB(const math::AABB& aabb, const math::matrix& transform);
+
+} //-- engine::resources::mesh.
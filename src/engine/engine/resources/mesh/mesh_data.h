@@ -0,0 +1,173 @@
+#pragma once
+
+#include <engine/resources/mesh_resource.h>
+#include <engine/resources/mesh/meshlet_builder.h>
+#include <engine/math/obb.h>
+#include <engine/math/sphere.h>
+
+namespace engine::resources
+{
+
+//-- A level of detail of a submesh: a range in the combined index buffer over the vertices of the submesh.
+struct LodDesc
+{
+	uint32_t startIndex = 0;
+	uint32_t numIndices = 0;
+	float error = 0.0f; //-- Object space deviation from the full detail, see mesh::simplify.
+};
+static_assert(std::is_trivially_copyable_v<LodDesc>, "LodDesc is stored in cooked files as is!");
+
+//-- An entry of the bone palette of a submesh, see MeshResource::Bone.
+struct BoneDesc
+{
+	uint32_t node = 0;
+	math::matrix geometryToBone;
+};
+static_assert(std::is_trivially_copyable_v<BoneDesc>, "BoneDesc is stored in cooked files as is!");
+
+//-- A node of the scene hierarchy. Nodes are flattened, so a parent always precedes its children.
+struct NodeDesc
+{
+	int32_t parent = -1; //-- -1 for the root.
+	uint32_t reserved = 0;
+	math::matrix nodeToParent;
+	math::matrix geometryToNode; //-- Transform of the geometry attached to the node, it doesn't affect the children.
+};
+static_assert(std::is_trivially_copyable_v<NodeDesc>, "NodeDesc is stored in cooked files as is!");
+
+//-- A mesh of the scene: consecutive submeshes which are drawn once per instance node.
+struct MeshDesc
+{
+	uint32_t submeshOffset = 0;
+	uint32_t numSubmeshes = 0;
+	uint32_t instanceOffset = 0; //-- The first node in MeshData::meshInstances.
+	uint32_t numInstances = 0;
+};
+static_assert(std::is_trivially_copyable_v<MeshDesc>, "MeshDesc is stored in cooked files as is!");
+
+//-- A blend shape target of a submesh: a run of sparse deltas sorted by the vertex, see MeshResource::Submesh::blendShapes.
+struct BlendShapeDesc
+{
+	uint32_t channel = 0; //-- Index of the blend channel in the scene and in MeshData::blendChannelWeights.
+	uint32_t deltaOffset = 0; //-- The first delta in MeshData::blendShapeVertices and the delta arrays.
+	uint32_t numDeltas = 0;
+	uint32_t hasNormals = 0; //-- Zero if the target doesn't change normals, its normal deltas are zero then.
+};
+static_assert(std::is_trivially_copyable_v<BlendShapeDesc>, "BlendShapeDesc is stored in cooked files as is!");
+
+//-- Description of a single draw part in the combined buffers.
+struct SubmeshDesc
+{
+	uint32_t numVertices = 0;
+	uint32_t numIndices = 0;
+	uint32_t startIndex = 0;
+	uint32_t baseVertex = 0;
+	uint32_t meshletOffset = 0;
+	uint32_t numMeshlets = 0;
+	uint32_t lodOffset = 0; //-- The first level in MeshData::lods, the level 0 is the full detail.
+	uint32_t numLods = 0;
+	uint32_t boneOffset = 0; //-- The first entry of the palette in MeshData::bones.
+	uint32_t numBones = 0; //-- Zero if the submesh isn't skinned. At most 256, the bone streams store 8-bit indices.
+	uint32_t blendShapeOffset = 0; //-- The first target in MeshData::blendShapes.
+	uint32_t numBlendShapes = 0;
+	//-- Bounds of the vertices of the submesh.
+	math::AABB aabb;
+	math::Sphere sphere;
+	math::OBB obb; //-- Equals the AABB if oriented bounds aren't computed.
+};
+static_assert(std::is_trivially_copyable_v<SubmeshDesc>, "SubmeshDesc is stored in cooked files as is!");
+
+//-- Non-owning view of GPU-ready mesh data.
+//-- It may point either to the importer output or directly into a mapped cooked file.
+struct MeshDataView
+{
+	using Streams = std::array<std::span<const uint8_t>, static_cast<size_t>(MeshResource::Stream::Count)>;
+
+	Streams streams;
+	std::span<const uint32_t> indices;
+	std::span<const SubmeshDesc> submeshes;
+	std::span<const NodeDesc> nodes;
+	std::span<const MeshDesc> meshes;
+	std::span<const uint32_t> meshInstances;
+	std::span<const LodDesc> lods;
+	std::span<const BoneDesc> bones;
+	std::span<const BlendShapeDesc> blendShapes;
+	std::span<const uint32_t> blendShapeVertices;
+	std::span<const math::vec3> blendShapePositionDeltas;
+	std::span<const math::vec3> blendShapeNormalDeltas;
+	std::span<const float> blendChannelWeights;
+	std::span<const mesh::Meshlet> meshlets;
+	std::span<const mesh::MeshletBounds> meshletBounds;
+	std::span<const uint32_t> meshletVertices;
+	std::span<const uint32_t> meshletTriangles;
+	math::AABB combinedAABB;
+	uint32_t numVertices = 0;
+	MeshResource::VertexFormat vertexFormat;
+};
+
+//-- Importer output. All streams are tightly packed with MeshResource::streamStride(vertexFormat, stream) strides.
+struct MeshData
+{
+	using Streams = std::array<std::vector<uint8_t>, static_cast<size_t>(MeshResource::Stream::Count)>;
+
+	MeshDataView view() const
+	{
+		MeshDataView result;
+		for (size_t i = 0; i < streams.size(); ++i)
+		{
+			result.streams[i] = streams[i];
+		}
+		result.indices = indices;
+		result.submeshes = submeshes;
+		result.nodes = nodes;
+		result.meshes = meshes;
+		result.meshInstances = meshInstances;
+		result.lods = lods;
+		result.bones = bones;
+		result.blendShapes = blendShapes;
+		result.blendShapeVertices = blendShapeVertices;
+		result.blendShapePositionDeltas = blendShapePositionDeltas;
+		result.blendShapeNormalDeltas = blendShapeNormalDeltas;
+		result.blendChannelWeights = blendChannelWeights;
+		result.meshlets = meshlets;
+		result.meshletBounds = meshletBounds;
+		result.meshletVertices = meshletVertices;
+		result.meshletTriangles = meshletTriangles;
+		result.combinedAABB = combinedAABB;
+		result.numVertices = numVertices;
+		result.vertexFormat = vertexFormat;
+
+		return result;
+	}
+
+	Streams streams;
+	std::vector<uint32_t> indices;
+	std::vector<SubmeshDesc> submeshes;
+	//-- Hierarchy of the scene, see mesh::flattenNodes. Bones and instances refer to these nodes.
+	std::vector<NodeDesc> nodes;
+	//-- Every mesh of the scene is stored once, no matter how many nodes instance it.
+	std::vector<MeshDesc> meshes;
+	std::vector<uint32_t> meshInstances;
+	//-- Levels of detail of all submeshes. Simplified indices follow the full detail indices of all submeshes.
+	std::vector<LodDesc> lods;
+	//-- Bone palettes of all submeshes.
+	std::vector<BoneDesc> bones;
+	//-- Blend shape targets of all submeshes. Deltas address vertices relative to the base vertex of the submesh
+	//-- and are applied to the float streams, so they don't depend on the vertex format.
+	std::vector<BlendShapeDesc> blendShapes;
+	std::vector<uint32_t> blendShapeVertices;
+	std::vector<math::vec3> blendShapePositionDeltas;
+	std::vector<math::vec3> blendShapeNormalDeltas;
+	//-- Default weights of all blend channels of the scene.
+	std::vector<float> blendChannelWeights;
+	//-- Meshlets of all submeshes. Offsets in meshlets are absolute, vertices are relative to the base vertex of the submesh.
+	std::vector<mesh::Meshlet> meshlets;
+	std::vector<mesh::MeshletBounds> meshletBounds;
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint32_t> meshletTriangles;
+	math::AABB combinedAABB;
+	uint32_t numVertices = 0;
+	MeshResource::VertexFormat vertexFormat;
+};
+
+} //-- engine::resources.
@@ -0,0 +1,405 @@
+#include <engine/resources/mesh/mesh_optimizer.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace engine::resources::mesh
+{
+
+namespace
+{
+
+inline constexpr uint32_t kInvalidIndex = ~0u;
+//-- Of the vertex cache pass, which needs the most.
+inline constexpr size_t kMaxAllocations = 8;
+
+//-- FIFO cache simulated with insertion timestamps: a vertex is in the cache while
+//-- less than cacheSize vertices were inserted after it.
+class FifoCache
+{
+public:
+	FifoCache(size_t numVertices, uint32_t cacheSize, utils::LinearArena& scratch)
+		: m_timestamps(scratch.allocate<uint32_t>(numVertices)), m_time(cacheSize + 1), m_cacheSize(cacheSize) { }
+
+	bool contains(uint32_t vertex) const { return m_time - m_timestamps[vertex] <= m_cacheSize; }
+	uint32_t age(uint32_t vertex) const { return m_time - m_timestamps[vertex]; }
+
+	//-- Returns true if the vertex wasn't in the cache.
+	bool touch(uint32_t vertex)
+	{
+		if (contains(vertex))
+		{
+			return false;
+		}
+
+		m_timestamps[vertex] = m_time++;
+		return true;
+	}
+
+	uint32_t touchTriangle(const uint32_t* triangle)
+	{
+		return static_cast<uint32_t>(touch(triangle[0])) + touch(triangle[1]) + touch(triangle[2]);
+	}
+
+	void flush() { m_time += m_cacheSize + 1; }
+
+private:
+	std::span<uint32_t> m_timestamps;
+	uint32_t m_time = 0;
+	uint32_t m_cacheSize = 0;
+};
+
+} //-- unnamed.
+
+
+size_t optimizerScratchSize(size_t numIndices, size_t numVertices)
+{
+	//-- The vertex cache pass: the live triangles, the adjacency offsets and their fill cursors, the timestamps, the adjacency,
+	//-- the dead end stack, the candidates and the emitted flags. The other passes need less.
+	return (4 * numVertices + 1 + 3 * numIndices) * sizeof(uint32_t) + numIndices / 3 * sizeof(bool)
+		+ kMaxAllocations * alignof(std::max_align_t);
+}
+
+
+VertexCacheStatistics analyzeVertexCache(std::span<const uint32_t> indices, size_t numVertices, utils::LinearArena& scratch, uint32_t cacheSize)
+{
+	VertexCacheStatistics result;
+	if (indices.empty())
+	{
+		return result;
+	}
+
+	FifoCache cache(numVertices, cacheSize, scratch);
+	auto used = scratch.allocate<bool>(numVertices);
+	size_t numUsed = 0;
+	for (uint32_t index : indices)
+	{
+		result.verticesTransformed += cache.touch(index);
+		if (!used[index])
+		{
+			used[index] = true;
+			++numUsed;
+		}
+	}
+
+	result.acmr = static_cast<float>(result.verticesTransformed) / static_cast<float>(indices.size() / 3);
+	result.atvr = static_cast<float>(result.verticesTransformed) / static_cast<float>(numUsed);
+
+	return result;
+}
+
+
+size_t optimizeVertexCache(std::span<uint32_t> destination, std::span<const uint32_t> indices, size_t numVertices,
+	utils::LinearArena& scratch, std::span<uint32_t> clusters, uint32_t cacheSize)
+{
+	const size_t numTriangles = indices.size() / 3;
+	if (numTriangles == 0)
+	{
+		return 0;
+	}
+
+	//-- Vertex -> triangles adjacency.
+	auto liveTriangles = scratch.allocate<uint32_t>(numVertices);
+	for (uint32_t index : indices)
+	{
+		++liveTriangles[index];
+	}
+
+	auto adjacencyOffsets = scratch.allocate<uint32_t>(numVertices + 1);
+	std::inclusive_scan(liveTriangles.begin(), liveTriangles.end(), adjacencyOffsets.begin() + 1);
+
+	auto adjacency = scratch.allocate<uint32_t>(indices.size());
+	{
+		auto fill = scratch.allocate<uint32_t>(numVertices);
+		std::copy_n(adjacencyOffsets.begin(), numVertices, fill.begin());
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	FifoCache cache(numVertices, cacheSize, scratch);
+	auto emitted = scratch.allocate<bool>(numTriangles);
+	//-- Every emitted corner is pushed once, so the stack never holds more than all corners. Neither do the candidates.
+	auto deadEnds = scratch.allocate<uint32_t>(indices.size());
+	size_t numDeadEnds = 0;
+	auto candidates = scratch.allocate<uint32_t>(indices.size());
+	size_t numCandidates = 0;
+	size_t numClusters = 0;
+	size_t cursor = 0;
+	size_t written = 0;
+
+	//-- Picks a vertex with live triangles when the 1-ring of the fanning vertex is exhausted.
+	auto skipDeadEnd = [&]() -> int64_t
+		{
+			while (numDeadEnds > 0)
+			{
+				uint32_t vertex = deadEnds[--numDeadEnds];
+				if (liveTriangles[vertex] > 0)
+				{
+					return vertex;
+				}
+			}
+
+			for (; cursor < numVertices; ++cursor)
+			{
+				if (liveTriangles[cursor] > 0)
+				{
+					return static_cast<int64_t>(cursor);
+				}
+			}
+
+			return -1;
+		};
+
+	int64_t fanning = skipDeadEnd();
+	bool clusterStart = true;
+	while (fanning >= 0)
+	{
+		//-- Emit all not emitted triangles around the fanning vertex.
+		numCandidates = 0;
+		for (uint32_t i = adjacencyOffsets[fanning]; i < adjacencyOffsets[fanning + 1]; ++i)
+		{
+			const uint32_t triangle = adjacency[i];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+
+			if (clusterStart && !clusters.empty())
+			{
+				clusters[numClusters++] = static_cast<uint32_t>(written / 3);
+			}
+			clusterStart = false;
+
+			for (size_t k = 0; k < 3; ++k)
+			{
+				const uint32_t vertex = indices[triangle * 3 + k];
+				destination[written++] = vertex;
+				deadEnds[numDeadEnds++] = vertex;
+				candidates[numCandidates++] = vertex;
+				--liveTriangles[vertex];
+				cache.touch(vertex);
+			}
+			emitted[triangle] = true;
+		}
+
+		//-- Select the next fanning vertex among the candidates: prefer the oldest one which will
+		//-- still be in the cache after its remaining triangles are emitted.
+		fanning = -1;
+		int64_t bestPriority = -1;
+		for (uint32_t vertex : candidates.first(numCandidates))
+		{
+			if (liveTriangles[vertex] == 0)
+			{
+				continue;
+			}
+
+			int64_t priority = 0;
+			if (cache.age(vertex) + 2 * liveTriangles[vertex] <= cacheSize)
+			{
+				priority = cache.age(vertex);
+			}
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				fanning = vertex;
+			}
+		}
+
+		if (fanning < 0)
+		{
+			fanning = skipDeadEnd();
+			clusterStart = true;
+		}
+	}
+
+	return numClusters;
+}
+
+
+void optimizeOverdraw(std::span<uint32_t> destination, std::span<const uint32_t> indices, std::span<const float> positions,
+	std::span<const uint32_t> clusters, float threshold, utils::LinearArena& scratch, uint32_t cacheSize)
+{
+	const size_t numTriangles = indices.size() / 3;
+	const size_t numVertices = positions.size() / 3;
+	if (numTriangles == 0)
+	{
+		return;
+	}
+
+	static constexpr uint32_t kWholeMesh[] = { 0 };
+	if (clusters.empty())
+	{
+		clusters = kWholeMesh;
+	}
+
+	//-- Split hard clusters further while the running ACMR is within the threshold of the cluster ACMR.
+	//-- Every triangle starts at most one cluster.
+	auto softClusterStorage = scratch.allocate<uint32_t>(numTriangles);
+	size_t numSoftClusters = 0;
+	{
+		FifoCache cache(numVertices, cacheSize, scratch);
+		for (size_t it = 0; it < clusters.size(); ++it)
+		{
+			const size_t begin = clusters[it];
+			const size_t end = it + 1 < clusters.size() ? clusters[it + 1] : numTriangles;
+
+			cache.flush();
+			uint32_t clusterMisses = 0;
+			for (size_t i = begin; i < end; ++i)
+			{
+				clusterMisses += cache.touchTriangle(&indices[i * 3]);
+			}
+			const float clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+			softClusterStorage[numSoftClusters++] = static_cast<uint32_t>(begin);
+
+			cache.flush();
+			uint32_t runningMisses = 0;
+			uint32_t runningTriangles = 0;
+			for (size_t i = begin; i < end; ++i)
+			{
+				runningMisses += cache.touchTriangle(&indices[i * 3]);
+				++runningTriangles;
+
+				if (static_cast<float>(runningMisses) / static_cast<float>(runningTriangles) <= clusterThreshold)
+				{
+					softClusterStorage[numSoftClusters++] = static_cast<uint32_t>(i + 1);
+					cache.flush();
+					runningMisses = 0;
+					runningTriangles = 0;
+				}
+			}
+
+			//-- The last split point may coincide with the end of the hard cluster.
+			if (softClusterStorage[numSoftClusters - 1] == end)
+			{
+				--numSoftClusters;
+			}
+		}
+	}
+	const auto softClusters = softClusterStorage.first(numSoftClusters);
+
+	auto position = [&positions](uint32_t vertex)
+		{
+			return std::array<float, 3>{ positions[vertex * 3 + 0], positions[vertex * 3 + 1], positions[vertex * 3 + 2] };
+		};
+
+	//-- Centroid of the mesh.
+	std::array<float, 3> meshCentroid = {};
+	for (uint32_t index : indices)
+	{
+		const auto p = position(index);
+		for (size_t k = 0; k < 3; ++k)
+		{
+			meshCentroid[k] += p[k];
+		}
+	}
+	for (float& value : meshCentroid)
+	{
+		value /= static_cast<float>(indices.size());
+	}
+
+	//-- Clusters which face away from the center are likely to occlude others, so draw them first.
+	auto sortKeys = scratch.allocate<float>(softClusters.size());
+	for (size_t it = 0; it < softClusters.size(); ++it)
+	{
+		const size_t begin = softClusters[it];
+		const size_t end = it + 1 < softClusters.size() ? softClusters[it + 1] : numTriangles;
+
+		std::array<float, 3> centroid = {};
+		std::array<float, 3> normal = {};
+		float area = 0.0f;
+		for (size_t i = begin; i < end; ++i)
+		{
+			const auto p0 = position(indices[i * 3 + 0]);
+			const auto p1 = position(indices[i * 3 + 1]);
+			const auto p2 = position(indices[i * 3 + 2]);
+
+			const std::array<float, 3> e0 = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			const std::array<float, 3> e1 = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			const std::array<float, 3> n = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+			const float triangleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			for (size_t k = 0; k < 3; ++k)
+			{
+				centroid[k] += (p0[k] + p1[k] + p2[k]) * (triangleArea / 3.0f);
+				normal[k] += n[k];
+			}
+			area += triangleArea;
+		}
+
+		const float invArea = area > 0.0f ? 1.0f / area : 0.0f;
+		const float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		const float invNormalLength = normalLength > 0.0f ? 1.0f / normalLength : 0.0f;
+
+		float key = 0.0f;
+		for (size_t k = 0; k < 3; ++k)
+		{
+			key += (centroid[k] * invArea - meshCentroid[k]) * normal[k] * invNormalLength;
+		}
+		sortKeys[it] = key;
+	}
+
+	//-- Ties keep the cache order, like a stable sort would, which needs a buffer of its own.
+	auto order = scratch.allocate<uint32_t>(softClusters.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&sortKeys](uint32_t lhs, uint32_t rhs)
+		{
+			return sortKeys[lhs] > sortKeys[rhs] || (sortKeys[lhs] == sortKeys[rhs] && lhs < rhs);
+		});
+
+	size_t written = 0;
+	for (uint32_t cluster : order)
+	{
+		const size_t begin = softClusters[cluster];
+		const size_t end = cluster + 1 < softClusters.size() ? softClusters[cluster + 1] : numTriangles;
+
+		std::copy(indices.begin() + begin * 3, indices.begin() + end * 3, destination.begin() + written);
+		written += (end - begin) * 3;
+	}
+}
+
+
+size_t optimizeVertexFetchRemap(std::span<uint32_t> remap, std::span<const uint32_t> indices, size_t numVertices)
+{
+	std::fill_n(remap.begin(), numVertices, kInvalidIndex);
+
+	uint32_t next = 0;
+	for (uint32_t index : indices)
+	{
+		if (remap[index] == kInvalidIndex)
+		{
+			remap[index] = next++;
+		}
+	}
+
+	return next;
+}
+
+
+void remapIndexBuffer(std::span<uint32_t> indices, std::span<const uint32_t> remap)
+{
+	for (uint32_t& index : indices)
+	{
+		index = remap[index];
+	}
+}
+
+
+void remapVertexBuffer(void* destination, const void* vertices, size_t numVertices, size_t stride, std::span<const uint32_t> remap)
+{
+	auto* dst = static_cast<uint8_t*>(destination);
+	const auto* src = static_cast<const uint8_t*>(vertices);
+	for (size_t i = 0; i < numVertices; ++i)
+	{
+		if (remap[i] != kInvalidIndex)
+		{
+			memcpy(dst + remap[i] * stride, src + i * stride, stride);
+		}
+	}
+}
+
+} //-- engine::resources::mesh.
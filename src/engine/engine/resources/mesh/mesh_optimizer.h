@@ -0,0 +1,51 @@
+#pragma once
+
+#include <engine/utils/linear_arena.h>
+
+//-- CPU passes which reorder indexed triangle lists for better GPU efficiency.
+//-- They don't depend on the renderer, so they can be used by any importer.
+namespace engine::resources::mesh
+{
+
+//-- Size of the simulated FIFO post-transform cache.
+inline constexpr uint32_t kVertexCacheSize = 16;
+
+struct VertexCacheStatistics
+{
+	uint32_t verticesTransformed = 0;
+	float acmr = 0.0f; //-- Average cache miss ratio: transformed vertices per triangle. Ideal is 0.5 for regular grids.
+	float atvr = 0.0f; //-- Average transformed vertex ratio: transformed vertices per used vertex. Ideal is 1.0.
+};
+
+//-- Upper bound of the scratch memory any of the passes below needs for the mesh. Temporaries come from the scratch arena
+//-- and are released with it, so passes which share an arena without a reset need the sum.
+ENGINE_API size_t optimizerScratchSize(size_t numIndices, size_t numVertices);
+
+//-- Simulates a FIFO post-transform cache of the given size.
+ENGINE_API VertexCacheStatistics analyzeVertexCache(std::span<const uint32_t> indices, size_t numVertices, utils::LinearArena& scratch,
+	uint32_t cacheSize = kVertexCacheSize);
+
+//-- Reorders triangles to improve the post-transform cache hit rate (Tipsify, Sander et al. 2007).
+//-- If clusters isn't empty, it receives the indices of the first triangle of every cluster that starts from a dead end,
+//-- i.e. the natural split points for the overdraw pass. It must fit a cluster per triangle. Returns the number of clusters.
+ENGINE_API size_t optimizeVertexCache(std::span<uint32_t> destination, std::span<const uint32_t> indices, size_t numVertices,
+	utils::LinearArena& scratch, std::span<uint32_t> clusters = {}, uint32_t cacheSize = kVertexCacheSize);
+
+//-- Reorders clusters of triangles so the ones facing outwards are drawn first.
+//-- The clusters from optimizeVertexCache are split further while their ACMR stays within
+//-- the threshold of the cache optimized order, so the cache efficiency is mostly preserved.
+//-- Positions are tightly packed float3.
+ENGINE_API void optimizeOverdraw(std::span<uint32_t> destination, std::span<const uint32_t> indices, std::span<const float> positions,
+	std::span<const uint32_t> clusters, float threshold, utils::LinearArena& scratch, uint32_t cacheSize = kVertexCacheSize);
+
+//-- Builds the remap table which orders vertices by their first use, so vertex streams are read linearly.
+//-- Unused vertices are dropped. Returns the number of unique used vertices.
+ENGINE_API size_t optimizeVertexFetchRemap(std::span<uint32_t> remap, std::span<const uint32_t> indices, size_t numVertices);
+
+//-- Applies the remap table to indices in place.
+ENGINE_API void remapIndexBuffer(std::span<uint32_t> indices, std::span<const uint32_t> remap);
+
+//-- Applies the remap table to a vertex stream. The destination and the source must not overlap.
+ENGINE_API void remapVertexBuffer(void* destination, const void* vertices, size_t numVertices, size_t stride, std::span<const uint32_t> remap);
+
+} //-- engine::resources::mesh.
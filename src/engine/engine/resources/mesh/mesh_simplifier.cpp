@@ -0,0 +1,527 @@
+#include <engine/resources/mesh/mesh_simplifier.h>
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+namespace engine::resources::mesh
+{
+
+namespace
+{
+
+//-- Boundaries are kept much stronger than the surface, otherwise open edges and seams shrink.
+inline constexpr double kBoundaryWeight = 10.0;
+//-- Collapses which rotate a triangle normal by more than ~75 degrees are rejected.
+inline constexpr double kMaxNormalRotationCos = 0.25;
+
+using Vec3 = std::array<double, 3>;
+
+FORCE_INLINE Vec3 sub(const Vec3& lhs, const Vec3& rhs) { return { lhs[0] - rhs[0], lhs[1] - rhs[1], lhs[2] - rhs[2] }; }
+FORCE_INLINE double dot(const Vec3& lhs, const Vec3& rhs) { return lhs[0] * rhs[0] + lhs[1] * rhs[1] + lhs[2] * rhs[2]; }
+FORCE_INLINE Vec3 cross(const Vec3& lhs, const Vec3& rhs)
+{
+	return { lhs[1] * rhs[2] - lhs[2] * rhs[1], lhs[2] * rhs[0] - lhs[0] * rhs[2], lhs[0] * rhs[1] - lhs[1] * rhs[0] };
+}
+
+
+enum class VertexKind : uint8_t
+{
+	Manifold, //-- Interior vertex, collapses anywhere.
+	Border, //-- On an open edge, collapses only along it.
+	Seam, //-- One of two vertices with the same position, collapses along the seam together with its twin.
+	Locked
+};
+
+//-- `x^T A x + 2 b^T x + c` scaled by the accumulated weight.
+struct Quadric
+{
+	double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+	double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+	double c = 0.0;
+	double weight = 0.0;
+
+	static Quadric plane(const Vec3& normal, double distance, double weight)
+	{
+		Quadric q;
+		q.a00 = normal[0] * normal[0] * weight;
+		q.a11 = normal[1] * normal[1] * weight;
+		q.a22 = normal[2] * normal[2] * weight;
+		q.a01 = normal[0] * normal[1] * weight;
+		q.a02 = normal[0] * normal[2] * weight;
+		q.a12 = normal[1] * normal[2] * weight;
+		q.b0 = normal[0] * distance * weight;
+		q.b1 = normal[1] * distance * weight;
+		q.b2 = normal[2] * distance * weight;
+		q.c = distance * distance * weight;
+		q.weight = weight;
+		return q;
+	}
+
+	void operator+=(const Quadric& other)
+	{
+		a00 += other.a00; a11 += other.a11; a22 += other.a22;
+		a01 += other.a01; a02 += other.a02; a12 += other.a12;
+		b0 += other.b0; b1 += other.b1; b2 += other.b2;
+		c += other.c;
+		weight += other.weight;
+	}
+
+	//-- Weighted mean squared distance from the point to the planes.
+	double error(const Vec3& p) const
+	{
+		const double rx = a00 * p[0] + a01 * p[1] + a02 * p[2] + 2.0 * b0;
+		const double ry = a01 * p[0] + a11 * p[1] + a12 * p[2] + 2.0 * b1;
+		const double rz = a02 * p[0] + a12 * p[1] + a22 * p[2] + 2.0 * b2;
+		const double result = rx * p[0] + ry * p[1] + rz * p[2] + c;
+
+		return weight > 0.0 ? std::abs(result) / weight : 0.0;
+	}
+};
+
+
+//-- Vertex -> triangles of the current index buffer.
+class Adjacency
+{
+public:
+	Adjacency(std::span<const uint32_t> indices, size_t numVertices) : m_indices(indices), m_offsets(numVertices + 1, 0)
+	{
+		for (uint32_t index : indices)
+		{
+			++m_offsets[index + 1];
+		}
+		std::partial_sum(m_offsets.begin(), m_offsets.end(), m_offsets.begin());
+
+		m_triangles.resize(indices.size());
+		std::vector<uint32_t> fill(m_offsets.begin(), m_offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			m_triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	std::span<const uint32_t> triangles(uint32_t vertex) const
+	{
+		return { m_triangles.data() + m_offsets[vertex], m_offsets[vertex + 1] - m_offsets[vertex] };
+	}
+
+	//-- Corners of the vertex in the triangle: the next and the previous vertex.
+	std::pair<uint32_t, uint32_t> neighbours(uint32_t triangle, uint32_t vertex) const
+	{
+		const uint32_t* corners = &m_indices[triangle * 3];
+		const size_t k = corners[0] == vertex ? 0 : (corners[1] == vertex ? 1 : 2);
+		return { corners[(k + 1) % 3], corners[(k + 2) % 3] };
+	}
+
+	//-- Directed edge.
+	bool hasEdge(uint32_t from, uint32_t to) const
+	{
+		for (uint32_t triangle : triangles(from))
+		{
+			if (neighbours(triangle, from).first == to)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+private:
+	std::span<const uint32_t> m_indices;
+	std::vector<uint32_t> m_offsets;
+	std::vector<uint32_t> m_triangles;
+};
+
+
+struct Collapse
+{
+	uint32_t from = 0;
+	uint32_t to = 0;
+	double error = 0.0;
+};
+
+} //-- unnamed.
+
+
+size_t simplify(std::span<uint32_t> destination, std::span<const uint32_t> indices, std::span<const float> positions,
+	size_t targetIndexCount, float targetError, float* resultError)
+{
+	ENGINE_CPU_ZONE;
+
+	const size_t numVertices = positions.size() / 3;
+	std::copy(indices.begin(), indices.end(), destination.begin());
+	size_t indexCount = indices.size();
+	double maxError = 0.0;
+
+	auto position = [&positions](uint32_t vertex) -> Vec3
+		{
+			return { positions[vertex * 3 + 0], positions[vertex * 3 + 1], positions[vertex * 3 + 2] };
+		};
+
+	//-- Vertices with the same position: remap points to the first one, wedges link them into a ring.
+	//-- Unreferenced vertices are left alone, otherwise they would turn used ones into seams.
+	std::vector<uint32_t> remap(numVertices);
+	std::vector<uint32_t> wedges(numVertices);
+	{
+		std::vector<bool> used(numVertices, false);
+		for (uint32_t index : indices)
+		{
+			used[index] = true;
+		}
+
+		struct PositionHash
+		{
+			size_t operator()(const std::array<uint32_t, 3>& key) const
+			{
+				return (key[0] * 73856093u) ^ (key[1] * 19349663u) ^ (key[2] * 83492791u);
+			}
+		};
+
+		std::unordered_map<std::array<uint32_t, 3>, uint32_t, PositionHash> unique;
+		unique.reserve(numVertices);
+		for (uint32_t vertex = 0; vertex < numVertices; ++vertex)
+		{
+			remap[vertex] = vertex;
+			wedges[vertex] = vertex;
+			if (!used[vertex])
+			{
+				continue;
+			}
+
+			std::array<uint32_t, 3> key;
+			memcpy(key.data(), &positions[vertex * 3], sizeof(key));
+			remap[vertex] = unique.emplace(key, vertex).first->second;
+			if (remap[vertex] != vertex)
+			{
+				wedges[vertex] = wedges[remap[vertex]];
+				wedges[remap[vertex]] = vertex;
+			}
+		}
+	}
+
+	//-- Quadrics are accumulated per position, so twins on seams share them.
+	std::vector<Quadric> quadrics(numVertices);
+	{
+		const Adjacency adjacency(std::span<const uint32_t>(destination.data(), indexCount), numVertices);
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			const uint32_t* triangle = &destination[i];
+			const Vec3 p0 = position(triangle[0]);
+			const Vec3 p1 = position(triangle[1]);
+			const Vec3 p2 = position(triangle[2]);
+
+			Vec3 normal = cross(sub(p1, p0), sub(p2, p0));
+			const double length = std::sqrt(dot(normal, normal));
+			if (length == 0.0)
+			{
+				continue;
+			}
+			normal = { normal[0] / length, normal[1] / length, normal[2] / length };
+
+			const Quadric face = Quadric::plane(normal, -dot(normal, p0), length * 0.5);
+			for (size_t k = 0; k < 3; ++k)
+			{
+				quadrics[remap[triangle[k]]] += face;
+			}
+
+			//-- Open edges (borders and seams) get a plane perpendicular to the triangle.
+			for (size_t k = 0; k < 3; ++k)
+			{
+				const uint32_t from = triangle[k];
+				const uint32_t to = triangle[(k + 1) % 3];
+				if (adjacency.hasEdge(to, from))
+				{
+					continue;
+				}
+
+				const Vec3 edge = sub(position(to), position(from));
+				const double edgeLengthSq = dot(edge, edge);
+				Vec3 edgeNormal = cross(edge, normal);
+				const double edgeNormalLength = std::sqrt(dot(edgeNormal, edgeNormal));
+				if (edgeNormalLength == 0.0)
+				{
+					continue;
+				}
+				edgeNormal = { edgeNormal[0] / edgeNormalLength, edgeNormal[1] / edgeNormalLength, edgeNormal[2] / edgeNormalLength };
+
+				const Quadric border = Quadric::plane(edgeNormal, -dot(edgeNormal, position(from)), edgeLengthSq * kBoundaryWeight);
+				quadrics[remap[from]] += border;
+				quadrics[remap[to]] += border;
+			}
+		}
+	}
+
+	const double maxErrorSq = static_cast<double>(targetError) * targetError;
+	std::vector<VertexKind> kinds(numVertices);
+	std::vector<uint32_t> collapses(numVertices);
+	std::vector<bool> locked(numVertices);
+	std::vector<Collapse> candidates;
+
+	while (indexCount > targetIndexCount)
+	{
+		const Adjacency adjacency(std::span<const uint32_t>(destination.data(), indexCount), numVertices);
+
+		auto hasPositionEdge = [&](uint32_t from, uint32_t to)
+			{
+				uint32_t wedge = from;
+				do
+				{
+					for (uint32_t triangle : adjacency.triangles(wedge))
+					{
+						if (remap[adjacency.neighbours(triangle, wedge).first] == remap[to])
+						{
+							return true;
+						}
+					}
+					wedge = wedges[wedge];
+				} while (wedge != from);
+
+				return false;
+			};
+
+		auto isOpenEdge = [&](uint32_t a, uint32_t b)
+			{
+				return adjacency.hasEdge(a, b) != adjacency.hasEdge(b, a);
+			};
+
+		//-- Classify vertices by their open edges. An open edge with an opposite edge in the position space is a seam.
+		{
+			struct OpenEdges
+			{
+				uint32_t out = 0;
+				uint32_t in = 0;
+				uint32_t border = 0;
+			};
+
+			std::vector<OpenEdges> openEdges(numVertices);
+			for (uint32_t vertex = 0; vertex < numVertices; ++vertex)
+			{
+				auto& open = openEdges[vertex];
+				for (uint32_t triangle : adjacency.triangles(vertex))
+				{
+					const auto [next, prev] = adjacency.neighbours(triangle, vertex);
+					if (!adjacency.hasEdge(next, vertex))
+					{
+						++open.out;
+						open.border += !hasPositionEdge(next, vertex);
+					}
+					if (!adjacency.hasEdge(vertex, prev))
+					{
+						++open.in;
+						open.border += !hasPositionEdge(vertex, prev);
+					}
+				}
+			}
+
+			for (uint32_t vertex = 0; vertex < numVertices; ++vertex)
+			{
+				const auto& open = openEdges[vertex];
+				const uint32_t twin = wedges[vertex];
+				if (twin == vertex)
+				{
+					const bool manifold = open.out == 0 && open.in == 0;
+					const bool border = open.out == 1 && open.in == 1;
+					kinds[vertex] = manifold ? VertexKind::Manifold : (border ? VertexKind::Border : VertexKind::Locked);
+				}
+				else if (wedges[twin] == vertex)
+				{
+					const auto& twinOpen = openEdges[twin];
+					const bool seam = open.out == 1 && open.in == 1 && open.border == 0
+						&& twinOpen.out == 1 && twinOpen.in == 1 && twinOpen.border == 0;
+					kinds[vertex] = seam ? VertexKind::Seam : VertexKind::Locked;
+				}
+				else
+				{
+					kinds[vertex] = VertexKind::Locked;
+				}
+			}
+		}
+
+		auto canCollapse = [&](uint32_t from, uint32_t to)
+			{
+				switch (kinds[from])
+				{
+				case VertexKind::Manifold:
+					return true;
+
+				case VertexKind::Border:
+					return (kinds[to] == VertexKind::Border || kinds[to] == VertexKind::Locked) && isOpenEdge(from, to);
+
+				case VertexKind::Seam:
+					return (kinds[to] == VertexKind::Seam || kinds[to] == VertexKind::Locked) && isOpenEdge(from, to);
+
+				default:
+					return false;
+				}
+			};
+
+		//-- The wedge of `to` which continues the seam from the twin of `from`.
+		auto seamTwin = [&](uint32_t from, uint32_t to) -> int64_t
+			{
+				const uint32_t twin = wedges[from];
+				uint32_t wedge = to;
+				do
+				{
+					if (wedge != to && isOpenEdge(twin, wedge))
+					{
+						return wedge;
+					}
+					wedge = wedges[wedge];
+				} while (wedge != to);
+
+				return -1;
+			};
+
+		//-- Moving the vertex must not flip any of its triangles, except the ones which degenerate.
+		auto flips = [&](uint32_t from, uint32_t to)
+			{
+				const Vec3 target = position(to);
+				for (uint32_t triangle : adjacency.triangles(from))
+				{
+					const auto [next, prev] = adjacency.neighbours(triangle, from);
+					if (remap[next] == remap[to] || remap[prev] == remap[to])
+					{
+						continue;
+					}
+
+					const Vec3 pn = position(next);
+					const Vec3 pp = position(prev);
+					const Vec3 before = cross(sub(pn, position(from)), sub(pp, position(from)));
+					const Vec3 after = cross(sub(pn, target), sub(pp, target));
+					const double limit = kMaxNormalRotationCos * std::sqrt(dot(before, before) * dot(after, after));
+					if (dot(before, after) <= limit)
+					{
+						return true;
+					}
+				}
+
+				return false;
+			};
+
+		//-- Gather candidates in both directions of every edge and sort by the error.
+		candidates.clear();
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			for (size_t k = 0; k < 3; ++k)
+			{
+				const uint32_t a = destination[i + k];
+				const uint32_t b = destination[i + (k + 1) % 3];
+				if (remap[a] == remap[b])
+				{
+					continue;
+				}
+
+				if (canCollapse(a, b))
+				{
+					candidates.push_back({ a, b, quadrics[remap[a]].error(position(b)) });
+				}
+				if (canCollapse(b, a))
+				{
+					candidates.push_back({ b, a, quadrics[remap[b]].error(position(a)) });
+				}
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const Collapse& lhs, const Collapse& rhs)
+			{
+				return std::tie(lhs.error, lhs.from, lhs.to) < std::tie(rhs.error, rhs.from, rhs.to);
+			});
+
+		//-- Apply the cheapest independent collapses. A manifold collapse removes two triangles, a border one removes one.
+		std::iota(collapses.begin(), collapses.end(), 0);
+		std::fill(locked.begin(), locked.end(), false);
+
+		const size_t trianglesToRemove = (indexCount - targetIndexCount) / 3 + 1;
+		size_t removedTriangles = 0;
+		size_t numCollapses = 0;
+		for (const Collapse& collapse : candidates)
+		{
+			if (collapse.error > maxErrorSq || removedTriangles >= trianglesToRemove)
+			{
+				break;
+			}
+
+			const uint32_t from = collapse.from;
+			const uint32_t to = collapse.to;
+			if (locked[remap[from]] || locked[remap[to]])
+			{
+				continue;
+			}
+
+			int64_t twinTo = -1;
+			if (kinds[from] == VertexKind::Seam)
+			{
+				twinTo = seamTwin(from, to);
+				if (twinTo < 0)
+				{
+					continue;
+				}
+			}
+
+			if (flips(from, to) || (twinTo >= 0 && flips(wedges[from], static_cast<uint32_t>(twinTo))))
+			{
+				continue;
+			}
+
+			collapses[from] = to;
+			if (twinTo >= 0)
+			{
+				collapses[wedges[from]] = static_cast<uint32_t>(twinTo);
+			}
+
+			quadrics[remap[to]] += quadrics[remap[from]];
+
+			//-- Triangles around the vertex must not change twice in a pass, the flip test sees only the old positions.
+			uint32_t wedge = from;
+			do
+			{
+				for (uint32_t triangle : adjacency.triangles(wedge))
+				{
+					const auto [next, prev] = adjacency.neighbours(triangle, wedge);
+					locked[remap[next]] = true;
+					locked[remap[prev]] = true;
+				}
+				wedge = wedges[wedge];
+			} while (wedge != from);
+			locked[remap[from]] = true;
+			locked[remap[to]] = true;
+
+			maxError = std::max(maxError, collapse.error);
+			removedTriangles += kinds[from] == VertexKind::Border ? 1 : 2;
+			++numCollapses;
+		}
+
+		if (numCollapses == 0)
+		{
+			break;
+		}
+
+		//-- Rewrite the indices and drop the degenerated triangles.
+		size_t written = 0;
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			const uint32_t i0 = collapses[destination[i + 0]];
+			const uint32_t i1 = collapses[destination[i + 1]];
+			const uint32_t i2 = collapses[destination[i + 2]];
+			if (remap[i0] == remap[i1] || remap[i1] == remap[i2] || remap[i0] == remap[i2])
+			{
+				continue;
+			}
+
+			destination[written++] = i0;
+			destination[written++] = i1;
+			destination[written++] = i2;
+		}
+		indexCount = written;
+	}
+
+	if (resultError)
+	{
+		*resultError = static_cast<float>(std::sqrt(maxError));
+	}
+
+	return indexCount;
+}
+
+} //-- engine::resources::mesh.
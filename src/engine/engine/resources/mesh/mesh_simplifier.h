@@ -0,0 +1,16 @@
+#pragma once
+
+//-- Quadric error metric simplification (Garland and Heckbert 1997) of indexed triangle lists.
+//-- Only indices are rewritten, so all levels of detail share the vertex buffers of the source mesh.
+namespace engine::resources::mesh
+{
+
+//-- Collapses edges in the order of the smallest quadric error until the number of indices drops to targetIndexCount
+//-- or the next collapse would exceed targetError. Positions are tightly packed float3.
+//-- Vertices which share a position but have different attributes (UV seams, hard normals) collapse only along the seam
+//-- together with their twins, mesh borders collapse only along themselves, and more complex vertices are locked.
+//-- Returns the number of indices written to destination, resultError receives the achieved error in object space units.
+size_t simplify(std::span<uint32_t> destination, std::span<const uint32_t> indices, std::span<const float> positions,
+	size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+} //-- engine::resources::mesh.
@@ -0,0 +1,221 @@
+#include <engine/resources/mesh/meshlet_builder.h>
+#include <engine/assert.h>
+
+#include <algorithm>
+
+namespace engine::resources::mesh
+{
+
+namespace
+{
+
+inline constexpr uint32_t kNotInMeshlet = ~0u;
+
+using Vec3 = std::array<float, 3>;
+
+FORCE_INLINE Vec3 position(std::span<const float> positions, uint32_t vertex)
+{
+	return { positions[vertex * 3 + 0], positions[vertex * 3 + 1], positions[vertex * 3 + 2] };
+}
+
+
+FORCE_INLINE Vec3 sub(const Vec3& lhs, const Vec3& rhs) { return { lhs[0] - rhs[0], lhs[1] - rhs[1], lhs[2] - rhs[2] }; }
+FORCE_INLINE float dot(const Vec3& lhs, const Vec3& rhs) { return lhs[0] * rhs[0] + lhs[1] * rhs[1] + lhs[2] * rhs[2]; }
+FORCE_INLINE Vec3 cross(const Vec3& lhs, const Vec3& rhs)
+{
+	return { lhs[1] * rhs[2] - lhs[2] * rhs[1], lhs[2] * rhs[0] - lhs[0] * rhs[2], lhs[0] * rhs[1] - lhs[1] * rhs[0] };
+}
+
+} //-- unnamed.
+
+
+void buildMeshlets(MeshletData& result, std::span<const uint32_t> indices, std::span<const float> positions,
+	uint32_t maxVertices, uint32_t maxTriangles)
+{
+	ENGINE_CPU_ZONE;
+
+	//-- Local indices are stored in 8 bits.
+	ENGINE_ASSERT(maxVertices > 0 && maxVertices <= 256 && maxTriangles > 0, "Invalid meshlet limits!");
+
+	const size_t numVertices = positions.size() / 3;
+	std::vector<uint32_t> localIndices(numVertices, kNotInMeshlet);
+
+	Meshlet meshlet;
+	meshlet.vertexOffset = static_cast<uint32_t>(result.vertices.size());
+	meshlet.triangleOffset = static_cast<uint32_t>(result.triangles.size());
+
+	auto flush = [&]()
+		{
+			if (meshlet.numTriangles == 0)
+			{
+				return;
+			}
+
+			for (uint32_t i = 0; i < meshlet.numVertices; ++i)
+			{
+				localIndices[result.vertices[meshlet.vertexOffset + i]] = kNotInMeshlet;
+			}
+
+			result.meshlets.push_back(meshlet);
+			result.bounds.push_back(computeMeshletBounds(result, meshlet, positions));
+
+			meshlet = {};
+			meshlet.vertexOffset = static_cast<uint32_t>(result.vertices.size());
+			meshlet.triangleOffset = static_cast<uint32_t>(result.triangles.size());
+		};
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const uint32_t triangle[3] = { indices[i + 0], indices[i + 1], indices[i + 2] };
+
+		uint32_t newVertices = 0;
+		for (size_t k = 0; k < 3; ++k)
+		{
+			//-- Count repeated indices of degenerated triangles once.
+			const bool repeated = (k > 0 && triangle[k] == triangle[0]) || (k > 1 && triangle[k] == triangle[1]);
+			newVertices += localIndices[triangle[k]] == kNotInMeshlet && !repeated;
+		}
+
+		if (meshlet.numVertices + newVertices > maxVertices || meshlet.numTriangles + 1 > maxTriangles)
+		{
+			flush();
+		}
+
+		uint32_t packed = 0;
+		for (size_t k = 0; k < 3; ++k)
+		{
+			uint32_t& local = localIndices[triangle[k]];
+			if (local == kNotInMeshlet)
+			{
+				local = meshlet.numVertices++;
+				result.vertices.push_back(triangle[k]);
+			}
+			packed |= local << (8 * k);
+		}
+
+		result.triangles.push_back(packed);
+		++meshlet.numTriangles;
+	}
+
+	flush();
+}
+
+
+MeshletBounds computeMeshletBounds(const MeshletData& data, const Meshlet& meshlet, std::span<const float> positions)
+{
+	MeshletBounds bounds;
+	if (meshlet.numVertices == 0)
+	{
+		return bounds;
+	}
+
+	auto vertex = [&](uint32_t local) { return position(positions, data.vertices[meshlet.vertexOffset + local]); };
+
+	//-- Bounding sphere, Ritter's algorithm: the initial sphere spans two distant points and grows to include the rest.
+	Vec3 center;
+	float radius = 0.0f;
+	{
+		auto farthest = [&](const Vec3& from)
+			{
+				uint32_t result = 0;
+				float maxDistance = -1.0f;
+				for (uint32_t i = 0; i < meshlet.numVertices; ++i)
+				{
+					const Vec3 d = sub(vertex(i), from);
+					const float distance = dot(d, d);
+					if (distance > maxDistance)
+					{
+						maxDistance = distance;
+						result = i;
+					}
+				}
+
+				return vertex(result);
+			};
+
+		const Vec3 a = farthest(vertex(0));
+		const Vec3 b = farthest(a);
+		center = { (a[0] + b[0]) * 0.5f, (a[1] + b[1]) * 0.5f, (a[2] + b[2]) * 0.5f };
+		radius = std::sqrt(dot(sub(b, a), sub(b, a))) * 0.5f;
+
+		for (uint32_t i = 0; i < meshlet.numVertices; ++i)
+		{
+			const Vec3 p = vertex(i);
+			const Vec3 d = sub(p, center);
+			const float distance = std::sqrt(dot(d, d));
+			if (distance > radius)
+			{
+				const float newRadius = (radius + distance) * 0.5f;
+				const float shift = (newRadius - radius) / distance;
+				center = { center[0] + d[0] * shift, center[1] + d[1] * shift, center[2] + d[2] * shift };
+				radius = newRadius;
+			}
+		}
+	}
+
+	bounds.center = math::vec3(center[0], center[1], center[2]);
+	bounds.radius = radius;
+
+	//-- Normal cone. The axis is the average of the unit normals of non-degenerated triangles.
+	struct Plane
+	{
+		Vec3 point;
+		Vec3 normal;
+	};
+
+	std::vector<Plane> planes;
+	planes.reserve(meshlet.numTriangles);
+	Vec3 axis = { 0.0f, 0.0f, 0.0f };
+	for (uint32_t i = 0; i < meshlet.numTriangles; ++i)
+	{
+		const uint32_t packed = data.triangles[meshlet.triangleOffset + i];
+		const Vec3 p0 = vertex(packed & 0xff);
+		const Vec3 p1 = vertex((packed >> 8) & 0xff);
+		const Vec3 p2 = vertex((packed >> 16) & 0xff);
+
+		const Vec3 normal = cross(sub(p1, p0), sub(p2, p0));
+		const float length = std::sqrt(dot(normal, normal));
+		if (length == 0.0f)
+		{
+			continue;
+		}
+
+		const Vec3 unit = { normal[0] / length, normal[1] / length, normal[2] / length };
+		planes.push_back({ p0, unit });
+		axis = { axis[0] + unit[0], axis[1] + unit[1], axis[2] + unit[2] };
+	}
+
+	const float axisLength = std::sqrt(dot(axis, axis));
+	if (planes.empty() || axisLength == 0.0f)
+	{
+		return bounds;
+	}
+	axis = { axis[0] / axisLength, axis[1] / axisLength, axis[2] / axisLength };
+
+	float minDot = 1.0f;
+	for (const Plane& plane : planes)
+	{
+		minDot = std::min(minDot, dot(plane.normal, axis));
+	}
+
+	//-- Normals spread over more than a hemisphere can't be culled by the cone.
+	if (minDot <= 0.0f)
+	{
+		return bounds;
+	}
+
+	//-- Move the apex back along the axis until every triangle plane faces it.
+	float maxT = 0.0f;
+	for (const Plane& plane : planes)
+	{
+		maxT = std::max(maxT, dot(sub(center, plane.point), plane.normal) / dot(axis, plane.normal));
+	}
+
+	bounds.coneApex = math::vec3(center[0] - axis[0] * maxT, center[1] - axis[1] * maxT, center[2] - axis[2] * maxT);
+	bounds.coneAxis = math::vec3(axis[0], axis[1], axis[2]);
+	bounds.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+
+	return bounds;
+}
+
+} //-- engine::resources::mesh.
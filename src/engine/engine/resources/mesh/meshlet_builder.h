@@ -0,0 +1,54 @@
+#pragma once
+
+#include <engine/math.h>
+
+//-- Splits indexed triangle lists into meshlets for the mesh shader path.
+//-- It has no renderer dependencies, so the builder can be used and tested on its own.
+namespace engine::resources::mesh
+{
+
+//-- 64 vertices and 126 triangles is the usual recommendation, 124 keeps the number of triangles a multiple of 4.
+inline constexpr uint32_t kMaxMeshletVertices = 64;
+inline constexpr uint32_t kMaxMeshletTriangles = 124;
+
+struct Meshlet
+{
+	uint32_t vertexOffset = 0; //-- First element in MeshletData::vertices.
+	uint32_t triangleOffset = 0; //-- First element in MeshletData::triangles.
+	uint32_t numVertices = 0;
+	uint32_t numTriangles = 0;
+};
+
+//-- Layout matches the structured buffer in the shaders, so it's tightly packed float4s.
+struct MeshletBounds
+{
+	math::vec3 center;
+	float radius = 0.0f;
+	//-- The meshlet is backfacing if `dot(normalize(coneApex - cameraPosition), coneAxis) >= coneCutoff`.
+	//-- Degenerated cones have the zero axis and the cutoff 1, so they are never culled.
+	math::vec3 coneApex;
+	float coneCutoff = 1.0f;
+	math::vec3 coneAxis;
+	float padding = 0.0f;
+};
+static_assert(sizeof(MeshletBounds) == 3 * 4 * sizeof(float));
+
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshletBounds> bounds;
+	//-- Indices of the mesh vertices used by the meshlets.
+	std::vector<uint32_t> vertices;
+	//-- Triangles as three 8-bit indices into the meshlet vertices: `i0 | i1 << 8 | i2 << 16`.
+	std::vector<uint32_t> triangles;
+};
+
+//-- Greedily packs triangles in the index buffer order, so it benefits from the vertex cache optimized order.
+//-- The result only depends on the input. Positions are tightly packed float3.
+ENGINE_API void buildMeshlets(MeshletData& result, std::span<const uint32_t> indices, std::span<const float> positions,
+	uint32_t maxVertices = kMaxMeshletVertices, uint32_t maxTriangles = kMaxMeshletTriangles);
+
+//-- Bounding sphere and normal cone of a single meshlet.
+ENGINE_API MeshletBounds computeMeshletBounds(const MeshletData& data, const Meshlet& meshlet, std::span<const float> positions);
+
+} //-- engine::resources::mesh.
@@ -0,0 +1,584 @@
+#include <engine/resources/mesh/obj_parser.h>
+#include <engine/assert.h>
+#include <engine/helpers.h>
+#include <engine/services/job_service.h>
+
+#include <bit>
+#include <charconv>
+#include <unordered_map>
+
+namespace engine::resources::mesh
+{
+
+namespace
+{
+
+//-- Large enough to amortize the tasks, small enough to balance the load.
+inline constexpr size_t kChunkSize = 1024 * 1024;
+//-- Doubles hold integers up to 2^53 and powers of ten up to 10^22 exactly, so such numbers get the nearest double.
+//-- Rounding that one to float again may be off by an ulp from from_chars for values right between two floats.
+inline constexpr size_t kMaxFastDigits = 15;
+inline constexpr int32_t kMaxFastExponent = 22;
+inline constexpr size_t kMaxIndexDigits = 10;
+inline constexpr uint32_t kWhite = 0xffffffff;
+
+inline constexpr double kPowersOf10[kMaxFastExponent + 1] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+inline constexpr uint64_t kIntegerPowersOf10[9] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+
+enum class LineType
+{
+	Other,
+	Position,
+	UV,
+	Normal,
+	Face,
+	Material
+};
+
+struct MaterialRun
+{
+	uint32_t material = 0;
+	size_t firstCorner = 0;
+};
+
+struct Chunk
+{
+	const char* begin = nullptr;
+	const char* end = nullptr;
+
+	//-- Counted by the first pass, so the second one resolves relative indices and writes attributes straight to their place.
+	uint32_t numPositions = 0;
+	uint32_t numUVs = 0;
+	uint32_t numNormals = 0;
+	std::vector<std::string_view> materials; //-- Names of usemtl lines in order.
+
+	uint32_t positionBase = 0;
+	uint32_t uvBase = 0;
+	uint32_t normalBase = 0;
+	uint32_t material = 0; //-- Active at the start of the chunk.
+
+	std::vector<ObjCorner> corners;
+	std::vector<MaterialRun> runs;
+	std::vector<uint32_t> colors; //-- Per position of the chunk, empty until the first colored one.
+	std::string error;
+};
+
+
+FORCE_INLINE bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+
+FORCE_INLINE const char* skipSpaces(const char* p, const char* end)
+{
+	while (p < end && isSpace(*p))
+	{
+		++p;
+	}
+	return p;
+}
+
+
+FORCE_INLINE const char* lineEnd(const char* p, const char* end)
+{
+	const void* eol = memchr(p, '\n', end - p);
+	return eol ? static_cast<const char*>(eol) : end;
+}
+
+
+//-- Both passes classify lines by the same function, so their counts agree. Moves p past the keyword.
+LineType classify(const char*& p, const char* eol)
+{
+	p = skipSpaces(p, eol);
+
+	auto keyword = [&p, eol](std::string_view name)
+		{
+			const size_t size = name.size();
+			if (static_cast<size_t>(eol - p) > size && std::string_view(p, size) == name && isSpace(p[size]))
+			{
+				p += size;
+				return true;
+			}
+			return false;
+		};
+
+	if (keyword("v"))
+	{
+		return LineType::Position;
+	}
+	if (keyword("vt"))
+	{
+		return LineType::UV;
+	}
+	if (keyword("vn"))
+	{
+		return LineType::Normal;
+	}
+	if (keyword("f"))
+	{
+		return LineType::Face;
+	}
+	if (keyword("usemtl"))
+	{
+		return LineType::Material;
+	}
+	return LineType::Other;
+}
+
+
+std::string_view readName(const char* p, const char* eol)
+{
+	p = skipSpaces(p, eol);
+	while (eol > p && isSpace(eol[-1]))
+	{
+		--eol;
+	}
+	return { p, static_cast<size_t>(eol - p) };
+}
+
+
+//-- Number of leading digits, 16 characters at once while they are readable.
+FORCE_INLINE size_t countDigits(const char* p, const char* end)
+{
+	const char* start = p;
+	while (end - p >= 16)
+	{
+		const __m128i values = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), _mm_set1_epi8('0'));
+		const __m128i digits = _mm_cmpeq_epi8(_mm_min_epu8(values, _mm_set1_epi8(9)), values);
+		const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(digits));
+		if (mask != 0xffff)
+		{
+			return static_cast<size_t>(p - start) + std::countr_one(mask);
+		}
+		p += 16;
+	}
+
+	while (p < end && static_cast<unsigned char>(*p - '0') < 10)
+	{
+		++p;
+	}
+	return static_cast<size_t>(p - start);
+}
+
+
+//-- Value of up to 8 digits, 8 characters have to be readable. SSE2 has no byte multiply-add,
+//-- so the digits are widened to 16 bits and combined pairwise by pmaddwd.
+FORCE_INLINE uint32_t parseDigits8(const char* p, size_t count)
+{
+	//-- Move the digits to the last lanes, the freed leading lanes become '0'.
+	const __m128i shift = _mm_cvtsi32_si128(static_cast<int>((8 - count) * 8));
+	const __m128i chars = _mm_sll_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), shift);
+	const __m128i padding = _mm_andnot_si128(_mm_sll_epi64(_mm_set1_epi32(-1), shift), _mm_set1_epi8('0'));
+
+	const __m128i values = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_or_si128(chars, padding), _mm_setzero_si128()), _mm_set1_epi16('0'));
+	const __m128i pairs = _mm_madd_epi16(values, _mm_setr_epi16(10, 1, 10, 1, 10, 1, 10, 1));
+	const __m128i quads = _mm_madd_epi16(_mm_packs_epi32(pairs, pairs), _mm_setr_epi16(100, 1, 100, 1, 0, 0, 0, 0));
+	return static_cast<uint32_t>(_mm_cvtsi128_si32(quads)) * 10000 + static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(quads, 4)));
+}
+
+
+//-- Appends count digits to value, 8 at once. Digits near the end of the text are parsed one by one.
+FORCE_INLINE uint64_t parseDigits(const char* p, size_t count, const char* end, uint64_t value)
+{
+	while (count > 0)
+	{
+		const size_t step = std::min<size_t>(count, 8);
+		if (end - p >= 8)
+		{
+			value = value * kIntegerPowersOf10[step] + parseDigits8(p, step);
+		}
+		else
+		{
+			for (size_t i = 0; i < step; ++i)
+			{
+				value = value * 10 + static_cast<uint64_t>(p[i] - '0');
+			}
+		}
+
+		p += step;
+		count -= step;
+	}
+
+	return value;
+}
+
+
+//-- Returns false if there is no number.
+bool parseFloat(const char*& cursor, const char* end, float& result)
+{
+	const char* start = skipSpaces(cursor, end);
+	const char* p = start;
+
+	const bool negative = p < end && *p == '-';
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		++p;
+	}
+
+	const char* integer = p;
+	const size_t numIntegerDigits = countDigits(p, end);
+	p += numIntegerDigits;
+
+	const char* fraction = p;
+	size_t numFractionDigits = 0;
+	if (p < end && *p == '.')
+	{
+		fraction = ++p;
+		numFractionDigits = countDigits(p, end);
+		p += numFractionDigits;
+	}
+
+	bool fast = numIntegerDigits + numFractionDigits > 0 && numIntegerDigits + numFractionDigits <= kMaxFastDigits;
+	int32_t exponent = 0;
+	if (fast && p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char* digits = p + 1;
+		const bool negativeExponent = digits < end && *digits == '-';
+		if (digits < end && (*digits == '-' || *digits == '+'))
+		{
+			++digits;
+		}
+
+		const size_t numExponentDigits = countDigits(digits, end);
+		fast = numExponentDigits > 0 && numExponentDigits <= 3;
+		if (fast)
+		{
+			exponent = static_cast<int32_t>(parseDigits(digits, numExponentDigits, end, 0));
+			exponent = negativeExponent ? -exponent : exponent;
+			p = digits + numExponentDigits;
+		}
+	}
+	exponent -= static_cast<int32_t>(numFractionDigits);
+
+	if (fast && exponent >= -kMaxFastExponent && exponent <= kMaxFastExponent)
+	{
+		const uint64_t mantissa = parseDigits(fraction, numFractionDigits, end, parseDigits(integer, numIntegerDigits, end, 0));
+		double value = static_cast<double>(mantissa);
+		value = exponent < 0 ? value / kPowersOf10[-exponent] : value * kPowersOf10[exponent];
+		result = static_cast<float>(negative ? -value : value);
+		cursor = p;
+		return true;
+	}
+
+	//-- Long mantissas, large exponents and special values are rare, leave them to the standard library.
+	start += start < end && *start == '+';
+	const auto [next, error] = std::from_chars(start, end, result);
+	if (error != std::errc())
+	{
+		return false;
+	}
+
+	cursor = next;
+	return true;
+}
+
+
+bool parseIndex(const char*& cursor, const char* end, int64_t& result)
+{
+	const char* p = cursor;
+	const bool negative = p < end && *p == '-';
+	p += negative;
+
+	const size_t numDigits = countDigits(p, end);
+	if (numDigits == 0 || numDigits > kMaxIndexDigits)
+	{
+		return false;
+	}
+
+	const auto value = static_cast<int64_t>(parseDigits(p, numDigits, end, 0));
+	result = negative ? -value : value;
+	cursor = p + numDigits;
+	return true;
+}
+
+
+//-- Indices are 1-based, negative ones are relative to the end of the attributes read so far.
+//-- base is the number of attributes before the chunk and count the number read in the chunk. Returns kObjNone if it's out of range.
+FORCE_INLINE uint32_t resolveIndex(int64_t index, uint32_t base, uint32_t count, size_t total)
+{
+	const int64_t absolute = index > 0 ? index - 1 : static_cast<int64_t>(base) + count + index;
+	return index != 0 && absolute >= 0 && absolute < static_cast<int64_t>(total) ? static_cast<uint32_t>(absolute) : kObjNone;
+}
+
+
+void countChunk(Chunk& chunk)
+{
+	ENGINE_CPU_ZONE_NAMED("mesh::countObjChunk");
+
+	for (const char* line = chunk.begin; line < chunk.end;)
+	{
+		const char* eol = lineEnd(line, chunk.end);
+		const char* p = line;
+		switch (classify(p, eol))
+		{
+		case LineType::Position: ++chunk.numPositions; break;
+		case LineType::UV: ++chunk.numUVs; break;
+		case LineType::Normal: ++chunk.numNormals; break;
+		case LineType::Material: chunk.materials.push_back(readName(p, eol)); break;
+		default: break;
+		}
+
+		line = eol + 1;
+	}
+}
+
+
+void parseChunk(Chunk& chunk, ObjData& result, const std::unordered_map<std::string_view, uint32_t>& materialIds, const char* text)
+{
+	ENGINE_CPU_ZONE_NAMED("mesh::parseObjChunk");
+
+	uint32_t numPositions = 0;
+	uint32_t numUVs = 0;
+	uint32_t numNormals = 0;
+	std::vector<ObjCorner> polygon;
+
+	chunk.runs.push_back({ .material = chunk.material, .firstCorner = 0 });
+
+	for (const char* line = chunk.begin; line < chunk.end;)
+	{
+		const char* eol = lineEnd(line, chunk.end);
+		const char* p = line;
+		switch (classify(p, eol))
+		{
+		case LineType::Position:
+		{
+			//-- Missing components stay zero, a failed number stops the parsing of the line.
+			math::vec3& position = result.positions[chunk.positionBase + numPositions];
+			parseFloat(p, eol, position.x);
+			parseFloat(p, eol, position.y);
+			parseFloat(p, eol, position.z);
+
+			float r = 0.0f;
+			float g = 0.0f;
+			float b = 0.0f;
+			if (parseFloat(p, eol, r) && parseFloat(p, eol, g) && parseFloat(p, eol, b))
+			{
+				if (chunk.colors.empty())
+				{
+					chunk.colors.resize(chunk.numPositions, kWhite);
+				}
+				chunk.colors[numPositions] = math::color(r, g, b, 1.0f).BGRA();
+			}
+
+			++numPositions;
+			break;
+		}
+
+		case LineType::UV:
+		{
+			math::vec2& uv = result.uvs[chunk.uvBase + numUVs];
+			parseFloat(p, eol, uv.x);
+			parseFloat(p, eol, uv.y);
+			++numUVs;
+			break;
+		}
+
+		case LineType::Normal:
+		{
+			math::vec3& normal = result.normals[chunk.normalBase + numNormals];
+			parseFloat(p, eol, normal.x);
+			parseFloat(p, eol, normal.y);
+			parseFloat(p, eol, normal.z);
+			++numNormals;
+			break;
+		}
+
+		case LineType::Face:
+		{
+			polygon.clear();
+			bool valid = true;
+			for (p = skipSpaces(p, eol); p < eol && valid; p = skipSpaces(p, eol))
+			{
+				//-- v, v/vt, v//vn or v/vt/vn.
+				int64_t index = 0;
+				ObjCorner corner;
+				valid = parseIndex(p, eol, index);
+				corner.position = resolveIndex(index, chunk.positionBase, numPositions, result.positions.size());
+				valid &= corner.position != kObjNone;
+
+				if (valid && p < eol && *p == '/')
+				{
+					++p;
+					if (p < eol && *p != '/')
+					{
+						valid = parseIndex(p, eol, index);
+						corner.uv = resolveIndex(index, chunk.uvBase, numUVs, result.uvs.size());
+						valid &= corner.uv != kObjNone;
+					}
+					if (valid && p < eol && *p == '/')
+					{
+						++p;
+						valid = parseIndex(p, eol, index);
+						corner.normal = resolveIndex(index, chunk.normalBase, numNormals, result.normals.size());
+						valid &= corner.normal != kObjNone;
+					}
+				}
+
+				valid &= p == eol || isSpace(*p);
+				polygon.push_back(corner);
+			}
+
+			if (!valid)
+			{
+				chunk.error = fmt::format("Invalid face '{}' at offset {}.", std::string_view(line, eol - line), line - text);
+				return;
+			}
+
+			//-- Fans match the triangulation of convex polygons, which scanned and exported meshes have.
+			for (size_t i = 2; i < polygon.size(); ++i)
+			{
+				chunk.corners.push_back(polygon[0]);
+				chunk.corners.push_back(polygon[i - 1]);
+				chunk.corners.push_back(polygon[i]);
+			}
+			break;
+		}
+
+		case LineType::Material:
+			chunk.runs.push_back({ .material = materialIds.at(readName(p, eol)), .firstCorner = chunk.corners.size() });
+			break;
+
+		default:
+			break;
+		}
+
+		line = eol + 1;
+	}
+}
+
+} //-- unnamed.
+
+
+bool parseObj(std::string_view text, ObjData& result, std::string& error)
+{
+	ENGINE_CPU_ZONE;
+
+	auto& jobs = service<JobService>();
+
+	std::vector<Chunk> chunks;
+	for (const char* begin = text.data(), *end = text.data() + text.size(); begin < end;)
+	{
+		const char* chunkEnd = begin + std::min<size_t>(kChunkSize, end - begin);
+		if (chunkEnd < end)
+		{
+			chunkEnd = std::min(lineEnd(chunkEnd, end) + 1, end);
+		}
+
+		chunks.push_back({ .begin = begin, .end = chunkEnd });
+		begin = chunkEnd;
+	}
+
+	jobs.parallelFor(chunks.size(), [&chunks](size_t chunkId) { countChunk(chunks[chunkId]); });
+
+	//-- Attribute bases of the chunks and material ids in the order of the first use.
+	//-- Faces before the first usemtl use the unnamed material.
+	std::vector<std::string_view> materials = { std::string_view() };
+	std::unordered_map<std::string_view, uint32_t> materialIds = { { std::string_view(), 0 } };
+	size_t numPositions = 0;
+	size_t numUVs = 0;
+	size_t numNormals = 0;
+	uint32_t material = 0;
+	for (Chunk& chunk : chunks)
+	{
+		chunk.positionBase = static_cast<uint32_t>(numPositions);
+		chunk.uvBase = static_cast<uint32_t>(numUVs);
+		chunk.normalBase = static_cast<uint32_t>(numNormals);
+		chunk.material = material;
+
+		numPositions += chunk.numPositions;
+		numUVs += chunk.numUVs;
+		numNormals += chunk.numNormals;
+
+		for (std::string_view name : chunk.materials)
+		{
+			const auto [it, inserted] = materialIds.emplace(name, static_cast<uint32_t>(materials.size()));
+			if (inserted)
+			{
+				materials.push_back(name);
+			}
+			material = it->second;
+		}
+	}
+
+	if (std::max({ numPositions, numUVs, numNormals }) >= kObjNone)
+	{
+		error = "Too many vertex attributes.";
+		return false;
+	}
+
+	result = {};
+	result.positions.resize(numPositions);
+	result.uvs.resize(numUVs);
+	result.normals.resize(numNormals);
+
+	jobs.parallelFor(chunks.size(), [&chunks, &result, &materialIds, &text](size_t chunkId)
+		{
+			parseChunk(chunks[chunkId], result, materialIds, text.data());
+		});
+
+	bool hasColors = false;
+	for (const Chunk& chunk : chunks)
+	{
+		if (!chunk.error.empty())
+		{
+			error = chunk.error;
+			return false;
+		}
+		hasColors |= !chunk.colors.empty();
+	}
+
+	if (hasColors)
+	{
+		result.colors.resize(numPositions, kWhite);
+		for (const Chunk& chunk : chunks)
+		{
+			std::copy(chunk.colors.begin(), chunk.colors.end(), result.colors.begin() + chunk.positionBase);
+		}
+	}
+
+	//-- Gather the faces of every material from all chunks in the file order.
+	auto forEachRun = [&chunks](auto&& fn)
+		{
+			for (const Chunk& chunk : chunks)
+			{
+				for (size_t i = 0; i < chunk.runs.size(); ++i)
+				{
+					const size_t last = i + 1 < chunk.runs.size() ? chunk.runs[i + 1].firstCorner : chunk.corners.size();
+					fn(chunk.runs[i].material, std::span<const ObjCorner>(chunk.corners).subspan(chunk.runs[i].firstCorner, last - chunk.runs[i].firstCorner));
+				}
+			}
+		};
+
+	std::vector<size_t> numCorners(materials.size(), 0);
+	forEachRun([&numCorners](uint32_t runMaterial, std::span<const ObjCorner> corners) { numCorners[runMaterial] += corners.size(); });
+
+	std::vector<uint32_t> partMaterials;
+	for (uint32_t i = 0; i < materials.size(); ++i)
+	{
+		if (numCorners[i] > 0)
+		{
+			result.parts.push_back({ .material = std::string(materials[i]) });
+			partMaterials.push_back(i);
+		}
+	}
+
+	jobs.parallelFor(result.parts.size(), [&result, &partMaterials, &numCorners, &forEachRun](size_t partId)
+		{
+			auto& corners = result.parts[partId].corners;
+			corners.reserve(numCorners[partMaterials[partId]]);
+			forEachRun([&corners, material = partMaterials[partId]](uint32_t runMaterial, std::span<const ObjCorner> run)
+				{
+					if (runMaterial == material)
+					{
+						corners.insert(corners.end(), run.begin(), run.end());
+					}
+				});
+		});
+
+	return true;
+}
+
+} //-- engine::resources::mesh.
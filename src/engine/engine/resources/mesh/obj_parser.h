@@ -0,0 +1,41 @@
+#pragma once
+
+#include <engine/math.h>
+
+//-- Wavefront OBJ parser for large scanned meshes. It reads only geometry: positions with optional vertex colors, UVs, normals,
+//-- polygonal faces and material switches. Groups, smoothing groups and material libraries are ignored.
+namespace engine::resources::mesh
+{
+
+inline constexpr uint32_t kObjNone = ~0u;
+
+//-- Zero based indices of the attributes of a face corner, kObjNone for missing ones.
+struct ObjCorner
+{
+	uint32_t position = kObjNone;
+	uint32_t uv = kObjNone;
+	uint32_t normal = kObjNone;
+};
+
+//-- Faces using a single material, triangulated as fans, three corners per triangle.
+struct ObjPart
+{
+	std::string material; //-- Empty for faces before the first usemtl.
+	std::vector<ObjCorner> corners;
+};
+
+struct ObjData
+{
+	std::vector<math::vec3> positions;
+	std::vector<uint32_t> colors; //-- BGRA of the "v x y z r g b" extension per position. Empty if no position has it.
+	std::vector<math::vec2> uvs;
+	std::vector<math::vec3> normals;
+	std::vector<ObjPart> parts; //-- In the order of the first use of materials. Materials without faces have no parts.
+};
+
+//-- The text is split into line aligned chunks which are parsed in parallel, then the faces are gathered by material.
+//-- Numbers are parsed by SSE2 kernels with a fallback to std::from_chars for the rare long or exotic ones.
+//-- Returns false with a description in error if a face refers to a missing attribute.
+ENGINE_API bool parseObj(std::string_view text, ObjData& result, std::string& error);
+
+} //-- engine::resources::mesh.
@@ -0,0 +1,35 @@
+#pragma once
+
+//-- SSE helpers shared by the batch kernels of the mesh pipeline.
+namespace engine::resources::mesh
+{
+
+//-- AoS -> SoA for four tightly packed float3.
+FORCE_INLINE void loadVec3x4(const float* source, __m128& x, __m128& y, __m128& z)
+{
+	const __m128 a = _mm_loadu_ps(source + 0); //-- x0 y0 z0 x1
+	const __m128 b = _mm_loadu_ps(source + 4); //-- y1 z1 x2 y2
+	const __m128 c = _mm_loadu_ps(source + 8); //-- z2 x3 y3 z3
+
+	x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+	y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+	z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+
+FORCE_INLINE float horizontalMin(__m128 value)
+{
+	value = _mm_min_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 0, 3, 2)));
+	value = _mm_min_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtss_f32(value);
+}
+
+
+FORCE_INLINE float horizontalMax(__m128 value)
+{
+	value = _mm_max_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 0, 3, 2)));
+	value = _mm_max_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtss_f32(value);
+}
+
+} //-- engine::resources::mesh.
@@ -0,0 +1,314 @@
+#include <engine/resources/mesh/tangent_generator.h>
+#include <engine/resources/mesh/vertex_welder.h>
+#include <engine/assert.h>
+#include <engine/helpers.h>
+#include <engine/services/job_service.h>
+
+namespace engine::resources::mesh
+{
+
+namespace
+{
+
+//-- Triangles and vertices processed by a single task.
+inline constexpr size_t kBatchSize = 16 * 1024;
+//-- Orientations of triangles, keys of the welding, the groups, the corner contributions, the sorting of the corners by groups
+//-- and the frames of groups.
+inline constexpr size_t kMaxAllocations = 14;
+inline constexpr float kEpsilon = 1e-20f;
+
+
+//-- Removes the component along the unit normal and normalizes the rest. Returns false for vectors parallel to the normal.
+FORCE_INLINE bool projectToPlane(math::vec3& vector, const math::vec3& normal)
+{
+	vector = vector - normal * normal.Dot(vector);
+	const float lengthSquared = vector.LengthSquared();
+	if (lengthSquared <= kEpsilon)
+	{
+		return false;
+	}
+
+	vector = vector * (1.0f / std::sqrt(lengthSquared));
+	return true;
+}
+
+
+FORCE_INLINE void triangleVertices(std::span<const uint32_t> indices, size_t triangle, uint32_t (&vertices)[3])
+{
+	for (uint32_t k = 0; k < 3; ++k)
+	{
+		const size_t corner = triangle * 3 + k;
+		vertices[k] = indices.empty() ? static_cast<uint32_t>(corner) : indices[corner];
+	}
+}
+
+
+FORCE_INLINE float signedUVArea(std::span<const math::vec2> uvs, const uint32_t (&vertices)[3])
+{
+	const float du1 = uvs[vertices[1]].x - uvs[vertices[0]].x;
+	const float dv1 = uvs[vertices[1]].y - uvs[vertices[0]].y;
+	const float du2 = uvs[vertices[2]].x - uvs[vertices[0]].x;
+	const float dv2 = uvs[vertices[2]].y - uvs[vertices[0]].y;
+	return du1 * dv2 - du2 * dv1;
+}
+
+
+//-- -1 for triangles with mirrored UVs, 1 for the regular ones and 0 for those without a usable UV mapping.
+void triangleOrientations(std::span<const math::vec2> uvs, std::span<const uint32_t> indices, size_t first, size_t count,
+	std::span<int8_t> orientations)
+{
+	for (size_t triangle = first; triangle < first + count; ++triangle)
+	{
+		uint32_t vertices[3];
+		triangleVertices(indices, triangle, vertices);
+
+		const float signedArea = signedUVArea(uvs, vertices);
+		orientations[triangle] = std::abs(signedArea) <= kEpsilon ? 0 : signedArea < 0.0f ? -1 : 1;
+	}
+}
+
+
+//-- Writes the angle weighted face tangent and bitangent of every corner of the triangles.
+void triangleContributions(std::span<const math::vec3> positions, std::span<const math::vec3> normals, std::span<const math::vec2> uvs,
+	std::span<const uint32_t> indices, size_t first, size_t count, std::span<math::vec3> cornerTangents, std::span<math::vec3> cornerBitangents)
+{
+	for (size_t triangle = first; triangle < first + count; ++triangle)
+	{
+		uint32_t vertices[3];
+		triangleVertices(indices, triangle, vertices);
+
+		const math::vec3 edge1 = positions[vertices[1]] - positions[vertices[0]];
+		const math::vec3 edge2 = positions[vertices[2]] - positions[vertices[0]];
+		const float du1 = uvs[vertices[1]].x - uvs[vertices[0]].x;
+		const float dv1 = uvs[vertices[1]].y - uvs[vertices[0]].y;
+		const float du2 = uvs[vertices[2]].x - uvs[vertices[0]].x;
+		const float dv2 = uvs[vertices[2]].y - uvs[vertices[0]].y;
+
+		//-- Directions of growing U and V on the triangle. Only the sign of the UV area matters, the lengths are normalized away.
+		const float signedArea = signedUVArea(uvs, vertices);
+		const float sign = signedArea < 0.0f ? -1.0f : 1.0f;
+		const math::vec3 faceTangent = (edge1 * dv2 - edge2 * dv1) * sign;
+		const math::vec3 faceBitangent = (edge2 * du1 - edge1 * du2) * sign;
+		const bool degenerate = std::abs(signedArea) <= kEpsilon || edge1.Cross(edge2).LengthSquared() <= kEpsilon;
+
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			const size_t corner = triangle * 3 + k;
+			cornerTangents[corner] = math::vec3(0.0f, 0.0f, 0.0f);
+			cornerBitangents[corner] = math::vec3(0.0f, 0.0f, 0.0f);
+			if (degenerate)
+			{
+				continue;
+			}
+
+			const math::vec3& normal = normals[vertices[k]];
+			math::vec3 tangent = faceTangent;
+			math::vec3 bitangent = faceBitangent;
+			math::vec3 next = positions[vertices[(k + 1) % 3]] - positions[vertices[k]];
+			math::vec3 previous = positions[vertices[(k + 2) % 3]] - positions[vertices[k]];
+			if (!projectToPlane(next, normal) || !projectToPlane(previous, normal))
+			{
+				continue;
+			}
+
+			const float angle = std::acos(std::clamp(next.Dot(previous), -1.0f, 1.0f));
+			if (projectToPlane(tangent, normal))
+			{
+				cornerTangents[corner] = tangent * angle;
+			}
+			if (projectToPlane(bitangent, normal))
+			{
+				cornerBitangents[corner] = bitangent * angle;
+			}
+		}
+	}
+}
+
+
+//-- Sums the contributions of the corners of every group and orthogonalizes the result against the normal of the group.
+//-- Only corners of triangles with the orientation of the group count, so mirrored UVs don't cancel the regular ones out.
+void groupFrames(std::span<const math::vec3> normals, std::span<const uint32_t> groupOffsets, std::span<const uint32_t> groupCorners,
+	std::span<const uint32_t> groupVertices, std::span<const uint32_t> groupMirrored, std::span<const int8_t> orientations,
+	std::span<const math::vec3> cornerTangents, std::span<const math::vec3> cornerBitangents, size_t first, size_t count,
+	std::span<math::vec3> groupTangents, std::span<math::vec3> groupBitangents)
+{
+	for (size_t group = first; group < first + count; ++group)
+	{
+		math::vec3 tangent(0.0f, 0.0f, 0.0f);
+		math::vec3 bitangent(0.0f, 0.0f, 0.0f);
+		for (uint32_t i = groupOffsets[group]; i < groupOffsets[group + 1]; ++i)
+		{
+			const uint32_t corner = groupCorners[i];
+			if ((orientations[corner / 3] < 0) == (groupMirrored[group] != 0))
+			{
+				tangent += cornerTangents[corner];
+				bitangent += cornerBitangents[corner];
+			}
+		}
+
+		//-- Vertices without a usable UV mapping get an arbitrary frame around the normal.
+		const math::vec3& normal = normals[groupVertices[group]];
+		if (!projectToPlane(tangent, normal))
+		{
+			tangent = std::abs(normal.x) < 0.9f ? math::vec3(1.0f, 0.0f, 0.0f) : math::vec3(0.0f, 1.0f, 0.0f);
+			projectToPlane(tangent, normal);
+		}
+
+		const math::vec3 cross = normal.Cross(tangent);
+		groupTangents[group] = tangent;
+		groupBitangents[group] = cross.Dot(bitangent) < 0.0f ? cross * -1.0f : cross;
+	}
+}
+
+
+//-- Runs fn(first, count) over batches of the range, in parallel if there are several batches.
+template<typename Fn>
+void forBatches(size_t count, const Fn& fn)
+{
+	const size_t numBatches = (count + kBatchSize - 1) / kBatchSize;
+	if (numBatches <= 1)
+	{
+		fn(size_t(0), count);
+		return;
+	}
+
+	service<JobService>().parallelFor(numBatches, [&fn, count](size_t batch)
+		{
+			const size_t first = batch * kBatchSize;
+			fn(first, std::min(kBatchSize, count - first));
+		});
+}
+
+} //-- unnamed.
+
+
+size_t tangentScratchSize(size_t numVertices, size_t numIndices)
+{
+	const size_t numCorners = numIndices > 0 ? numIndices : numVertices;
+	//-- Keys: a position, a normal, a UV and the orientation per vertex. Groups: the group of the vertex, the representative vertex,
+	//-- the offset, the sorting cursor and the frame. Corners: the contributions, the sorted corner and the orientation of the triangle.
+	const size_t vertexSize = 2 * sizeof(math::vec3) + sizeof(math::vec2) + 5 * sizeof(uint32_t) + 2 * sizeof(math::vec3);
+	const size_t cornerSize = 2 * sizeof(math::vec3) + sizeof(uint32_t) + sizeof(int8_t);
+	return numVertices * vertexSize + numCorners * cornerSize + sizeof(uint32_t) + weldScratchSize(numVertices)
+		+ kMaxAllocations * alignof(std::max_align_t);
+}
+
+
+void generateTangents(std::span<const math::vec3> positions, std::span<const math::vec3> normals, std::span<const math::vec2> uvs,
+	std::span<const uint32_t> indices, std::span<math::vec3> tangents, std::span<math::vec3> bitangents, utils::LinearArena& scratch)
+{
+	ENGINE_CPU_ZONE;
+
+	const size_t numVertices = positions.size();
+	const size_t numCorners = indices.empty() ? numVertices : indices.size();
+	ENGINE_ASSERT(normals.size() == numVertices && uvs.size() == numVertices, "Every vertex needs a normal and a UV!");
+	ENGINE_ASSERT(tangents.size() == numVertices && bitangents.size() == numVertices, "Every vertex needs a tangent and a bitangent!");
+	ENGINE_ASSERT_DEBUG(numCorners % 3 == 0);
+	if (numVertices == 0)
+	{
+		return;
+	}
+
+	auto orientations = scratch.allocate<int8_t>(numCorners / 3);
+	forBatches(numCorners / 3, [&](size_t first, size_t count)
+		{
+			ENGINE_CPU_ZONE_NAMED("mesh::triangleOrientations");
+
+			triangleOrientations(uvs, indices, first, count, orientations);
+		});
+
+	//-- Vertices of flat streams take the orientation of their triangle. Indexed ones take the one of most of their corners,
+	//-- corners of the other orientation are left out of their frames.
+	auto keyMirrored = scratch.allocate<uint32_t>(numVertices);
+	if (indices.empty())
+	{
+		for (size_t vertex = 0; vertex < numVertices; ++vertex)
+		{
+			keyMirrored[vertex] = orientations[vertex / 3] < 0 ? 1 : 0;
+		}
+	}
+	else
+	{
+		for (size_t corner = 0; corner < numCorners; ++corner)
+		{
+			keyMirrored[indices[corner]] -= static_cast<uint32_t>(orientations[corner / 3]);
+		}
+		for (uint32_t& mirrored : keyMirrored)
+		{
+			mirrored = static_cast<int32_t>(mirrored) > 0 ? 1 : 0;
+		}
+	}
+
+	//-- Group vertices which share the position, the normal, the UV and its orientation like MikkTSpace does.
+	//-- The welder works on copies of the attributes.
+	auto keyPositions = scratch.allocate<math::vec3>(numVertices);
+	auto keyNormals = scratch.allocate<math::vec3>(numVertices);
+	auto keyUVs = scratch.allocate<math::vec2>(numVertices);
+	std::copy(positions.begin(), positions.end(), keyPositions.begin());
+	std::copy(normals.begin(), normals.end(), keyNormals.begin());
+	std::copy(uvs.begin(), uvs.end(), keyUVs.begin());
+
+	const WeldStream keys[] = {
+		{ .data = keyPositions.data(), .numComponents = 3, .floats = false },
+		{ .data = keyNormals.data(), .numComponents = 3, .floats = false },
+		{ .data = keyUVs.data(), .numComponents = 2, .floats = false },
+		{ .data = keyMirrored.data(), .numComponents = 1, .floats = false }
+	};
+	auto groups = scratch.allocate<uint32_t>(numVertices);
+	const size_t numGroups = weldVertices(keys, groups, scratch);
+	//-- The welding compacted the keys, so the first numGroups of them belong to the groups.
+	const auto groupMirrored = std::span<const uint32_t>(keyMirrored).first(numGroups);
+
+	auto cornerTangents = scratch.allocate<math::vec3>(numCorners);
+	auto cornerBitangents = scratch.allocate<math::vec3>(numCorners);
+	forBatches(numCorners / 3, [&](size_t first, size_t count)
+		{
+			ENGINE_CPU_ZONE_NAMED("mesh::triangleContributions");
+
+			triangleContributions(positions, normals, uvs, indices, first, count, cornerTangents, cornerBitangents);
+		});
+
+	//-- Counting sort of the corners by groups, so every group sums its corners in the same order on any number of threads.
+	auto groupOffsets = scratch.allocate<uint32_t>(numGroups + 1);
+	auto groupVertices = scratch.allocate<uint32_t>(numGroups);
+	for (size_t corner = 0; corner < numCorners; ++corner)
+	{
+		++groupOffsets[groups[indices.empty() ? corner : indices[corner]] + 1];
+	}
+	for (size_t group = 0; group < numGroups; ++group)
+	{
+		groupOffsets[group + 1] += groupOffsets[group];
+	}
+	for (size_t vertex = numVertices; vertex > 0; --vertex)
+	{
+		groupVertices[groups[vertex - 1]] = static_cast<uint32_t>(vertex - 1);
+	}
+
+	auto groupCorners = scratch.allocate<uint32_t>(numCorners);
+	{
+		auto cursors = scratch.allocate<uint32_t>(numGroups);
+		std::copy_n(groupOffsets.begin(), numGroups, cursors.begin());
+		for (size_t corner = 0; corner < numCorners; ++corner)
+		{
+			groupCorners[cursors[groups[indices.empty() ? corner : indices[corner]]]++] = static_cast<uint32_t>(corner);
+		}
+	}
+
+	auto groupTangents = scratch.allocate<math::vec3>(numGroups);
+	auto groupBitangents = scratch.allocate<math::vec3>(numGroups);
+	forBatches(numGroups, [&](size_t first, size_t count)
+		{
+			ENGINE_CPU_ZONE_NAMED("mesh::groupFrames");
+
+			groupFrames(normals, groupOffsets, groupCorners, groupVertices, groupMirrored, orientations, cornerTangents, cornerBitangents,
+				first, count, groupTangents, groupBitangents);
+		});
+
+	for (size_t vertex = 0; vertex < numVertices; ++vertex)
+	{
+		tangents[vertex] = groupTangents[groups[vertex]];
+		bitangents[vertex] = groupBitangents[groups[vertex]];
+	}
+}
+
+} //-- engine::resources::mesh.
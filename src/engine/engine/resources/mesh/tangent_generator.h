@@ -0,0 +1,22 @@
+#pragma once
+
+#include <engine/math.h>
+#include <engine/utils/linear_arena.h>
+
+//-- Tangent frames for meshes which come without them.
+namespace engine::resources::mesh
+{
+
+//-- Upper bound of the scratch memory generateTangents needs.
+size_t tangentScratchSize(size_t numVertices, size_t numIndices);
+
+//-- Generates per vertex tangents and bitangents from the normals and the UVs the way MikkTSpace does: face tangents are
+//-- projected onto the plane of the vertex normal and summed weighted by the corner angles over all corners which share
+//-- the position, the normal, the UV and the orientation of the UVs, then orthogonalized. The bitangent is the cross product of the normal and the tangent
+//-- flipped to the side of the summed UV bitangent, so mirrored UVs keep their handedness.
+//-- indices is the triangle list over the vertices, empty for flat streams where every three vertices are a triangle.
+//-- Large inputs are processed in parallel, the result doesn't depend on the number of threads.
+void generateTangents(std::span<const math::vec3> positions, std::span<const math::vec3> normals, std::span<const math::vec2> uvs,
+	std::span<const uint32_t> indices, std::span<math::vec3> tangents, std::span<math::vec3> bitangents, utils::LinearArena& scratch);
+
+} //-- engine::resources::mesh.
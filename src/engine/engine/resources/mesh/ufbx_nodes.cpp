@@ -0,0 +1,36 @@
+#include <engine/resources/mesh/ufbx_nodes.h>
+#include <engine/assert.h>
+
+namespace engine::resources::mesh
+{
+
+std::vector<uint32_t> flattenNodes(const ufbx_scene* scene)
+{
+	ENGINE_CPU_ZONE;
+
+	std::vector<uint32_t> order;
+	order.reserve(scene->nodes.count);
+	if (!scene->root_node)
+	{
+		return order;
+	}
+
+	std::vector<const ufbx_node*> stack = { scene->root_node };
+	while (!stack.empty())
+	{
+		const ufbx_node* node = stack.back();
+		stack.pop_back();
+		order.push_back(node->typed_id);
+
+		//-- Reversed, so children are popped in the file order.
+		for (size_t i = node->children.count; i > 0; --i)
+		{
+			stack.push_back(node->children.data[i - 1]);
+		}
+	}
+
+	ENGINE_ASSERT(order.size() == scene->nodes.count, "Not all nodes are reachable from the root!");
+	return order;
+}
+
+} //-- engine::resources::mesh.
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <ufbx/ufbx.h>
+
+namespace engine::resources::mesh
+{
+
+//-- Orders the nodes of the scene so that every parent precedes its children: depth first from the root, children in the file order.
+//-- Returns ids of the nodes in ufbx_scene::nodes. Mesh and animation importers share the order, so node indices of meshes
+//-- match the tracks of animation clips.
+std::vector<uint32_t> flattenNodes(const ufbx_scene* scene);
+
+} //-- engine::resources::mesh.
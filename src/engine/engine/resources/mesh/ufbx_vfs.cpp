@@ -0,0 +1,74 @@
+#include <engine/resources/mesh/ufbx_vfs.h>
+#include <engine/services/vfs_service.h>
+#include <engine/utils/mapped_file.h>
+
+namespace engine::resources::mesh
+{
+
+namespace
+{
+
+//-- ufbx reads streams through its own buffer. Large blocks keep the number of VFS reads and archive inflate calls low.
+inline constexpr size_t kReadBufferSize = 1024 * 1024;
+
+bool openStream(ufbx_stream& stream, std::string_view path)
+{
+	auto file = service<VFSService>().openFile(path);
+	if (!file || !file->IsOpened())
+	{
+		return false;
+	}
+
+	//-- ufbx calls close_fn once it's done with the stream, including failed loads.
+	stream.read_fn = [](void* user, void* data, size_t size) -> size_t
+		{
+			return static_cast<size_t>((*static_cast<vfspp::IFilePtr*>(user))->Read(static_cast<uint8_t*>(data), size));
+		};
+	stream.close_fn = [](void* user)
+		{
+			delete static_cast<vfspp::IFilePtr*>(user);
+		};
+	stream.user = new vfspp::IFilePtr(std::move(file));
+
+	return true;
+}
+
+
+bool openFile(void* /*user*/, ufbx_stream* stream, const char* path, size_t pathLength, const ufbx_open_file_info* /*info*/)
+{
+	return openStream(*stream, std::string_view(path, pathLength));
+}
+
+} //-- unnamed.
+
+
+ufbx_scene* loadScene(std::string_view path, ufbx_load_opts opts, ufbx_error& error)
+{
+	ENGINE_CPU_ZONE;
+
+	//-- External files are resolved relative to the filename with VFS separators.
+	opts.filename = { path.data(), path.size() };
+	opts.path_separator = '/';
+	opts.open_file_cb = { .fn = &openFile, .user = nullptr };
+	opts.read_buffer_size = kReadBufferSize;
+
+	utils::MappedFile mapping;
+	if (service<VFSService>().mapFile(path, mapping))
+	{
+		return ufbx_load_memory(mapping.data(), mapping.size(), &opts, &error);
+	}
+
+	ufbx_stream stream = {};
+	if (!openStream(stream, path))
+	{
+		static constexpr std::string_view kNotFound = "File not found";
+		error = {};
+		error.type = UFBX_ERROR_FILE_NOT_FOUND;
+		error.description = { kNotFound.data(), kNotFound.size() };
+		return nullptr;
+	}
+
+	return ufbx_load_stream(&stream, &opts, &error);
+}
+
+} //-- engine::resources::mesh.
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <ufbx/ufbx.h>
+
+//-- Loads ufbx scenes (FBX, OBJ) through the VFS, so source assets can be shipped inside archives.
+namespace engine::resources::mesh
+{
+
+//-- Files of native file systems are mapped and parsed in place, files inside archives are streamed through the VFS in large blocks.
+//-- External files (like .mtl of OBJ) are opened through the VFS too, relative to the path of the scene.
+//-- Returns nullptr and fills error on failure. The result is freed with ufbx_free_scene.
+ufbx_scene* loadScene(std::string_view path, ufbx_load_opts opts, ufbx_error& error);
+
+} //-- engine::resources::mesh.
@@ -0,0 +1,364 @@
+#include <engine/resources/mesh/vertex_quantization.h>
+#include <engine/resources/mesh/simd.h>
+
+#include <algorithm>
+
+namespace engine::resources::mesh
+{
+
+namespace
+{
+
+inline constexpr float kSnorm16Scale = 32767.0f;
+inline constexpr float kUnorm16Scale = 65535.0f;
+
+//-- Rounds to the nearest integer with the default MXCSR rounding mode.
+FORCE_INLINE __m128i toSnorm16(__m128 value)
+{
+	const __m128 clamped = _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+	return _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(kSnorm16Scale)));
+}
+
+
+//-- -32768 and -32767 both decode to -1.
+float fromSnorm16(int16_t value)
+{
+	return std::max(value / kSnorm16Scale, -1.0f);
+}
+
+
+FORCE_INLINE __m128 copySign(__m128 magnitude, __m128 sign)
+{
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	return _mm_or_ps(_mm_andnot_ps(signMask, magnitude), _mm_and_ps(signMask, sign));
+}
+
+
+FORCE_INLINE __m128 abs(__m128 value)
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+}
+
+
+//-- See http://jcgt.org/published/0003/02/01/ (Cigolle et al. 2014).
+FORCE_INLINE void octahedralEncode(__m128 x, __m128 y, __m128 z, __m128& u, __m128& v)
+{
+	const __m128 sum = _mm_add_ps(_mm_add_ps(abs(x), abs(y)), abs(z));
+	//-- Zero vectors are mapped to (0, 0), which decodes to +Z.
+	const __m128 invSum = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(sum, _mm_set1_ps(1e-20f)));
+
+	const __m128 px = _mm_mul_ps(x, invSum);
+	const __m128 py = _mm_mul_ps(y, invSum);
+
+	//-- Fold the lower hemisphere over the diagonals.
+	const __m128 foldedX = copySign(_mm_sub_ps(_mm_set1_ps(1.0f), abs(py)), px);
+	const __m128 foldedY = copySign(_mm_sub_ps(_mm_set1_ps(1.0f), abs(px)), py);
+	const __m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+
+	u = _mm_or_ps(_mm_and_ps(lower, foldedX), _mm_andnot_ps(lower, px));
+	v = _mm_or_ps(_mm_and_ps(lower, foldedY), _mm_andnot_ps(lower, py));
+}
+
+
+//-- Float to half conversion with SSE2 only, see https://gist.github.com/rygorous/2156668.
+//-- Negative results are sign extended, so they survive _mm_packs_epi32.
+FORCE_INLINE __m128i floatToHalf(__m128 value)
+{
+	const __m128i kF16Max = _mm_set1_epi32((127 + 16) << 23);
+	const __m128i kNanBit = _mm_set1_epi32(0x200);
+	const __m128i kInfinity = _mm_set1_epi32(0x7c00);
+	const __m128i kMinNormal = _mm_set1_epi32((127 - 14) << 23);
+	const __m128i kSubnormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+	const __m128i kNormalBias = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+
+	const __m128 sign = _mm_and_ps(value, _mm_set1_ps(-0.0f));
+	const __m128 absValue = _mm_xor_ps(value, sign);
+	const __m128i absBits = _mm_castps_si128(absValue);
+
+	const __m128i isNan = _mm_castps_si128(_mm_cmpunord_ps(absValue, absValue));
+	const __m128i isRegular = _mm_cmpgt_epi32(kF16Max, absBits);
+	const __m128i infOrNan = _mm_or_si128(_mm_and_si128(isNan, kNanBit), kInfinity);
+	const __m128i isSubnormal = _mm_cmpgt_epi32(kMinNormal, absBits);
+
+	//-- The FPU does the rounding of subnormals for us.
+	const __m128 subnormalSum = _mm_add_ps(absValue, _mm_castsi128_ps(kSubnormalMagic));
+	const __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(subnormalSum), kSubnormalMagic);
+
+	//-- Rebias the exponent and round the mantissa to nearest even.
+	const __m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(absBits, 31 - 13), 31);
+	const __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absBits, kNormalBias), mantissaOdd), 13);
+
+	const __m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+	const __m128i joined = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, infOrNan));
+
+	return _mm_or_si128(joined, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+}
+
+
+//-- Builds the quaternion of the orthonormalized tangent frame, xyzw.
+std::array<float, 4> tangentFrameQuaternion(const math::vec3& tangent, const math::vec3& bitangent, const math::vec3& normal)
+{
+	auto dot = [](const math::vec3& lhs, const math::vec3& rhs) { return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z; };
+	auto cross = [](const math::vec3& lhs, const math::vec3& rhs)
+		{
+			return math::vec3(lhs.y * rhs.z - lhs.z * rhs.y, lhs.z * rhs.x - lhs.x * rhs.z, lhs.x * rhs.y - lhs.y * rhs.x);
+		};
+	auto normalize = [&dot](const math::vec3& value, const math::vec3& fallback)
+		{
+			const float lengthSq = dot(value, value);
+			if (lengthSq < 1e-12f)
+			{
+				return fallback;
+			}
+
+			const float invLength = 1.0f / std::sqrt(lengthSq);
+			return math::vec3(value.x * invLength, value.y * invLength, value.z * invLength);
+		};
+
+	const math::vec3 n = normalize(normal, math::vec3(0.0f, 0.0f, 1.0f));
+
+	//-- Gram-Schmidt, falls back to any vector orthogonal to the normal.
+	const float tn = dot(tangent, n);
+	math::vec3 t = normalize(math::vec3(tangent.x - n.x * tn, tangent.y - n.y * tn, tangent.z - n.z * tn), math::vec3(0.0f, 0.0f, 0.0f));
+	if (dot(t, t) == 0.0f)
+	{
+		const math::vec3 axis = std::abs(n.x) < 0.9f ? math::vec3(1.0f, 0.0f, 0.0f) : math::vec3(0.0f, 1.0f, 0.0f);
+		t = normalize(cross(axis, n), math::vec3(1.0f, 0.0f, 0.0f));
+	}
+
+	//-- The rotation maps X, Y, Z to t, b, n. The original bitangent only gives the handedness.
+	const math::vec3 b = cross(n, t);
+	const float handedness = dot(b, bitangent) < 0.0f ? -1.0f : 1.0f;
+
+	//-- Matrix with t, b, n columns to quaternion.
+	std::array<float, 4> q;
+	const float trace = t.x + b.y + n.z;
+	if (trace > 0.0f)
+	{
+		const float s = 0.5f / std::sqrt(trace + 1.0f);
+		q = { (b.z - n.y) * s, (n.x - t.z) * s, (t.y - b.x) * s, 0.25f / s };
+	}
+	else if (t.x > b.y && t.x > n.z)
+	{
+		const float s = 2.0f * std::sqrt(1.0f + t.x - b.y - n.z);
+		q = { 0.25f * s, (b.x + t.y) / s, (n.x + t.z) / s, (b.z - n.y) / s };
+	}
+	else if (b.y > n.z)
+	{
+		const float s = 2.0f * std::sqrt(1.0f + b.y - t.x - n.z);
+		q = { (b.x + t.y) / s, 0.25f * s, (n.y + b.z) / s, (n.x - t.z) / s };
+	}
+	else
+	{
+		const float s = 2.0f * std::sqrt(1.0f + n.z - t.x - b.y);
+		q = { (n.x + t.z) / s, (n.y + b.z) / s, 0.25f * s, (t.y - b.x) / s };
+	}
+
+	//-- q and -q are the same rotation, so make w positive and keep it away from zero,
+	//-- otherwise its sign is lost in SNORM. Then store the handedness in the sign of w.
+	if (q[3] < 0.0f)
+	{
+		q = { -q[0], -q[1], -q[2], -q[3] };
+	}
+
+	constexpr float kMinW = 1.0f / kSnorm16Scale;
+	if (q[3] < kMinW)
+	{
+		const float scale = std::sqrt(1.0f - kMinW * kMinW);
+		q = { q[0] * scale, q[1] * scale, q[2] * scale, kMinW };
+	}
+
+	if (handedness < 0.0f)
+	{
+		q = { -q[0], -q[1], -q[2], -q[3] };
+	}
+
+	return q;
+}
+
+} //-- unnamed.
+
+
+void quantizePositions(uint16_t* destination, std::span<const math::vec3> positions, const math::AABB& aabb)
+{
+	ENGINE_CPU_ZONE;
+
+	const math::vec3 extent = aabb.m_max - aabb.m_min;
+	const math::vec3 scale(
+		extent.x > 0.0f ? kUnorm16Scale / extent.x : 0.0f,
+		extent.y > 0.0f ? kUnorm16Scale / extent.y : 0.0f,
+		extent.z > 0.0f ? kUnorm16Scale / extent.z : 0.0f);
+
+	const __m128 minX = _mm_set1_ps(aabb.m_min.x);
+	const __m128 minY = _mm_set1_ps(aabb.m_min.y);
+	const __m128 minZ = _mm_set1_ps(aabb.m_min.z);
+	const __m128 scaleX = _mm_set1_ps(scale.x);
+	const __m128 scaleY = _mm_set1_ps(scale.y);
+	const __m128 scaleZ = _mm_set1_ps(scale.z);
+	const __m128 upper = _mm_set1_ps(kUnorm16Scale);
+	//-- There is no unsigned saturated pack in SSE2, so pack biased values and flip the sign bit back.
+	const __m128i bias = _mm_set1_epi32(32768);
+	const __m128i signBit = _mm_set1_epi16(static_cast<int16_t>(0x8000));
+
+	auto quantize = [&upper, &bias](__m128 value, __m128 min, __m128 scale)
+		{
+			const __m128 normalized = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(value, min), scale), _mm_setzero_ps()), upper);
+			return _mm_sub_epi32(_mm_cvtps_epi32(normalized), bias);
+		};
+
+	const float* source = reinterpret_cast<const float*>(positions.data());
+	size_t i = 0;
+	for (; i + 4 <= positions.size(); i += 4)
+	{
+		__m128 x, y, z;
+		loadVec3x4(source + i * 3, x, y, z);
+
+		const __m128i xy = _mm_xor_si128(_mm_packs_epi32(quantize(x, minX, scaleX), quantize(y, minY, scaleY)), signBit);
+		const __m128i zw = _mm_unpacklo_epi16(_mm_xor_si128(_mm_packs_epi32(quantize(z, minZ, scaleZ), _mm_setzero_si128()), signBit), _mm_setzero_si128());
+		const __m128i interleaved = _mm_unpacklo_epi16(xy, _mm_srli_si128(xy, 8)); //-- x0 y0 x1 y1 x2 y2 x3 y3
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4 + 0), _mm_unpacklo_epi32(interleaved, zw));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4 + 8), _mm_unpackhi_epi32(interleaved, zw));
+	}
+
+	for (; i < positions.size(); ++i)
+	{
+		const math::vec3& position = positions[i];
+		auto quantizeScalar = [](float value, float min, float scale)
+			{
+				return static_cast<uint16_t>(std::lround(std::clamp((value - min) * scale, 0.0f, kUnorm16Scale)));
+			};
+
+		destination[i * 4 + 0] = quantizeScalar(position.x, aabb.m_min.x, scale.x);
+		destination[i * 4 + 1] = quantizeScalar(position.y, aabb.m_min.y, scale.y);
+		destination[i * 4 + 2] = quantizeScalar(position.z, aabb.m_min.z, scale.z);
+		destination[i * 4 + 3] = 0;
+	}
+}
+
+
+void encodeOctahedral(int16_t* destination, std::span<const math::vec3> vectors)
+{
+	ENGINE_CPU_ZONE;
+
+	const float* source = reinterpret_cast<const float*>(vectors.data());
+	size_t i = 0;
+	for (; i + 4 <= vectors.size(); i += 4)
+	{
+		__m128 x, y, z, u, v;
+		loadVec3x4(source + i * 3, x, y, z);
+		octahedralEncode(x, y, z, u, v);
+
+		const __m128i uv = _mm_packs_epi32(toSnorm16(u), toSnorm16(v));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 2), _mm_unpacklo_epi16(uv, _mm_srli_si128(uv, 8)));
+	}
+
+	//-- Pad the tail to a full batch, so both paths give bit exact results.
+	if (i < vectors.size())
+	{
+		std::array<math::vec3, 4> tail = {};
+		std::copy(vectors.begin() + i, vectors.end(), tail.begin());
+
+		__m128 x, y, z, u, v;
+		loadVec3x4(reinterpret_cast<const float*>(tail.data()), x, y, z);
+		octahedralEncode(x, y, z, u, v);
+
+		std::array<int16_t, 8> encoded;
+		const __m128i uv = _mm_packs_epi32(toSnorm16(u), toSnorm16(v));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(encoded.data()), _mm_unpacklo_epi16(uv, _mm_srli_si128(uv, 8)));
+		std::copy_n(encoded.begin(), (vectors.size() - i) * 2, destination + i * 2);
+	}
+}
+
+
+void encodeQTangents(int16_t* destination, std::span<const math::vec3> tangents, std::span<const math::vec3> bitangents,
+	std::span<const math::vec3> normals)
+{
+	ENGINE_CPU_ZONE;
+
+	//-- Building a quaternion is branchy, so only the conversion to SNORM is vectorized.
+	for (size_t i = 0; i < normals.size(); i += 2)
+	{
+		const auto q0 = tangentFrameQuaternion(tangents[i], bitangents[i], normals[i]);
+		const auto q1 = i + 1 < normals.size() ? tangentFrameQuaternion(tangents[i + 1], bitangents[i + 1], normals[i + 1]) : q0;
+
+		const __m128i packed = _mm_packs_epi32(toSnorm16(_mm_loadu_ps(q0.data())), toSnorm16(_mm_loadu_ps(q1.data())));
+		if (i + 1 < normals.size())
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), packed);
+		}
+		else
+		{
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(destination + i * 4), packed);
+		}
+	}
+}
+
+
+void convertToHalf(uint16_t* destination, std::span<const float> values)
+{
+	ENGINE_CPU_ZONE;
+
+	size_t i = 0;
+	for (; i + 8 <= values.size(); i += 8)
+	{
+		const __m128i lo = floatToHalf(_mm_loadu_ps(values.data() + i));
+		const __m128i hi = floatToHalf(_mm_loadu_ps(values.data() + i + 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_packs_epi32(lo, hi));
+	}
+
+	if (i < values.size())
+	{
+		std::array<float, 8> tail = {};
+		std::copy(values.begin() + i, values.end(), tail.begin());
+
+		std::array<uint16_t, 8> converted;
+		const __m128i lo = floatToHalf(_mm_loadu_ps(tail.data()));
+		const __m128i hi = floatToHalf(_mm_loadu_ps(tail.data() + 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(converted.data()), _mm_packs_epi32(lo, hi));
+		std::copy_n(converted.begin(), values.size() - i, destination + i);
+	}
+}
+
+
+
+void decodeOctahedral(std::span<math::vec3> destination, const int16_t* source)
+{
+	for (size_t i = 0; i < destination.size(); ++i)
+	{
+		const float u = fromSnorm16(source[i * 2]);
+		const float v = fromSnorm16(source[i * 2 + 1]);
+		const float z = 1.0f - std::abs(u) - std::abs(v);
+
+		//-- Unfold the lower hemisphere.
+		const math::vec3 vector = z < 0.0f
+			? math::vec3(std::copysign(1.0f - std::abs(v), u), std::copysign(1.0f - std::abs(u), v), z)
+			: math::vec3(u, v, z);
+		destination[i] = vector / vector.Length();
+	}
+}
+
+
+void decodeQTangents(std::span<math::vec3> tangents, std::span<math::vec3> bitangents, std::span<math::vec3> normals, const int16_t* source)
+{
+	for (size_t i = 0; i < normals.size(); ++i)
+	{
+		const int16_t* encoded = source + i * 4;
+		float x = fromSnorm16(encoded[0]);
+		float y = fromSnorm16(encoded[1]);
+		float z = fromSnorm16(encoded[2]);
+		float w = fromSnorm16(encoded[3]);
+		const float invLength = 1.0f / std::sqrt(x * x + y * y + z * z + w * w);
+		x *= invLength;
+		y *= invLength;
+		z *= invLength;
+		w *= invLength;
+
+		//-- The rotation of X and Z, the sign of w gives the handedness of the bitangent.
+		tangents[i] = math::vec3(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y));
+		normals[i] = math::vec3(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y));
+		bitangents[i] = normals[i].Cross(tangents[i]) * (encoded[3] < 0 ? -1.0f : 1.0f);
+	}
+}
+
+} //-- engine::resources::mesh.
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <engine/math/aabb.h>
+
+//-- Batch encoders for compact vertex formats.
+//-- The streams are processed four vertices at a time with SSE, tails are handled by the scalar path.
+namespace engine::resources::mesh
+{
+
+//-- Positions relative to the AABB as 16-bit UNORM xyz with zero w (R16G16B16A16_UNORM).
+//-- Decoding is `aabb.min + value * (aabb.max - aabb.min)`.
+ENGINE_API void quantizePositions(uint16_t* destination, std::span<const math::vec3> positions, const math::AABB& aabb);
+
+//-- Unit vectors as octahedral 16-bit SNORM xy (R16G16_SNORM).
+ENGINE_API void encodeOctahedral(int16_t* destination, std::span<const math::vec3> vectors);
+
+//-- Tangent frames as a quaternion in 16-bit SNORM xyzw (R16G16B16A16_SNORM).
+//-- The sign of w stores the handedness of the bitangent, so w is kept away from zero.
+//-- Degenerated tangents (e.g. zeroed missing streams) are replaced with an arbitrary frame around the normal.
+ENGINE_API void encodeQTangents(int16_t* destination, std::span<const math::vec3> tangents, std::span<const math::vec3> bitangents,
+	std::span<const math::vec3> normals);
+
+//-- IEEE 754 half precision with round to nearest even.
+ENGINE_API void convertToHalf(uint16_t* destination, std::span<const float> values);
+
+//-- Inverses of the encoders above for the vertices which are modified on the CPU, see MeshResource::blendVertices.
+//-- Vectors are normalized, bitangents are rebuilt from the tangent, the normal and the handedness.
+ENGINE_API void decodeOctahedral(std::span<math::vec3> destination, const int16_t* source);
+ENGINE_API void decodeQTangents(std::span<math::vec3> tangents, std::span<math::vec3> bitangents, std::span<math::vec3> normals, const int16_t* source);
+
+} //-- engine::resources::mesh.
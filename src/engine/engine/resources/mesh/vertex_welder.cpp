@@ -0,0 +1,323 @@
+#include <engine/resources/mesh/vertex_welder.h>
+#include <engine/assert.h>
+#include <engine/helpers.h>
+#include <engine/services/job_service.h>
+
+#include <bit>
+
+namespace engine::resources::mesh
+{
+
+namespace
+{
+
+inline constexpr size_t kMaxStreams = 16;
+inline constexpr uint32_t kEmptySlot = ~0u;
+//-- Hashes, vertices ordered by shards, representatives and the tables.
+inline constexpr size_t kMaxAllocations = 4;
+
+//-- Smaller inputs are welded on the calling thread, tasks wouldn't pay off.
+inline constexpr size_t kParallelThreshold = 64 * 1024;
+inline constexpr size_t kHashBatchSize = 16 * 1024;
+//-- Large inputs are split into shards by the top bits of the hashes, every shard is welded by its own task into its own table.
+inline constexpr uint32_t kShardBits = 6;
+inline constexpr uint32_t kMaxShards = 1u << kShardBits;
+//-- Vertices quantized at once, their components fit the stack.
+inline constexpr size_t kChunkSize = 64;
+
+struct Stream
+{
+	uint32_t* data = nullptr;
+	uint32_t numComponents = 0;
+	float inverseStep = 0.0f; //-- Zero keeps the exact bits.
+};
+
+
+//-- Keys are the bits of the values rounded to the grid, so they never saturate like 32-bit integers would for far values.
+//-- Values from 2^23 steps on are whole already and kept as they are, so are infinities and NaNs. Zeros of both signs give the same key.
+FORCE_INLINE __m128 snapToGrid(__m128 value, __m128 inverseStep)
+{
+	const __m128 scaled = _mm_mul_ps(value, inverseStep);
+	const __m128 rounded = _mm_cvtepi32_ps(_mm_cvtps_epi32(scaled));
+	const __m128 small = _mm_cmplt_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), scaled), _mm_set1_ps(8388608.0f));
+	return _mm_or_ps(_mm_and_ps(small, rounded), _mm_andnot_ps(small, scaled));
+}
+
+
+//-- The scalar version of the batch below. Both use the same rounding, so the hashes and the comparisons agree.
+FORCE_INLINE uint32_t quantize(uint32_t bits, float inverseStep)
+{
+	if (inverseStep == 0.0f)
+	{
+		return bits;
+	}
+
+	const __m128 value = _mm_castsi128_ps(_mm_cvtsi32_si128(static_cast<int>(bits)));
+	return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_castps_si128(snapToGrid(value, _mm_set_ss(inverseStep)))));
+}
+
+
+//-- Components of consecutive vertices are contiguous, so the layout of the vertex doesn't matter and 4 components are quantized at once.
+void quantize(const uint32_t* source, size_t count, float inverseStep, uint32_t* result)
+{
+	if (inverseStep == 0.0f)
+	{
+		memcpy(result, source, count * sizeof(uint32_t));
+		return;
+	}
+
+	const __m128 scale = _mm_set1_ps(inverseStep);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 value = _mm_loadu_ps(reinterpret_cast<const float*>(source + i));
+		_mm_storeu_ps(reinterpret_cast<float*>(result + i), snapToGrid(value, scale));
+	}
+	for (; i < count; ++i)
+	{
+		result[i] = quantize(source[i], inverseStep);
+	}
+}
+
+
+//-- MurmurHash3 steps.
+FORCE_INLINE uint32_t mix(uint32_t hash, uint32_t key)
+{
+	key *= 0xcc9e2d51;
+	key = std::rotl(key, 15);
+	key *= 0x1b873593;
+
+	hash ^= key;
+	hash = std::rotl(hash, 13);
+	return hash * 5 + 0xe6546b64;
+}
+
+
+FORCE_INLINE uint32_t finalize(uint32_t hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+
+void hashVertices(std::span<const Stream> streams, size_t first, size_t count, std::span<uint32_t> hashes)
+{
+	const size_t end = first + count;
+	for (size_t chunk = first; chunk < end; chunk += kChunkSize)
+	{
+		const size_t numChunkVertices = std::min(kChunkSize, end - chunk);
+
+		uint32_t chunkHashes[kChunkSize] = {};
+		uint32_t keys[kChunkSize * 4];
+		for (const Stream& stream : streams)
+		{
+			const uint32_t numComponents = stream.numComponents;
+			quantize(stream.data + chunk * numComponents, numChunkVertices * numComponents, stream.inverseStep, keys);
+
+			for (size_t i = 0; i < numChunkVertices; ++i)
+			{
+				for (uint32_t k = 0; k < numComponents; ++k)
+				{
+					chunkHashes[i] = mix(chunkHashes[i], keys[i * numComponents + k]);
+				}
+			}
+		}
+
+		for (size_t i = 0; i < numChunkVertices; ++i)
+		{
+			hashes[chunk + i] = finalize(chunkHashes[i]);
+		}
+	}
+}
+
+
+bool equalVertices(std::span<const Stream> streams, uint32_t lhs, uint32_t rhs)
+{
+	for (const Stream& stream : streams)
+	{
+		const uint32_t* a = stream.data + static_cast<size_t>(lhs) * stream.numComponents;
+		const uint32_t* b = stream.data + static_cast<size_t>(rhs) * stream.numComponents;
+		for (uint32_t k = 0; k < stream.numComponents; ++k)
+		{
+			if (quantize(a[k], stream.inverseStep) != quantize(b[k], stream.inverseStep))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+//-- Open addressing with linear probing over vertex ids, the hashes are looked up to skip most of the comparisons.
+//-- Vertices come in the ascending order, so the representative of every vertex is the first equal one.
+void weldShard(std::span<const Stream> streams, std::span<const uint32_t> hashes, std::span<const uint32_t> vertices,
+	std::span<uint32_t> table, std::span<uint32_t> representatives)
+{
+	std::fill(table.begin(), table.end(), kEmptySlot);
+	const uint32_t mask = static_cast<uint32_t>(table.size() - 1);
+
+	for (uint32_t vertex : vertices)
+	{
+		const uint32_t hash = hashes[vertex];
+		for (uint32_t slot = hash & mask;; slot = (slot + 1) & mask)
+		{
+			const uint32_t other = table[slot];
+			if (other == kEmptySlot)
+			{
+				table[slot] = vertex;
+				representatives[vertex] = vertex;
+				break;
+			}
+			if (hashes[other] == hash && equalVertices(streams, other, vertex))
+			{
+				representatives[vertex] = other;
+				break;
+			}
+		}
+	}
+}
+
+
+//-- Power of two with the load factor up to 0.5.
+size_t tableSize(size_t numVertices)
+{
+	return numVertices > 0 ? std::bit_ceil(numVertices * 2) : 0;
+}
+
+} //-- unnamed.
+
+
+size_t weldScratchSize(size_t numVertices)
+{
+	//-- Tables of all shards take up to 4 slots per vertex.
+	return numVertices * 7 * sizeof(uint32_t) + kMaxAllocations * alignof(std::max_align_t);
+}
+
+
+size_t weldVertices(std::span<const WeldStream> weldStreams, std::span<uint32_t> indices, utils::LinearArena& scratch)
+{
+	ENGINE_CPU_ZONE;
+
+	const size_t numVertices = indices.size();
+	ENGINE_ASSERT(numVertices < kEmptySlot, "Too many vertices to weld!");
+	ENGINE_ASSERT(weldStreams.size() <= kMaxStreams, "Too many streams to weld!");
+	if (numVertices == 0)
+	{
+		return 0;
+	}
+
+	std::array<Stream, kMaxStreams> streamStorage;
+	for (size_t i = 0; i < weldStreams.size(); ++i)
+	{
+		const WeldStream& source = weldStreams[i];
+		ENGINE_ASSERT_DEBUG(source.numComponents > 0 && source.numComponents <= 4);
+
+		streamStorage[i] = {
+			.data = static_cast<uint32_t*>(source.data),
+			.numComponents = source.numComponents,
+			.inverseStep = source.floats && source.tolerance > 0.0f ? 1.0f / source.tolerance : 0.0f
+		};
+	}
+	const std::span<const Stream> streams(streamStorage.data(), weldStreams.size());
+
+	const bool parallel = numVertices >= kParallelThreshold;
+	auto& jobs = service<JobService>();
+
+	auto hashes = scratch.allocate<uint32_t>(numVertices);
+	if (parallel)
+	{
+		const size_t numBatches = (numVertices + kHashBatchSize - 1) / kHashBatchSize;
+		jobs.parallelFor(numBatches, [&streams, &hashes, numVertices](size_t batch)
+			{
+				ENGINE_CPU_ZONE_NAMED("mesh::hashVertices");
+
+				const size_t first = batch * kHashBatchSize;
+				hashVertices(streams, first, std::min(kHashBatchSize, numVertices - first), hashes);
+			});
+	}
+	else
+	{
+		hashVertices(streams, 0, numVertices, hashes);
+	}
+
+	//-- Counting sort by shards keeps vertices of every shard in the ascending order.
+	const uint32_t numShards = parallel ? kMaxShards : 1;
+	auto shardOf = [numShards](uint32_t hash) { return numShards > 1 ? hash >> (32 - kShardBits) : 0u; };
+
+	std::array<uint32_t, kMaxShards + 1> shardOffsets = {};
+	for (uint32_t hash : hashes)
+	{
+		++shardOffsets[shardOf(hash) + 1];
+	}
+
+	std::array<size_t, kMaxShards + 1> tableOffsets = {};
+	for (uint32_t shard = 0; shard < numShards; ++shard)
+	{
+		tableOffsets[shard + 1] = tableOffsets[shard] + tableSize(shardOffsets[shard + 1]);
+		shardOffsets[shard + 1] += shardOffsets[shard];
+	}
+
+	auto order = scratch.allocate<uint32_t>(numVertices);
+	{
+		std::array<uint32_t, kMaxShards> cursors;
+		std::copy_n(shardOffsets.begin(), kMaxShards, cursors.begin());
+		for (uint32_t vertex = 0; vertex < numVertices; ++vertex)
+		{
+			order[cursors[shardOf(hashes[vertex])]++] = vertex;
+		}
+	}
+
+	auto tables = scratch.allocate<uint32_t>(tableOffsets[numShards]);
+	auto representatives = scratch.allocate<uint32_t>(numVertices);
+
+	auto weld = [&](size_t shard)
+		{
+			ENGINE_CPU_ZONE_NAMED("mesh::weldShard");
+
+			const auto vertices = std::span<const uint32_t>(order).subspan(shardOffsets[shard], shardOffsets[shard + 1] - shardOffsets[shard]);
+			const auto table = tables.subspan(tableOffsets[shard], tableOffsets[shard + 1] - tableOffsets[shard]);
+			weldShard(streams, hashes, vertices, table, representatives);
+		};
+
+	if (parallel)
+	{
+		jobs.parallelFor(numShards, weld);
+	}
+	else
+	{
+		weld(0);
+	}
+
+	//-- Number unique vertices by their first use and move them to their place.
+	//-- Representatives precede the vertices they represent, so nothing is overwritten before it's read.
+	uint32_t numUnique = 0;
+	for (uint32_t vertex = 0; vertex < numVertices; ++vertex)
+	{
+		const uint32_t representative = representatives[vertex];
+		if (representative != vertex)
+		{
+			indices[vertex] = indices[representative];
+			continue;
+		}
+
+		if (numUnique != vertex)
+		{
+			for (const Stream& stream : streams)
+			{
+				memcpy(stream.data + static_cast<size_t>(numUnique) * stream.numComponents,
+					stream.data + static_cast<size_t>(vertex) * stream.numComponents, stream.numComponents * sizeof(uint32_t));
+			}
+		}
+		indices[vertex] = numUnique++;
+	}
+
+	return numUnique;
+}
+
+} //-- engine::resources::mesh.
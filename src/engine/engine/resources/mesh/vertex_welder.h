@@ -0,0 +1,28 @@
+#pragma once
+
+#include <engine/utils/linear_arena.h>
+
+//-- Turns flat per-corner vertex streams into an indexed vertex buffer.
+namespace engine::resources::mesh
+{
+
+//-- A stream of tightly packed vertices of 32-bit components, compacted in place by the welding.
+struct WeldStream
+{
+	void* data = nullptr;
+	uint32_t numComponents = 0; //-- 1..4.
+	bool floats = true;
+	//-- Float components are snapped to a grid of this step before comparing, which merges the noise of exported
+	//-- attributes unless a grid line happens to lie between the values. Zero compares the exact bits like for integers.
+	float tolerance = 0.0f;
+};
+
+//-- Upper bound of the scratch memory weldVertices needs.
+ENGINE_API size_t weldScratchSize(size_t numVertices);
+
+//-- Merges equal vertices, writes the index of the unique vertex of every input vertex and compacts the streams in place.
+//-- Unique vertices are ordered by their first use and keep the values of their first vertex. Returns the number of unique vertices.
+//-- Large inputs are hashed and welded in parallel, the result doesn't depend on the number of threads.
+ENGINE_API size_t weldVertices(std::span<const WeldStream> streams, std::span<uint32_t> indices, utils::LinearArena& scratch);
+
+} //-- engine::resources::mesh.
@@ -1,15 +1,31 @@
 #include <engine/resources/mesh_resource.h>
 #include <engine/helpers.h>
 #include <engine/math.h>
+#include <engine/resources/mesh/amesh.h>
+#include <engine/resources/mesh/mesh_bounds.h>
+#include <engine/resources/mesh/mesh_data.h>
+#include <engine/resources/mesh/meshlet_builder.h>
+#include <engine/resources/mesh/mesh_optimizer.h>
+#include <engine/resources/mesh/mesh_simplifier.h>
+#include <engine/resources/mesh/obj_parser.h>
+#include <engine/resources/mesh/tangent_generator.h>
+#include <engine/resources/mesh/ufbx_nodes.h>
+#include <engine/resources/mesh/ufbx_vfs.h>
+#include <engine/resources/mesh/vertex_quantization.h>
+#include <engine/resources/mesh/vertex_welder.h>
+#include <engine/services/cache_service.h>
+#include <engine/services/job_service.h>
 #include <engine/services/render_service.h>
 #include <engine/services/vfs_service.h>
 #include <engine/render/d3d12/backend.h>
+#include <engine/utils/content_hash.h>
+#include <engine/utils/linear_arena.h>
+#include <engine/utils/mapped_file.h>
+#include <engine/utils/string.h>
 
+#include <cgltf.h>
 #include <ufbx/ufbx.h>
 
-#define ENABLE_READ_SKINNING 0
-#define ENABLE_READ_ANIMATION 0
-
 namespace engine::resources
 {
 
@@ -17,235 +33,573 @@ namespace engine::resources
 namespace
 {
 
-#if ENABLE_READ_ANIMATION
-struct NodeAnimation
+
+math::vec2 ufbx_to_um_vec2(ufbx_vec2 v) { return math::vec2((float)v.x, (float)v.y); }
+math::vec3 ufbx_to_um_vec3(ufbx_vec3 v) { return math::vec3((float)v.x, (float)v.y, (float)v.z); }
+//math::vec4 ufbx_to_um_vec4(ufbx_vec4 v) { return math::vec4((float)v.x, (float)v.y, (float)v.z, (float)v.w); }
+math::color ufbx_to_um_color(ufbx_vec4 v) { return math::color((float)v.x, (float)v.y, (float)v.z, (float)v.w); }
+
+math::matrix ufbx_to_um_mat(ufbx_matrix m) {
+	return math::matrix(
+		(float)m.m00, (float)m.m01, (float)m.m02, (float)m.m03,
+		(float)m.m10, (float)m.m11, (float)m.m12, (float)m.m13,
+		(float)m.m20, (float)m.m21, (float)m.m22, (float)m.m23,
+		0.0f, 0.0f, 0.0f, 1.0f
+	);
+}
+
+//-- nodeIndices maps ids of ufbx nodes to their indices in the flattened hierarchy.
+void readNode(NodeDesc& node, const ufbx_node* ufbxNode, std::span<const uint32_t> nodeIndices)
+{
+	node.parent = ufbxNode->parent ? static_cast<int32_t>(nodeIndices[ufbxNode->parent->typed_id]) : -1;
+	node.nodeToParent = ufbx_to_um_mat(ufbxNode->node_to_parent);
+	node.geometryToNode = ufbx_to_um_mat(ufbxNode->geometry_to_node);
+}
+
+struct PartStatistics
 {
-	float timeBegin;
-	float framerate;
-	size_t numFrames;
-	math::quat constRot;
-	math::vec3 constPos;
-	math::vec3 constScale;
-	math::quat* rot;
-	math::vec3* pos;
-	math::vec3* scale;
+	mesh::VertexCacheStatistics cacheBefore;
+	mesh::VertexCacheStatistics cacheAfter;
+	size_t numVertices = 0;
+	size_t numTriangles = 0;
 };
 
-struct BlendChannelAnimation
+//-- A welded part before it's placed into the combined buffers.
+struct PartData
 {
-	float constWeight;
-	float* weight;
+	MeshData::Streams streams; //-- Float streams with kStreamSizes strides. Missing streams are empty.
+	std::vector<uint32_t> indices;
+	SubmeshDesc submesh; //-- Offsets in the combined buffers are assigned when the part is placed.
+	std::vector<BoneDesc> bones; //-- Bone palette of the part in the order of the first use.
+	//-- Blend shape targets with offsets relative to the arrays below, vertices are relative to the part.
+	std::vector<BlendShapeDesc> blendShapes;
+	std::vector<uint32_t> blendShapeVertices;
+	std::vector<math::vec3> blendShapePositionDeltas;
+	std::vector<math::vec3> blendShapeNormalDeltas;
+	PartStatistics statistics;
 };
 
-struct Animation
-{
-	const char* name;
-	float timeBegin;
-	float timeEnd;
-	float framerate;
-	size_t numFrames;
+//-- Indices in the bone streams are 8-bit, so skinned parts are split into draws with at most this many bones, see splitByBones.
+inline constexpr size_t kMaxPartBones = 256;
+inline constexpr size_t kMaxInfluences = 4;
 
-	NodeAnimation* nodes;
-	BlendChannelAnimation* blendChannels;
-};
-#endif
+//-- Calls fn(weight) for up to four largest positive weights of the vertex.
+//-- Weights of a vertex are sorted in the descending order, so the first ones are the best approximation.
+template<typename Fn>
+void forEachInfluence(const ufbx_skin_deformer* skin, uint32_t vertex, Fn&& fn)
+{
+	const ufbx_skin_vertex skinVertex = skin->vertices.data[vertex];
+	size_t numInfluences = 0;
+	for (size_t i = 0; i < skinVertex.num_weights && numInfluences < kMaxInfluences; ++i)
+	{
+		const ufbx_skin_weight weight = skin->weights.data[skinVertex.weight_begin + i];
+		if (weight.weight > 0.0)
+		{
+			fn(weight);
+			++numInfluences;
+		}
+	}
+}
 
-struct Node
+//-- Splits the faces of a part into ranges whose vertices use at most kMaxPartBones bones. Faces are taken in order, so a range
+//-- keeps neighbouring faces together. A triangle uses at most 12 bones, so every range gets at least one.
+//-- clusterMarks has a zeroed entry per cluster of the skin. Ranges are (first face, number of faces) in the face list of the part.
+void splitByBones(const ufbx_mesh* ufbxMesh, const ufbx_mesh_part* meshPart, const ufbx_skin_deformer* skin, std::vector<uint32_t>& clusterMarks,
+	std::vector<std::pair<uint32_t, uint32_t>>& ranges)
 {
-	int32_t parent_index;
+	ranges.clear();
+	ranges.emplace_back(0, 0);
+	size_t numBones = 0;
 
-	math::matrix geometry_to_node;
-	math::matrix node_to_parent;
-	math::matrix node_to_world;
-	math::matrix geometry_to_world;
-	math::matrix normal_to_world;
-};
+	//-- A cluster is in the current range if its mark is the number of the range.
+	auto mark = [&ranges](uint32_t value) { return value == static_cast<uint32_t>(ranges.size()); };
 
-struct BlendChannel
-{
-	float weight;
-};
+	for (uint32_t faceId = 0; faceId < meshPart->num_faces; ++faceId)
+	{
+		const ufbx_face face = ufbxMesh->faces.data[meshPart->face_indices.data[faceId]];
 
-struct Scene
+		std::array<uint32_t, 3 * kMaxInfluences> faceClusters = {};
+		size_t numFaceClusters = 0;
+		for (uint32_t corner = face.index_begin; corner < face.index_begin + face.num_indices; ++corner)
+		{
+			forEachInfluence(skin, ufbxMesh->vertex_indices.data[corner], [&](const ufbx_skin_weight& weight)
+				{
+					const auto end = faceClusters.begin() + numFaceClusters;
+					if (std::find(faceClusters.begin(), end, weight.cluster_index) == end)
+					{
+						faceClusters[numFaceClusters++] = weight.cluster_index;
+					}
+				});
+		}
+
+		size_t numNewBones = 0;
+		for (size_t i = 0; i < numFaceClusters; ++i)
+		{
+			numNewBones += mark(clusterMarks[faceClusters[i]]) ? 0 : 1;
+		}
+		if (numBones + numNewBones > kMaxPartBones)
+		{
+			ranges.emplace_back(faceId, 0);
+			numBones = 0;
+			numNewBones = numFaceClusters;
+		}
+
+		for (size_t i = 0; i < numFaceClusters; ++i)
+		{
+			clusterMarks[faceClusters[i]] = static_cast<uint32_t>(ranges.size());
+		}
+		numBones += numNewBones;
+		++ranges.back().second;
+	}
+}
+
+//-- Picks up to four largest weights of the vertex, adds their bones to the palette of the part and quantizes the weights to 8 bits.
+//-- Vertices without weights get zero weights.
+void readSkinVertex(const ufbx_skin_deformer* skin, uint32_t vertex, std::span<uint32_t> clusterToBone, std::vector<BoneDesc>& bones,
+	uint32_t& packedIndices, uint32_t& packedWeights)
 {
-	std::vector<Node> nodes;
-	std::vector<BlendChannel> blendChannels;
-#if ENABLE_READ_ANIMATION
-	std::vector<Animation> animations;
-#endif
+	std::array<uint32_t, kMaxInfluences> boneIds = {};
+	std::array<float, kMaxInfluences> weights = {};
+	size_t numInfluences = 0;
+	float totalWeight = 0.0f;
 
-	math::vec3 aabbMin;
-	math::vec3 aabbMax;
-};
+	forEachInfluence(skin, vertex, [&](const ufbx_skin_weight& weight)
+		{
+			uint32_t& bone = clusterToBone[weight.cluster_index];
+			if (bone == 0)
+			{
+				ENGINE_ASSERT_DEBUG(bones.size() < kMaxPartBones, "The part isn't split by bones!");
+
+				const ufbx_skin_cluster* cluster = skin->clusters.data[weight.cluster_index];
+				bones.push_back({
+					.node = cluster->bone_node ? cluster->bone_node->typed_id : 0,
+					.geometryToBone = ufbx_to_um_mat(cluster->geometry_to_bone)
+				});
+				bone = static_cast<uint32_t>(bones.size());
+			}
 
+			boneIds[numInfluences] = bone - 1;
+			weights[numInfluences] = static_cast<float>(weight.weight);
+			totalWeight += weights[numInfluences];
+			++numInfluences;
+		});
 
-math::vec2 ufbx_to_um_vec2(ufbx_vec2 v) { return math::vec2((float)v.x, (float)v.y); }
-math::vec3 ufbx_to_um_vec3(ufbx_vec3 v) { return math::vec3((float)v.x, (float)v.y, (float)v.z); }
-//math::vec4 ufbx_to_um_vec4(ufbx_vec4 v) { return math::vec4((float)v.x, (float)v.y, (float)v.z, (float)v.w); }
-math::color ufbx_to_um_color(ufbx_vec4 v) { return math::color((float)v.x, (float)v.y, (float)v.z, (float)v.w); }
+	packedIndices = 0;
+	packedWeights = 0;
+	if (totalWeight > 0.0f)
+	{
+		//-- The quantized weights have to sum up to exactly 255, so the rounding error goes to the largest weight.
+		std::array<uint32_t, kMaxInfluences> quantized = {};
+		uint32_t sum = 0;
+		for (size_t i = 0; i < numInfluences; ++i)
+		{
+			quantized[i] = static_cast<uint32_t>(std::lround(weights[i] / totalWeight * 255.0f));
+			sum += quantized[i];
+		}
+		quantized[0] = quantized[0] + 255 - sum;
 
-math::matrix ufbx_to_um_mat(ufbx_matrix m) {
-	return math::matrix(
-		(float)m.m00, (float)m.m01, (float)m.m02, (float)m.m03,
-		(float)m.m10, (float)m.m11, (float)m.m12, (float)m.m13,
-		(float)m.m20, (float)m.m21, (float)m.m22, (float)m.m23,
-		0.0f, 0.0f, 0.0f, 1.0f
-	);
+		for (size_t i = 0; i < numInfluences; ++i)
+		{
+			packedIndices |= boneIds[i] << (i * 8);
+			packedWeights |= quantized[i] << (i * 8);
+		}
+	}
 }
 
-void readNode(Node& node, ufbx_node* ufbxNode)
+//-- Upper bound of the scratch memory readMesh needs for a part: the flat streams, the indices, the triangulation buffer,
+//-- the cluster to palette map of the skin, the tangent generation, the welding tables, the optimization passes
+//-- and the vertex maps and the displacement bounds of blend shapes. The results are copied to the vectors of the part,
+//-- which are the only heap allocations of reading besides the arena, see countPartBuffers.
+size_t readMeshScratchSize(const size_t maxVerticesInStream, const size_t numTrianglesIndices, const size_t maxSkinClusters,
+	const size_t maxBlendMeshVertices)
 {
-	node.parent_index = ufbxNode->parent ? ufbxNode->parent->typed_id : -1;
-	node.node_to_parent = ufbx_to_um_mat(ufbxNode->node_to_parent);
-	node.node_to_world = ufbx_to_um_mat(ufbxNode->node_to_world);
-	node.geometry_to_node = ufbx_to_um_mat(ufbxNode->geometry_to_node);
-	node.geometry_to_world = ufbx_to_um_mat(ufbxNode->geometry_to_world);
-	node.normal_to_world = ufbx_to_um_mat(ufbx_matrix_for_normals(&ufbxNode->geometry_to_world));
+	//-- Every allocation may be padded up to its alignment.
+	static constexpr size_t kMaxAllocations = 24;
+
+	size_t vertexSize = 0;
+	for (UINT streamSize : MeshResource::kStreamSizes)
+	{
+		vertexSize += streamSize;
+	}
+	vertexSize += 4 * sizeof(uint32_t); //-- Indices, cache optimized indices, cache clusters and the vertex remap.
+
+	//-- Source vertex ids of the flat and the welded vertices, the source to welded vertex map and its offsets,
+	//-- the lower and the upper displacements of the welded vertices.
+	const size_t blendShapesSize = maxBlendMeshVertices > 0
+		? (3 * maxVerticesInStream + maxBlendMeshVertices + 1) * sizeof(uint32_t) + 2 * maxVerticesInStream * sizeof(math::vec3) : 0;
+
+	return maxVerticesInStream * vertexSize + (numTrianglesIndices + maxSkinClusters) * sizeof(uint32_t) + blendShapesSize
+		+ mesh::tangentScratchSize(maxVerticesInStream, 0) + mesh::weldScratchSize(maxVerticesInStream)
+		+ 4 * mesh::optimizerScratchSize(maxVerticesInStream, maxVerticesInStream) //-- Two cache analyses, the cache and the overdraw pass.
+		+ kMaxAllocations * alignof(std::max_align_t);
 }
 
-void readMesh(MeshResource& mesh, MeshResource::Submesh& submesh, ufbx_mesh_part* meshPart, ufbx_mesh* ufbxMesh, const size_t maxVerticesInStream, const size_t numTrianglesIndices,
-	const size_t numUVSets, size_t& vertexOffset, size_t& indexOffset)
+
+//-- Number of the heap blocks which the parts own.
+size_t countPartBuffers(std::span<const PartData> parts)
 {
-	ENGINE_ASSERT_DEBUG(ufbxMesh->vertex_position.exists, "FBX mesh doesn't include vertices!");
-	std::vector<uint32_t> trianglesIndices(numTrianglesIndices);
+	size_t numBuffers = 0;
+	for (const PartData& part : parts)
+	{
+		for (const auto& stream : part.streams)
+		{
+			numBuffers += stream.capacity() > 0;
+		}
+		numBuffers += (part.indices.capacity() > 0) + (part.bones.capacity() > 0) + (part.blendShapes.capacity() > 0)
+			+ (part.blendShapeVertices.capacity() > 0) + (part.blendShapePositionDeltas.capacity() > 0) + (part.blendShapeNormalDeltas.capacity() > 0);
+	}
+	return numBuffers;
+}
 
-	std::array<bool, static_cast<size_t>(MeshResource::Stream::Count)> hasStream =
+//-- Converts the blend shapes of the mesh to sparse targets of the welded part. ufbx stores offsets per vertex of the mesh,
+//-- which the welding may split into several vertices or which may belong to other parts, so they are mapped through vertexIds,
+//-- the mesh vertex of every welded vertex. Offsets which move neither the position nor the normal are dropped.
+//-- Only the full weight shape of a channel is used, in-between shapes aren't supported yet.
+void readBlendShapes(PartData& part, utils::LinearArena& arena, const ufbx_mesh* ufbxMesh, std::span<const uint32_t> vertexIds)
+{
+	static constexpr float kMinDelta = 1e-6f;
+
+	//-- Welded vertices of every mesh vertex as a compressed sparse row map.
+	auto firstWelded = arena.allocate<uint32_t>(ufbxMesh->num_vertices + 1);
+	auto welded = arena.allocate<uint32_t>(vertexIds.size());
+	std::fill(firstWelded.begin(), firstWelded.end(), 0);
+	for (uint32_t vertexId : vertexIds)
 	{
-		true,
-		ufbxMesh->vertex_tangent.exists,
-		ufbxMesh->vertex_bitangent.exists,
-		ufbxMesh->vertex_normal.exists,
-		numUVSets >= 1,
-		numUVSets >= 2,
-		ufbxMesh->vertex_color.exists
-	};
+		++firstWelded[vertexId + 1];
+	}
+	for (size_t i = 1; i < firstWelded.size(); ++i)
+	{
+		firstWelded[i] += firstWelded[i - 1];
+	}
+	for (size_t vertex = 0; vertex < vertexIds.size(); ++vertex)
+	{
+		welded[firstWelded[vertexIds[vertex]]++] = static_cast<uint32_t>(vertex);
+	}
+	//-- Filling advanced every offset to the next one, shift them back.
+	for (size_t i = firstWelded.size() - 1; i > 0; --i)
+	{
+		firstWelded[i] = firstWelded[i - 1];
+	}
+	firstWelded[0] = 0;
 
-	//-- ToDo: place in a higher scope to avoid redundant reallocations.
-	std::vector<math::vec3> positions(maxVerticesInStream);
-	//-- ToDo: Pack these values: tangetns, bitangents, normals.
-	std::vector<math::vec3> tangents(hasStream[static_cast<size_t>(MeshResource::Stream::Tangent)] ? maxVerticesInStream : 0);
-	std::vector<math::vec3> bitangents(hasStream[static_cast<size_t>(MeshResource::Stream::Bitangent)] ? maxVerticesInStream : 0);
-	std::vector<math::vec3> normals(hasStream[static_cast<size_t>(MeshResource::Stream::Normal)] ? maxVerticesInStream : 0);
-	std::vector<math::vec2> uvSet0(hasStream[static_cast<size_t>(MeshResource::Stream::UV0)] ? maxVerticesInStream : 0);
-	std::vector<math::vec2> uvSet1(hasStream[static_cast<size_t>(MeshResource::Stream::UV1)] ? maxVerticesInStream : 0);
-	std::vector<uint32_t> colors(hasStream[static_cast<size_t>(MeshResource::Stream::VertexColor)] ? maxVerticesInStream : 0);
-
-	std::vector<uint32_t> indices(maxVerticesInStream);
-
-#if ENABLE_READ_SKINNING
-	skin_vertex* skin_vertices = alloc(skin_vertex, max_triangles * 3);
-	skin_vertex* mesh_skin_vertices = alloc(skin_vertex, ufbxMesh->num_vertices);
-#endif
-
-	// In FBX files a single mesh can be instanced by multiple nodes. ufbx handles the connection
-	// in two ways: (1) `ufbx_node.mesh/light/camera/etc` contains pointer to the data "attribute"
-	// that node uses and (2) each element that can be connected to a node contains a list of
-	// `ufbx_node*` instances eg. `ufbx_mesh.instances`.
-	/*mesh.instanceNodeIndices.resize(ufbxMesh->instances.count);
-	for (size_t i = 0; i < ufbxMesh->instances.count; i++)
-	{
-		mesh.instanceNodeIndices[i] = (int32_t)ufbxMesh->instances.data[i]->typed_id;
-	}*/
-
-#if ENABLE_READ_SKINNING
-	// Create the vertex buffers
-	size_t num_blend_shapes = 0;
-	ufbx_blend_channel* blend_channels[MAX_BLEND_SHAPES];
-	size_t num_bones = 0;
-	ufbx_skin_deformer* skin = NULL;*/
-
-	if (ufbxMesh->skin_deformers.count > 0)
-	{
-		ENGINE_FAIL("Implement skinning!");
-		mesh.skinned = true;
-
-		// Having multiple skin deformers attached at once is exceedingly rare so we can just
-		// pick the first one without having to worry too much about it.
-		skin = ufbxMesh->skin_deformers.data[0];
-
-		// NOTE: A proper implementation would split meshes with too many bones to chunks but
-		// for simplicity we're going to just pick the first `MAX_BONES` ones.
-		for (size_t ci = 0; ci < skin->clusters.count; ci++) {
-			ufbx_skin_cluster* cluster = skin->clusters.data[ci];
-			if (num_bones < MAX_BONES) {
-				vmesh->bone_indices[num_bones] = (int32_t)cluster->bone_node->typed_id;
-				vmesh->bone_matrices[num_bones] = ufbx_to_um_mat(cluster->geometry_to_bone);
-				num_bones++;
-			}
-		}
-		vmesh->num_bones = num_bones;
-
-		// Pre-calculate the skinned vertex bones/weights for each vertex as they will probably
-		// be shared by multiple indices.
-		for (size_t vertexId = 0; vertexId < ufbxMesh->num_vertices; vertexId++) {
-			size_t num_weights = 0;
-			float total_weight = 0.0f;
-			float weights[4] = { 0.0f };
-			uint8_t clusters[4] = { 0 };
-
-			// `ufbx_skin_vertex` contains the offset and number of weights that deform the vertex
-			// in a descending weight order so we can pick the first N weights to use and get a
-			// reasonable approximation of the skinning.
-			ufbx_skin_vertex vertex_weights = skin->vertices.data[vertexId];
-			for (size_t wi = 0; wi < vertex_weights.num_weights; wi++) {
-				if (num_weights >= 4) break;
-				ufbx_skin_weight weight = skin->weights.data[vertex_weights.weight_begin + wi];
-
-				// Since we only support a fixed amount of bones up to `MAX_BONES` and we take the
-				// first N ones we need to ignore weights with too high `cluster_index`.
-				if (weight.cluster_index < MAX_BONES) {
-					total_weight += (float)weight.weight;
-					clusters[num_weights] = (uint8_t)weight.cluster_index;
-					weights[num_weights] = (float)weight.weight;
-					num_weights++;
-				}
+	//-- (welded vertex, offset) pairs of a shape, sorted to store deltas in the vertex order.
+	std::vector<std::pair<uint32_t, uint32_t>> entries;
+	for (size_t deformerId = 0; deformerId < ufbxMesh->blend_deformers.count; ++deformerId)
+	{
+		const ufbx_blend_deformer* deformer = ufbxMesh->blend_deformers.data[deformerId];
+		for (size_t channelId = 0; channelId < deformer->channels.count; ++channelId)
+		{
+			const ufbx_blend_channel* channel = deformer->channels.data[channelId];
+			const ufbx_blend_shape* shape = channel->target_shape;
+			if (!shape)
+			{
+				continue;
 			}
 
-			// Normalize and quantize the weights to 8 bits. We need to be a bit careful to make
-			// sure the _quantized_ sum is normalized ie. all 8-bit values sum to 255.
-			if (total_weight > 0.0f) {
-				skin_vertex* skin_vert = &mesh_skin_vertices[vertexId];
-				uint32_t quantized_sum = 0;
-				for (size_t i = 0; i < 4; i++) {
-					uint8_t quantized_weight = (uint8_t)((float)weights[i] / total_weight * 255.0f);
-					quantized_sum += quantized_weight;
-					skin_vert->bone_index[i] = clusters[i];
-					skin_vert->bone_weight[i] = quantized_weight;
+			const bool hasNormals = shape->normal_offsets.count == shape->num_offsets;
+			entries.clear();
+			for (size_t offset = 0; offset < shape->num_offsets; ++offset)
+			{
+				const math::vec3 position = ufbx_to_um_vec3(shape->position_offsets.data[offset]);
+				const math::vec3 normal = hasNormals ? ufbx_to_um_vec3(shape->normal_offsets.data[offset]) : math::vec3(0.0f, 0.0f, 0.0f);
+				if (position.LengthSquared() < kMinDelta * kMinDelta && normal.LengthSquared() < kMinDelta * kMinDelta)
+				{
+					continue;
+				}
+
+				const uint32_t vertexId = shape->offset_vertices.data[offset];
+				for (uint32_t i = firstWelded[vertexId]; i < firstWelded[vertexId + 1]; ++i)
+				{
+					entries.emplace_back(welded[i], static_cast<uint32_t>(offset));
 				}
-				skin_vert->bone_weight[0] += 255 - quantized_sum;
 			}
-		}*/
-	}
 
-	// Fetch blend channels from all attached blend deformers.
-	for (size_t di = 0; di < ufbxMesh->blend_deformers.count; di++)
-	{
-		ufbx_blend_deformer* deformer = ufbxMesh->blend_deformers.data[di];
-		for (size_t ci = 0; ci < deformer->channels.count; ci++)
-		{
-			ufbx_blend_channel* chan = deformer->channels.data[ci];
-			if (chan->keyframes.count == 0)
+			if (entries.empty())
 			{
 				continue;
 			}
 
-			if (num_blend_shapes < MAX_BLEND_SHAPES)
+			std::sort(entries.begin(), entries.end());
+			part.blendShapes.push_back({
+				.channel = channel->typed_id,
+				.deltaOffset = static_cast<uint32_t>(part.blendShapeVertices.size()),
+				.numDeltas = static_cast<uint32_t>(entries.size()),
+				.hasNormals = hasNormals ? 1u : 0u
+			});
+			for (const auto [vertex, offset] : entries)
 			{
-				blend_channels[num_blend_shapes] = chan;
-				vmesh->blend_channel_indices[num_blend_shapes] = (int32_t)chan->typed_id;
-				num_blend_shapes++;
+				part.blendShapeVertices.push_back(vertex);
+				part.blendShapePositionDeltas.push_back(ufbx_to_um_vec3(shape->position_offsets.data[offset]));
+				part.blendShapeNormalDeltas.push_back(hasNormals ? ufbx_to_um_vec3(shape->normal_offsets.data[offset]) : math::vec3(0.0f, 0.0f, 0.0f));
 			}
 		}
 	}
-	if (num_blend_shapes > 0) {
-		vmesh->blend_shape_image = pack_blend_channels_to_image(ufbxMesh, blend_channels, num_blend_shapes);
-		vmesh->num_blend_shapes = num_blend_shapes;
+}
+
+
+//-- A blend of the targets with weights in [0, 1] moves every vertex within the box of the sums of its negative and positive deltas.
+//-- The bounds are widened to cover these boxes, so positions quantized relative to the AABB stay in range when they are blended.
+//-- The OBB keeps its axes and the sphere its center.
+void widenBlendShapeBounds(PartData& part, utils::LinearArena& arena)
+{
+	const size_t numVertices = part.submesh.numVertices;
+	const math::vec3 zero(0.0f, 0.0f, 0.0f);
+	auto lower = arena.allocate<math::vec3>(numVertices);
+	auto upper = arena.allocate<math::vec3>(numVertices);
+	std::fill(lower.begin(), lower.end(), zero);
+	std::fill(upper.begin(), upper.end(), zero);
+	for (size_t i = 0; i < part.blendShapeVertices.size(); ++i)
+	{
+		const uint32_t vertex = part.blendShapeVertices[i];
+		lower[vertex] += math::min(part.blendShapePositionDeltas[i], zero);
+		upper[vertex] += math::max(part.blendShapePositionDeltas[i], zero);
+	}
+
+	auto& submesh = part.submesh;
+	auto& obb = submesh.obb;
+	std::array<float, 3> obbMin = {};
+	std::array<float, 3> obbMax = {};
+	const std::array<float, 3> obbExtents = { obb.m_extents.x, obb.m_extents.y, obb.m_extents.z };
+	for (size_t axis = 0; axis < 3; ++axis)
+	{
+		obbMin[axis] = obb.m_center.Dot(obb.m_axes[axis]) - obbExtents[axis];
+		obbMax[axis] = obb.m_center.Dot(obb.m_axes[axis]) + obbExtents[axis];
+	}
+
+	const auto* positions = reinterpret_cast<const math::vec3*>(part.streams[static_cast<size_t>(MeshResource::Stream::Position)].data());
+	for (size_t vertex = 0; vertex < numVertices; ++vertex)
+	{
+		const math::vec3& position = positions[vertex];
+		submesh.aabb.extend(position + lower[vertex]);
+		submesh.aabb.extend(position + upper[vertex]);
+
+		const float displacement = math::max(-lower[vertex], upper[vertex]).Length();
+		submesh.sphere.m_radius = std::max(submesh.sphere.m_radius, (position - submesh.sphere.m_center).Length() + displacement);
+
+		//-- The projection of the box on an axis spans the smaller and the larger products of every component.
+		for (size_t axis = 0; axis < 3; ++axis)
+		{
+			const math::vec3& direction = obb.m_axes[axis];
+			const math::vec3 fromLower = direction * lower[vertex];
+			const math::vec3 fromUpper = direction * upper[vertex];
+			const math::vec3 low = math::min(fromLower, fromUpper);
+			const math::vec3 high = math::max(fromLower, fromUpper);
+			const float center = position.Dot(direction);
+			obbMin[axis] = std::min(obbMin[axis], center + low.x + low.y + low.z);
+			obbMax[axis] = std::max(obbMax[axis], center + high.x + high.y + high.z);
+		}
+	}
+
+	obb.m_center = zero;
+	for (size_t axis = 0; axis < 3; ++axis)
+	{
+		obb.m_center += obb.m_axes[axis] * ((obbMin[axis] + obbMax[axis]) * 0.5f);
+	}
+	obb.m_extents = math::vec3(obbMax[0] - obbMin[0], obbMax[1] - obbMin[1], obbMax[2] - obbMin[2]) * 0.5f;
+}
+
+
+//-- Vertex streams of a part with kStreamSizes strides. Missing streams are null.
+struct PartStreams
+{
+	std::array<void*, static_cast<size_t>(MeshResource::Stream::Count)> streams = {};
+	size_t numVertices = 0;
+	//-- Optional ids welded exactly along with the streams, so every vertex maps to a single id. They are compacted, but not reordered.
+	uint32_t* ids = nullptr;
+	//-- Triangle list over the vertices. Empty for flat streams, where every three vertices are a triangle.
+	std::span<const uint32_t> indices;
+};
+
+//-- Float streams are snapped to the grids of their kinds, the packed ones are welded exactly.
+float weldTolerance(const MeshResource::ImportSettings& settings, MeshResource::Stream stream)
+{
+	switch (stream)
+	{
+	case MeshResource::Stream::Position: return settings.weldPositionTolerance;
+	case MeshResource::Stream::Tangent:
+	case MeshResource::Stream::Bitangent:
+	case MeshResource::Stream::Normal: return settings.weldNormalTolerance;
+	case MeshResource::Stream::UV0:
+	case MeshResource::Stream::UV1: return settings.weldUVTolerance;
+	default: return 0.0f;
+	}
+}
+
+//-- Fills the tangent frame streams from the normals and the first UV set for sources which come without tangents.
+//-- It runs before the welding, so corners which get equal frames are still merged.
+void generatePartTangents(PartStreams& streams, utils::LinearArena& arena, const MeshResource::ImportSettings& settings)
+{
+	auto& tangentStream = streams.streams[static_cast<size_t>(MeshResource::Stream::Tangent)];
+	auto& bitangentStream = streams.streams[static_cast<size_t>(MeshResource::Stream::Bitangent)];
+	const auto* normals = static_cast<const math::vec3*>(streams.streams[static_cast<size_t>(MeshResource::Stream::Normal)]);
+	const auto* uvs = static_cast<const math::vec2*>(streams.streams[static_cast<size_t>(MeshResource::Stream::UV0)]);
+	if (!settings.generateTangents || tangentStream || !normals || !uvs)
+	{
+		return;
+	}
+
+	const auto* positions = static_cast<const math::vec3*>(streams.streams[static_cast<size_t>(MeshResource::Stream::Position)]);
+	const size_t numVertices = streams.numVertices;
+	auto tangents = arena.allocate<math::vec3>(numVertices);
+	auto bitangents = arena.allocate<math::vec3>(numVertices);
+	mesh::generateTangents({ positions, numVertices }, { normals, numVertices }, { uvs, numVertices }, streams.indices, tangents, bitangents,
+		arena);
+
+	tangentStream = tangents.data();
+	bitangentStream = bitangents.data();
+}
+
+//-- Welds the vertices, optimizes them and copies the result to the part storage along with the bounds.
+//-- The streams are compacted in place. Returns the remap table of the stored vertices, empty if the welded order is kept,
+//-- so the caller can apply it to the ids. Temporaries come from the arena.
+std::span<const uint32_t> buildPart(PartData& part, utils::LinearArena& arena, const MeshResource::ImportSettings& settings,
+	const PartStreams& source)
+{
+	std::array<mesh::WeldStream, static_cast<size_t>(MeshResource::Stream::Count) + 1> streams = {};
+	size_t numStreams = 0;
+	for (size_t i = 0; i < static_cast<size_t>(MeshResource::Stream::Count); ++i)
+	{
+		if (source.streams[i])
+		{
+			const auto stream = static_cast<MeshResource::Stream>(i);
+			const bool packed = stream == MeshResource::Stream::VertexColor || stream == MeshResource::Stream::BoneIndices
+				|| stream == MeshResource::Stream::BoneWeights;
+			streams[numStreams++] = {
+				.data = source.streams[i],
+				.numComponents = MeshResource::kStreamSizes[i] / static_cast<UINT>(sizeof(uint32_t)),
+				.floats = !packed,
+				.tolerance = weldTolerance(settings, stream)
+			};
+		}
+	}
+	if (source.ids)
+	{
+		streams[numStreams++] = { .data = source.ids, .numComponents = 1, .floats = false };
+	}
+
+	//-- Weld the vertex buffer. The welder compacts the streams and returns the number of used vertices.
+	//-- The weld map of flat streams is the index buffer, indexed parts are mapped through it.
+	auto indices = arena.allocate<uint32_t>(source.numVertices);
+	const size_t numOptimizedVertices = mesh::weldVertices({ streams.data(), numStreams }, indices, arena);
+	if (!source.indices.empty())
+	{
+		const auto weldMap = indices;
+		indices = arena.allocate<uint32_t>(source.indices.size());
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			indices[i] = weldMap[source.indices[i]];
+		}
+	}
+	const size_t numIndices = indices.size();
+
+	//-- Optimize for the post-transform cache and overdraw, then order vertices by their first use.
+	//-- The order drops vertices which indexed parts don't use.
+	std::span<uint32_t> remap;
+	size_t numStoredVertices = numOptimizedVertices;
+	auto& statistics = part.statistics;
+	if (settings.optimizeGeometry)
+	{
+		statistics.cacheBefore = mesh::analyzeVertexCache(indices, numOptimizedVertices, arena);
+
+		auto cacheOptimized = arena.allocate<uint32_t>(numIndices);
+		auto clusters = arena.allocate<uint32_t>(numIndices / 3);
+		clusters = clusters.first(mesh::optimizeVertexCache(cacheOptimized, indices, numOptimizedVertices, arena, clusters));
+
+		const auto* positions = static_cast<const float*>(source.streams[static_cast<size_t>(MeshResource::Stream::Position)]);
+		mesh::optimizeOverdraw(indices, cacheOptimized, { positions, numOptimizedVertices * 3 }, clusters, settings.overdrawThreshold, arena);
+
+		statistics.cacheAfter = mesh::analyzeVertexCache(indices, numOptimizedVertices, arena);
+
+		remap = arena.allocate<uint32_t>(numOptimizedVertices);
+		numStoredVertices = mesh::optimizeVertexFetchRemap(remap, indices, numOptimizedVertices);
+		mesh::remapIndexBuffer(indices, remap);
+	}
+	statistics.numVertices = numStoredVertices;
+	statistics.numTriangles = numIndices / 3;
+
+	//-- Copy the compacted streams to the part storage.
+	for (size_t i = 0; i < static_cast<size_t>(MeshResource::Stream::Count); ++i)
+	{
+		if (source.streams[i])
+		{
+			const size_t stride = MeshResource::kStreamSizes[i];
+			part.streams[i].resize(numStoredVertices * stride);
+			uint8_t* destination = part.streams[i].data();
+			if (remap.empty())
+			{
+				memcpy(destination, source.streams[i], numOptimizedVertices * stride);
+			}
+			else
+			{
+				mesh::remapVertexBuffer(destination, source.streams[i], numOptimizedVertices, stride, remap);
+			}
+		}
 	}
-#endif
+
+	part.indices.assign(indices.begin(), indices.end());
+
+	//-- Bounds of the welded vertices, so only the vertices which the part uses count.
+	auto& submesh = part.submesh;
+	const auto& positionStream = part.streams[static_cast<size_t>(MeshResource::Stream::Position)];
+	const std::span<const math::vec3> partPositions(reinterpret_cast<const math::vec3*>(positionStream.data()), numStoredVertices);
+	submesh.aabb = mesh::computeAABB(partPositions);
+	submesh.sphere = mesh::computeBoundingSphere(partPositions);
+	submesh.obb = settings.orientedBounds ? mesh::computeOBB(partPositions, submesh.aabb) : math::OBB(submesh.aabb.m_min, submesh.aabb.m_max);
+
+	submesh.numVertices = static_cast<uint32_t>(numStoredVertices);
+	submesh.numIndices = static_cast<uint32_t>(numIndices);
+	submesh.numBones = static_cast<uint32_t>(part.bones.size());
+
+	return remap;
+}
+
+//-- Reads and welds a single part into its own storage, so the combined buffers can be allocated at the exact size.
+//-- Temporaries come from the arena, which is reset by the caller after the part is read.
+//-- Parts don't share anything, so it's safe to call it for different parts in parallel.
+//-- Reads the faces [firstFace, firstFace + numFaces) of the part, which are all triangles.
+void readMesh(PartData& part, utils::LinearArena& arena, const MeshResource::ImportSettings& settings, ufbx_mesh_part* meshPart,
+	ufbx_mesh* ufbxMesh, const uint32_t firstFace, const uint32_t numFaces, const size_t numTrianglesIndices, const size_t numUVSets)
+{
+	const size_t maxVerticesInStream = numFaces * 3;
+	ENGINE_ASSERT_DEBUG(ufbxMesh->vertex_position.exists, "FBX mesh doesn't include vertices!");
+	//-- Having multiple skin deformers attached at once is exceedingly rare, so only the first one is used.
+	const ufbx_skin_deformer* skin = ufbxMesh->skin_deformers.count > 0 ? ufbxMesh->skin_deformers.data[0] : nullptr;
+	auto trianglesIndices = arena.allocate<uint32_t>(numTrianglesIndices);
+
+	std::array<bool, static_cast<size_t>(MeshResource::Stream::Count)> hasStream =
+	{
+		true,
+		ufbxMesh->vertex_tangent.exists,
+		ufbxMesh->vertex_bitangent.exists,
+		ufbxMesh->vertex_normal.exists,
+		numUVSets >= 1,
+		numUVSets >= 2,
+		ufbxMesh->vertex_color.exists,
+		skin != nullptr,
+		skin != nullptr
+	};
+
+	auto positions = arena.allocate<math::vec3>(maxVerticesInStream);
+	//-- ToDo: Pack these values: tangetns, bitangents, normals.
+	auto tangents = arena.allocate<math::vec3>(hasStream[static_cast<size_t>(MeshResource::Stream::Tangent)] ? maxVerticesInStream : 0);
+	auto bitangents = arena.allocate<math::vec3>(hasStream[static_cast<size_t>(MeshResource::Stream::Bitangent)] ? maxVerticesInStream : 0);
+	auto normals = arena.allocate<math::vec3>(hasStream[static_cast<size_t>(MeshResource::Stream::Normal)] ? maxVerticesInStream : 0);
+	auto uvSet0 = arena.allocate<math::vec2>(hasStream[static_cast<size_t>(MeshResource::Stream::UV0)] ? maxVerticesInStream : 0);
+	auto uvSet1 = arena.allocate<math::vec2>(hasStream[static_cast<size_t>(MeshResource::Stream::UV1)] ? maxVerticesInStream : 0);
+	auto colors = arena.allocate<uint32_t>(hasStream[static_cast<size_t>(MeshResource::Stream::VertexColor)] ? maxVerticesInStream : 0);
+
+	//-- Palette entry + 1 of every cluster of the skin, zero for clusters which the part doesn't use yet.
+	auto clusterToBone = arena.allocate<uint32_t>(skin ? skin->clusters.count : 0);
+	auto boneIndices = arena.allocate<uint32_t>(skin ? maxVerticesInStream : 0);
+	auto boneWeights = arena.allocate<uint32_t>(skin ? maxVerticesInStream : 0);
+
+	//-- Blend shapes address the vertices of the mesh, so their ids are welded as an extra stream to map the shapes afterwards.
+	const bool hasBlendShapes = ufbxMesh->blend_deformers.count > 0;
+	auto vertexIds = arena.allocate<uint32_t>(hasBlendShapes ? maxVerticesInStream : 0);
 
 	size_t numVertices = 0;
 	//-- First fetch all vertices into a flat non-indexed buffer, we also need to triangulate the faces.
-	for (size_t faceId = 0; faceId < meshPart->num_faces; faceId++)
+	for (size_t faceId = firstFace; faceId < firstFace + numFaces; faceId++)
 	{
 		ufbx_face face = ufbxMesh->faces.data[meshPart->face_indices.data[faceId]];
 		//-- Right now we assume that all faces are triangulated.
@@ -282,7 +636,7 @@ void readMesh(MeshResource& mesh, MeshResource::Submesh& submesh, ufbx_mesh_part
 			}
 			if (hasStream[static_cast<size_t>(MeshResource::Stream::UV1)])
 			{
-				ufbx_vec2 uv1 = ufbx_get_vertex_vec2(&ufbxMesh->uv_sets.data[0].vertex_uv, idx);
+				ufbx_vec2 uv1 = ufbx_get_vertex_vec2(&ufbxMesh->uv_sets.data[1].vertex_uv, idx);
 				uvSet1[numVertices] = ufbx_to_um_vec2(uv1);
 			}
 			if (hasStream[static_cast<size_t>(MeshResource::Stream::VertexColor)])
@@ -290,250 +644,456 @@ void readMesh(MeshResource& mesh, MeshResource::Submesh& submesh, ufbx_mesh_part
 				ufbx_vec4 color = ufbx_get_vertex_vec4(&ufbxMesh->vertex_color, idx);
 				colors[numVertices] = ufbx_to_um_color(color).BGRA();
 			}
-			//vert->f_vertex_index = (float)ufbxMesh->vertex_indices.data[idx];
-
-			// The skinning vertex stream is pre-calculated above so we just need to
-			// copy the right one by the vertex index.
-#if ENABLE_READ_SKINNING
-			if (skin) {
-				skin_vertices[numVertices] = mesh_skin_vertices[ufbxMesh->vertex_indices.data[idx]];
+			if (skin)
+			{
+				readSkinVertex(skin, ufbxMesh->vertex_indices.data[idx], clusterToBone, part.bones, boneIndices[numVertices], boneWeights[numVertices]);
+			}
+			if (hasBlendShapes)
+			{
+				vertexIds[numVertices] = ufbxMesh->vertex_indices.data[idx];
 			}
-#endif
+
 			numVertices++;
 		}
 	}
 
-	std::vector<ufbx_vertex_stream> streams;
-	streams.reserve(static_cast<size_t>(MeshResource::Stream::Count));
-
-	auto fillStream = [&streams, numVertices](auto& container)
+	PartStreams streams = { .numVertices = numVertices, .ids = hasBlendShapes ? vertexIds.data() : nullptr };
+	auto setStream = [&streams, &hasStream](MeshResource::Stream stream, auto& container)
 		{
-			auto& stream = streams.emplace_back();
-
-			stream.data = container.data();
-			stream.vertex_count = numVertices;
-			stream.vertex_size = sizeof(container[0]);
+			const auto id = static_cast<size_t>(stream);
+			streams.streams[id] = hasStream[id] ? container.data() : nullptr;
 		};
 
-	fillStream(positions);
-
-	if (hasStream[static_cast<size_t>(MeshResource::Stream::Tangent)])
-	{
-		fillStream(tangents);
-	}
-	if (hasStream[static_cast<size_t>(MeshResource::Stream::Bitangent)])
-	{
-		fillStream(bitangents);
-	}
-	if (hasStream[static_cast<size_t>(MeshResource::Stream::Normal)])
-	{
-		fillStream(normals);
-	}
-	if (hasStream[static_cast<size_t>(MeshResource::Stream::UV0)])
-	{
-		fillStream(uvSet0);
-	}
-	if (hasStream[static_cast<size_t>(MeshResource::Stream::UV1)])
-	{
-		fillStream(uvSet1);
-	}
-	if (hasStream[static_cast<size_t>(MeshResource::Stream::VertexColor)])
-	{
-		fillStream(colors);
-	}
-
-#if ENABLE_READ_SKINNING
-	if (skin) {
-		streams[1].data = skin_vertices;
-		streams[1].vertex_count = numVertices;
-		streams[1].vertex_size = sizeof(skin_vertex);
-		num_streams = 2;
-	}
-#endif
+	setStream(MeshResource::Stream::Position, positions);
+	setStream(MeshResource::Stream::Tangent, tangents);
+	setStream(MeshResource::Stream::Bitangent, bitangents);
+	setStream(MeshResource::Stream::Normal, normals);
+	setStream(MeshResource::Stream::UV0, uvSet0);
+	setStream(MeshResource::Stream::UV1, uvSet1);
+	setStream(MeshResource::Stream::VertexColor, colors);
+	setStream(MeshResource::Stream::BoneIndices, boneIndices);
+	setStream(MeshResource::Stream::BoneWeights, boneWeights);
+	generatePartTangents(streams, arena, settings);
 
-	//-- Optimize the flat vertex buffer into an indexed one.
-	//-- `ufbx_generate_indices()` compacts the vertex buffer and returns the number of used vertices.
-	ufbx_error error;
-	size_t numOptimizedVertices = ufbx_generate_indices(streams.data(), streams.size(), indices.data(), numVertices, NULL, &error);
-	if (error.type != UFBX_ERROR_NONE)
-	{
-		logger().error(fmt::format("[MeshResource]: Failed to generate index buffer ({}): {}", static_cast<int32_t>(error.type), error.description.data));
-	}
+	const std::span<const uint32_t> remap = buildPart(part, arena, settings, streams);
 
-	auto emptyRange = CD3DX12_RANGE(0, 0);
-	void* memoryBegin = nullptr;
-	size_t streamId = 0;
-	for (size_t i = 0; i < static_cast<size_t>(MeshResource::Stream::Count); ++i)
+	if (hasBlendShapes)
 	{
-		if (hasStream[i])
+		const size_t numWeldedVertices = part.submesh.numVertices;
+		std::span<uint32_t> weldedVertexIds(vertexIds.data(), numWeldedVertices);
+		if (!remap.empty())
 		{
-			D3D12_VERTEX_BUFFER_VIEW streamView =
-			{
-				.BufferLocation = mesh.m_streams[i]->GetGPUVirtualAddress(),
-				//-- ToDo: looks like we may allocate much more memory than use here.
-				//-- See how we calculate totalVertices in the load method.
-				.SizeInBytes = static_cast<UINT>(numOptimizedVertices * streams[streamId].vertex_size),
-				.StrideInBytes = MeshResource::kStreamSizes[i]
-			};
-			submesh.renderPart.streamViews[i] = streamView;
-
-			mesh.m_uploadBuffers[i]->Map(0, &emptyRange, &memoryBegin);
-
-			auto* memorySubmesh = static_cast<uint8_t*>(memoryBegin) + vertexOffset * streamView.StrideInBytes;
-			memcpy(memorySubmesh, positions.data(), streamView.SizeInBytes);
-
-			mesh.m_uploadBuffers[i]->Unmap(0, nullptr);
-
-			++streamId;
+			weldedVertexIds = arena.allocate<uint32_t>(numWeldedVertices);
+			mesh::remapVertexBuffer(weldedVertexIds.data(), vertexIds.data(), numWeldedVertices, sizeof(uint32_t), remap);
+		}
+		readBlendShapes(part, arena, ufbxMesh, weldedVertexIds);
+		if (!part.blendShapes.empty())
+		{
+			widenBlendShapeBounds(part, arena);
 		}
 	}
+	part.submesh.numBlendShapes = static_cast<uint32_t>(part.blendShapes.size());
+}
 
-	//-- Initialize the vertex buffer view.
-	{
-		submesh.renderPart.indexBufferView = {
-			.BufferLocation = mesh.m_indexBuffer->GetGPUVirtualAddress(),
-			.SizeInBytes = static_cast<UINT>(numVertices * sizeof(uint32_t)),
-			//-- TODO: Check the size and put small index buffers to R16 buffer.
-			.Format = DXGI_FORMAT_R32_UINT
-		};
-
-		mesh.m_uploadIndexBuffer->Map(0, &emptyRange, &memoryBegin);
+//-- Submeshes are independent, so their meshlets are built in parallel and concatenated in order afterwards.
+void buildMeshlets(MeshData& data)
+{
+	ENGINE_CPU_ZONE;
 
-		auto* memoryIndices = static_cast<uint8_t*>(memoryBegin) + indexOffset * sizeof(uint32_t);
-		memcpy(memoryIndices, indices.data(), submesh.renderPart.indexBufferView.SizeInBytes);
+	std::vector<mesh::MeshletData> meshlets(data.submeshes.size());
+	service<JobService>().parallelFor(data.submeshes.size(), [&data, &meshlets](size_t submeshId)
+		{
+			ENGINE_CPU_ZONE_NAMED("MeshResource::buildMeshlets");
 
-		mesh.m_uploadIndexBuffer->Unmap(0, nullptr);
-	}
+			const auto& submesh = data.submeshes[submeshId];
+			const auto* positions = reinterpret_cast<const float*>(data.streams[static_cast<size_t>(MeshResource::Stream::Position)].data());
 
-#if ENABLE_READ_SKINNING
-	if (vmesh->skinned) {
-		part->skin_buffer = sg_make_buffer(&(sg_buffer_desc) {
-			.size = num_vertices * sizeof(skin_vertex),
-				.type = SG_BUFFERTYPE_VERTEXBUFFER,
-				.data = { skin_vertices, num_vertices * sizeof(skin_vertex) },
+			mesh::buildMeshlets(meshlets[submeshId], { data.indices.data() + submesh.startIndex, submesh.numIndices },
+				{ positions + submesh.baseVertex * 3, submesh.numVertices * 3 });
 		});
-	}
-#endif
 
-	//-- Compute bounds from the vertices.
-	//mesh.aabb_is_local = ufbxMesh->skinned_is_local; //-- ToDo: Reconsider later.
-	submesh.aabb = math::AABB();
-	for (size_t i = 0; i < ufbxMesh->num_vertices; i++)
+	for (size_t submeshId = 0; submeshId < data.submeshes.size(); ++submeshId)
 	{
-		math::vec3 pos = ufbx_to_um_vec3(ufbxMesh->skinned_position.values.data[i]);
-		submesh.aabb.extend(pos);
-	}
+		auto& submesh = data.submeshes[submeshId];
+		const auto& result = meshlets[submeshId];
 
-	submesh.renderPart.numVertices = static_cast<UINT>(numOptimizedVertices);
-	submesh.renderPart.numIndices = static_cast<UINT>(numVertices);
-	submesh.renderPart.startIndex = static_cast<UINT>(indexOffset);
-	submesh.renderPart.baseVertex = static_cast<UINT>(vertexOffset);
+		submesh.meshletOffset = static_cast<uint32_t>(data.meshlets.size());
+		submesh.numMeshlets = static_cast<uint32_t>(result.meshlets.size());
 
-	vertexOffset += numOptimizedVertices;
-	indexOffset += numVertices;
-}
+		const auto vertexOffset = static_cast<uint32_t>(data.meshletVertices.size());
+		const auto triangleOffset = static_cast<uint32_t>(data.meshletTriangles.size());
+		for (mesh::Meshlet meshlet : result.meshlets)
+		{
+			meshlet.vertexOffset += vertexOffset;
+			meshlet.triangleOffset += triangleOffset;
+			data.meshlets.push_back(meshlet);
+		}
 
-void readBlendChannel(BlendChannel& blendChannel, ufbx_blend_channel* chan)
-{
-	blendChannel.weight = (float)chan->weight;
+		data.meshletBounds.insert(data.meshletBounds.end(), result.bounds.begin(), result.bounds.end());
+		data.meshletVertices.insert(data.meshletVertices.end(), result.vertices.begin(), result.vertices.end());
+		data.meshletTriangles.insert(data.meshletTriangles.end(), result.triangles.begin(), result.triangles.end());
+	}
 }
 
-#if ENABLE_READ_ANIMATION
-void readNodeAnim(Animation& va, NodeAnimation& vna, ufbx_anim_stack* stack, ufbx_node* node)
+
+//-- Every submesh is simplified into a chain where each level is produced from the previous one, so errors accumulate.
+//-- Indices of the levels are appended after the full detail indices of all submeshes and address the same vertices.
+void generateLods(MeshData& data, const MeshResource::ImportSettings& settings, std::string_view path)
 {
-	vna->rot = alloc(um_quat, va->num_frames);
-	vna->pos = alloc(um_vec3, va->num_frames);
-	vna->scale = alloc(um_vec3, va->num_frames);
+	ENGINE_CPU_ZONE;
 
-	bool const_rot = true, const_pos = true, const_scale = true;
+	//-- A level which removes less than this part of the previous one isn't worth a draw range.
+	static constexpr float kMinLodReduction = 0.1f;
 
-	// Sample the node's transform evenly for the whole animation stack duration
-	for (size_t i = 0; i < va->num_frames; i++) {
-		double time = stack->time_begin + (double)i / va->framerate;
+	struct SubmeshLods
+	{
+		std::vector<uint32_t> indices;
+		std::vector<LodDesc> lods; //-- Start indices are relative to the indices above.
+	};
 
-		ufbx_transform transform = ufbx_evaluate_transform(stack->anim, node, time);
-		vna->rot[i] = ufbx_to_um_quat(transform.rotation);
-		vna->pos[i] = ufbx_to_um_vec3(transform.translation);
-		vna->scale[i] = ufbx_to_um_vec3(transform.scale);
+	std::vector<SubmeshLods> results(data.submeshes.size());
+	service<JobService>().parallelFor(data.submeshes.size(), [&data, &results, &settings](size_t submeshId)
+		{
+			ENGINE_CPU_ZONE_NAMED("MeshResource::generateLods");
+
+			const auto& submesh = data.submeshes[submeshId];
+			const auto* positions = reinterpret_cast<const float*>(data.streams[static_cast<size_t>(MeshResource::Stream::Position)].data());
+			const std::span<const float> submeshPositions(positions + submesh.baseVertex * 3, submesh.numVertices * 3);
+			const float maxError = settings.lodMaxError * (submesh.aabb.m_max - submesh.aabb.m_min).Length();
+
+			//-- Every level is optimized from scratch, so a level reuses the arena of the previous one.
+			utils::LinearArena scratch(settings.optimizeGeometry ? mesh::optimizerScratchSize(submesh.numIndices, submesh.numVertices) : 0);
+			auto& result = results[submeshId];
+			std::vector<uint32_t> previous(data.indices.begin() + submesh.startIndex, data.indices.begin() + submesh.startIndex + submesh.numIndices);
+			std::vector<uint32_t> simplified(previous.size());
+			float error = 0.0f;
+			for (float ratio : settings.lodTriangleRatios)
+			{
+				if (!(error < maxError))
+				{
+					break;
+				}
 
-		if (i > 0) {
-			// Negated quaternions are equivalent, but interpolating between ones of different
-			// polarity takes a the longer path, so flip the quaternion if necessary.
-			if (um_quat_dot(vna->rot[i], vna->rot[i - 1]) < 0.0f) {
-				vna->rot[i] = um_quat_neg(vna->rot[i]);
-			}
+				const size_t targetIndexCount = static_cast<size_t>(submesh.numIndices * ratio) / 3 * 3;
+				float levelError = 0.0f;
+				const size_t numIndices = mesh::simplify(simplified, previous, submeshPositions, targetIndexCount, maxError - error, &levelError);
+				if (numIndices == 0 || numIndices > previous.size() * (1.0f - kMinLodReduction))
+				{
+					break;
+				}
+
+				previous.resize(numIndices);
+				if (settings.optimizeGeometry)
+				{
+					scratch.reset();
+					mesh::optimizeVertexCache(previous, { simplified.data(), numIndices }, submesh.numVertices, scratch);
+				}
+				else
+				{
+					std::copy_n(simplified.begin(), numIndices, previous.begin());
+				}
+
+				error += levelError;
+				result.lods.push_back({ .startIndex = static_cast<uint32_t>(result.indices.size()), .numIndices = static_cast<uint32_t>(numIndices), .error = error });
+				result.indices.insert(result.indices.end(), previous.begin(), previous.end());
+			}
+		});
+
+	//-- The level 0 is the full detail range of the submesh.
+	std::vector<size_t> levelTriangles;
+	for (size_t submeshId = 0; submeshId < data.submeshes.size(); ++submeshId)
+	{
+		auto& submesh = data.submeshes[submeshId];
+		const auto& result = results[submeshId];
+
+		submesh.lodOffset = static_cast<uint32_t>(data.lods.size());
+		submesh.numLods = static_cast<uint32_t>(result.lods.size() + 1);
+		data.lods.push_back({ .startIndex = submesh.startIndex, .numIndices = submesh.numIndices, .error = 0.0f });
+
+		const auto startIndex = static_cast<uint32_t>(data.indices.size());
+		for (LodDesc lod : result.lods)
+		{
+			lod.startIndex += startIndex;
+			data.lods.push_back(lod);
+		}
+		data.indices.insert(data.indices.end(), result.indices.begin(), result.indices.end());
 
-			// Keep track of which channels are constant for the whole animation as an optimization
-			if (!um_quat_equal(vna->rot[i - 1], vna->rot[i])) const_rot = false;
-			if (!um_equal3(vna->pos[i - 1], vna->pos[i])) const_pos = false;
-			if (!um_equal3(vna->scale[i - 1], vna->scale[i])) const_scale = false;
+		levelTriangles.resize(std::max<size_t>(levelTriangles.size(), submesh.numLods), 0);
+		for (size_t i = 0; i < submesh.numLods; ++i)
+		{
+			levelTriangles[i] += data.lods[submesh.lodOffset + i].numIndices / 3;
 		}
 	}
 
-	if (const_rot) { vna->const_rot = vna->rot[0]; free(vna->rot); vna->rot = NULL; }
-	if (const_pos) { vna->const_pos = vna->pos[0]; free(vna->pos); vna->pos = NULL; }
-	if (const_scale) { vna->const_scale = vna->scale[0]; free(vna->scale); vna->scale = NULL; }
+	std::string levels;
+	for (size_t triangles : levelTriangles)
+	{
+		levels += fmt::format("{}{}", levels.empty() ? "" : ", ", triangles);
+	}
+	logger().info(fmt::format("[MeshResource]: '{}' levels of detail triangles: {}.", path, levels));
 }
 
-void readBlendChannelAnim(Animation& va, BlendChannelAnimation* vbca, ufbx_anim_stack* stack, ufbx_blend_channel* chan)
+
+//-- Converts the float streams produced by the import to the compact vertex format.
+//-- Positions are quantized relative to the submesh AABB, so submeshes are converted independently in parallel.
+void quantizeStreams(MeshData& data, const MeshResource::VertexFormat& format)
 {
-	vbca->weight = alloc(float, va->num_frames);
+	ENGINE_CPU_ZONE;
+
+	using Stream = MeshResource::Stream;
+
+	//-- Streams which the import didn't store stay empty in any format.
+	auto has = [&data](Stream stream) { return !data.streams[static_cast<size_t>(stream)].empty(); };
+
+	MeshData::Streams streams;
+	for (size_t i = 0; i < static_cast<size_t>(Stream::Count); ++i)
+	{
+		const auto stream = static_cast<Stream>(i);
+		const bool stored = stream == Stream::Tangent ? has(Stream::Normal) : has(stream);
+		streams[i].resize(stored ? MeshResource::streamStride(format, stream) * data.numVertices : 0);
+	}
+
+	service<JobService>().parallelFor(data.submeshes.size(), [&data, &streams, &format, &has](size_t submeshId)
+		{
+			ENGINE_CPU_ZONE_NAMED("MeshResource::quantizeStreams");
+
+			const auto& submesh = data.submeshes[submeshId];
+
+			auto source = [&data, &submesh](Stream stream)
+				{
+					const size_t id = static_cast<size_t>(stream);
+					return data.streams[id].data() + submesh.baseVertex * MeshResource::kStreamSizes[id];
+				};
+			auto vectors = [&source, &submesh](Stream stream)
+				{
+					return std::span<const math::vec3>(reinterpret_cast<const math::vec3*>(source(stream)), submesh.numVertices);
+				};
+			auto destination = [&streams, &format, &submesh](Stream stream)
+				{
+					return streams[static_cast<size_t>(stream)].data() + submesh.baseVertex * MeshResource::streamStride(format, stream);
+				};
+			auto copy = [&source, &destination, &submesh](Stream stream)
+				{
+					memcpy(destination(stream), source(stream), submesh.numVertices * MeshResource::kStreamSizes[static_cast<size_t>(stream)]);
+				};
+
+			if (format.quantizedPositions)
+			{
+				mesh::quantizePositions(reinterpret_cast<uint16_t*>(destination(Stream::Position)), vectors(Stream::Position), submesh.aabb);
+			}
+			else
+			{
+				copy(Stream::Position);
+			}
+
+			//-- The tangent frame is stored as a whole, see emitParts.
+			if (has(Stream::Normal))
+			{
+				switch (format.tangentFrame)
+				{
+				case MeshResource::TangentFrame::Float:
+					copy(Stream::Tangent);
+					copy(Stream::Bitangent);
+					copy(Stream::Normal);
+					break;
+
+				case MeshResource::TangentFrame::Octahedral:
+					mesh::encodeOctahedral(reinterpret_cast<int16_t*>(destination(Stream::Tangent)), vectors(Stream::Tangent));
+					mesh::encodeOctahedral(reinterpret_cast<int16_t*>(destination(Stream::Bitangent)), vectors(Stream::Bitangent));
+					mesh::encodeOctahedral(reinterpret_cast<int16_t*>(destination(Stream::Normal)), vectors(Stream::Normal));
+					break;
+
+				case MeshResource::TangentFrame::QTangent:
+					mesh::encodeQTangents(reinterpret_cast<int16_t*>(destination(Stream::Tangent)), vectors(Stream::Tangent),
+						vectors(Stream::Bitangent), vectors(Stream::Normal));
+					break;
+
+				default:
+					ENGINE_FAIL("Unknown tangent frame format!");
+				}
+			}
+
+			for (Stream stream : { Stream::UV0, Stream::UV1 })
+			{
+				if (!has(stream))
+				{
+					continue;
+				}
 
-	bool const_weight = true;
+				if (format.halfUVs)
+				{
+					std::span<const float> uvs(reinterpret_cast<const float*>(source(stream)), submesh.numVertices * 2);
+					mesh::convertToHalf(reinterpret_cast<uint16_t*>(destination(stream)), uvs);
+				}
+				else
+				{
+					copy(stream);
+				}
+			}
 
-	// Sample the blend weight evenly for the whole animation stack duration
-	for (size_t i = 0; i < va->num_frames; i++) {
-		double time = stack->time_begin + (double)i / va->framerate;
+			if (has(Stream::VertexColor))
+			{
+				copy(Stream::VertexColor);
+			}
+			if (format.skinned)
+			{
+				copy(Stream::BoneIndices);
+				copy(Stream::BoneWeights);
+			}
+		});
 
-		ufbx_real weight = ufbx_evaluate_blend_weight(stack->anim, chan, time);
-		vbca->weight[i] = (float)weight;
+	data.streams = std::move(streams);
+	data.vertexFormat = format;
+}
 
-		// Keep track of which channels are constant for the whole animation as an optimization
-		if (i > 0) {
-			if (vbca->weight[i - 1] != vbca->weight[i]) const_weight = false;
+//-- Totals of the optimization and skinning statistics of all parts.
+void logPartStatistics(const std::vector<PartData>& parts, std::string_view path, const MeshResource::ImportSettings& settings)
+{
+	if (settings.optimizeGeometry)
+	{
+		size_t numTriangles = 0;
+		size_t numVertices = 0;
+		size_t transformedBefore = 0;
+		size_t transformedAfter = 0;
+		for (const auto& part : parts)
+		{
+			numTriangles += part.statistics.numTriangles;
+			numVertices += part.statistics.numVertices;
+			transformedBefore += part.statistics.cacheBefore.verticesTransformed;
+			transformedAfter += part.statistics.cacheAfter.verticesTransformed;
 		}
-	}
 
-	if (const_weight) { vbca->const_weight = vbca->weight[0]; free(vbca->weight); vbca->weight = NULL; }
+		if (numTriangles > 0 && numVertices > 0)
+		{
+			logger().info(fmt::format("[MeshResource]: '{}' post-transform cache: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}.", path,
+				static_cast<float>(transformedBefore) / numTriangles, static_cast<float>(transformedAfter) / numTriangles,
+				static_cast<float>(transformedBefore) / numVertices, static_cast<float>(transformedAfter) / numVertices));
+		}
+	}
 }
 
-void readAnimStack(Animation& anim, ufbx_anim_stack* stack, ufbx_scene* scene)
+//-- Allocates the combined buffers at the exact welded size and copies the parts to their regions in parallel.
+//-- The number of welded vertices is known only after reading, so the parts are read into their own storage first.
+void emitParts(MeshData& data, std::vector<PartData>& parts)
 {
-	const float target_framerate = 30.0f;
-	const size_t max_frames = 4096;
+	ENGINE_CPU_ZONE;
+
+	data.submeshes.resize(parts.size());
+	MeshResource::StreamMask streamMask = MeshResource::streamBit(MeshResource::Stream::Position);
+	size_t numVertices = 0;
+	size_t numIndices = 0;
+	for (size_t partId = 0; partId < parts.size(); ++partId)
+	{
+		auto& part = parts[partId];
+		auto& submesh = data.submeshes[partId];
+		submesh = part.submesh;
+		submesh.baseVertex = static_cast<uint32_t>(numVertices);
+		submesh.startIndex = static_cast<uint32_t>(numIndices);
+		submesh.boneOffset = static_cast<uint32_t>(data.bones.size());
+
+		numVertices += submesh.numVertices;
+		numIndices += submesh.numIndices;
+		data.bones.insert(data.bones.end(), part.bones.begin(), part.bones.end());
+
+		submesh.blendShapeOffset = static_cast<uint32_t>(data.blendShapes.size());
+		const auto deltaOffset = static_cast<uint32_t>(data.blendShapeVertices.size());
+		for (BlendShapeDesc blendShape : part.blendShapes)
+		{
+			blendShape.deltaOffset += deltaOffset;
+			data.blendShapes.push_back(blendShape);
+		}
+		data.blendShapeVertices.insert(data.blendShapeVertices.end(), part.blendShapeVertices.begin(), part.blendShapeVertices.end());
+		data.blendShapePositionDeltas.insert(data.blendShapePositionDeltas.end(), part.blendShapePositionDeltas.begin(),
+			part.blendShapePositionDeltas.end());
+		data.blendShapeNormalDeltas.insert(data.blendShapeNormalDeltas.end(), part.blendShapeNormalDeltas.begin(),
+			part.blendShapeNormalDeltas.end());
+		for (size_t i = 0; i < static_cast<size_t>(MeshResource::Stream::Count); ++i)
+		{
+			streamMask |= part.streams[i].empty() ? 0 : MeshResource::streamBit(static_cast<MeshResource::Stream>(i));
+		}
+	}
+
+	//-- Only streams which some part has are stored. The tangent frame is stored as a whole, QTangents need all of it.
+	//-- Parts which miss a stored stream keep zeros, so submeshes without a skin in a skinned mesh have zero weights and keep the bind pose.
+	const MeshResource::StreamMask tangentFrame = MeshResource::streamBit(MeshResource::Stream::Tangent)
+		| MeshResource::streamBit(MeshResource::Stream::Bitangent) | MeshResource::streamBit(MeshResource::Stream::Normal);
+	if (streamMask & tangentFrame)
+	{
+		streamMask |= tangentFrame;
+	}
+	data.vertexFormat.skinned = (streamMask & MeshResource::streamBit(MeshResource::Stream::BoneIndices)) != 0;
 
-	// Sample the animation evenly at `target_framerate` if possible while limiting the maximum
-	// number of frames to `max_frames` by potentially dropping FPS.
-	float duration = (float)stack->time_end - (float)stack->time_begin;
-	size_t num_frames = clamp_sz((size_t)(duration * target_framerate), 2, max_frames);
-	float framerate = (float)(num_frames - 1) / duration;
+	//-- Meshes are placed by the world transforms of their instance nodes. Data without meshes is drawn once by the first node,
+	//-- or at the origin if there are no nodes either, see MeshResource::createGPUResources.
+	std::vector<math::matrix> nodeToWorld(data.nodes.size());
+	for (size_t i = 0; i < data.nodes.size(); ++i)
+	{
+		const auto& node = data.nodes[i];
+		nodeToWorld[i] = node.parent >= 0 ? node.nodeToParent * nodeToWorld[node.parent] : node.nodeToParent;
+	}
+	auto geometryToWorld = [&data, &nodeToWorld](uint32_t node)
+		{
+			return node < nodeToWorld.size() ? data.nodes[node].geometryToNode * nodeToWorld[node] : math::matrix();
+		};
 
-	anim.name = alloc_dup(char, stack->name.length + 1, stack->name.data);
-	anim.time_begin = (float)stack->time_begin;
-	anim.time_end = (float)stack->time_end;
-	anim.framerate = framerate;
-	anim.num_frames = num_frames;
+	auto submeshesAABB = [&data](uint32_t first, uint32_t count)
+		{
+			math::AABB aabb;
+			for (const auto& submesh : std::span(data.submeshes).subspan(first, count))
+			{
+				aabb.extend(submesh.aabb);
+			}
+			return aabb;
+		};
 
-	// Sample the animations of all nodes and blend channels in the stack
-	anim.nodes = alloc(viewer_node_anim, scene->nodes.count);
-	for (size_t i = 0; i < scene->nodes.count; i++) {
-		ufbx_node* node = scene->nodes.data[i];
-		read_node_anim(anim, anim.nodes[i], stack, node);
+	data.combinedAABB = math::AABB();
+	if (data.meshes.empty())
+	{
+		data.combinedAABB = mesh::transformAABB(submeshesAABB(0, static_cast<uint32_t>(data.submeshes.size())), geometryToWorld(0));
+	}
+	for (const auto& desc : data.meshes)
+	{
+		const math::AABB meshAABB = submeshesAABB(desc.submeshOffset, desc.numSubmeshes);
+		for (uint32_t i = 0; i < desc.numInstances; ++i)
+		{
+			data.combinedAABB.extend(mesh::transformAABB(meshAABB, geometryToWorld(data.meshInstances[desc.instanceOffset + i])));
+		}
 	}
 
-	anim.blend_channels = alloc(viewer_blend_channel_anim, scene->blend_channels.count);
-	for (size_t i = 0; i < scene->blend_channels.count; i++) {
-		ufbx_blend_channel* chan = scene->blend_channels.data[i];
-		read_blend_channel_anim(anim, anim.blend_channels[i], stack, chan);
+	data.numVertices = static_cast<uint32_t>(numVertices);
+	for (size_t i = 0; i < static_cast<size_t>(MeshResource::Stream::Count); ++i)
+	{
+		if (streamMask & MeshResource::streamBit(static_cast<MeshResource::Stream>(i)))
+		{
+			data.streams[i].resize(MeshResource::kStreamSizes[i] * numVertices);
+		}
 	}
-}
-#endif
+	data.indices.resize(numIndices);
+
+	service<JobService>().parallelFor(parts.size(), [&data, &parts](size_t partId)
+		{
+			ENGINE_CPU_ZONE_NAMED("MeshResource::emitPart");
+
+			auto& part = parts[partId];
+			const auto& submesh = data.submeshes[partId];
+			for (size_t i = 0; i < static_cast<size_t>(MeshResource::Stream::Count); ++i)
+			{
+				if (!part.streams[i].empty())
+				{
+					memcpy(data.streams[i].data() + submesh.baseVertex * MeshResource::kStreamSizes[i], part.streams[i].data(), part.streams[i].size());
+				}
+			}
+			memcpy(data.indices.data() + submesh.startIndex, part.indices.data(), part.indices.size() * sizeof(uint32_t));
+
+			//-- The part storage is as large as its region, release it right away.
+			part = {};
+		});
 }
 
-void MeshResource::load(std::string_view path)
+//-- Reads the scene through ufbx: the hierarchy, instances and blend channels into data and the geometry into parts.
+bool importFbx(std::string_view path, const MeshResource::ImportSettings& settings, MeshData& data, std::vector<PartData>& parts)
 {
-	auto& rs = service<RenderService>();
-	std::string absolutePath = service<VFSService>().absolutePath(path);
+	ENGINE_CPU_ZONE;
 
 	ufbx_load_opts opts = {
 		.target_axes = ufbx_axes_right_handed_y_up,
@@ -541,32 +1101,46 @@ void MeshResource::load(std::string_view path)
 	};
 
 	ufbx_error error;
-	ufbx_scene* ufbxScene = ufbx_load_file(absolutePath.c_str(), &opts, &error);
+	ufbx_scene* ufbxScene = mesh::loadScene(path, opts, error);
 	if (!ufbxScene)
 	{
-		logger().error(fmt::format("[MeshResource]: Can't load the file '{}'. Error: {}", absolutePath, error.description.data));
-		return ;
+		logger().error(fmt::format("[MeshResource]: Can't load the file '{}'. Error: {}", path, error.description.data));
+		return false;
 	}
 
-	Scene scene;
-	scene.nodes.resize(ufbxScene->nodes.count);
-	for (size_t i = 0; i < scene.nodes.size(); i++)
+	//-- Keep the hierarchy flattened, so world transforms are accumulated in a single pass.
+	const std::vector<uint32_t> nodeOrder = mesh::flattenNodes(ufbxScene);
+	std::vector<uint32_t> nodeIndices(ufbxScene->nodes.count, 0);
+	for (size_t i = 0; i < nodeOrder.size(); ++i)
 	{
-		readNode(scene.nodes[i], ufbxScene->nodes.data[i]);
+		nodeIndices[nodeOrder[i]] = static_cast<uint32_t>(i);
 	}
 
-	//-- ToDo: Remove it and use proper API.
-	auto* d3d12Backend = static_cast<render::d3d12::Backend*>(rs.backend());
-	auto* device = d3d12Backend->device();
+	data.nodes.resize(nodeOrder.size());
+	for (size_t i = 0; i < nodeOrder.size(); i++)
+	{
+		readNode(data.nodes[i], ufbxScene->nodes.data[nodeOrder[i]], nodeIndices);
+	}
 
-	//-- Step1. Prepare: calc some data.
+	//-- Prepare: calc some data.
 	//-- Assume that all meshes in a file are part of one big mesh.
 	size_t totalSubmeshes = 0;
 	size_t maxTriangles = 0;
-	size_t totalVertices = 0;
+	size_t maxFaceTriangles = 0;
+	size_t maxSkinClusters = 0;
+	size_t maxBlendMeshVertices = 0;
 	for (size_t meshId = 0; meshId < ufbxScene->meshes.count; meshId++)
 	{
 		auto* ufbxMesh = ufbxScene->meshes.data[meshId];
+		maxFaceTriangles = std::max(maxFaceTriangles, ufbxMesh->max_face_triangles);
+		if (ufbxMesh->skin_deformers.count > 0)
+		{
+			maxSkinClusters = std::max(maxSkinClusters, ufbxMesh->skin_deformers.data[0]->clusters.count);
+		}
+		if (ufbxMesh->blend_deformers.count > 0)
+		{
+			maxBlendMeshVertices = std::max(maxBlendMeshVertices, ufbxMesh->num_vertices);
+		}
 		//-- We need to render each material of the mesh in a separate part, so let's count the number of parts and maximum number of triangles needed.
 		for (size_t partId = 0; partId < ufbxMesh->material_parts.count; partId++)
 		{
@@ -585,150 +1159,1388 @@ void MeshResource::load(std::string_view path)
 				if (face.num_indices != 3)
 				{
 					logger().error(fmt::format("[MeshResource]: Mesh {}, submesh {} has got not triangulated face {}.", meshId, partId, faceId));
-					return;
+					ufbx_free_scene(ufbxScene);
+					return false;
 				}
 			}
-
-			//-- Assume that a model has already triangulated faces.
-			totalVertices += part->num_triangles * 3;
 		}
 
 		if (maxTriangles == 0)
 		{
 			logger().error(fmt::format("[MeshResource]: Zero triangles in the mesh {}! Did you forget to triangulate it?", meshId));
-			return;
+			ufbx_free_scene(ufbxScene);
+			return false;
 		}
 	}
 
-	//-- Step 2. Create GPU resources.
+	if (totalSubmeshes == 0)
+	{
+		logger().error(fmt::format("[MeshResource]: The file '{}' doesn't contain any geometry.", path));
+		ufbx_free_scene(ufbxScene);
+		return false;
+	}
+
+	//-- Read and weld every part into its own storage in parallel.
 	{
-		D3D12_HEAP_PROPERTIES heapProps =
+		struct PartDesc
 		{
-			.Type = D3D12_HEAP_TYPE_UPLOAD,
-			.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
-			.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
-			.CreationNodeMask = 1,
-			.VisibleNodeMask = 1
+			ufbx_mesh* mesh = nullptr;
+			ufbx_mesh_part* part = nullptr;
+			uint32_t firstFace = 0;
+			uint32_t numFaces = 0;
 		};
 
-		D3D12_RESOURCE_DESC bufferDesc =
-		{
-			.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
-			.Width = 0,
-			.Height = 1,
-			.DepthOrArraySize = 1,
-			.MipLevels = 1,
-			.Format = DXGI_FORMAT_UNKNOWN,
-			.SampleDesc = {.Count = 1, .Quality = 0},
-			.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-			.Flags = D3D12_RESOURCE_FLAG_NONE
-		};
+		std::vector<PartDesc> descs;
+		descs.reserve(totalSubmeshes);
+		std::vector<uint32_t> clusterMarks;
+		std::vector<std::pair<uint32_t, uint32_t>> faceRanges;
+		data.meshes.reserve(ufbxScene->meshes.count);
+		for (size_t meshId = 0; meshId < ufbxScene->meshes.count; meshId++)
+		{
+			//-- Our shader supports only a single material per draw call so we need to split the mesh into parts by material.
+			//-- `ufbx_mesh_part` contains a handy compact list of faces that use the material which we use here.
+			auto* ufbxMesh = ufbxScene->meshes.data[meshId];
+			auto& meshDesc = data.meshes.emplace_back();
+			meshDesc.submeshOffset = static_cast<uint32_t>(descs.size());
+			for (size_t partId = 0; partId < ufbxMesh->material_parts.count; partId++)
+			{
+				ufbx_mesh_part* meshPart = &ufbxMesh->material_parts.data[partId];
+				if (meshPart->num_triangles == 0)
+				{
+					continue;
+				}
 
-		//-- Stream buffers.
-		for (size_t i = 0; i < static_cast<size_t>(MeshResource::Stream::Count); ++i)
+				//-- Parts whose skin has too many bones for the 8-bit indices are drawn in several submeshes.
+				const ufbx_skin_deformer* skin = ufbxMesh->skin_deformers.count > 0 ? ufbxMesh->skin_deformers.data[0] : nullptr;
+				if (!skin || skin->clusters.count <= kMaxPartBones)
+				{
+					descs.push_back({ .mesh = ufbxMesh, .part = meshPart, .firstFace = 0, .numFaces = static_cast<uint32_t>(meshPart->num_faces) });
+					continue;
+				}
+
+				clusterMarks.assign(skin->clusters.count, 0);
+				splitByBones(ufbxMesh, meshPart, skin, clusterMarks, faceRanges);
+				for (const auto [firstFace, numFaces] : faceRanges)
+				{
+					descs.push_back({ .mesh = ufbxMesh, .part = meshPart, .firstFace = firstFace, .numFaces = numFaces });
+				}
+				if (faceRanges.size() > 1)
+				{
+					logger().info(fmt::format("[MeshResource]: '{}' mesh {} part {} is split into {} draws of at most {} bones.", path, meshId, partId,
+						faceRanges.size(), kMaxPartBones));
+				}
+			}
+			meshDesc.numSubmeshes = static_cast<uint32_t>(descs.size()) - meshDesc.submeshOffset;
+
+			//-- A mesh can be instanced by multiple nodes. Its geometry is read once in its own space and drawn per instance.
+			meshDesc.instanceOffset = static_cast<uint32_t>(data.meshInstances.size());
+			meshDesc.numInstances = static_cast<uint32_t>(ufbxMesh->instances.count);
+			for (size_t i = 0; i < ufbxMesh->instances.count; i++)
+			{
+				data.meshInstances.push_back(nodeIndices[ufbxMesh->instances.data[i]->typed_id]);
+			}
+		}
+
+		//-- Scratch memory of reading lives in an arena per thread, sized from the largest part, so the scratch memory of a whole import
+		//-- takes a fixed number of heap blocks. The buffers of the parts are allocated per part on top of that.
+		//-- parallelFor runs at most one task per worker plus the calling thread at once.
+		auto& jobs = service<JobService>();
+		utils::ArenaPool arenas(std::min(descs.size(), jobs.numThreads() + 1), readMeshScratchSize(maxTriangles * 3, maxFaceTriangles * 3, maxSkinClusters, maxBlendMeshVertices));
+
+		parts.resize(descs.size());
+		jobs.parallelFor(descs.size(), [&parts, &descs, &arenas, &settings](size_t partId)
+			{
+				ENGINE_CPU_ZONE_NAMED("MeshResource::readMesh");
+
+				const auto& desc = descs[partId];
+				const size_t numTrianglesIndices = desc.mesh->max_face_triangles * 3;
+				const size_t numUVSets = desc.mesh->uv_sets.count;
+				auto arena = arenas.acquire();
+				readMesh(parts[partId], *arena, settings, desc.part, desc.mesh, desc.firstFace, desc.numFaces, numTrianglesIndices, numUVSets);
+			});
+
+		const auto scratch = arenas.statistics();
+		logger().info(fmt::format("[MeshResource]: '{}' scratch memory: {} allocations, {} heap blocks, {} KiB peak, {} part buffers.", path,
+			scratch.allocations, scratch.heapAllocations, scratch.peakBytes / 1024, countPartBuffers(parts)));
+	}
+
+	//-- Parts refer to ufbx nodes, move them to the flattened hierarchy.
+	for (auto& part : parts)
+	{
+		for (BoneDesc& bone : part.bones)
 		{
-			bufferDesc.Width = MeshResource::kStreamSizes[i] * totalVertices;
-			m_streamsSize[i] = bufferDesc.Width;
+			bone.node = nodeIndices[bone.node];
+		}
+	}
 
-			//-- Upload buffer.
-			heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
-			assertIfFailed(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc,
-				D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_uploadBuffers[i])));
+	data.blendChannelWeights.resize(ufbxScene->blend_channels.count);
+	for (size_t i = 0; i < data.blendChannelWeights.size(); i++)
+	{
+		data.blendChannelWeights[i] = static_cast<float>(ufbxScene->blend_channels.data[i]->weight);
+	}
 
-			//-- Usual stream.
-			heapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
-			assertIfFailed(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc,
-				D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_streams[i])));
+	ufbx_free_scene(ufbxScene);
+
+	return true;
+}
+
+//-- Gathers the attributes of the corners of an OBJ part into flat streams and builds the part from them.
+void readObjPart(PartData& part, utils::LinearArena& arena, const MeshResource::ImportSettings& settings, const mesh::ObjData& obj,
+	const mesh::ObjPart& objPart)
+{
+	const size_t numCorners = objPart.corners.size();
+	bool hasUVs = false;
+	bool hasNormals = false;
+	for (const mesh::ObjCorner& corner : objPart.corners)
+	{
+		hasUVs |= corner.uv != mesh::kObjNone;
+		hasNormals |= corner.normal != mesh::kObjNone;
+	}
+	const bool hasColors = !obj.colors.empty();
+
+	//-- Corners without an attribute which others of the part have keep zeros.
+	auto positions = arena.allocate<math::vec3>(numCorners);
+	auto normals = arena.allocate<math::vec3>(hasNormals ? numCorners : 0);
+	auto uvs = arena.allocate<math::vec2>(hasUVs ? numCorners : 0);
+	auto colors = arena.allocate<uint32_t>(hasColors ? numCorners : 0);
+	for (size_t i = 0; i < numCorners; ++i)
+	{
+		const mesh::ObjCorner& corner = objPart.corners[i];
+		positions[i] = obj.positions[corner.position];
+		if (hasNormals && corner.normal != mesh::kObjNone)
+		{
+			normals[i] = obj.normals[corner.normal].Normalized();
+		}
+		if (hasUVs && corner.uv != mesh::kObjNone)
+		{
+			uvs[i] = obj.uvs[corner.uv];
 		}
+		if (hasColors)
+		{
+			colors[i] = obj.colors[corner.position];
+		}
+	}
+
+	PartStreams streams = { .numVertices = numCorners };
+	streams.streams[static_cast<size_t>(MeshResource::Stream::Position)] = positions.data();
+	streams.streams[static_cast<size_t>(MeshResource::Stream::Normal)] = hasNormals ? normals.data() : nullptr;
+	streams.streams[static_cast<size_t>(MeshResource::Stream::UV0)] = hasUVs ? uvs.data() : nullptr;
+	streams.streams[static_cast<size_t>(MeshResource::Stream::VertexColor)] = hasColors ? colors.data() : nullptr;
+	generatePartTangents(streams, arena, settings);
+	buildPart(part, arena, settings, streams);
+}
+
+//-- Reads Wavefront OBJ files with the dedicated parser, the generic ufbx path takes minutes on scans of hundreds of MiB.
+//-- OBJ has no hierarchy, so the file is a single mesh split into parts by materials.
+bool importObj(std::string_view path, const MeshResource::ImportSettings& settings, std::vector<PartData>& parts)
+{
+	ENGINE_CPU_ZONE;
+
+	//-- Files of native file systems are parsed in place, the ones inside archives are read into memory.
+	auto& vfs = service<VFSService>();
+	utils::MappedFile mapping;
+	std::vector<uint8_t> buffer;
+	std::string_view text;
+	if (vfs.mapFile(path, mapping))
+	{
+		text = { reinterpret_cast<const char*>(mapping.data()), mapping.size() };
+	}
+	else if (vfs.readFile(path, buffer))
+	{
+		text = { reinterpret_cast<const char*>(buffer.data()), buffer.size() };
+	}
+	else
+	{
+		logger().error(fmt::format("[MeshResource]: Can't load the file '{}'.", path));
+		return false;
+	}
+
+	mesh::ObjData obj;
+	std::string error;
+	if (!mesh::parseObj(text, obj, error))
+	{
+		logger().error(fmt::format("[MeshResource]: Can't parse the file '{}'. Error: {}", path, error));
+		return false;
+	}
+
+	if (obj.parts.empty())
+	{
+		logger().error(fmt::format("[MeshResource]: The file '{}' doesn't contain any geometry.", path));
+		return false;
+	}
+
+	size_t maxCorners = 0;
+	size_t numTriangles = 0;
+	for (const mesh::ObjPart& objPart : obj.parts)
+	{
+		maxCorners = std::max(maxCorners, objPart.corners.size());
+		numTriangles += objPart.corners.size() / 3;
+	}
+	logger().info(fmt::format("[MeshResource]: '{}' OBJ: {} positions, {} triangles, {} materials.", path, obj.positions.size(), numTriangles,
+		obj.parts.size()));
 
-		//-- Index buffers.
+	auto& jobs = service<JobService>();
+	utils::ArenaPool arenas(std::min(obj.parts.size(), jobs.numThreads() + 1), readMeshScratchSize(maxCorners, 0, 0, 0));
+
+	parts.resize(obj.parts.size());
+	jobs.parallelFor(obj.parts.size(), [&parts, &obj, &arenas, &settings](size_t partId)
 		{
-			//-- TODO: Check the size of index buffer and place it in a dedicated buffer (r16/r32).
-			bufferDesc.Width = sizeof(uint32_t) * 10000; //-- ToDo: Reconsider later.
-			m_indexBufferSize = bufferDesc.Width;
+			ENGINE_CPU_ZONE_NAMED("MeshResource::readObjPart");
 
-			//-- Upload buffer.
-			heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
-			assertIfFailed(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc,
-				D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_uploadIndexBuffer)));
+			auto arena = arenas.acquire();
+			readObjPart(parts[partId], *arena, settings, obj, obj.parts[partId]);
+		});
 
-			//-- Usual stream.
-			heapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
-			assertIfFailed(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc,
-				D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_indexBuffer)));
+	return true;
+}
+
+//-- Copies an accessor into tightly packed floats. Float accessors with the matching layout are copied straight from the buffer
+//-- as a whole, the others are converted element by element.
+void readAccessor(const cgltf_accessor* accessor, float* destination)
+{
+	const size_t numComponents = cgltf_num_components(accessor->type);
+	const size_t elementSize = numComponents * sizeof(float);
+	if (accessor->component_type == cgltf_component_type_r_32f && !accessor->normalized && !accessor->is_sparse && accessor->buffer_view
+		&& accessor->stride == elementSize)
+	{
+		memcpy(destination, cgltf_buffer_view_data(accessor->buffer_view) + accessor->offset, accessor->count * elementSize);
+		return;
+	}
+
+	cgltf_accessor_unpack_floats(accessor, destination, accessor->count * numComponents);
+}
+
+void readIndices(const cgltf_accessor* accessor, std::span<uint32_t> indices)
+{
+	if (accessor->is_sparse || !accessor->buffer_view)
+	{
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			indices[i] = static_cast<uint32_t>(cgltf_accessor_read_index(accessor, i));
 		}
+		return;
 	}
 
-	//-- Step 3. Reading the file.
+	const uint8_t* source = cgltf_buffer_view_data(accessor->buffer_view) + accessor->offset;
+	const size_t stride = accessor->stride;
+	switch (accessor->component_type)
 	{
-		m_subMeshes.reserve(totalSubmeshes);
-		m_combinedAABB = math::AABB();
-		size_t vertexOffset = 0;
-		size_t indexOffset = 0;
+	case cgltf_component_type_r_8u:
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			indices[i] = source[i * stride];
+		}
+		break;
 
-		const size_t maxVerticesInStream = maxTriangles * 3;
-		for (size_t meshId = 0; meshId < ufbxScene->meshes.count; meshId++)
+	case cgltf_component_type_r_16u:
+		for (size_t i = 0; i < indices.size(); ++i)
 		{
-			//-- Our shader supports only a single material per draw call so we need to split the mesh into parts by material.
-			//-- `ufbx_mesh_part` contains a handy compact list of faces that use the material which we use here.
-			auto* ufbxMesh = ufbxScene->meshes.data[meshId];
-			if (ufbxMesh->skin_deformers.count > 0)
+			uint16_t index = 0;
+			memcpy(&index, source + i * stride, sizeof(index));
+			indices[i] = index;
+		}
+		break;
+
+	default:
+		if (stride == sizeof(uint32_t))
+		{
+			memcpy(indices.data(), source, indices.size_bytes());
+		}
+		else
+		{
+			for (size_t i = 0; i < indices.size(); ++i)
 			{
-				ENGINE_FAIL("Implement skinning!");
-				logger().error("Mesh consists of skinning geometry! Loader doesn't support yet this technology (:D)");
+				memcpy(&indices[i], source + i * stride, sizeof(uint32_t));
 			}
+		}
+		break;
+	}
+}
 
-			const size_t numTrianglesIndices = ufbxMesh->max_face_triangles * 3;
-			const size_t numUVSets = ufbxMesh->uv_sets.count;
-			for (size_t partId = 0; partId < ufbxMesh->material_parts.count; partId++)
+//-- Reads a triangle primitive into the part. Vertices of glTF are already indexed, so they are welded only to merge duplicates.
+void readGlbPart(PartData& part, utils::LinearArena& arena, const MeshResource::ImportSettings& settings, const cgltf_primitive* primitive)
+{
+	const cgltf_accessor* positionAccessor = nullptr;
+	const cgltf_accessor* normalAccessor = nullptr;
+	const cgltf_accessor* tangentAccessor = nullptr;
+	const cgltf_accessor* colorAccessor = nullptr;
+	std::array<const cgltf_accessor*, 2> uvAccessors = {};
+	for (size_t i = 0; i < primitive->attributes_count; ++i)
+	{
+		const cgltf_attribute& attribute = primitive->attributes[i];
+		const cgltf_type type = attribute.data->type;
+		switch (attribute.type)
+		{
+		case cgltf_attribute_type_position: positionAccessor = type == cgltf_type_vec3 ? attribute.data : nullptr; break;
+		case cgltf_attribute_type_normal: normalAccessor = type == cgltf_type_vec3 ? attribute.data : nullptr; break;
+		case cgltf_attribute_type_tangent: tangentAccessor = type == cgltf_type_vec4 ? attribute.data : nullptr; break;
+		case cgltf_attribute_type_texcoord:
+			if (attribute.index < uvAccessors.size() && type == cgltf_type_vec2)
 			{
-				ufbx_mesh_part* meshPart = &ufbxMesh->material_parts.data[partId];
-				if (meshPart->num_triangles == 0)
-				{
-					continue;
-				}
-
-				auto& submesh = m_subMeshes.emplace_back();
-
-				readMesh(*this, submesh, meshPart, ufbxMesh, maxVerticesInStream, numTrianglesIndices, numUVSets, vertexOffset, indexOffset);
-				m_combinedAABB.extend(submesh.aabb);
+				uvAccessors[attribute.index] = attribute.data;
+			}
+			break;
+		case cgltf_attribute_type_color:
+			if (attribute.index == 0 && (type == cgltf_type_vec3 || type == cgltf_type_vec4))
+			{
+				colorAccessor = attribute.data;
 			}
+			break;
+		default:
+			break;
 		}
 	}
 
-	//-- Step 4. Upload data to the GPU.
-	/*{
-		CommandContext& InitContext = CommandContext::Begin();
+	ENGINE_ASSERT_DEBUG(positionAccessor, "Primitives without positions are skipped by the importer!");
+	const size_t numVertices = positionAccessor->count;
+	PartStreams streams = { .numVertices = numVertices };
 
-		size_t MaxBytes = std::min<size_t>(Dest.GetBufferSize() - DestOffset, Src.GetBufferSize() - SrcOffset);
-		NumBytes = std::min<size_t>(MaxBytes, NumBytes);
+	auto positions = arena.allocate<math::vec3>(numVertices);
+	readAccessor(positionAccessor, &positions[0].x);
+	streams.streams[static_cast<size_t>(MeshResource::Stream::Position)] = positions.data();
 
-		// copy data to the intermediate upload heap and then schedule a copy from the upload heap to the default texture
-		InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_COPY_DEST, true);
-		InitContext.m_CommandList->CopyBufferRegion(Dest.GetResource(), DestOffset, (ID3D12Resource*)Src.GetResource(), SrcOffset, NumBytes);
-		InitContext.TransitionResource(Dest, D3D12_RESOURCE_STATE_GENERIC_READ, true);
-
-		// Execute the command list and wait for it to finish so we can release the upload buffer
-		InitContext.Finish(true);
-	}*/
+	auto normals = arena.allocate<math::vec3>(normalAccessor ? numVertices : 0);
+	if (normalAccessor)
+	{
+		readAccessor(normalAccessor, &normals[0].x);
+		for (math::vec3& normal : normals)
+		{
+			normal.Normalize();
+		}
+		streams.streams[static_cast<size_t>(MeshResource::Stream::Normal)] = normals.data();
+	}
 
-	scene.blendChannels.resize(ufbxScene->blend_channels.count);
-	for (size_t i = 0; i < scene.blendChannels.size(); i++)
+	//-- The w of glTF tangents is the handedness of the bitangent, which points along the growing V of glTF.
+	//-- V is flipped below, so the bitangent is flipped as well.
+	if (tangentAccessor && normalAccessor)
 	{
-		readBlendChannel(scene.blendChannels[i], ufbxScene->blend_channels.data[i]);
+		auto packedTangents = arena.allocate<math::vec4>(numVertices);
+		readAccessor(tangentAccessor, &packedTangents[0].x);
+
+		auto tangents = arena.allocate<math::vec3>(numVertices);
+		auto bitangents = arena.allocate<math::vec3>(numVertices);
+		for (size_t i = 0; i < numVertices; ++i)
+		{
+			const math::vec4& packed = packedTangents[i];
+			tangents[i] = math::vec3(packed.x, packed.y, packed.z).Normalized();
+			bitangents[i] = normals[i].Cross(tangents[i]) * (packed.w < 0.0f ? 1.0f : -1.0f);
+		}
+		streams.streams[static_cast<size_t>(MeshResource::Stream::Tangent)] = tangents.data();
+		streams.streams[static_cast<size_t>(MeshResource::Stream::Bitangent)] = bitangents.data();
 	}
 
-#if ENABLE_READ_ANIMATION
-	scene.animations.resize(ufbxScene->anim_stacks.count);
-	for (size_t i = 0; i < scene.animations.size(); i++)
+	//-- glTF puts the UV origin at the top left corner, flip it to the bottom left one of FBX, which the rest of the data uses.
+	for (size_t set = 0; set < uvAccessors.size(); ++set)
 	{
-		readAnimStack(scene.animations[i], ufbxScene->anim_stacks.data[i], ufbxScene);
+		if (uvAccessors[set])
+		{
+			auto uvs = arena.allocate<math::vec2>(numVertices);
+			readAccessor(uvAccessors[set], &uvs[0].x);
+			for (math::vec2& uv : uvs)
+			{
+				uv.y = 1.0f - uv.y;
+			}
+			streams.streams[static_cast<size_t>(MeshResource::Stream::UV0) + set] = uvs.data();
+		}
 	}
-#endif
 
-	ufbx_free_scene(ufbxScene);
+	if (colorAccessor)
+	{
+		const size_t numComponents = cgltf_num_components(colorAccessor->type);
+		auto components = arena.allocate<float>(numVertices * numComponents);
+		readAccessor(colorAccessor, components.data());
 
-	m_status = Status::Ready;
+		auto colors = arena.allocate<uint32_t>(numVertices);
+		for (size_t i = 0; i < numVertices; ++i)
+		{
+			const float* color = &components[i * numComponents];
+			colors[i] = math::color(color[0], color[1], color[2], numComponents == 4 ? color[3] : 1.0f).BGRA();
+		}
+		streams.streams[static_cast<size_t>(MeshResource::Stream::VertexColor)] = colors.data();
+	}
+
+	if (primitive->indices)
+	{
+		auto indices = arena.allocate<uint32_t>(primitive->indices->count);
+		readIndices(primitive->indices, indices);
+		streams.indices = indices;
+	}
+
+	generatePartTangents(streams, arena, settings);
+	buildPart(part, arena, settings, streams);
+}
+
+//-- Reads binary glTF files. cgltf keeps the BIN chunk in place, so accessors are read straight from the file data and
+//-- float attributes skip the conversion through doubles of the ufbx path. Skins and morph targets aren't imported yet.
+bool importGlb(std::string_view path, const MeshResource::ImportSettings& settings, MeshData& data, std::vector<PartData>& parts)
+{
+	ENGINE_CPU_ZONE;
+
+	auto& vfs = service<VFSService>();
+	utils::MappedFile mapping;
+	std::vector<uint8_t> buffer;
+	std::span<const uint8_t> bytes;
+	if (vfs.mapFile(path, mapping))
+	{
+		bytes = { mapping.data(), mapping.size() };
+	}
+	else if (vfs.readFile(path, buffer))
+	{
+		bytes = buffer;
+	}
+	else
+	{
+		logger().error(fmt::format("[MeshResource]: Can't load the file '{}'.", path));
+		return false;
+	}
+
+	cgltf_options options = { .type = cgltf_file_type_glb };
+	cgltf_data* parsed = nullptr;
+	cgltf_result result = cgltf_parse(&options, bytes.data(), bytes.size(), &parsed);
+	std::unique_ptr<cgltf_data, decltype(&cgltf_free)> gltf(parsed, &cgltf_free);
+
+	//-- External buffers would bypass the VFS, so only the BIN chunk and embedded buffers are supported.
+	for (size_t i = 0; result == cgltf_result_success && i < gltf->buffers_count; ++i)
+	{
+		const char* uri = gltf->buffers[i].uri;
+		result = uri && strncmp(uri, "data:", 5) != 0 ? cgltf_result_file_not_found : result;
+	}
+	if (result == cgltf_result_success)
+	{
+		result = cgltf_load_buffers(&options, gltf.get(), nullptr);
+	}
+	if (result == cgltf_result_success)
+	{
+		result = cgltf_validate(gltf.get());
+	}
+	if (result != cgltf_result_success)
+	{
+		logger().error(fmt::format("[MeshResource]: Can't load the file '{}'. Error: {}", path, static_cast<int32_t>(result)));
+		return false;
+	}
+
+	//-- Flatten the hierarchy of the scene depth first, so parents precede their children.
+	const cgltf_scene* scene = gltf->scene ? gltf->scene : (gltf->scenes_count > 0 ? &gltf->scenes[0] : nullptr);
+	//-- Nodes to visit along with the indices of their parents.
+	std::vector<std::pair<const cgltf_node*, int32_t>> stack;
+	if (scene)
+	{
+		for (size_t i = scene->nodes_count; i > 0; --i)
+		{
+			stack.emplace_back(scene->nodes[i - 1], -1);
+		}
+	}
+	else
+	{
+		for (size_t i = gltf->nodes_count; i > 0; --i)
+		{
+			if (!gltf->nodes[i - 1].parent)
+			{
+				stack.emplace_back(&gltf->nodes[i - 1], -1);
+			}
+		}
+	}
+
+	std::vector<std::vector<uint32_t>> meshInstances(gltf->meshes_count);
+	while (!stack.empty())
+	{
+		const auto [node, parent] = stack.back();
+		stack.pop_back();
+
+		const auto index = static_cast<uint32_t>(data.nodes.size());
+		auto& desc = data.nodes.emplace_back();
+		desc.parent = parent;
+		//-- Column-major matrices for column vectors are the row-major ones for row vectors.
+		float nodeToParent[16];
+		cgltf_node_transform_local(node, nodeToParent);
+		desc.nodeToParent = math::matrix(nodeToParent);
+
+		if (node->mesh)
+		{
+			meshInstances[node->mesh - gltf->meshes].push_back(index);
+		}
+
+		for (size_t i = node->children_count; i > 0; --i)
+		{
+			stack.emplace_back(node->children[i - 1], static_cast<int32_t>(index));
+		}
+	}
+
+	std::vector<const cgltf_primitive*> primitives;
+	size_t maxVertices = 0;
+	size_t maxIndices = 0;
+	bool hasDeformers = gltf->skins_count > 0;
+	for (size_t meshId = 0; meshId < gltf->meshes_count; ++meshId)
+	{
+		const cgltf_mesh& gltfMesh = gltf->meshes[meshId];
+		auto& meshDesc = data.meshes.emplace_back();
+		meshDesc.submeshOffset = static_cast<uint32_t>(primitives.size());
+		for (size_t i = 0; i < gltfMesh.primitives_count; ++i)
+		{
+			const cgltf_primitive* primitive = &gltfMesh.primitives[i];
+			const bool hasPositions = cgltf_find_accessor(primitive, cgltf_attribute_type_position, 0) != nullptr;
+			if (primitive->type != cgltf_primitive_type_triangles || !hasPositions)
+			{
+				logger().warning(fmt::format("[MeshResource]: '{}' mesh {} primitive {} isn't a triangle list with positions, skip it.", path, meshId, i));
+				continue;
+			}
+
+			hasDeformers |= primitive->targets_count > 0;
+			const size_t numVertices = cgltf_find_accessor(primitive, cgltf_attribute_type_position, 0)->count;
+			maxVertices = std::max(maxVertices, numVertices);
+			maxIndices = std::max(maxIndices, primitive->indices ? primitive->indices->count : numVertices);
+			primitives.push_back(primitive);
+		}
+		meshDesc.numSubmeshes = static_cast<uint32_t>(primitives.size()) - meshDesc.submeshOffset;
+
+		meshDesc.instanceOffset = static_cast<uint32_t>(data.meshInstances.size());
+		meshDesc.numInstances = static_cast<uint32_t>(meshInstances[meshId].size());
+		data.meshInstances.insert(data.meshInstances.end(), meshInstances[meshId].begin(), meshInstances[meshId].end());
+	}
+
+	if (hasDeformers)
+	{
+		logger().warning(fmt::format("[MeshResource]: '{}' has skins or morph targets, which aren't imported from glTF yet.", path));
+	}
+
+	if (primitives.empty())
+	{
+		logger().error(fmt::format("[MeshResource]: The file '{}' doesn't contain any geometry.", path));
+		return false;
+	}
+
+	//-- Index buffers of indexed parts take the place of the triangulation buffer, the staging of packed tangents and colors comes on top.
+	auto& jobs = service<JobService>();
+	const size_t scratchSize = readMeshScratchSize(std::max(maxVertices, maxIndices), maxIndices, 0, 0) + maxVertices * 2 * sizeof(math::vec4);
+	utils::ArenaPool arenas(std::min(primitives.size(), jobs.numThreads() + 1), scratchSize);
+
+	parts.resize(primitives.size());
+	jobs.parallelFor(primitives.size(), [&parts, &primitives, &arenas, &settings](size_t partId)
+		{
+			ENGINE_CPU_ZONE_NAMED("MeshResource::readGlbPart");
+
+			auto arena = arenas.acquire();
+			readGlbPart(parts[partId], *arena, settings, primitives[partId]);
+		});
+
+	return true;
+}
+
+}
+
+std::string MeshResource::ImportSettings::key() const
+{
+	std::string key = fmt::format("{}|{}|{}|{}|{}|{}|{}|{}|{}|{}|{}|{}", optimizeGeometry, overdrawThreshold,
+		static_cast<uint32_t>(vertexFormat.tangentFrame), vertexFormat.halfUVs, vertexFormat.quantizedPositions, buildMeshlets, lodMaxError,
+		orientedBounds, weldPositionTolerance, weldNormalTolerance, weldUVTolerance, generateTangents);
+	for (float ratio : lodTriangleRatios)
+	{
+		key += fmt::format("|{}", ratio);
+	}
+	return key;
+}
+
+
+uint32_t MeshResource::ImportSettings::hash() const
+{
+	const std::string settingsKey = key();
+	return utils::fnv1a_32(settingsKey.data(), settingsKey.size());
+}
+
+
+UINT MeshResource::streamStride(const VertexFormat& format, Stream stream)
+{
+	switch (stream)
+	{
+	case Stream::Position:
+		return format.quantizedPositions ? 4 * sizeof(uint16_t) : sizeof(math::vec3);
+
+	case Stream::Tangent:
+		switch (format.tangentFrame)
+		{
+		case TangentFrame::Octahedral: return 2 * sizeof(int16_t);
+		case TangentFrame::QTangent: return 4 * sizeof(int16_t);
+		default: return sizeof(math::vec3);
+		}
+
+	case Stream::Bitangent:
+	case Stream::Normal:
+		switch (format.tangentFrame)
+		{
+		case TangentFrame::Octahedral: return 2 * sizeof(int16_t);
+		case TangentFrame::QTangent: return 0;
+		default: return sizeof(math::vec3);
+		}
+
+	case Stream::UV0:
+	case Stream::UV1:
+		return format.halfUVs ? 2 * sizeof(uint16_t) : sizeof(math::vec2);
+
+	case Stream::VertexColor:
+		return sizeof(uint32_t);
+
+	case Stream::BoneIndices:
+	case Stream::BoneWeights:
+		return format.skinned ? sizeof(uint32_t) : 0;
+
+	default:
+		ENGINE_FAIL("Unknown stream!");
+		return 0;
+	}
+}
+
+
+DXGI_FORMAT MeshResource::streamFormat(const VertexFormat& format, Stream stream)
+{
+	switch (stream)
+	{
+	case Stream::Position:
+		return format.quantizedPositions ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R32G32B32_FLOAT;
+
+	case Stream::Tangent:
+		switch (format.tangentFrame)
+		{
+		case TangentFrame::Octahedral: return DXGI_FORMAT_R16G16_SNORM;
+		case TangentFrame::QTangent: return DXGI_FORMAT_R16G16B16A16_SNORM;
+		default: return DXGI_FORMAT_R32G32B32_FLOAT;
+		}
+
+	case Stream::Bitangent:
+	case Stream::Normal:
+		//-- Streams missing in QTangent format are bound as null buffers, which read as zero.
+		return format.tangentFrame == TangentFrame::Octahedral ? DXGI_FORMAT_R16G16_SNORM : DXGI_FORMAT_R32G32B32_FLOAT;
+
+	case Stream::UV0:
+	case Stream::UV1:
+		return format.halfUVs ? DXGI_FORMAT_R16G16_FLOAT : DXGI_FORMAT_R32G32_FLOAT;
+
+	case Stream::VertexColor:
+		return DXGI_FORMAT_R8G8B8A8_UNORM;
+
+	case Stream::BoneIndices:
+		return DXGI_FORMAT_R8G8B8A8_UINT;
+
+	case Stream::BoneWeights:
+		return DXGI_FORMAT_R8G8B8A8_UNORM;
+
+	default:
+		ENGINE_FAIL("Unknown stream!");
+		return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+
+size_t MeshResource::selectLod(const Submesh& submesh, float pixelsPerUnit, float maxPixelError)
+{
+	//-- Errors only grow along the chain, so the first level over the threshold ends the search.
+	size_t result = 0;
+	for (size_t i = 1; i < submesh.lods.size(); ++i)
+	{
+		if (submesh.lods[i].error * pixelsPerUnit > maxPixelError)
+		{
+			break;
+		}
+		result = i;
+	}
+
+	return result;
+}
+
+
+MeshResource::InputLayout MeshResource::inputLayout(StreamMask shaderStreams) const
+{
+	static constexpr std::array<std::pair<const char*, UINT>, static_cast<size_t>(Stream::Count)> kSemantics =
+	{{
+		{ "POSITION", 0 },
+		{ "TANGENT", 0 },
+		{ "BITANGENT", 0 },
+		{ "NORMAL", 0 },
+		{ "TEXCOORD", 0 },
+		{ "TEXCOORD", 1 },
+		{ "COLOR", 0 },
+		{ "BLENDINDICES", 0 },
+		{ "BLENDWEIGHT", 0 }
+	}};
+
+	InputLayout layout;
+	const StreamMask streams = m_streamMask | shaderStreams;
+	for (size_t i = 0; i < static_cast<size_t>(Stream::Count); ++i)
+	{
+		if ((streams & streamBit(static_cast<Stream>(i))) == 0)
+		{
+			continue;
+		}
+
+		layout.elements[layout.numElements++] =
+		{
+			.SemanticName = kSemantics[i].first,
+			.SemanticIndex = kSemantics[i].second,
+			.Format = streamFormat(m_vertexFormat, static_cast<Stream>(i)),
+			.InputSlot = static_cast<UINT>(i),
+			.AlignedByteOffset = 0,
+			.InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
+			.InstanceDataStepRate = 0
+		};
+	}
+
+	return layout;
+}
+
+
+void MeshResource::load(std::string_view path, const ImportSettings& settings)
+{
+	ENGINE_CPU_ZONE;
+
+	auto& vfs = service<VFSService>();
+	auto& cache = service<CacheService>();
+	const std::string cookedPath = amesh::cookedPath(path);
+	const uint32_t settingsHash = settings.hash();
+
+	//-- Sources inside archives can't be mapped, packages ship the cooked files next to them instead, so these are tried first.
+	utils::MappedFile source;
+	if (!vfs.mapFile(path, source))
+	{
+		std::vector<uint8_t> cooked;
+		if (vfs.readFile(cookedPath, cooked) && loadCooked(cooked, settingsHash))
+		{
+			return;
+		}
+
+		logger().warning(fmt::format("[MeshResource]: The cooked file '{}' is missing, invalid or outdated. Reimport '{}'.", cookedPath, path));
+	}
+
+	//-- The cooked file next to the source is what packages ship. It's up to date if it's newer than the source,
+	//-- the same policy as AnimationResource::load has.
+	const std::filesystem::path absoluteCookedPath = vfs.absolutePath(cookedPath);
+	std::error_code sourceTimeError;
+	std::error_code cookedTimeError;
+	const auto sourceTime = std::filesystem::last_write_time(vfs.absolutePath(path), sourceTimeError);
+	const auto cookedTime = std::filesystem::last_write_time(absoluteCookedPath, cookedTimeError);
+	const bool cookedUpToDate = source.valid() && !sourceTimeError && !cookedTimeError && cookedTime >= sourceTime;
+
+	//-- Cooked data depends only on the source bytes, the settings and the importers, whose fixed options amesh::kVersion tracks.
+	//-- The path isn't a part of the key, so byte identical meshes share the entry.
+	std::filesystem::path entryPath;
+	if (source.valid() && cache.enabled())
+	{
+		ENGINE_CPU_ZONE_NAMED("MeshResource::lookupCache");
+
+		const auto key = utils::ContentHasher().update({ source.data(), source.size() }).update(settings.key()).update(amesh::kVersion).digest();
+		entryPath = cache.entryPath("meshes", key, amesh::kExtension);
+
+		utils::MappedFile entry;
+		if (entry.open(entryPath) && loadCooked({ entry.data(), entry.size() }, settingsHash))
+		{
+			logger().info(fmt::format("[MeshResource]: '{}' is loaded from the cache entry '{}'.", path, entryPath.filename().string()));
+
+			std::error_code error;
+			if (!cookedUpToDate && !std::filesystem::copy_file(entryPath, absoluteCookedPath, std::filesystem::copy_options::overwrite_existing, error))
+			{
+				logger().warning(fmt::format("[MeshResource]: Can't copy the cache entry of '{}' to '{}'.", path, cookedPath));
+			}
+			return;
+		}
+	}
+	source.close();
+
+	//-- A cache miss or a disabled cache falls back to the cooked file, which also fills a fresh cache.
+	if (cookedUpToDate)
+	{
+		utils::MappedFile cooked;
+		if (vfs.mapFile(cookedPath, cooked) && loadCooked({ cooked.data(), cooked.size() }, settingsHash))
+		{
+			std::error_code error;
+			if (!entryPath.empty() && !std::filesystem::copy_file(absoluteCookedPath, entryPath, std::filesystem::copy_options::overwrite_existing, error))
+			{
+				logger().warning(fmt::format("[MeshResource]: Can't add '{}' to the cache.", cookedPath));
+			}
+			return;
+		}
+
+		logger().warning(fmt::format("[MeshResource]: The cooked file '{}' is invalid or outdated. Reimport '{}'.", cookedPath, path));
+	}
+
+	MeshData data;
+	if (!import(path, settings, data))
+	{
+		m_status = Status::Failed;
+		return;
+	}
+
+	//-- Nothing above loaded the cooked file, so it's missing or stale. It's a copy of the cache entry if there is one.
+	const auto view = data.view();
+	std::error_code error;
+	const bool cached = !entryPath.empty() && amesh::write(entryPath, settingsHash, view);
+	if (cached ? !std::filesystem::copy_file(entryPath, absoluteCookedPath, std::filesystem::copy_options::overwrite_existing, error)
+		: !amesh::write(absoluteCookedPath, settingsHash, view))
+	{
+		logger().warning(fmt::format("[MeshResource]: Can't cook the mesh '{}'.", path));
+	}
+
+	createGPUResources(view);
+
+	m_status = Status::Ready;
+}
+
+
+void MeshResource::applyPose(const animation::Pose& pose)
+{
+	ENGINE_CPU_ZONE;
+
+	//-- The same single pass as in the load, parents precede their children.
+	const size_t numAnimated = std::min(pose.numTracks, m_nodes.size());
+	for (size_t i = 0; i < m_nodes.size(); ++i)
+	{
+		auto& node = m_nodes[i];
+		if (i < numAnimated)
+		{
+			node.nodeToParent = math::matrix::CreateScale(pose.scale(i)) * math::matrix::CreateFromQuaternion(pose.rotation(i))
+				* math::matrix::CreateTranslation(pose.translation(i));
+		}
+		node.nodeToWorld = node.parent >= 0 ? node.nodeToParent * m_nodes[node.parent].nodeToWorld : node.nodeToParent;
+		node.geometryToWorld = node.geometryToNode * node.nodeToWorld;
+	}
+
+	updateCombinedAABB();
+}
+
+
+void MeshResource::updateCombinedAABB()
+{
+	m_combinedAABB = math::AABB();
+	for (const auto& mesh : m_meshes)
+	{
+		for (uint32_t node : mesh.instances)
+		{
+			m_combinedAABB.extend(mesh::transformAABB(mesh.aabb, m_nodes[node].geometryToWorld));
+		}
+	}
+}
+
+
+void MeshResource::writeInstanceTransforms(std::span<math::matrix> destination) const
+{
+	ENGINE_ASSERT_DEBUG(destination.size() >= m_numInstances, "Not enough room for the instance transforms!");
+
+	for (const auto& mesh : m_meshes)
+	{
+		for (size_t i = 0; i < mesh.instances.size(); ++i)
+		{
+			destination[mesh.firstInstance + i] = m_nodes[mesh.instances[i]].geometryToWorld;
+		}
+	}
+}
+
+
+void MeshResource::blendVertices(const Submesh& submesh, std::span<const float> weights, std::span<uint8_t> positions, std::span<uint8_t> normals)
+{
+	ENGINE_CPU_ZONE;
+
+	const size_t numVertices = submesh.basePositions.size();
+	ENGINE_ASSERT_DEBUG(positions.size() >= numVertices * streamStride(m_vertexFormat, Stream::Position), "Not enough room for the positions!");
+	ENGINE_ASSERT_DEBUG(submesh.baseNormals.empty() || normals.size() >= numVertices * streamStride(m_vertexFormat, normalStream(m_vertexFormat)),
+		"Not enough room for the normals!");
+
+	m_blendedPositions.assign(submesh.basePositions.begin(), submesh.basePositions.end());
+	m_blendedNormals.assign(submesh.baseNormals.begin(), submesh.baseNormals.end());
+	animation::applyBlendShapes(submesh.blendShapes, weights, m_blendedPositions, m_blendedNormals);
+
+	if (m_vertexFormat.quantizedPositions)
+	{
+		mesh::quantizePositions(reinterpret_cast<uint16_t*>(positions.data()), m_blendedPositions, submesh.aabb);
+	}
+	else
+	{
+		memcpy(positions.data(), m_blendedPositions.data(), numVertices * sizeof(math::vec3));
+	}
+
+	if (m_blendedNormals.empty())
+	{
+		return;
+	}
+
+	//-- The deltas don't keep normals unit length. The compact encoders normalize them anyway.
+	switch (m_vertexFormat.tangentFrame)
+	{
+	case TangentFrame::Octahedral:
+		mesh::encodeOctahedral(reinterpret_cast<int16_t*>(normals.data()), m_blendedNormals);
+		break;
+
+	case TangentFrame::QTangent:
+		mesh::encodeQTangents(reinterpret_cast<int16_t*>(normals.data()), submesh.baseTangents, submesh.baseBitangents, m_blendedNormals);
+		break;
+
+	default:
+		for (math::vec3& normal : m_blendedNormals)
+		{
+			const float length = normal.Length();
+			normal = length > 0.0f ? normal / length : normal;
+		}
+		memcpy(normals.data(), m_blendedNormals.data(), numVertices * sizeof(math::vec3));
+		break;
+	}
+}
+
+
+bool MeshResource::loadCooked(std::span<const uint8_t> bytes, uint32_t settingsHash)
+{
+	ENGINE_CPU_ZONE;
+
+	MeshDataView view;
+	if (!amesh::read(bytes, settingsHash, view))
+	{
+		return false;
+	}
+
+	//-- The view points into the file data, so copy it to the upload buffers before it's released.
+	createGPUResources(view);
+
+	m_status = Status::Ready;
+	return true;
+}
+
+
+bool MeshResource::import(std::string_view path, const ImportSettings& settings, MeshData& data)
+{
+	ENGINE_CPU_ZONE;
+
+	//-- Step 1. Read: importers fill the scene description and read every part into its own storage.
+	std::vector<PartData> parts;
+	std::string extension = std::filesystem::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+	bool imported = false;
+	if (extension == ".obj")
+	{
+		imported = importObj(path, settings, parts);
+	}
+	else if (extension == ".glb")
+	{
+		imported = importGlb(path, settings, data, parts);
+	}
+	else
+	{
+		imported = importFbx(path, settings, data, parts);
+	}
+	if (!imported)
+	{
+		return false;
+	}
+	logPartStatistics(parts, path, settings);
+
+	//-- Step 2. Emit: place the parts into the combined buffers.
+	emitParts(data, parts);
+
+	//-- Step 3. Levels of detail and meshlets are built from the float positions, so before the conversion to the vertex format.
+	//-- Meshlets cover only the full detail.
+	if (!settings.lodTriangleRatios.empty())
+	{
+		generateLods(data, settings, path);
+	}
+
+	if (settings.buildMeshlets)
+	{
+		buildMeshlets(data);
+	}
+
+	//-- Step 4. Convert to the requested vertex format.
+	if (settings.vertexFormat != VertexFormat())
+	{
+		VertexFormat format = settings.vertexFormat;
+		format.skinned = data.vertexFormat.skinned;
+		quantizeStreams(data, format);
+	}
+
+	if (!data.blendShapes.empty())
+	{
+		logger().info(fmt::format("[MeshResource]: '{}' blend shapes: {} targets of {} channels, {} deltas, {} KiB.", path, data.blendShapes.size(),
+			data.blendChannelWeights.size(), data.blendShapeVertices.size(),
+			data.blendShapeVertices.size() * (sizeof(uint32_t) + 2 * sizeof(math::vec3)) / 1024));
+	}
+
+	return true;
+}
+
+
+void MeshResource::createGPUResources(const MeshDataView& data)
+{
+	ENGINE_CPU_ZONE;
+
+	//-- ToDo: Remove it and use proper API.
+	auto* d3d12Backend = static_cast<render::d3d12::Backend*>(service<RenderService>().backend());
+	auto* device = d3d12Backend->device();
+
+	D3D12_HEAP_PROPERTIES heapProps =
+	{
+		.Type = D3D12_HEAP_TYPE_UPLOAD,
+		.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+		.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
+		.CreationNodeMask = 1,
+		.VisibleNodeMask = 1
+	};
+
+	D3D12_RESOURCE_DESC bufferDesc =
+	{
+		.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
+		.Width = 0,
+		.Height = 1,
+		.DepthOrArraySize = 1,
+		.MipLevels = 1,
+		.Format = DXGI_FORMAT_UNKNOWN,
+		.SampleDesc = {.Count = 1, .Quality = 0},
+		.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+		.Flags = D3D12_RESOURCE_FLAG_NONE
+	};
+
+	m_uploads.clear();
+
+	auto emptyRange = CD3DX12_RANGE(0, 0);
+	auto createBuffer = [&](std::span<const uint8_t> bytes, Buffer& uploadBuffer, Buffer& buffer, D3D12_RESOURCE_STATES state)
+		{
+			bufferDesc.Width = bytes.size();
+
+			//-- Upload buffer.
+			heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
+			assertIfFailed(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+				D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&uploadBuffer)));
+
+			//-- Usual stream.
+			heapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
+			assertIfFailed(device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc,
+				D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&buffer)));
+
+			void* memory = nullptr;
+			assertIfFailed(uploadBuffer->Map(0, &emptyRange, &memory));
+			memcpy(memory, bytes.data(), bytes.size());
+			uploadBuffer->Unmap(0, nullptr);
+
+			m_uploads.push_back({ .source = uploadBuffer.Get(), .destination = buffer.Get(), .size = bytes.size(), .state = state });
+		};
+
+	m_vertexFormat = data.vertexFormat;
+
+	//-- Stream buffers. Streams which the mesh doesn't have or the vertex format doesn't store are left without buffers.
+	m_streamMask = 0;
+	for (size_t i = 0; i < static_cast<size_t>(MeshResource::Stream::Count); ++i)
+	{
+		m_streamsSize[i] = data.streams[i].size();
+		if (data.streams[i].empty())
+		{
+			m_uploadBuffers[i].Reset();
+			m_streams[i].Reset();
+			continue;
+		}
+
+		createBuffer(data.streams[i], m_uploadBuffers[i], m_streams[i], D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+		m_streamMask |= streamBit(static_cast<Stream>(i));
+	}
+
+	//-- Index buffers. Every submesh moves all its levels of detail to the buffer of its index format, so the ranges are rebased.
+	std::vector<std::vector<Lod>> lods(data.submeshes.size());
+	std::vector<IndexFormat> indexFormats(data.submeshes.size());
+	{
+		static constexpr size_t kMaxR16Vertices = size_t(1) << 16;
+
+		std::array<std::vector<uint8_t>, static_cast<size_t>(IndexFormat::Count)> indexBytes;
+		for (size_t submeshId = 0; submeshId < data.submeshes.size(); ++submeshId)
+		{
+			const auto& desc = data.submeshes[submeshId];
+			auto& submeshLods = lods[submeshId];
+
+			//-- Files cooked without levels of detail still get the full detail one.
+			if (desc.numLods == 0)
+			{
+				submeshLods.push_back({ .numIndices = desc.numIndices, .startIndex = desc.startIndex, .error = 0.0f });
+			}
+			for (const auto& lod : data.lods.subspan(desc.lodOffset, desc.numLods))
+			{
+				submeshLods.push_back({ .numIndices = lod.numIndices, .startIndex = lod.startIndex, .error = lod.error });
+			}
+
+			const IndexFormat format = desc.numVertices <= kMaxR16Vertices ? IndexFormat::R16 : IndexFormat::R32;
+			indexFormats[submeshId] = format;
+
+			auto& bytes = indexBytes[static_cast<size_t>(format)];
+			for (auto& lod : submeshLods)
+			{
+				const auto indices = data.indices.subspan(lod.startIndex, lod.numIndices);
+				const size_t offset = bytes.size();
+				if (format == IndexFormat::R16)
+				{
+					lod.startIndex = static_cast<uint32_t>(offset / sizeof(uint16_t));
+					bytes.resize(offset + indices.size() * sizeof(uint16_t));
+					auto* destination = reinterpret_cast<uint16_t*>(bytes.data() + offset);
+					for (size_t i = 0; i < indices.size(); ++i)
+					{
+						destination[i] = static_cast<uint16_t>(indices[i]);
+					}
+				}
+				else
+				{
+					lod.startIndex = static_cast<uint32_t>(offset / sizeof(uint32_t));
+					bytes.resize(offset + indices.size_bytes());
+					memcpy(bytes.data() + offset, indices.data(), indices.size_bytes());
+				}
+			}
+		}
+
+		for (size_t i = 0; i < indexBytes.size(); ++i)
+		{
+			m_indexBuffersSize[i] = indexBytes[i].size();
+			m_uploadIndexBuffers[i].Reset();
+			m_indexBuffers[i].Reset();
+			if (!indexBytes[i].empty())
+			{
+				createBuffer(indexBytes[i], m_uploadIndexBuffers[i], m_indexBuffers[i], D3D12_RESOURCE_STATE_INDEX_BUFFER);
+			}
+		}
+	}
+
+	//-- Meshlet buffers.
+	{
+		const std::array<std::span<const std::byte>, static_cast<size_t>(MeshletBuffer::Count)> meshletBytes =
+		{
+			std::as_bytes(data.meshlets),
+			std::as_bytes(data.meshletBounds),
+			std::as_bytes(data.meshletVertices),
+			std::as_bytes(data.meshletTriangles)
+		};
+
+		for (size_t i = 0; i < meshletBytes.size(); ++i)
+		{
+			m_meshletUploadBuffers[i].Reset();
+			m_meshletBuffers[i].Reset();
+			if (!meshletBytes[i].empty())
+			{
+				createBuffer({ reinterpret_cast<const uint8_t*>(meshletBytes[i].data()), meshletBytes[i].size() }, m_meshletUploadBuffers[i],
+					m_meshletBuffers[i], D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+			}
+		}
+	}
+
+	//-- Hierarchy and instances. World transforms are accumulated in a single pass, parents precede their children.
+	m_nodes.resize(data.nodes.size());
+	for (size_t i = 0; i < data.nodes.size(); ++i)
+	{
+		const auto& desc = data.nodes[i];
+		auto& node = m_nodes[i];
+		node.parent = desc.parent;
+		node.nodeToParent = desc.nodeToParent;
+		node.geometryToNode = desc.geometryToNode;
+		node.nodeToWorld = desc.parent >= 0 ? desc.nodeToParent * m_nodes[desc.parent].nodeToWorld : desc.nodeToParent;
+		node.geometryToWorld = desc.geometryToNode * node.nodeToWorld;
+	}
+
+	m_meshes.clear();
+	m_meshes.reserve(data.meshes.size());
+	std::vector<math::matrix> instanceTransforms;
+	instanceTransforms.reserve(data.meshInstances.size());
+	//-- Data without a hierarchy is a single mesh drawn once at the origin.
+	if (data.meshes.empty())
+	{
+		if (m_nodes.empty())
+		{
+			m_nodes.push_back({ .parent = -1 });
+		}
+		auto& mesh = m_meshes.emplace_back();
+		mesh.numSubmeshes = static_cast<uint32_t>(data.submeshes.size());
+		mesh.instances = { 0 };
+		for (const auto& desc : data.submeshes)
+		{
+			mesh.aabb.extend(desc.aabb);
+		}
+		instanceTransforms.push_back(m_nodes.front().geometryToWorld);
+	}
+	for (const auto& desc : data.meshes)
+	{
+		auto& mesh = m_meshes.emplace_back();
+		mesh.firstSubmesh = desc.submeshOffset;
+		mesh.numSubmeshes = desc.numSubmeshes;
+		for (const auto& submesh : data.submeshes.subspan(desc.submeshOffset, desc.numSubmeshes))
+		{
+			mesh.aabb.extend(submesh.aabb);
+		}
+		mesh.instances.assign(data.meshInstances.begin() + desc.instanceOffset, data.meshInstances.begin() + desc.instanceOffset + desc.numInstances);
+		mesh.firstInstance = static_cast<uint32_t>(instanceTransforms.size());
+		mesh.instanceTransforms = instanceTransforms.size() * sizeof(math::matrix); //-- Offset until the buffer is created.
+		for (uint32_t node : mesh.instances)
+		{
+			instanceTransforms.push_back(m_nodes[node].geometryToWorld);
+		}
+	}
+
+	m_numInstances = instanceTransforms.size();
+	m_instanceUploadBuffer.Reset();
+	m_instanceBuffer.Reset();
+	if (!instanceTransforms.empty())
+	{
+		const auto bytes = std::as_bytes(std::span(instanceTransforms));
+		createBuffer({ reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size() }, m_instanceUploadBuffer, m_instanceBuffer,
+			D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		for (auto& mesh : m_meshes)
+		{
+			mesh.instanceTransforms += m_instanceBuffer->GetGPUVirtualAddress();
+		}
+	}
+
+	//-- Blend shapes. The view may point into a file which is released after the load, so the deltas are copied.
+	m_blendShapeVertices.assign(data.blendShapeVertices.begin(), data.blendShapeVertices.end());
+	m_blendShapePositionDeltas.assign(data.blendShapePositionDeltas.begin(), data.blendShapePositionDeltas.end());
+	m_blendShapeNormalDeltas.assign(data.blendShapeNormalDeltas.begin(), data.blendShapeNormalDeltas.end());
+	m_blendChannelWeights.assign(data.blendChannelWeights.begin(), data.blendChannelWeights.end());
+
+	//-- Base positions of submeshes with blend shapes, decoded the same way as the vertex shader does,
+	//-- and base normals of the ones whose targets change normals.
+	const Stream normalStreamId = normalStream(m_vertexFormat);
+	const auto& normalStreamData = data.streams[static_cast<size_t>(normalStreamId)];
+	auto blendsNormals = [&data, &normalStreamData](const SubmeshDesc& desc)
+		{
+			const auto blendShapes = data.blendShapes.subspan(desc.blendShapeOffset, desc.numBlendShapes);
+			return !normalStreamData.empty()
+				&& std::any_of(blendShapes.begin(), blendShapes.end(), [](const BlendShapeDesc& blendShape) { return blendShape.hasNormals; });
+		};
+	size_t numBasePositions = 0;
+	size_t numBaseNormals = 0;
+	for (const auto& desc : data.submeshes)
+	{
+		numBasePositions += desc.numBlendShapes > 0 ? desc.numVertices : 0;
+		numBaseNormals += blendsNormals(desc) ? desc.numVertices : 0;
+	}
+	const bool qtangents = m_vertexFormat.tangentFrame == TangentFrame::QTangent;
+	m_blendShapeBasePositions.resize(numBasePositions);
+	m_blendShapeBaseNormals.resize(numBaseNormals);
+	m_blendShapeBaseTangents.resize(qtangents ? numBaseNormals : 0);
+	m_blendShapeBaseBitangents.resize(qtangents ? numBaseNormals : 0);
+	numBasePositions = 0;
+	numBaseNormals = 0;
+
+	//-- Views.
+	m_subMeshes.clear();
+	m_subMeshes.reserve(data.submeshes.size());
+	for (size_t submeshId = 0; submeshId < data.submeshes.size(); ++submeshId)
+	{
+		const auto& desc = data.submeshes[submeshId];
+		auto& submesh = m_subMeshes.emplace_back();
+		auto& renderPart = submesh.renderPart;
+
+		for (size_t i = 0; i < static_cast<size_t>(MeshResource::Stream::Count); ++i)
+		{
+			//-- A zeroed view binds a null buffer.
+			renderPart.streamViews[i] = {};
+			if (m_streams[i])
+			{
+				renderPart.streamViews[i] =
+				{
+					.BufferLocation = m_streams[i]->GetGPUVirtualAddress(),
+					.SizeInBytes = static_cast<UINT>(m_streamsSize[i]),
+					.StrideInBytes = streamStride(m_vertexFormat, static_cast<MeshResource::Stream>(i))
+				};
+			}
+		}
+
+		const size_t indexFormat = static_cast<size_t>(indexFormats[submeshId]);
+		renderPart.indexBufferView =
+		{
+			.BufferLocation = m_indexBuffers[indexFormat]->GetGPUVirtualAddress(),
+			.SizeInBytes = static_cast<UINT>(m_indexBuffersSize[indexFormat]),
+			.Format = indexFormats[submeshId] == IndexFormat::R16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT
+		};
+
+		submesh.lods = std::move(lods[submeshId]);
+		submesh.bones.reserve(desc.numBones);
+		for (const auto& bone : data.bones.subspan(desc.boneOffset, desc.numBones))
+		{
+			submesh.bones.push_back({ .node = bone.node, .geometryToBone = bone.geometryToBone });
+		}
+		submesh.blendShapes.reserve(desc.numBlendShapes);
+		for (const auto& blendShape : data.blendShapes.subspan(desc.blendShapeOffset, desc.numBlendShapes))
+		{
+			const std::span<const math::vec3> normalDeltas(m_blendShapeNormalDeltas);
+			submesh.blendShapes.push_back({
+				.channel = blendShape.channel,
+				.vertices = std::span<const uint32_t>(m_blendShapeVertices).subspan(blendShape.deltaOffset, blendShape.numDeltas),
+				.positionDeltas = std::span<const math::vec3>(m_blendShapePositionDeltas).subspan(blendShape.deltaOffset, blendShape.numDeltas),
+				.normalDeltas = blendShape.hasNormals ? normalDeltas.subspan(blendShape.deltaOffset, blendShape.numDeltas) : std::span<const math::vec3>()
+			});
+		}
+		if (desc.numBlendShapes > 0)
+		{
+			const std::span<math::vec3> positions(m_blendShapeBasePositions.data() + numBasePositions, desc.numVertices);
+			const auto& stream = data.streams[static_cast<size_t>(Stream::Position)];
+			if (m_vertexFormat.quantizedPositions)
+			{
+				const auto* quantized = reinterpret_cast<const uint16_t*>(stream.data()) + desc.baseVertex * 4;
+				const math::vec3 scale = (desc.aabb.m_max - desc.aabb.m_min) / 65535.0f;
+				for (size_t i = 0; i < positions.size(); ++i)
+				{
+					positions[i] = math::vec3(quantized[i * 4], quantized[i * 4 + 1], quantized[i * 4 + 2]) * scale + desc.aabb.m_min;
+				}
+			}
+			else
+			{
+				memcpy(positions.data(), stream.data() + desc.baseVertex * sizeof(math::vec3), positions.size_bytes());
+			}
+			submesh.basePositions = positions;
+			numBasePositions += positions.size();
+		}
+		if (blendsNormals(desc))
+		{
+			const std::span<math::vec3> normals(m_blendShapeBaseNormals.data() + numBaseNormals, desc.numVertices);
+			const size_t offset = desc.baseVertex * streamStride(m_vertexFormat, normalStreamId);
+			switch (m_vertexFormat.tangentFrame)
+			{
+			case TangentFrame::Octahedral:
+				mesh::decodeOctahedral(normals, reinterpret_cast<const int16_t*>(normalStreamData.data() + offset));
+				break;
+
+			case TangentFrame::QTangent:
+			{
+				const std::span<math::vec3> tangents(m_blendShapeBaseTangents.data() + numBaseNormals, desc.numVertices);
+				const std::span<math::vec3> bitangents(m_blendShapeBaseBitangents.data() + numBaseNormals, desc.numVertices);
+				mesh::decodeQTangents(tangents, bitangents, normals, reinterpret_cast<const int16_t*>(normalStreamData.data() + offset));
+				submesh.baseTangents = tangents;
+				submesh.baseBitangents = bitangents;
+				break;
+			}
+
+			default:
+				memcpy(normals.data(), normalStreamData.data() + offset, normals.size_bytes());
+				break;
+			}
+			submesh.baseNormals = normals;
+			numBaseNormals += normals.size();
+		}
+		renderPart.numVertices = desc.numVertices;
+		renderPart.numIndices = submesh.lods.front().numIndices;
+		renderPart.startIndex = submesh.lods.front().startIndex;
+		renderPart.baseVertex = desc.baseVertex;
+		if (m_vertexFormat.quantizedPositions)
+		{
+			renderPart.positionScale = desc.aabb.m_max - desc.aabb.m_min;
+			renderPart.positionOffset = desc.aabb.m_min;
+		}
+
+		if (desc.numMeshlets > 0)
+		{
+			auto address = [this](MeshletBuffer buffer, size_t offset)
+				{
+					return m_meshletBuffers[static_cast<size_t>(buffer)]->GetGPUVirtualAddress() + offset;
+				};
+
+			auto& meshletPart = submesh.meshletPart;
+			meshletPart.meshlets = address(MeshletBuffer::Meshlets, desc.meshletOffset * sizeof(mesh::Meshlet));
+			meshletPart.bounds = address(MeshletBuffer::Bounds, desc.meshletOffset * sizeof(mesh::MeshletBounds));
+			meshletPart.vertices = address(MeshletBuffer::Vertices, 0);
+			meshletPart.triangles = address(MeshletBuffer::Triangles, 0);
+			meshletPart.numMeshlets = desc.numMeshlets;
+		}
+
+		submesh.aabb = desc.aabb;
+		submesh.sphere = desc.sphere;
+		submesh.obb = desc.obb;
+	}
+
+	//-- The same as updateCombinedAABB gives for the nodes of the file.
+	m_combinedAABB = data.combinedAABB;
 }
 
 } //-- engine::resources.
@@ -2,6 +2,10 @@
 
 #include <engine/resources/resource.h>
 #include <engine/math/aabb.h>
+#include <engine/math/obb.h>
+#include <engine/math/sphere.h>
+#include <engine/resources/animation/animation_clip.h>
+#include <engine/resources/animation/blend_shapes.h>
 
 //-- TODO: RECONSIDER LATER.
 #include <engine/integration/d3d12/integration.h>
@@ -9,6 +13,9 @@
 namespace engine::resources
 {
 
+struct MeshData;
+struct MeshDataView;
+
 class MeshResource : public IResource
 {
 public:
@@ -21,9 +28,16 @@ public:
 		UV0,
 		UV1,
 		VertexColor,
+		BoneIndices, //-- Four 8-bit indices in the bone palette of the submesh.
+		BoneWeights, //-- Four 8-bit UNORM weights which sum up to one.
 		Count
 	};
 
+	//-- A bit per stream, see streamBit.
+	using StreamMask = uint16_t;
+	static constexpr StreamMask streamBit(Stream stream) { return static_cast<StreamMask>(1u << static_cast<uint32_t>(stream)); }
+
+	//-- Strides of the float streams. Importers produce them in this format, compact formats are converted afterwards.
 	inline static constexpr std::array<UINT, static_cast<size_t>(Stream::Count)> kStreamSizes = {
 		sizeof(math::vec3), //-- position
 		sizeof(math::vec3), //-- tangent
@@ -32,6 +46,44 @@ public:
 		sizeof(math::vec2), //-- uv0
 		sizeof(math::vec2), //-- uv1
 		sizeof(uint32_t), //-- color
+		sizeof(uint32_t), //-- bone indices
+		sizeof(uint32_t), //-- bone weights
+	};
+
+	enum class TangentFrame : uint8_t
+	{
+		Float, //-- float3 tangent, bitangent and normal.
+		Octahedral, //-- Octahedral 16-bit SNORM tangent, bitangent and normal.
+		QTangent, //-- A single quaternion in the tangent stream, the bitangent and normal streams are empty.
+		Count
+	};
+
+	//-- Layout of the streams in the GPU buffers.
+	struct VertexFormat
+	{
+		TangentFrame tangentFrame = TangentFrame::Float;
+		bool halfUVs = false;
+		//-- 16-bit positions relative to the AABB of the submesh. See RenderRepresentation::positionScale.
+		bool quantizedPositions = false;
+		//-- Bone streams are stored. It's set by the import if any part of the mesh is skinned and ignored in the import settings.
+		bool skinned = false;
+
+		bool operator==(const VertexFormat&) const = default;
+	};
+	static_assert(sizeof(VertexFormat) == 4, "VertexFormat is stored in cooked files as is!");
+
+	inline static constexpr VertexFormat kCompactVertexFormat = { .tangentFrame = TangentFrame::QTangent, .halfUVs = true, .quantizedPositions = true };
+
+	//-- Zero stride means the stream isn't stored in this format.
+	static UINT streamStride(const VertexFormat& format, Stream stream);
+	//-- The stream which holds the normals in this format, the quaternion of QTangents or the normal stream.
+	static Stream normalStream(const VertexFormat& format) { return format.tangentFrame == TangentFrame::QTangent ? Stream::Tangent : Stream::Normal; }
+	static DXGI_FORMAT streamFormat(const VertexFormat& format, Stream stream);
+
+	struct InputLayout
+	{
+		std::array<D3D12_INPUT_ELEMENT_DESC, static_cast<size_t>(Stream::Count)> elements;
+		UINT numElements = 0;
 	};
 
 	struct RenderRepresentation
@@ -43,33 +95,219 @@ public:
 		uint32_t numIndices = 0;
 		uint32_t startIndex = 0;
 		uint32_t baseVertex = 0;
+
+		//-- Dequantization of positions: `position * positionScale + positionOffset`.
+		math::vec3 positionScale = math::vec3(1.0f, 1.0f, 1.0f);
+		math::vec3 positionOffset = math::vec3(0.0f, 0.0f, 0.0f);
+	};
+
+	//-- Structured buffers for the amplification and mesh shaders, see mesh::MeshletData.
+	//-- Meshlets address vertices and triangles by absolute offsets, vertex indices are relative to RenderRepresentation::baseVertex.
+	struct MeshletRepresentation
+	{
+		D3D12_GPU_VIRTUAL_ADDRESS meshlets = 0; //-- The first meshlet of the submesh.
+		D3D12_GPU_VIRTUAL_ADDRESS bounds = 0; //-- Bounds of the first meshlet of the submesh.
+		D3D12_GPU_VIRTUAL_ADDRESS vertices = 0;
+		D3D12_GPU_VIRTUAL_ADDRESS triangles = 0;
+		uint32_t numMeshlets = 0;
+	};
+
+	//-- A level of detail shares the streams and the index buffer of the submesh, only the index range differs.
+	struct Lod
+	{
+		uint32_t numIndices = 0;
+		uint32_t startIndex = 0;
+		float error = 0.0f; //-- Object space deviation from the full detail.
+	};
+
+	//-- An entry of the bone palette of a submesh, the bone streams index it.
+	struct Bone
+	{
+		uint32_t node = 0; //-- Index of the bone node in nodes(), the same as the track in animation clips of the scene.
+		math::matrix geometryToBone; //-- Inverse bind matrix.
 	};
 
 	struct Submesh
 	{
 		RenderRepresentation renderPart;
+		MeshletRepresentation meshletPart;
+		//-- From the full detail to the coarsest one, never empty.
+		std::vector<Lod> lods;
+		//-- Empty if the submesh isn't skinned.
+		std::vector<Bone> bones;
+		//-- Sparse targets over the vertices of the submesh, see animation::applyBlendShapes. They point into the mesh storage.
+		std::vector<animation::BlendShapeTarget> blendShapes;
+		//-- Float positions of the bind pose which the targets are added to, empty if the submesh has no blend shapes.
+		//-- They point into the mesh storage.
+		std::span<const math::vec3> basePositions;
+		//-- Float normals of the bind pose, empty if no target changes normals or the mesh has none. QTangents are rebuilt
+		//-- around the blended normals, so they also keep the tangents and the bitangents, which are empty in other formats.
+		std::span<const math::vec3> baseNormals;
+		std::span<const math::vec3> baseTangents;
+		std::span<const math::vec3> baseBitangents;
+		//-- Bounds of the submesh in the space of its mesh. They cover every blend of its targets.
 		math::AABB aabb;
+		math::Sphere sphere;
+		math::OBB obb;
 	};
 	using Submeshes = std::vector<Submesh>;
 
+	//-- A node of the scene hierarchy. A parent always precedes its children.
+	struct Node
+	{
+		int32_t parent = -1;
+		math::matrix nodeToParent;
+		math::matrix geometryToNode;
+		math::matrix nodeToWorld;
+		math::matrix geometryToWorld; //-- Places the geometry of meshes instanced by the node.
+	};
+
+	//-- A mesh of the scene is uploaded once and drawn instanced by all nodes which refer to it.
+	struct Mesh
+	{
+		uint32_t firstSubmesh = 0;
+		uint32_t numSubmeshes = 0;
+		math::AABB aabb; //-- Of all submeshes in the space of the mesh.
+		std::vector<uint32_t> instances; //-- Nodes of the instances.
+		uint32_t firstInstance = 0; //-- Of the mesh in the transforms of all instances, see writeInstanceTransforms.
+		//-- geometryToWorld of every instance as a structured buffer of row-major matrices, indexed by SV_InstanceID.
+		D3D12_GPU_VIRTUAL_ADDRESS instanceTransforms = 0;
+	};
+
+	struct ImportSettings
+	{
+		//-- Reorder triangles for the post-transform vertex cache and overdraw, then vertices for linear fetching.
+		bool optimizeGeometry = true;
+		//-- How much the overdraw pass may degrade ACMR of the vertex cache optimized order.
+		float overdrawThreshold = 1.05f;
+		VertexFormat vertexFormat = kCompactVertexFormat;
+		bool buildMeshlets = true;
+		//-- Triangle ratios of the generated levels of detail relative to the full detail, in the descending order.
+		//-- Empty disables the generation.
+		std::vector<float> lodTriangleRatios = { 0.5f, 0.25f, 0.125f };
+		//-- The largest error of a level relative to the diagonal of the submesh AABB. The chain ends earlier if it's reached.
+		float lodMaxError = 0.05f;
+		//-- Fit oriented boxes along the principal axes of submeshes, otherwise they are equal to the AABBs.
+		bool orientedBounds = true;
+		//-- Attributes are snapped to grids of these steps to weld corners into vertices. Zero welds only equal bits.
+		//-- Positions are in meters, tangent frame components and UVs are unitless.
+		float weldPositionTolerance = 0.00001f;
+		float weldNormalTolerance = 0.0001f;
+		float weldUVTolerance = 0.00001f;
+		//-- Generate the tangent frames of parts which have normals and UVs but no tangents.
+		bool generateTangents = true;
+
+		//-- All fields which affect the result, formatted explicitly, so neither padding nor the layout of the struct matter.
+		std::string key() const;
+		//-- Cooked files store it to detect that they were produced with other settings.
+		uint32_t hash() const;
+	};
+
 public:
 	~MeshResource() = default;
 
-	void load(std::string_view path);
+	//-- Loads the cooked version of the mesh if it's up to date, otherwise imports the source asset and cooks it.
+	void load(std::string_view path, const ImportSettings& settings = {});
+
+	const VertexFormat& vertexFormat() const { return m_vertexFormat; }
+	bool skinned() const { return m_vertexFormat.skinned; }
+	//-- Streams which have buffers. The others aren't stored at all and their views bind null buffers.
+	StreamMask streamMask() const { return m_streamMask; }
+	const std::vector<Node>& nodes() const { return m_nodes; }
+	const std::vector<Mesh>& meshes() const { return m_meshes; }
+	//-- Instances of all meshes.
+	size_t numInstances() const { return m_numInstances; }
+	//-- World bounds of all instances of all meshes at the current node transforms.
+	const math::AABB& combinedAABB() const { return m_combinedAABB; }
+	//-- Moves the nodes to the local transforms of the pose, tracks of animation clips of the scene follow nodes().
+	//-- Nodes past the tracks of the pose keep their transforms. The instance buffer isn't updated, see writeInstanceTransforms.
+	void applyPose(const animation::Pose& pose);
+	//-- geometryToWorld of the current node transforms of all instances in the layout of Mesh::instanceTransforms.
+	void writeInstanceTransforms(std::span<math::matrix> destination) const;
+	//-- Default weights of all blend channels of the scene, the channels of blend shape targets index them.
+	std::span<const float> blendChannelWeights() const { return m_blendChannelWeights; }
+	//-- Adds the targets of the submesh weighted by the blend channel weights to its base positions and normals and writes
+	//-- the results in the vertex format. positions has room for all vertices of the submesh, so does normals in the layout
+	//-- of normalStream if the submesh has base normals. Tangents of the float and octahedral formats keep the bind pose.
+	void blendVertices(const Submesh& submesh, std::span<const float> weights, std::span<uint8_t> positions, std::span<uint8_t> normals);
+	//-- Picks the coarsest level whose error stays below maxPixelError on the screen.
+	//-- pixelsPerUnit is the projected size of one object space unit at the distance of the submesh.
+	static size_t selectLod(const Submesh& submesh, float pixelsPerUnit, float maxPixelError = 1.0f);
+	//-- Input layout of the stored streams and the ones the shader reads in the vertex format of the loaded mesh.
+	//-- Streams which the shader reads but the mesh doesn't store are fed from null buffers, which read as zero.
+	//-- Semantic names are static strings.
+	InputLayout inputLayout(StreamMask shaderStreams) const;
+
+private:
+	bool loadCooked(std::span<const uint8_t> bytes, uint32_t settingsHash);
+	bool import(std::string_view path, const ImportSettings& settings, MeshData& data);
+	void createGPUResources(const MeshDataView& data);
+	void updateCombinedAABB();
 
 public:
 	using Buffer = Microsoft::WRL::ComPtr<ID3D12Resource>;
+
+	//-- Indices are relative to the base vertex, so submeshes with up to 65536 vertices are drawn from the R16 buffer.
+	enum class IndexFormat : uint8_t
+	{
+		R16,
+		R32,
+		Count
+	};
+
+	enum class MeshletBuffer : uint8_t
+	{
+		Meshlets,
+		Bounds,
+		Vertices,
+		Triangles,
+		Count
+	};
+
+	//-- Copies from the upload buffers which have to be recorded before the mesh is used.
+	struct Upload
+	{
+		ID3D12Resource* source = nullptr;
+		ID3D12Resource* destination = nullptr;
+		UINT64 size = 0;
+		D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON; //-- The state after the copy.
+	};
+
 	//-- Store all streams of each type in a separated combined buffer.
 	std::array<Buffer, static_cast<size_t>(Stream::Count)> m_streams;
 	std::array<Buffer, static_cast<size_t>(Stream::Count)> m_uploadBuffers; //-- ToDo: Reconsider later. It should be part of Backend/ResourceManager/something else.
 	std::array<UINT64, static_cast<size_t>(Stream::Count)> m_streamsSize; //-- ToDo: Reconsider later. It should be part of Backend/ResourceManager/something else.
-	//-- Store all indices of all submeshes in one combined buffer.
-	Buffer m_indexBuffer;
-	Buffer m_uploadIndexBuffer; //-- ToDo: Get rid off. See m_uploadBuffers.
-	UINT64 m_indexBufferSize;
+	//-- Store all indices of all submeshes in one combined buffer per index format.
+	std::array<Buffer, static_cast<size_t>(IndexFormat::Count)> m_indexBuffers;
+	std::array<Buffer, static_cast<size_t>(IndexFormat::Count)> m_uploadIndexBuffers; //-- ToDo: Get rid off. See m_uploadBuffers.
+	std::array<UINT64, static_cast<size_t>(IndexFormat::Count)> m_indexBuffersSize;
+	//-- Meshlets of all submeshes. Empty if meshlets aren't built.
+	std::array<Buffer, static_cast<size_t>(MeshletBuffer::Count)> m_meshletBuffers;
+	std::array<Buffer, static_cast<size_t>(MeshletBuffer::Count)> m_meshletUploadBuffers; //-- ToDo: See m_uploadBuffers.
+	//-- Transforms of the instances of all meshes.
+	Buffer m_instanceBuffer;
+	Buffer m_instanceUploadBuffer; //-- ToDo: See m_uploadBuffers.
+	std::vector<Upload> m_uploads;
 
 	std::vector<Submesh> m_subMeshes;
-	math::AABB m_combinedAABB; //-- ToDo: Or jsut calc it every time?
+	std::vector<Node> m_nodes;
+	std::vector<Mesh> m_meshes;
+	size_t m_numInstances = 0;
+	//-- Blend shape deltas of all submeshes. They are evaluated on the CPU, so they stay in memory.
+	std::vector<uint32_t> m_blendShapeVertices;
+	std::vector<math::vec3> m_blendShapePositionDeltas;
+	std::vector<math::vec3> m_blendShapeNormalDeltas;
+	std::vector<float> m_blendChannelWeights;
+	std::vector<math::vec3> m_blendShapeBasePositions;
+	std::vector<math::vec3> m_blendShapeBaseNormals;
+	std::vector<math::vec3> m_blendShapeBaseTangents;
+	std::vector<math::vec3> m_blendShapeBaseBitangents;
+	//-- Scratch of blendVertices.
+	std::vector<math::vec3> m_blendedPositions;
+	std::vector<math::vec3> m_blendedNormals;
+	VertexFormat m_vertexFormat;
+	StreamMask m_streamMask = 0;
+	math::AABB m_combinedAABB;
 };
 
 using MeshResourcePtr = std::shared_ptr<MeshResource>;
@@ -26,6 +26,12 @@ public:
 
 	//-- Releases internal memory. You may call it after using this data.
 	virtual void release() = 0;
+
+	//-- Grows every time the shaders are reloaded, so pipeline states made of the older ones can be recreated.
+	uint32_t version() const { return m_version; }
+
+protected:
+	uint32_t m_version = 0;
 };
 
 using ShaderResourcePtr = std::shared_ptr<ShaderResource>;
@@ -0,0 +1,62 @@
+#include <engine/services/cache_service.h>
+#include <engine/helpers.h>
+#include <engine/reflection/registration.h>
+#include <engine/services/cli_service.h>
+
+namespace engine
+{
+
+namespace
+{
+
+META_REGISTRATION
+{
+	reflection::Service<CacheService>("CacheService")
+		.cli({ "--cacheFolder", "-noCache", "-purgeCache" });
+}
+
+} //-- unnamed.
+
+
+bool CacheService::initialize()
+{
+	auto& cli = service<CLIService>().parser();
+
+	std::string folder;
+	cli("--cacheFolder", "cache") >> folder;
+	m_folder = std::filesystem::absolute(folder);
+	m_enabled = !cli["-noCache"];
+
+	std::error_code error;
+	if (cli["-purgeCache"])
+	{
+		const auto removed = std::filesystem::remove_all(m_folder, error);
+		if (error)
+		{
+			logger().warning(fmt::format("[CacheService]: Can't purge '{}'. Error: {}", m_folder.string(), error.message()));
+		}
+		else
+		{
+			logger().info(fmt::format("[CacheService]: Purged '{}', {} entries removed.", m_folder.string(), removed));
+		}
+	}
+
+	logger().info(fmt::format("[CacheService]: {} '{}'", m_enabled ? "Cache folder" : "Bypassed cache folder", m_folder.string()));
+
+	return true;
+}
+
+
+std::filesystem::path CacheService::entryPath(std::string_view kind, const utils::ContentHash& key, std::string_view extension) const
+{
+	std::filesystem::path path = m_folder / kind;
+
+	std::error_code error;
+	std::filesystem::create_directories(path, error);
+
+	path /= key.toString();
+	path += extension;
+	return path;
+}
+
+} //-- engine.
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <engine/services/service_manager.h>
+#include <engine/utils/content_hash.h>
+
+namespace engine
+{
+
+//-- Local cache of cooked resources keyed by content hashes of their sources, see utils::ContentHasher.
+//-- Entries are files `<folder>/<kind>/<hash><extension>`, so they outlive runs and byte identical sources share them.
+class CacheService final : public Service<CacheService>
+{
+public:
+	CacheService() = default;
+	~CacheService() = default;
+
+	bool initialize();
+
+	//-- False if the cache is bypassed, then resources are cooked every time and nothing is stored.
+	bool enabled() const { return m_enabled; }
+	//-- Absolute path of the entry. The folder of the kind is created on demand.
+	std::filesystem::path entryPath(std::string_view kind, const utils::ContentHash& key, std::string_view extension) const;
+
+private:
+	std::filesystem::path m_folder;
+	bool m_enabled = true;
+};
+
+} //-- engine.
@@ -0,0 +1,42 @@
+#include <engine/services/job_service.h>
+#include <engine/helpers.h>
+#include <engine/reflection/registration.h>
+#include <engine/services/cli_service.h>
+
+namespace engine
+{
+
+namespace
+{
+
+META_REGISTRATION
+{
+	reflection::Service<JobService>("JobService")
+		.cli({ "--jobThreads" });
+}
+
+} //-- unnamed.
+
+
+bool JobService::initialize()
+{
+	auto& cli = service<CLIService>().parser();
+
+	//-- By default leave one core for the main thread.
+	const size_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	size_t numThreads = hardwareThreads - 1;
+	cli("--jobThreads", numThreads) >> numThreads;
+
+	m_pool = std::make_unique<utils::ThreadPool>(numThreads);
+	logger().info(fmt::format("[JobService]: {} worker threads", numThreads));
+
+	return true;
+}
+
+
+void JobService::release()
+{
+	m_pool.reset();
+}
+
+} //-- engine.
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <engine/services/service_manager.h>
+#include <engine/utils/thread_pool.h>
+
+namespace engine
+{
+
+//-- Owns the pool of worker threads which is shared by CPU heavy systems (resource import, etc).
+class JobService final : public Service<JobService>
+{
+public:
+	JobService() = default;
+	~JobService() = default;
+
+	bool initialize();
+	void release() override;
+
+	size_t numThreads() const { return m_pool->numThreads(); }
+
+	template<typename Fn>
+	auto submit(Fn&& fn)
+	{
+		return m_pool->submit(std::forward<Fn>(fn));
+	}
+
+	//-- Calls fn(i) for every i in [0, count) in parallel and waits for the result.
+	void parallelFor(size_t count, const std::function<void(size_t)>& fn)
+	{
+		m_pool->parallelFor(count, fn);
+	}
+
+private:
+	std::unique_ptr<utils::ThreadPool> m_pool;
+};
+
+} //-- engine.
@@ -0,0 +1,425 @@
+#include <engine/services/shader_compiler_service.h>
+#include <engine/assert.h>
+#include <engine/helpers.h>
+#include <engine/reflection/registration.h>
+#include <engine/render/d3d12/shader_compiler.h>
+#include <engine/services/cli_service.h>
+#include <engine/services/job_service.h>
+#include <engine/services/vfs_service.h>
+
+namespace engine::render
+{
+
+namespace
+{
+
+inline constexpr std::string_view kShaderFolder = "/shaders";
+
+META_REGISTRATION
+{
+	reflection::Service<ShaderCompilerService>("ShaderCompilerService")
+		.cli({ "-noShaderHotReload" });
+}
+
+} //-- unnamed.
+
+
+ShaderCompilerService::ShaderCompilerService() = default;
+
+
+ShaderCompilerService::~ShaderCompilerService() = default;
+
+
+bool ShaderCompilerService::initialize()
+{
+	auto& cli = service<CLIService>().parser();
+
+	if (!m_includeCache.initialize(kShaderFolder))
+	{
+		logger().error(fmt::format("[ShaderCompilerService]: Can't resolve the shader folder '{}'.", kShaderFolder));
+		return false;
+	}
+
+	//-- Jobs run on the workers, or on the calling thread if there are none. Stages of a job are compiled by parallelFor
+	//-- from within the job, so they take the worker of the job and never add a thread.
+	const size_t numCompilers = std::max(service<JobService>().numThreads(), size_t(1));
+	m_compilers.reserve(numCompilers);
+	for (size_t i = 0; i < numCompilers; ++i)
+	{
+		auto compiler = std::make_unique<d3d12::ShaderCompiler>(m_includeCache);
+		if (!compiler->initialize())
+		{
+			logger().error("[ShaderCompilerService]: Can't initialize a shader compiler.");
+			return false;
+		}
+
+		m_idle.push_back(compiler.get());
+		m_compilers.push_back(std::move(compiler));
+	}
+
+	logger().info(fmt::format("[ShaderCompilerService]: {} shader compilers", numCompilers));
+
+	//-- Only native folders can be watched, shaders inside archives don't change anyway.
+	if (!cli["-noShaderHotReload"])
+	{
+		const std::string folder = service<VFSService>().absolutePath(kShaderFolder);
+		if (m_watcher.watch(folder))
+		{
+			logger().info(fmt::format("[ShaderCompilerService]: Hot reload of shaders in '{}'", folder));
+		}
+		else
+		{
+			logger().warning(fmt::format("[ShaderCompilerService]: Can't watch '{}', hot reload of shaders is disabled.", folder));
+		}
+	}
+
+	return true;
+}
+
+
+void ShaderCompilerService::release()
+{
+	//-- Queued jobs still use the compilers.
+	{
+		std::unique_lock lock(m_mutex);
+		m_condition.wait(lock, [this]() { return m_numPending == 0; });
+	}
+
+	m_reloads.clear();
+	m_shaders.clear();
+	m_watcher.close();
+	m_idle.clear();
+	m_compilers.clear();
+}
+
+
+template<typename Fn>
+auto ShaderCompilerService::submit(Fn&& fn) -> std::future<std::invoke_result_t<Fn>>
+{
+	using Result = std::invoke_result_t<Fn>;
+
+	auto& jobs = service<JobService>();
+
+	//-- Without workers the job is compiled right away.
+	if (jobs.numThreads() == 0)
+	{
+		std::promise<Result> result;
+		result.set_value(fn());
+		return result.get_future();
+	}
+
+	{
+		std::lock_guard lock(m_mutex);
+		++m_numPending;
+	}
+
+	return jobs.submit([this, fn = std::forward<Fn>(fn)]()
+		{
+			auto result = fn();
+			{
+				std::lock_guard lock(m_mutex);
+				--m_numPending;
+			}
+			m_condition.notify_all();
+
+			return result;
+		});
+}
+
+
+void ShaderCompilerService::tick()
+{
+	if (!m_watcher.valid())
+	{
+		return;
+	}
+
+	ENGINE_CPU_ZONE;
+
+	std::lock_guard lock(m_shadersMutex);
+
+	//-- Finished reloads. Resources are swapped here, between frames, so a frame never mixes old and new stages.
+	std::vector<uint32_t> dirty;
+	for (auto it = m_reloads.begin(); it != m_reloads.end();)
+	{
+		if (it->build.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		Build result = it->build.get();
+		const uint32_t id = it->id;
+		it = m_reloads.erase(it);
+
+		auto shader = m_shaders.find(id);
+		if (shader == m_shaders.end())
+		{
+			continue;
+		}
+
+		auto& tracked = shader->second;
+		tracked.reloading = false;
+		if (tracked.dirty)
+		{
+			tracked.dirty = false;
+			dirty.push_back(id);
+		}
+
+		auto resource = tracked.resource.lock();
+		if (!resource)
+		{
+			continue;
+		}
+
+		if (result.resource->ready())
+		{
+			resource->swap(*result.resource);
+			resource->setStatus(resources::IResource::Status::Ready);
+			tracked.dependencies = std::move(result.dependencies);
+			logger().info(fmt::format("[ShaderCompilerService]: The shader '{}' is reloaded.", tracked.request.path));
+		}
+		else
+		{
+			//-- Includes of the broken build are watched too, so fixing them reloads the shader.
+			for (auto& dependency : result.dependencies)
+			{
+				if (std::find(tracked.dependencies.begin(), tracked.dependencies.end(), dependency) == tracked.dependencies.end())
+				{
+					tracked.dependencies.push_back(std::move(dependency));
+				}
+			}
+			logger().error(fmt::format("[ShaderCompilerService]: Can't reload the shader '{}', the previous one is kept.", tracked.request.path));
+		}
+	}
+
+	const auto changes = m_watcher.poll();
+	std::vector<std::string> changed;
+	changed.reserve(changes.size());
+	for (const auto& path : changes)
+	{
+		m_includeCache.invalidate(path);
+		changed.push_back(ShaderIncludeCache::normalize(path));
+	}
+
+	for (auto it = m_shaders.begin(); it != m_shaders.end();)
+	{
+		auto& [id, shader] = *it;
+		if (shader.resource.expired() && !shader.reloading)
+		{
+			it = m_shaders.erase(it);
+			continue;
+		}
+
+		const bool affected = std::find(dirty.begin(), dirty.end(), id) != dirty.end()
+			|| std::any_of(shader.dependencies.begin(), shader.dependencies.end(), [&changed](const std::string& dependency)
+				{
+					return std::find(changed.begin(), changed.end(), dependency) != changed.end();
+				});
+
+		if (affected)
+		{
+			if (shader.reloading)
+			{
+				shader.dirty = true;
+			}
+			else
+			{
+				reload(id, shader);
+			}
+		}
+		++it;
+	}
+}
+
+
+std::vector<std::future<resources::ShaderResourcePtr>> ShaderCompilerService::compile(std::span<const Job> jobs)
+{
+	std::vector<std::future<resources::ShaderResourcePtr>> results;
+	results.reserve(jobs.size());
+	for (const Job& job : jobs)
+	{
+		results.push_back(schedule({ .path = job.path, .stage = job.stage, .defines = job.defines }));
+	}
+
+	return results;
+}
+
+
+std::future<resources::ShaderResourcePtr> ShaderCompilerService::compile(std::string_view path, std::vector<std::string> defines)
+{
+	return schedule({ .path = std::string(path), .stage = std::nullopt, .defines = std::move(defines) });
+}
+
+
+bool ShaderCompilerService::prescan(std::string_view path, ShaderPrescan& result)
+{
+	d3d12::ShaderCompiler::Blob blob;
+	std::string absolutePath;
+	return d3d12::ShaderCompiler::readSource(path, blob, absolutePath)
+		&& ShaderPrescan::scan({ reinterpret_cast<const char*>(blob.data()), blob.size() }, absolutePath, m_includeCache, result);
+}
+
+
+std::future<resources::ShaderResourcePtr> ShaderCompilerService::schedule(Request request)
+{
+	return submit([this, request = std::move(request)]() -> resources::ShaderResourcePtr
+		{
+			ENGINE_CPU_ZONE_NAMED("ShaderCompilerService::compile");
+
+			logger().info(fmt::format("[ShaderCompilerService]: load the shader '{}'", request.path));
+
+			Build result = build(request);
+			track(request, result);
+
+			return result.resource;
+		});
+}
+
+
+ShaderCompilerService::Build ShaderCompilerService::build(const Request& request)
+{
+	Build result;
+	result.resource = std::make_shared<d3d12::ShaderResource>();
+
+	d3d12::ShaderCompiler::Blob blob;
+	std::string absolutePath;
+	if (!d3d12::ShaderCompiler::readSource(request.path, blob, absolutePath))
+	{
+		return result;
+	}
+
+	//-- Includes found by the prescan are watched even if the compiler doesn't open them, e.g. in disabled branches.
+	ShaderPrescan prescan;
+	const bool scanned = ShaderPrescan::scan({ reinterpret_cast<const char*>(blob.data()), blob.size() }, absolutePath, m_includeCache, prescan);
+	result.dependencies = prescan.files;
+	if (!scanned)
+	{
+		return result;
+	}
+
+	//-- Compile only the entry points which the source defines.
+	const ShaderPrescan::Stages requestedStages = request.stage ? ShaderPrescan::Stages().set(static_cast<uint8_t>(*request.stage)) : prescan.stages;
+	std::array<Stage, static_cast<size_t>(Stage::Count)> stages;
+	size_t numStages = 0;
+	for (uint8_t i = 0; i < static_cast<uint8_t>(Stage::Count); ++i)
+	{
+		if (!requestedStages.test(i))
+		{
+			continue;
+		}
+
+		if (!prescan.stages.test(i))
+		{
+			logger().error(fmt::format("[ShaderCompilerService]: The shader '{}' doesn't define the entry point of the requested stage.", request.path));
+			return result;
+		}
+
+		//-- The attribute may come from a macro, so the compiler has the last word.
+		const auto stage = static_cast<Stage>(i);
+		const bool threadGroups = stage == Stage::Compute || stage == Stage::Amplification || stage == Stage::Mesh;
+		if (threadGroups && prescan.entryPoints[i].numThreads.empty())
+		{
+			logger().warning(fmt::format("[ShaderCompilerService]: An entry point of '{}' has no [numthreads] attribute.", request.path));
+		}
+		stages[numStages++] = stage;
+	}
+
+	if (numStages == 0)
+	{
+		logger().error(fmt::format("[ShaderCompilerService]: The shader '{}' doesn't include any entry points (vs_main, ps_main, cs_main, as_main, ms_main)", request.path));
+		return result;
+	}
+
+	//-- Stages write different blobs of the resource.
+	std::array<std::vector<d3d12::shader_cache::Include>, static_cast<size_t>(Stage::Count)> includes;
+	std::atomic<bool> compiled = true;
+	std::atomic<size_t> numSkipped = 0;
+	service<JobService>().parallelFor(numStages, [&](size_t i)
+		{
+			auto& compiler = acquireCompiler();
+			if (!compiler.compile(blob, absolutePath, prescan, stages[i], request.defines, *result.resource))
+			{
+				compiled = false;
+			}
+			else if (compiler.skipped())
+			{
+				++numSkipped;
+			}
+			includes[i] = compiler.includes();
+			releaseCompiler(compiler);
+		});
+
+	for (size_t i = 0; i < numStages; ++i)
+	{
+		for (auto& include : includes[i])
+		{
+			if (std::find(result.dependencies.begin(), result.dependencies.end(), include.path) == result.dependencies.end())
+			{
+				result.dependencies.push_back(std::move(include.path));
+			}
+		}
+	}
+
+	//-- Requested stages are never skipped quietly, and neither are all stages of the file.
+	if (compiled && numSkipped == numStages)
+	{
+		logger().error(fmt::format("[ShaderCompilerService]: The preprocessor removes all requested entry points of the shader '{}'.", request.path));
+		compiled = false;
+	}
+
+	if (compiled)
+	{
+		result.resource->setStatus(resources::IResource::Status::Ready);
+	}
+
+	return result;
+}
+
+
+void ShaderCompilerService::track(const Request& request, const Build& build)
+{
+	//-- Failed shaders are tracked too, so fixing them loads them.
+	if (!m_watcher.valid())
+	{
+		return;
+	}
+
+	std::lock_guard lock(m_shadersMutex);
+	m_shaders.emplace(m_nextShaderId++, TrackedShader{ .request = request, .resource = build.resource, .dependencies = build.dependencies });
+}
+
+
+void ShaderCompilerService::reload(uint32_t id, TrackedShader& shader)
+{
+	logger().info(fmt::format("[ShaderCompilerService]: reload the shader '{}'", shader.request.path));
+
+	shader.reloading = true;
+	m_reloads.push_back({ .id = id, .build = submit([this, request = shader.request]()
+		{
+			return build(request);
+		}) });
+}
+
+
+d3d12::ShaderCompiler& ShaderCompilerService::acquireCompiler()
+{
+	std::unique_lock lock(m_mutex);
+	m_condition.wait(lock, [this]() { return !m_idle.empty(); });
+
+	auto* compiler = m_idle.back();
+	m_idle.pop_back();
+	return *compiler;
+}
+
+
+void ShaderCompilerService::releaseCompiler(d3d12::ShaderCompiler& compiler)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_idle.push_back(&compiler);
+	}
+	m_condition.notify_all();
+}
+
+} //-- engine::render.
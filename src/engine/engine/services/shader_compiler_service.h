@@ -0,0 +1,110 @@
+#pragma once
+
+#include <engine/services/service_manager.h>
+#include <engine/render/shader_include_cache.h>
+#include <engine/render/shader_prescan.h>
+#include <engine/resources/shader_resource.h>
+#include <engine/utils/file_watcher.h>
+
+namespace engine::render
+{
+
+namespace d3d12
+{
+class ShaderCompiler;
+class ShaderResource;
+} //-- d3d12.
+
+//-- Compiles shaders on the workers of JobService. A compiler isn't thread safe, so the service owns one per worker,
+//-- or a single one if jobs run on the calling thread, and every job borrows an idle one for the time of compiling.
+//-- Compiled shaders are tracked with the files they are built from. When one of these changes, the affected shaders
+//-- are recompiled in the background and their resources take the new bytecode on the main thread.
+class ShaderCompilerService final : public Service<ShaderCompilerService>
+{
+public:
+	using Stage = resources::ShaderResource::Type;
+
+	struct Job
+	{
+		std::string path;
+		Stage stage = Stage::Vertex;
+		std::vector<std::string> defines; //-- "NAME" or "NAME=VALUE".
+	};
+
+public:
+	ShaderCompilerService();
+	~ShaderCompilerService();
+
+	bool initialize();
+	void release() override;
+
+	void tick() override;
+
+	//-- Compiles the jobs concurrently. The resource of every job has only the stage of the job and is Ready or Failed.
+	std::vector<std::future<resources::ShaderResourcePtr>> compile(std::span<const Job> jobs);
+	//-- Compiles all stages of the file concurrently. The resource is Ready if all of them are compiled,
+	//-- stages whose entry points the preprocessor removes are left out.
+	std::future<resources::ShaderResourcePtr> compile(std::string_view path, std::vector<std::string> defines = {});
+
+	//-- Reads the file and scans it without compiling, see ShaderPrescan. Blocking, any thread may call it.
+	bool prescan(std::string_view path, ShaderPrescan& result);
+
+private:
+	//-- What to compile, kept for reloading.
+	struct Request
+	{
+		std::string path;
+		std::optional<Stage> stage; //-- All stages of the file if empty.
+		std::vector<std::string> defines;
+	};
+
+	struct Build
+	{
+		std::shared_ptr<d3d12::ShaderResource> resource;
+		std::vector<std::string> dependencies; //-- The source and all its includes, see ShaderIncludeCache::normalize.
+	};
+
+	struct TrackedShader
+	{
+		Request request;
+		std::weak_ptr<d3d12::ShaderResource> resource;
+		std::vector<std::string> dependencies;
+		bool reloading = false;
+		bool dirty = false; //-- Changed again while reloading.
+	};
+
+	struct Reload
+	{
+		uint32_t id = 0;
+		std::future<Build> build;
+	};
+
+	std::future<resources::ShaderResourcePtr> schedule(Request request);
+	Build build(const Request& request);
+	void track(const Request& request, const Build& build);
+	void reload(uint32_t id, TrackedShader& shader);
+
+	template<typename Fn>
+	auto submit(Fn&& fn) -> std::future<std::invoke_result_t<Fn>>;
+
+	//-- Waits for an idle compiler, so any number of threads may compile.
+	d3d12::ShaderCompiler& acquireCompiler();
+	void releaseCompiler(d3d12::ShaderCompiler& compiler);
+
+private:
+	ShaderIncludeCache m_includeCache;
+	std::vector<std::unique_ptr<d3d12::ShaderCompiler>> m_compilers;
+	std::vector<d3d12::ShaderCompiler*> m_idle;
+	size_t m_numPending = 0;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+
+	//-- Hot reload. Shaders are tracked from the workers, reloads are started and finished on the main thread.
+	utils::FileWatcher m_watcher;
+	std::unordered_map<uint32_t, TrackedShader> m_shaders;
+	uint32_t m_nextShaderId = 0;
+	std::mutex m_shadersMutex;
+	std::vector<Reload> m_reloads;
+};
+
+} //-- engine::render.
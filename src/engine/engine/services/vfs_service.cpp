@@ -58,6 +58,24 @@ bool VFSService::initialize(const Engine::Config::VFSParams& params)
 }
 
 
+bool VFSService::readFile(std::string_view relativePath, std::vector<uint8_t>& bytes)
+{
+	ENGINE_CPU_ZONE;
+
+	auto file = openFile(relativePath);
+	if (!file || !file->IsOpened())
+	{
+		return false;
+	}
+
+	//-- A single read, so archives decompress the file in one go.
+	bytes.resize(file->Size());
+	bytes.resize(file->Read(bytes.data(), bytes.size()));
+
+	return !bytes.empty();
+}
+
+
 void VFSService::release()
 {
 	m_vfs.reset();
@@ -2,6 +2,7 @@
 
 #include <engine/engine.h>
 #include <engine/services/service_manager.h>
+#include <engine/utils/mapped_file.h>
 #include <vfspp/VFS.h>
 
 namespace engine
@@ -28,6 +29,15 @@ public:
 		return m_vfs->OpenFile(vfspp::FileInfo(std::string(relativePath)), mode);
 	}
 
+	//-- Maps a file of a native file system in place. Files inside archives can't be mapped, read them with openFile.
+	inline bool mapFile(std::string_view relativePath, utils::MappedFile& file) const
+	{
+		return file.open(absolutePath(relativePath));
+	}
+
+	//-- Reads the whole file into memory. Works for every file system, so it is the fallback for mapFile.
+	bool readFile(std::string_view relativePath, std::vector<uint8_t>& bytes);
+
 private:
 	vfspp::VirtualFileSystemPtr m_vfs;
 };
@@ -0,0 +1,58 @@
+#include <engine/utils/content_hash.h>
+#include <engine/assert.h>
+
+#include <xxhash.h>
+
+namespace engine::utils
+{
+
+std::string ContentHash::toString() const
+{
+	return fmt::format("{:016x}{:016x}", high, low);
+}
+
+
+ContentHasher::ContentHasher()
+	: m_state(XXH3_createState())
+{
+	ENGINE_ASSERT(m_state, "Can't allocate the hash state!");
+	XXH3_128bits_reset(m_state);
+}
+
+
+ContentHasher::~ContentHasher()
+{
+	XXH3_freeState(m_state);
+}
+
+
+ContentHasher& ContentHasher::update(std::span<const uint8_t> bytes)
+{
+	XXH3_128bits_update(m_state, bytes.data(), bytes.size());
+	return *this;
+}
+
+
+ContentHasher& ContentHasher::update(std::string_view text)
+{
+	//-- The length separates consecutive strings, so "ab" + "c" and "a" + "bc" differ.
+	update(static_cast<uint32_t>(text.size()));
+	XXH3_128bits_update(m_state, text.data(), text.size());
+	return *this;
+}
+
+
+ContentHasher& ContentHasher::update(uint32_t value)
+{
+	XXH3_128bits_update(m_state, &value, sizeof(value));
+	return *this;
+}
+
+
+ContentHash ContentHasher::digest() const
+{
+	const XXH128_hash_t hash = XXH3_128bits_digest(m_state);
+	return { .low = hash.low64, .high = hash.high64 };
+}
+
+} //-- engine::utils.
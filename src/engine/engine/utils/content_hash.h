@@ -0,0 +1,38 @@
+#pragma once
+
+#include <engine/utils/noncopyable.h>
+
+struct XXH3_state_s;
+
+namespace engine::utils
+{
+
+//-- 128-bit XXH3 digest. Wide enough to key caches by the content alone, so equal files share entries.
+struct ContentHash
+{
+	uint64_t low = 0;
+	uint64_t high = 0;
+
+	bool operator==(const ContentHash&) const = default;
+	//-- 32 hex digits, usable as a file name.
+	std::string toString() const;
+};
+
+//-- Streaming XXH3, so large files and the settings they are processed with are hashed without concatenating them.
+class ContentHasher : public NonCopyable
+{
+public:
+	ContentHasher();
+	~ContentHasher();
+
+	ContentHasher& update(std::span<const uint8_t> bytes);
+	ContentHasher& update(std::string_view text);
+	ContentHasher& update(uint32_t value);
+
+	ContentHash digest() const;
+
+private:
+	XXH3_state_s* m_state = nullptr;
+};
+
+} //-- engine::utils.
@@ -0,0 +1,229 @@
+#include <engine/utils/file_watcher.h>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace engine::utils
+{
+
+struct FileWatcher::Impl
+{
+	std::filesystem::path folder;
+#if defined(_WIN32)
+	//-- A single overlapped read is always in flight, the OS fills the buffer until it's polled.
+	bool read()
+	{
+		return ReadDirectoryChangesW(directory, buffer.data(), static_cast<DWORD>(buffer.size()), TRUE,
+			FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE, nullptr, &overlapped, nullptr);
+	}
+
+	HANDLE directory = INVALID_HANDLE_VALUE;
+	OVERLAPPED overlapped = {};
+	alignas(DWORD) std::array<uint8_t, 64 * 1024> buffer;
+#else
+	//-- inotify isn't recursive, every folder has its own watch.
+	void add(const std::filesystem::path& path)
+	{
+		const int watch = inotify_add_watch(fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (watch >= 0)
+		{
+			folders[watch] = path;
+		}
+
+		std::error_code error;
+		for (std::filesystem::recursive_directory_iterator it(path, error), end; !error && it != end; it.increment(error))
+		{
+			if (it->is_directory(error))
+			{
+				const int subfolderWatch = inotify_add_watch(fd, it->path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+				if (subfolderWatch >= 0)
+				{
+					folders[subfolderWatch] = it->path();
+				}
+			}
+		}
+	}
+
+	int fd = -1;
+	std::unordered_map<int, std::filesystem::path> folders;
+#endif
+};
+
+
+FileWatcher::FileWatcher() = default;
+
+
+FileWatcher::FileWatcher(FileWatcher&& other) noexcept = default;
+
+
+FileWatcher& FileWatcher::operator=(FileWatcher&& other) noexcept
+{
+	if (this != &other)
+	{
+		close();
+		m_impl = std::move(other.m_impl);
+	}
+
+	return *this;
+}
+
+
+FileWatcher::~FileWatcher()
+{
+	close();
+}
+
+
+bool FileWatcher::watch(const std::filesystem::path& folder)
+{
+	close();
+
+	auto impl = std::make_unique<Impl>();
+	impl->folder = std::filesystem::absolute(folder).lexically_normal();
+
+#if defined(_WIN32)
+	impl->directory = CreateFileW(impl->folder.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (impl->directory == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	impl->overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	if (impl->overlapped.hEvent == nullptr || !impl->read())
+	{
+		if (impl->overlapped.hEvent)
+		{
+			CloseHandle(impl->overlapped.hEvent);
+		}
+		CloseHandle(impl->directory);
+		return false;
+	}
+#else
+	impl->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (impl->fd < 0)
+	{
+		return false;
+	}
+
+	impl->add(impl->folder);
+	if (impl->folders.empty())
+	{
+		::close(impl->fd);
+		return false;
+	}
+#endif
+
+	m_impl = std::move(impl);
+	return true;
+}
+
+
+void FileWatcher::close()
+{
+	if (!m_impl)
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	//-- The buffer must outlive the cancelled read.
+	DWORD bytes = 0;
+	CancelIoEx(m_impl->directory, &m_impl->overlapped);
+	GetOverlappedResult(m_impl->directory, &m_impl->overlapped, &bytes, TRUE);
+	CloseHandle(m_impl->overlapped.hEvent);
+	CloseHandle(m_impl->directory);
+#else
+	::close(m_impl->fd);
+#endif
+
+	m_impl.reset();
+}
+
+
+std::vector<std::filesystem::path> FileWatcher::poll()
+{
+	std::vector<std::filesystem::path> changes;
+	if (!m_impl)
+	{
+		return changes;
+	}
+
+#if defined(_WIN32)
+	DWORD bytes = 0;
+	if (!GetOverlappedResult(m_impl->directory, &m_impl->overlapped, &bytes, FALSE))
+	{
+		if (GetLastError() != ERROR_IO_INCOMPLETE)
+		{
+			m_impl->read();
+		}
+		return changes;
+	}
+
+	//-- Zero bytes means the buffer overflowed and the changes are lost.
+	for (DWORD offset = 0; bytes > 0;)
+	{
+		const auto& info = *reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(m_impl->buffer.data() + offset);
+		if (info.Action == FILE_ACTION_ADDED || info.Action == FILE_ACTION_MODIFIED || info.Action == FILE_ACTION_RENAMED_NEW_NAME)
+		{
+			const std::wstring_view name(info.FileName, info.FileNameLength / sizeof(WCHAR));
+			changes.push_back((m_impl->folder / name).lexically_normal());
+		}
+
+		if (info.NextEntryOffset == 0)
+		{
+			break;
+		}
+		offset += info.NextEntryOffset;
+	}
+
+	m_impl->read();
+#else
+	alignas(inotify_event) std::array<char, 16 * 1024> buffer;
+	while (true)
+	{
+		const ssize_t length = ::read(m_impl->fd, buffer.data(), buffer.size());
+		if (length <= 0)
+		{
+			break;
+		}
+
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const auto& event = *reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+			offset += static_cast<ssize_t>(sizeof(inotify_event) + event.len);
+
+			const auto folder = m_impl->folders.find(event.wd);
+			if (folder == m_impl->folders.end() || event.len == 0)
+			{
+				continue;
+			}
+
+			const auto path = (folder->second / event.name).lexically_normal();
+			if (event.mask & IN_ISDIR)
+			{
+				//-- Files of new folders are reported from now on.
+				if (event.mask & (IN_CREATE | IN_MOVED_TO))
+				{
+					m_impl->add(path);
+				}
+			}
+			else if (event.mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+			{
+				changes.push_back(path);
+			}
+		}
+	}
+#endif
+
+	std::sort(changes.begin(), changes.end());
+	changes.erase(std::unique(changes.begin(), changes.end()), changes.end());
+
+	return changes;
+}
+
+} //-- engine::utils.
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <engine/utils/noncopyable.h>
+
+namespace engine::utils
+{
+
+//-- Reports files changed inside a folder and its subfolders. It doesn't block and has no threads of its own,
+//-- changes are collected by the OS between polls: ReadDirectoryChangesW on Windows and inotify on Linux.
+class FileWatcher : public NonCopyable
+{
+public:
+	FileWatcher();
+	FileWatcher(FileWatcher&& other) noexcept;
+	FileWatcher& operator=(FileWatcher&& other) noexcept;
+	~FileWatcher();
+
+	bool watch(const std::filesystem::path& folder);
+	void close();
+
+	bool valid() const { return m_impl != nullptr; }
+
+	//-- Absolute lexically normal paths of files written, created or renamed since the last poll, without duplicates.
+	std::vector<std::filesystem::path> poll();
+
+private:
+	struct Impl;
+
+	std::unique_ptr<Impl> m_impl;
+};
+
+} //-- engine::utils.
@@ -0,0 +1,119 @@
+#include <engine/utils/linear_arena.h>
+#include <engine/assert.h>
+
+namespace engine::utils
+{
+
+LinearArena::Statistics& LinearArena::Statistics::operator+=(const Statistics& other)
+{
+	allocations += other.allocations;
+	heapAllocations += other.heapAllocations;
+	peakBytes += other.peakBytes;
+	return *this;
+}
+
+
+LinearArena::LinearArena(size_t capacity)
+{
+	reserve(capacity);
+}
+
+
+void LinearArena::reserve(size_t capacity)
+{
+	m_overflow.clear();
+	m_overflowBytes = 0;
+	m_offset = 0;
+
+	if (capacity > m_capacity)
+	{
+		m_block = std::make_unique_for_overwrite<std::byte[]>(capacity);
+		m_capacity = capacity;
+		++m_statistics.heapAllocations;
+	}
+}
+
+
+void LinearArena::reset()
+{
+	//-- Grow geometrically, so the block catches up with the peak usage (plus alignment padding) in a couple of rounds.
+	if (!m_overflow.empty())
+	{
+		reserve(std::max(used(), m_capacity * 2));
+	}
+
+	m_offset = 0;
+}
+
+
+void* LinearArena::allocate(size_t size, size_t alignment)
+{
+	ENGINE_ASSERT_DEBUG(alignment > 0 && (alignment & (alignment - 1)) == 0, "Alignment must be a power of two!");
+
+	++m_statistics.allocations;
+
+	//-- Align the address, the block itself is aligned only to the default new alignment.
+	const auto base = reinterpret_cast<uintptr_t>(m_block.get());
+	const size_t offset = ((base + m_offset + alignment - 1) & ~(alignment - 1)) - base;
+	if (m_block && offset + size <= m_capacity)
+	{
+		m_offset = offset + size;
+		m_statistics.peakBytes = std::max(m_statistics.peakBytes, used());
+		return m_block.get() + offset;
+	}
+
+	//-- The padding is counted too, so the grown block fits the same sequence of allocations.
+	auto& block = m_overflow.emplace_back(std::make_unique_for_overwrite<std::byte[]>(size + alignment));
+	m_overflowBytes += size + alignment;
+	++m_statistics.heapAllocations;
+	m_statistics.peakBytes = std::max(m_statistics.peakBytes, used());
+
+	const auto address = reinterpret_cast<uintptr_t>(block.get());
+	return block.get() + (((address + alignment - 1) & ~(alignment - 1)) - address);
+}
+
+
+ArenaPool::ArenaPool(size_t numArenas, size_t capacity)
+{
+	m_arenas.reserve(numArenas);
+	m_free.reserve(numArenas);
+	for (size_t i = 0; i < numArenas; ++i)
+	{
+		m_arenas.emplace_back(capacity);
+		m_free.push_back(numArenas - i - 1);
+	}
+}
+
+
+ArenaPool::Lease ArenaPool::acquire()
+{
+	std::lock_guard lock(m_mutex);
+	ENGINE_ASSERT(!m_free.empty(), "More concurrent tasks than arenas in the pool!");
+
+	const size_t index = m_free.back();
+	m_free.pop_back();
+	return Lease(*this, index);
+}
+
+
+LinearArena::Statistics ArenaPool::statistics() const
+{
+	LinearArena::Statistics result;
+	for (const auto& arena : m_arenas)
+	{
+		result += arena.statistics();
+	}
+
+	return result;
+}
+
+
+void ArenaPool::release(size_t index)
+{
+	m_arenas[index].reset();
+
+	std::lock_guard lock(m_mutex);
+	m_free.push_back(index);
+}
+
+} //-- engine::utils.
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <engine/utils/noncopyable.h>
+
+namespace engine::utils
+{
+
+//-- Bump allocator over a single block for short-lived scratch data. All allocations are released at once by reset().
+//-- Allocations which don't fit the block get their own heap blocks, and reset() grows the block,
+//-- so a properly sized or warmed up arena never touches the heap.
+class LinearArena : public NonCopyable
+{
+public:
+	struct Statistics
+	{
+		size_t allocations = 0; //-- Served allocations.
+		size_t heapAllocations = 0; //-- Heap blocks, including the main one.
+		size_t peakBytes = 0;
+
+		ENGINE_API Statistics& operator+=(const Statistics& other);
+	};
+
+	LinearArena() = default;
+	ENGINE_API explicit LinearArena(size_t capacity);
+
+	//-- Releases all allocations and makes sure the next capacity bytes fit the main block.
+	ENGINE_API void reserve(size_t capacity);
+	ENGINE_API void reset();
+
+	ENGINE_API void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	//-- Value initialized array. Destructors are never called, so only trivially destructible types are allowed.
+	template<typename T>
+	std::span<T> allocate(size_t count)
+	{
+		static_assert(std::is_trivially_destructible_v<T>, "Arena never calls destructors!");
+
+		T* data = static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+		std::uninitialized_value_construct_n(data, count);
+		return { data, count };
+	}
+
+	size_t capacity() const { return m_capacity; }
+	size_t used() const { return m_offset + m_overflowBytes; }
+	const Statistics& statistics() const { return m_statistics; }
+
+private:
+	std::unique_ptr<std::byte[]> m_block;
+	size_t m_capacity = 0;
+	size_t m_offset = 0;
+	std::vector<std::unique_ptr<std::byte[]>> m_overflow;
+	size_t m_overflowBytes = 0;
+	Statistics m_statistics;
+};
+
+//-- Arenas for tasks of a parallel loop. A task takes a free arena and returns it once finished,
+//-- so a loop needs as many arenas as tasks may run at once, i.e. the number of workers plus the calling thread.
+class ArenaPool : public NonCopyable
+{
+public:
+	//-- Returns the arena to the pool on destruction. The arena is reset, so nothing allocated by the task survives it.
+	class Lease : public NonCopyable
+	{
+	public:
+		Lease(ArenaPool& pool, size_t index) : m_pool(pool), m_index(index) {}
+		~Lease() { m_pool.release(m_index); }
+
+		LinearArena& operator*() const { return m_pool.m_arenas[m_index]; }
+		LinearArena* operator->() const { return &m_pool.m_arenas[m_index]; }
+
+	private:
+		ArenaPool& m_pool;
+		size_t m_index;
+	};
+
+	ArenaPool(size_t numArenas, size_t capacity);
+
+	Lease acquire();
+	//-- Sum of the statistics of all arenas.
+	LinearArena::Statistics statistics() const;
+
+private:
+	void release(size_t index);
+
+private:
+	std::vector<LinearArena> m_arenas;
+	std::vector<size_t> m_free;
+	std::mutex m_mutex;
+};
+
+} //-- engine::utils.
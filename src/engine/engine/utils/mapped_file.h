@@ -0,0 +1,34 @@
+#pragma once
+
+#include <engine/utils/noncopyable.h>
+
+namespace engine::utils
+{
+
+//-- Read-only memory mapped view of a whole file.
+//-- The view stays valid until the object is closed or destroyed.
+class MappedFile : public NonCopyable
+{
+public:
+	MappedFile() = default;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	~MappedFile();
+
+	bool open(const std::filesystem::path& path);
+	void close();
+
+	bool valid() const { return m_data != nullptr; }
+	const uint8_t* data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+private:
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+#if defined(_WIN32)
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#endif
+};
+
+} //-- engine::utils.
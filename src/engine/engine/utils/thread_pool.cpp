@@ -0,0 +1,120 @@
+#include <engine/utils/thread_pool.h>
+
+namespace engine::utils
+{
+
+ThreadPool::ThreadPool(size_t numThreads)
+{
+	m_threads.reserve(numThreads);
+	for (size_t i = 0; i < numThreads; ++i)
+	{
+		m_threads.emplace_back([this]() { workerLoop(); });
+	}
+}
+
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+	m_condition.notify_all();
+
+	for (auto& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	if (count == 1 || m_threads.empty())
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			fn(i);
+		}
+		return;
+	}
+
+	//-- Helpers may start after the loop is already finished, so they hold the state by a shared pointer.
+	struct State
+	{
+		std::atomic<size_t> next = 0;
+		std::atomic<size_t> done = 0;
+		size_t count = 0;
+		const std::function<void(size_t)>* fn = nullptr;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+
+	auto state = std::make_shared<State>();
+	state->count = count;
+	state->fn = &fn;
+
+	auto work = [](State& state)
+		{
+			for (size_t i = state.next.fetch_add(1); i < state.count; i = state.next.fetch_add(1))
+			{
+				(*state.fn)(i);
+				if (state.done.fetch_add(1) + 1 == state.count)
+				{
+					std::lock_guard lock(state.mutex);
+					state.finished.notify_all();
+				}
+			}
+		};
+
+	const size_t numHelpers = std::min(count - 1, m_threads.size());
+	for (size_t i = 0; i < numHelpers; ++i)
+	{
+		push([state, work]() { work(*state); });
+	}
+
+	work(*state);
+
+	//-- Only indices which are being processed right now may be left, so it can't dead lock.
+	std::unique_lock lock(state->mutex);
+	state->finished.wait(lock, [&state]() { return state->done.load() == state->count; });
+}
+
+
+void ThreadPool::push(Task&& task)
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_condition.notify_one();
+}
+
+
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		Task task;
+		{
+			std::unique_lock lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+			if (m_stop && m_tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+
+		task();
+	}
+}
+
+} //-- engine::utils.
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <engine/utils/noncopyable.h>
+
+namespace engine::utils
+{
+
+//-- Simple pool of worker threads with a shared FIFO queue.
+class ThreadPool : public NonCopyable
+{
+public:
+	using Task = std::function<void()>;
+
+	explicit ThreadPool(size_t numThreads);
+	~ThreadPool();
+
+	size_t numThreads() const { return m_threads.size(); }
+
+	//-- Runs the task on one of the workers.
+	template<typename Fn>
+	auto submit(Fn&& fn) -> std::future<std::invoke_result_t<Fn>>
+	{
+		using Result = std::invoke_result_t<Fn>;
+
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+		auto future = task->get_future();
+		push([task]() { (*task)(); });
+
+		return future;
+	}
+
+	//-- Calls fn(i) for every i in [0, count) and blocks until all calls are finished.
+	//-- The calling thread takes part in the work too, so it's safe to call it from a worker.
+	void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+	void push(Task&& task);
+	void workerLoop();
+
+private:
+	std::vector<std::thread> m_threads;
+	std::deque<Task> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stop = false;
+};
+
+} //-- engine::utils.
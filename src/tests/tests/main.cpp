@@ -0,0 +1,68 @@
+#include <tests/test.h>
+
+namespace tests
+{
+
+namespace
+{
+
+size_t g_numFailedChecks = 0;
+
+} //-- unnamed.
+
+
+std::vector<TestCase>& testCases()
+{
+	static std::vector<TestCase> s_testCases;
+	return s_testCases;
+}
+
+
+void fail(std::string_view expression, std::string_view file, int line)
+{
+	++g_numFailedChecks;
+	fmt::println("  CHECK({}) failed at {}:{}", expression, file, line);
+}
+
+} //-- tests.
+
+
+int main(int argc, char* argv[])
+{
+	using namespace std::string_view_literals;
+
+	auto& engine = engine::engine();
+
+	engine::Engine::Config config;
+	config.vfsParams.aliases = { { "/", "/resources", engine::Engine::Config::VFSParams::Alias::Type::Native }};
+	config.cliParams = { .arguments = static_cast<char**>(argv), .numArguments = static_cast<uint16_t>(argc) };
+
+	if (!engine.initializeCore(config))
+	{
+		fmt::println("Can't initialize the engine.");
+		return 1;
+	}
+
+	const bool benchmarks = std::find(argv + 1, argv + argc, "-bench"sv) != argv + argc;
+
+	size_t numRun = 0;
+	size_t numFailed = 0;
+	for (const auto& testCase : tests::testCases())
+	{
+		if (testCase.benchmark && !benchmarks)
+		{
+			continue;
+		}
+
+		fmt::println("[{}]", testCase.name);
+		const size_t numFailedChecks = tests::g_numFailedChecks;
+		testCase.fn();
+		++numRun;
+		numFailed += tests::g_numFailedChecks != numFailedChecks;
+	}
+
+	fmt::println("{} of {} test cases failed.", numFailed, numRun);
+	engine.release();
+
+	return numFailed == 0 ? 0 : 1;
+}
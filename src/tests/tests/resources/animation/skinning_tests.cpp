@@ -0,0 +1,172 @@
+#include <tests/test.h>
+#include <engine/resources/animation/skinning.h>
+
+#include <random>
+
+namespace
+{
+
+using namespace engine::resources::animation;
+using engine::math::matrix;
+using engine::math::quat;
+using engine::math::vec3;
+
+//-- Random rigid bones and vertices with random palette indices and weights. Every seventh vertex has a single bone,
+//-- every eleventh one has no weights at all.
+struct SkinnedVertices
+{
+	SkinnedVertices(size_t numVertices, size_t numBones)
+	{
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+		for (size_t i = 0; i < numBones; ++i)
+		{
+			const vec3 axis = vec3(value(random), value(random), value(random) + 2.0f);
+			palette.push_back(matrix::CreateFromQuaternion(quat::CreateFromAxisAngle(axis / axis.Length(), value(random) * 3.0f))
+				* matrix::CreateTranslation(value(random) * 5.0f, value(random) * 5.0f, value(random) * 5.0f));
+		}
+		dualQuats.resize(numBones);
+		toDualQuats(palette, dualQuats);
+
+		for (size_t i = 0; i < numVertices; ++i)
+		{
+			positions.emplace_back(value(random), value(random), value(random));
+			normals.emplace_back(0.0f, 1.0f, 0.0f);
+
+			uint32_t indices = 0;
+			for (uint32_t influence = 0; influence < 4; ++influence)
+			{
+				indices |= static_cast<uint32_t>(random() % numBones) << (influence * 8);
+			}
+			const uint32_t first = random() % 256;
+			const uint32_t second = random() % (256 - first);
+			const uint32_t third = random() % (256 - first - second);
+			const uint32_t weights = i % 11 == 0 ? 0 : i % 7 == 0 ? 255 : first | (second << 8) | (third << 16) | ((255 - first - second - third) << 24);
+			boneIndices.push_back(indices);
+			boneWeights.push_back(weights);
+		}
+	}
+
+	SkinningSource source() const { return { .positions = positions, .normals = normals, .boneIndices = boneIndices, .boneWeights = boneWeights }; }
+
+	std::vector<matrix> palette;
+	std::vector<DualQuat> dualQuats;
+	std::vector<vec3> positions;
+	std::vector<vec3> normals;
+	std::vector<uint32_t> boneIndices;
+	std::vector<uint32_t> boneWeights;
+};
+
+
+float distance(const vec3& lhs, const vec3& rhs)
+{
+	return (lhs - rhs).Length();
+}
+
+} //-- unnamed.
+
+
+TEST_CASE(linearSkinningBlendsBoneTransforms)
+{
+	const SkinnedVertices vertices(1000, 40);
+	std::vector<vec3> positions(vertices.positions.size());
+	std::vector<vec3> normals(vertices.normals.size());
+	skinLinear(vertices.palette, vertices.source(), { .positions = positions, .normals = normals }, 0, positions.size());
+
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		//-- The missing weight is completed with the identity.
+		vec3 expected = vertices.positions[i];
+		for (uint32_t influence = 0; influence < 4; ++influence)
+		{
+			const float weight = static_cast<float>((vertices.boneWeights[i] >> (influence * 8)) & 0xff) / 255.0f;
+			const auto& bone = vertices.palette[(vertices.boneIndices[i] >> (influence * 8)) & 0xff];
+			expected += (vec3::Transform(vertices.positions[i], bone) - vertices.positions[i]) * weight;
+		}
+		CHECK(distance(positions[i], expected) < 1e-4f);
+		CHECK(std::abs(normals[i].Length() - 1.0f) < 1e-4f);
+	}
+}
+
+
+TEST_CASE(dualQuaternionSkinningKeepsRigidBones)
+{
+	const SkinnedVertices vertices(1000, 40);
+	std::vector<vec3> positions(vertices.positions.size());
+	std::vector<vec3> normals(vertices.normals.size());
+	skinDualQuaternion(vertices.dualQuats, vertices.source(), { .positions = positions, .normals = normals }, 0, positions.size());
+
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		if (vertices.boneWeights[i] == 0)
+		{
+			CHECK(distance(positions[i], vertices.positions[i]) < 1e-5f);
+			CHECK(distance(normals[i], vertices.normals[i]) < 1e-5f);
+		}
+		else if (vertices.boneWeights[i] == 255)
+		{
+			const auto& bone = vertices.palette[vertices.boneIndices[i] & 0xff];
+			CHECK(distance(positions[i], vec3::Transform(vertices.positions[i], bone)) < 1e-4f);
+			CHECK(distance(normals[i], vec3::TransformNormal(vertices.normals[i], bone)) < 1e-4f);
+		}
+	}
+}
+
+
+TEST_CASE(dualQuaternionSkinningIgnoresUnweightedBones)
+{
+	//-- The indices of bones without weight point outside of the palette, the result must not change.
+	const SkinnedVertices vertices(1000, 40);
+	SkinnedVertices outside = vertices;
+	for (size_t i = 0; i < outside.boneIndices.size(); ++i)
+	{
+		for (uint32_t influence = 0; influence < 4; ++influence)
+		{
+			if (((outside.boneWeights[i] >> (influence * 8)) & 0xff) == 0)
+			{
+				outside.boneIndices[i] |= 0xffu << (influence * 8);
+			}
+		}
+	}
+
+	std::vector<vec3> expected(vertices.positions.size());
+	std::vector<vec3> positions(vertices.positions.size());
+	skinDualQuaternion(vertices.dualQuats, vertices.source(), { .positions = expected }, 0, expected.size());
+	skinDualQuaternion(outside.dualQuats, outside.source(), { .positions = positions }, 0, positions.size());
+	CHECK(memcmp(expected.data(), positions.data(), positions.size() * sizeof(vec3)) == 0);
+}
+
+
+TEST_CASE(parallelSkinningMatchesSerial)
+{
+	//-- Several batches and a partial one.
+	const SkinnedVertices vertices(10000, 64);
+	std::vector<vec3> serial(vertices.positions.size());
+	std::vector<vec3> parallel(vertices.positions.size());
+
+	skinLinear(vertices.palette, vertices.source(), { .positions = serial }, 0, serial.size());
+	skinLinear(vertices.palette, vertices.source(), { .positions = parallel });
+	CHECK(memcmp(serial.data(), parallel.data(), serial.size() * sizeof(vec3)) == 0);
+
+	skinDualQuaternion(vertices.dualQuats, vertices.source(), { .positions = serial }, 0, serial.size());
+	skinDualQuaternion(vertices.dualQuats, vertices.source(), { .positions = parallel });
+	CHECK(memcmp(serial.data(), parallel.data(), serial.size() * sizeof(vec3)) == 0);
+}
+
+
+BENCHMARK(skinningThroughput)
+{
+	const SkinnedVertices vertices(200000, 128);
+	std::vector<vec3> positions(vertices.positions.size());
+	std::vector<vec3> normals(vertices.normals.size());
+	const SkinningTarget target = { .positions = positions, .normals = normals };
+
+	const double linear = tests::measure(10, [&]() { skinLinear(vertices.palette, vertices.source(), target, 0, positions.size()); });
+	const double linearParallel = tests::measure(10, [&]() { skinLinear(vertices.palette, vertices.source(), target); });
+	const double dualQuat = tests::measure(10, [&]() { skinDualQuaternion(vertices.dualQuats, vertices.source(), target, 0, positions.size()); });
+	const double dualQuatParallel = tests::measure(10, [&]() { skinDualQuaternion(vertices.dualQuats, vertices.source(), target); });
+
+	fmt::println("  {} vertices: linear {:.2f} ms, parallel {:.2f} ms; dual quaternion {:.2f} ms, parallel {:.2f} ms.", positions.size(),
+		linear, linearParallel, dualQuat, dualQuatParallel);
+}
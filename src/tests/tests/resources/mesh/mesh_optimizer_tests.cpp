@@ -0,0 +1,206 @@
+#include <tests/test.h>
+#include <engine/resources/mesh/mesh_optimizer.h>
+
+#include <numeric>
+#include <random>
+
+namespace
+{
+
+using namespace engine::resources::mesh;
+using engine::utils::LinearArena;
+
+//-- A grid of size x size quads over a wave, so the overdraw pass sees triangles facing different directions.
+void makeGrid(uint32_t size, std::vector<uint32_t>& indices, std::vector<float>& positions)
+{
+	for (uint32_t y = 0; y <= size; ++y)
+	{
+		for (uint32_t x = 0; x <= size; ++x)
+		{
+			positions.insert(positions.end(), { static_cast<float>(x), static_cast<float>(y), std::sin(x * 0.3f) * 2.0f });
+		}
+	}
+
+	for (uint32_t y = 0; y < size; ++y)
+	{
+		for (uint32_t x = 0; x < size; ++x)
+		{
+			const uint32_t corner = y * (size + 1) + x;
+			indices.insert(indices.end(), { corner, corner + 1, corner + size + 2, corner, corner + size + 2, corner + size + 1 });
+		}
+	}
+}
+
+
+std::vector<uint32_t> shuffleTriangles(std::span<const uint32_t> indices)
+{
+	std::vector<uint32_t> order(indices.size() / 3);
+	std::iota(order.begin(), order.end(), 0);
+	std::shuffle(order.begin(), order.end(), std::mt19937(3));
+
+	std::vector<uint32_t> shuffled;
+	for (uint32_t triangle : order)
+	{
+		shuffled.insert(shuffled.end(), indices.begin() + triangle * 3, indices.begin() + triangle * 3 + 3);
+	}
+	return shuffled;
+}
+
+
+//-- Triangles rotated to start from their smallest index, which keeps the winding, and sorted.
+std::vector<std::array<uint32_t, 3>> sortedTriangles(std::span<const uint32_t> indices)
+{
+	std::vector<std::array<uint32_t, 3>> triangles;
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		std::array<uint32_t, 3> triangle = { indices[i], indices[i + 1], indices[i + 2] };
+		std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+
+//-- Runs the cache and the overdraw passes like the importer does and checks that they only reorder triangles.
+void checkOptimize(std::span<const uint32_t> indices, std::span<const float> positions)
+{
+	const size_t numVertices = positions.size() / 3;
+	const auto triangles = sortedTriangles(indices);
+	LinearArena scratch(optimizerScratchSize(indices.size(), numVertices));
+
+	const auto before = analyzeVertexCache(indices, numVertices, scratch);
+	scratch.reset();
+
+	std::vector<uint32_t> cacheOptimized(indices.size());
+	std::vector<uint32_t> clusters(indices.size() / 3);
+	clusters.resize(optimizeVertexCache(cacheOptimized, indices, numVertices, scratch, clusters));
+	scratch.reset();
+	CHECK(sortedTriangles(cacheOptimized) == triangles);
+	CHECK(!clusters.empty() && clusters.front() == 0 && std::is_sorted(clusters.begin(), clusters.end()));
+
+	const auto cacheAfter = analyzeVertexCache(cacheOptimized, numVertices, scratch);
+	scratch.reset();
+	CHECK(cacheAfter.acmr <= before.acmr);
+
+	std::vector<uint32_t> overdrawOptimized(indices.size());
+	optimizeOverdraw(overdrawOptimized, cacheOptimized, positions, clusters, 1.05f, scratch);
+	scratch.reset();
+	CHECK(sortedTriangles(overdrawOptimized) == triangles);
+
+	//-- The overdraw pass gives some of the cache efficiency up. The threshold bounds it per cluster,
+	//-- the reordered clusters also lose the vertices they shared with their old neighbours.
+	const auto overdrawAfter = analyzeVertexCache(overdrawOptimized, numVertices, scratch);
+	CHECK(overdrawAfter.acmr <= before.acmr);
+	CHECK(overdrawAfter.acmr <= cacheAfter.acmr * 1.1f);
+	CHECK(scratch.statistics().heapAllocations == 1);
+}
+
+} //-- unnamed.
+
+
+TEST_CASE(vertexCacheAnalysisCountsMisses)
+{
+	//-- Two triangles sharing an edge transform four vertices, the last vertex is never used.
+	const std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3 };
+	LinearArena scratch(optimizerScratchSize(indices.size(), 5));
+	const auto statistics = analyzeVertexCache(indices, 5, scratch);
+	CHECK(statistics.verticesTransformed == 4);
+	CHECK(statistics.acmr == 2.0f);
+	CHECK(statistics.atvr == 1.0f);
+
+	//-- A cache of three entries evicts vertex 0 before the last triangle uses it again.
+	const std::vector<uint32_t> evicting = { 0, 1, 2, 3, 4, 2, 0, 3, 4 };
+	const auto small = analyzeVertexCache(evicting, 5, scratch, 3);
+	CHECK(small.verticesTransformed == 6);
+	CHECK(analyzeVertexCache(evicting, 5, scratch, 5).verticesTransformed == 5);
+}
+
+
+TEST_CASE(optimizersKeepTrianglesAndReduceMisses)
+{
+	std::vector<uint32_t> indices;
+	std::vector<float> positions;
+	makeGrid(64, indices, positions);
+
+	checkOptimize(indices, positions);
+	checkOptimize(shuffleTriangles(indices), positions);
+}
+
+
+TEST_CASE(vertexFetchRemapOrdersByFirstUse)
+{
+	std::vector<uint32_t> indices;
+	std::vector<float> positions;
+	makeGrid(16, indices, positions);
+	indices = shuffleTriangles(indices);
+
+	//-- An extra vertex which no triangle uses is dropped.
+	const size_t numVertices = positions.size() / 3 + 1;
+	std::vector<uint32_t> remap(numVertices);
+	const size_t numUnique = optimizeVertexFetchRemap(remap, indices, numVertices);
+	CHECK(numUnique == numVertices - 1);
+	CHECK(remap.back() == ~0u);
+
+	//-- The used vertices are a bijection onto [0, numUnique).
+	std::vector<bool> targets(numUnique, false);
+	for (size_t i = 0; i + 1 < numVertices; ++i)
+	{
+		CHECK(remap[i] < numUnique && !targets[remap[i]]);
+		targets[remap[i]] = true;
+	}
+
+	//-- Remapped indices touch the vertices in order, each new vertex is the next one.
+	std::vector<uint32_t> remapped = indices;
+	remapIndexBuffer(remapped, remap);
+	uint32_t next = 0;
+	for (uint32_t index : remapped)
+	{
+		CHECK(index <= next);
+		next += index == next;
+	}
+	CHECK(next == numUnique);
+
+	std::vector<float> remappedPositions(numUnique * 3);
+	remapVertexBuffer(remappedPositions.data(), positions.data(), numVertices - 1, 3 * sizeof(float), remap);
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		CHECK(memcmp(&remappedPositions[remapped[i] * 3], &positions[indices[i] * 3], 3 * sizeof(float)) == 0);
+	}
+}
+
+
+BENCHMARK(optimizerThroughput)
+{
+	std::vector<uint32_t> grid;
+	std::vector<float> positions;
+	makeGrid(512, grid, positions);
+	const auto indices = shuffleTriangles(grid);
+	const size_t numVertices = positions.size() / 3;
+
+	LinearArena scratch(optimizerScratchSize(indices.size(), numVertices));
+	std::vector<uint32_t> cacheOptimized(indices.size());
+	std::vector<uint32_t> clusters(indices.size() / 3);
+	std::vector<uint32_t> overdrawOptimized(indices.size());
+	std::vector<uint32_t> remap(numVertices);
+
+	size_t numClusters = 0;
+	const double cacheTime = tests::measure(5, [&]()
+		{
+			scratch.reset();
+			numClusters = optimizeVertexCache(cacheOptimized, indices, numVertices, scratch, clusters);
+		});
+	const double overdrawTime = tests::measure(5, [&]()
+		{
+			scratch.reset();
+			optimizeOverdraw(overdrawOptimized, cacheOptimized, positions, { clusters.data(), numClusters }, 1.05f, scratch);
+		});
+	const double fetchTime = tests::measure(5, [&]() { optimizeVertexFetchRemap(remap, overdrawOptimized, numVertices); });
+
+	scratch.reset();
+	const float before = analyzeVertexCache(indices, numVertices, scratch).acmr;
+	scratch.reset();
+	const float after = analyzeVertexCache(overdrawOptimized, numVertices, scratch).acmr;
+	fmt::println("  {} triangles, ACMR {:.3f} -> {:.3f}: cache {:.2f} ms, overdraw {:.2f} ms, fetch {:.2f} ms.", indices.size() / 3, before, after,
+		cacheTime, overdrawTime, fetchTime);
+}
@@ -0,0 +1,111 @@
+#include <tests/test.h>
+#include <engine/resources/mesh/meshlet_builder.h>
+
+namespace
+{
+
+using namespace engine::resources::mesh;
+
+//-- A grid of size x size quads in the z = 0 plane, front faces look at +z.
+void makeGrid(uint32_t size, std::vector<uint32_t>& indices, std::vector<float>& positions)
+{
+	for (uint32_t y = 0; y <= size; ++y)
+	{
+		for (uint32_t x = 0; x <= size; ++x)
+		{
+			positions.insert(positions.end(), { static_cast<float>(x), static_cast<float>(y), 0.0f });
+		}
+	}
+
+	for (uint32_t y = 0; y < size; ++y)
+	{
+		for (uint32_t x = 0; x < size; ++x)
+		{
+			const uint32_t corner = y * (size + 1) + x;
+			indices.insert(indices.end(), { corner, corner + 1, corner + size + 2, corner, corner + size + 2, corner + size + 1 });
+		}
+	}
+}
+
+
+uint32_t meshletIndex(const MeshletData& data, const Meshlet& meshlet, uint32_t triangle, uint32_t corner)
+{
+	const uint32_t local = (data.triangles[meshlet.triangleOffset + triangle] >> (8 * corner)) & 0xff;
+	return data.vertices[meshlet.vertexOffset + local];
+}
+
+} //-- unnamed.
+
+
+TEST_CASE(meshletsKeepTrianglesWithinLimits)
+{
+	std::vector<uint32_t> indices;
+	std::vector<float> positions;
+	makeGrid(40, indices, positions);
+
+	MeshletData data;
+	buildMeshlets(data, indices, positions);
+	CHECK(data.meshlets.size() == data.bounds.size());
+
+	//-- Triangles are packed greedily in the index order, so unpacking them gives the index buffer back.
+	std::vector<uint32_t> unpacked;
+	for (const auto& meshlet : data.meshlets)
+	{
+		CHECK(meshlet.numVertices <= kMaxMeshletVertices);
+		CHECK(meshlet.numTriangles > 0 && meshlet.numTriangles <= kMaxMeshletTriangles);
+
+		for (uint32_t i = 0; i < meshlet.numTriangles; ++i)
+		{
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				CHECK(((data.triangles[meshlet.triangleOffset + i] >> (8 * corner)) & 0xff) < meshlet.numVertices);
+				unpacked.push_back(meshletIndex(data, meshlet, i, corner));
+			}
+		}
+	}
+	CHECK(unpacked == indices);
+
+	MeshletData again;
+	buildMeshlets(again, indices, positions);
+	CHECK(again.meshlets.size() == data.meshlets.size() && again.vertices == data.vertices && again.triangles == data.triangles);
+}
+
+
+TEST_CASE(meshletBoundsEncloseVerticesAndConesFollowNormals)
+{
+	std::vector<uint32_t> indices;
+	std::vector<float> positions;
+	makeGrid(20, indices, positions);
+
+	MeshletData data;
+	buildMeshlets(data, indices, positions);
+
+	for (size_t i = 0; i < data.meshlets.size(); ++i)
+	{
+		const auto& meshlet = data.meshlets[i];
+		const auto& bounds = data.bounds[i];
+		for (uint32_t v = 0; v < meshlet.numVertices; ++v)
+		{
+			const float* p = positions.data() + data.vertices[meshlet.vertexOffset + v] * 3;
+			const engine::math::vec3 d(p[0] - bounds.center.x, p[1] - bounds.center.y, p[2] - bounds.center.z);
+			CHECK(d.Length() <= bounds.radius * 1.0001f + 1e-5f);
+		}
+
+		//-- A flat patch has a zero angle cone along its normal.
+		CHECK(bounds.coneAxis.z > 0.999f);
+		CHECK(bounds.coneCutoff < 1e-3f);
+	}
+}
+
+
+TEST_CASE(meshletConesOfClosedShapesAreNeverCulled)
+{
+	//-- A tetrahedron, normals spread over more than a hemisphere.
+	const std::vector<float> positions = { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+	const std::vector<uint32_t> indices = { 0, 2, 1, 0, 1, 3, 0, 3, 2, 1, 2, 3 };
+
+	MeshletData data;
+	buildMeshlets(data, indices, positions);
+	CHECK(data.meshlets.size() == 1);
+	CHECK(data.bounds.front().coneCutoff == 1.0f);
+}
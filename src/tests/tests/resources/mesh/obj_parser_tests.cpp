@@ -0,0 +1,164 @@
+#include <tests/test.h>
+#include <engine/resources/mesh/obj_parser.h>
+
+#include <bit>
+#include <charconv>
+#include <random>
+
+namespace
+{
+
+using namespace engine::resources::mesh;
+
+//-- Text of a chunk of the parser, the longer files are split into several ones.
+inline constexpr size_t kChunkSize = 1024 * 1024;
+
+//-- The reference value. from_chars doesn't take the leading '+' which OBJ writers emit.
+float referenceFloat(std::string_view text)
+{
+	text.remove_prefix(!text.empty() && text.front() == '+');
+	float value = 0.0f;
+	const auto [next, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+	CHECK(error == std::errc() && next == text.data() + text.size());
+	return value;
+}
+
+
+//-- Parses every number as the x of a position and compares the bits with from_chars.
+void checkFloats(std::span<const std::string> numbers)
+{
+	std::string text;
+	for (const auto& number : numbers)
+	{
+		text += fmt::format("v {} 0 0\n", number);
+	}
+	//-- The last number ends the text, so the digits there can't be read 8 at once.
+	text += fmt::format("v 0 0 {}", numbers.back());
+
+	ObjData data;
+	std::string error;
+	CHECK(parseObj(text, data, error));
+	CHECK(data.positions.size() == numbers.size() + 1);
+	for (size_t i = 0; i < std::min(numbers.size(), data.positions.size()); ++i)
+	{
+		const float expected = referenceFloat(numbers[i]);
+		if (std::bit_cast<uint32_t>(data.positions[i].x) != std::bit_cast<uint32_t>(expected))
+		{
+			fmt::println("  '{}' is parsed as {}, expected {}.", numbers[i], data.positions[i].x, expected);
+			CHECK(false);
+		}
+	}
+	CHECK(data.positions.empty() || std::bit_cast<uint32_t>(data.positions.back().z) == std::bit_cast<uint32_t>(referenceFloat(numbers.back())));
+}
+
+} //-- unnamed.
+
+
+TEST_CASE(objFloatsMatchFromChars)
+{
+	const std::vector<std::string> numbers = {
+		//-- 15 significant digits are the limit of the fast path, 16 go to from_chars.
+		"123456789012345", "-0.123456789012345", "1234567.89012345", "1234567890123456", "0.1234567890123456", "-98765432.10987654",
+		//-- Right above the middle of 1 and the next float by less than a double ulp, so a double rounds it to the middle.
+		"1.000000059604644776",
+		//-- Powers of ten up to 10^22 are exact doubles, larger exponents go to from_chars.
+		"1e22", "1e23", "1e-22", "1e-23", "-4.5e+22", "7.25e-23", "1.5e23", "15e21", "1E5", "2.5e-3",
+		//-- Signs and missing parts.
+		"-.5", "1e5", "+1", "+.25", "5.", "-0", "0", "-7", "+12.5e+1",
+		//-- Long digit runs are counted 16 at once, from_chars takes the rest.
+		"3.14159265358979323846264338327950288", "0.000000000000000000000000000001", "100000000000000000000000000000000000",
+		"inf", "-inf",
+		//-- Exponents with more than three digits.
+		"1e0001", "5e-0010"
+	};
+	checkFloats(numbers);
+}
+
+
+TEST_CASE(objRandomFloatsMatchFromChars)
+{
+	std::mt19937 random(11);
+	std::uniform_real_distribution<double> value(-1000.0, 1000.0);
+	std::uniform_int_distribution<int> exponent(-30, 30);
+
+	std::vector<std::string> numbers;
+	for (size_t i = 0; i < 50000; ++i)
+	{
+		const double number = value(random);
+		switch (i % 5)
+		{
+		case 0: numbers.push_back(fmt::format("{:.6f}", number)); break;
+		case 1: numbers.push_back(fmt::format("{:.9g}", number)); break;
+		case 2: numbers.push_back(fmt::format("{:.3e}", number * std::pow(10.0, exponent(random)))); break;
+		case 3: numbers.push_back(fmt::format("{:.17g}", number)); break;
+		default: numbers.push_back(fmt::format("{}", static_cast<float>(number))); break;
+		}
+	}
+	checkFloats(numbers);
+}
+
+
+TEST_CASE(objRelativeIndicesCrossChunks)
+{
+	//-- Every quad adds its attributes right before its face and refers to them relatively, the text spans several chunks,
+	//-- so faces at the start of a chunk refer to attributes of the previous one.
+	std::string text = "usemtl quads\n";
+	size_t numQuads = 0;
+	while (text.size() < 2 * kChunkSize + kChunkSize / 2)
+	{
+		for (size_t i = 0; i < 4; ++i)
+		{
+			text += fmt::format("v {} 0 0\nvt {} 0\n", numQuads * 4 + i, numQuads * 4 + i);
+		}
+		text += fmt::format("vn {} 0 0\nf -4/-4/-1 -3/-3/-1 -2/-2/-1 -1/-1/-1\n", numQuads);
+		++numQuads;
+	}
+	//-- Positive indices address the same attributes from anywhere.
+	text += "f 1//1 2//1 3//1\n";
+
+	ObjData data;
+	std::string error;
+	CHECK(parseObj(text, data, error));
+	CHECK(data.parts.size() == 1 && data.parts[0].material == "quads");
+	CHECK(data.positions.size() == numQuads * 4 && data.uvs.size() == numQuads * 4 && data.normals.size() == numQuads);
+	if (data.parts.size() != 1 || data.parts[0].corners.size() != numQuads * 6 + 3)
+	{
+		CHECK(false);
+		return;
+	}
+
+	const auto& corners = data.parts[0].corners;
+	for (size_t quad = 0; quad < numQuads; ++quad)
+	{
+		//-- The fan of the quad.
+		const uint32_t first = static_cast<uint32_t>(quad * 4);
+		const std::array<uint32_t, 6> expected = { first, first + 1, first + 2, first, first + 2, first + 3 };
+		for (size_t i = 0; i < expected.size(); ++i)
+		{
+			const ObjCorner corner = corners[quad * 6 + i];
+			CHECK(corner.position == expected[i] && corner.uv == expected[i] && corner.normal == quad);
+		}
+	}
+	CHECK(corners[numQuads * 6].position == 0 && corners[numQuads * 6].uv == kObjNone && corners[numQuads * 6].normal == 0);
+
+	for (size_t i = 0; i < data.positions.size(); ++i)
+	{
+		CHECK(data.positions[i].x == static_cast<float>(i) && data.uvs[i].x == static_cast<float>(i));
+	}
+}
+
+
+TEST_CASE(objRejectsMissingAttributes)
+{
+	ObjData data;
+	std::string error;
+	CHECK(parseObj("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n", data, error));
+	CHECK(!parseObj("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 0 1 2\n", data, error));
+	CHECK(!parseObj("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n", data, error));
+	CHECK(!parseObj("v 0 0 0\nv 1 0 0\nv 0 1 0\nf -1 -2 -4\n", data, error));
+	CHECK(!parseObj("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1/1 2/1 3/1\n", data, error));
+	CHECK(!parseObj("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 00000000003\n", data, error));
+	//-- Relative indices can't refer to attributes which follow the face.
+	CHECK(!parseObj("v 0 0 0\nv 1 0 0\nf -2 -1 -3\nv 0 1 0\n", data, error));
+	CHECK(!error.empty());
+}
@@ -0,0 +1,348 @@
+#include <tests/test.h>
+#include <engine/resources/mesh/vertex_quantization.h>
+
+#include <bit>
+#include <random>
+
+namespace
+{
+
+using namespace engine;
+using namespace engine::resources::mesh;
+
+//-- Sizes around the batches of four and eight, so both the SIMD loops and the tails run.
+inline constexpr size_t kSizes[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 17, 1027 };
+
+math::vec3 randomUnitVector(std::mt19937& random)
+{
+	std::normal_distribution<float> value;
+	math::vec3 vector(value(random), value(random), value(random));
+	return vector / vector.Length();
+}
+
+
+float snorm16(int16_t value)
+{
+	return std::max(value / 32767.0f, -1.0f);
+}
+
+
+math::vec3 octahedralDecode(int16_t u, int16_t v)
+{
+	const float x = snorm16(u);
+	const float y = snorm16(v);
+	const float z = 1.0f - std::abs(x) - std::abs(y);
+	math::vec3 vector = z < 0.0f
+		? math::vec3(std::copysign(1.0f - std::abs(y), x), std::copysign(1.0f - std::abs(x), y), z)
+		: math::vec3(x, y, z);
+	return vector / vector.Length();
+}
+
+
+//-- Tangent, bitangent and normal of the encoded frame. The sign of w flips the bitangent.
+std::array<math::vec3, 3> decodeQTangent(const int16_t* encoded)
+{
+	const float length = std::sqrt(snorm16(encoded[0]) * snorm16(encoded[0]) + snorm16(encoded[1]) * snorm16(encoded[1])
+		+ snorm16(encoded[2]) * snorm16(encoded[2]) + snorm16(encoded[3]) * snorm16(encoded[3]));
+	const float x = snorm16(encoded[0]) / length;
+	const float y = snorm16(encoded[1]) / length;
+	const float z = snorm16(encoded[2]) / length;
+	const float w = snorm16(encoded[3]) / length;
+
+	const math::vec3 tangent(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y));
+	const math::vec3 normal(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y));
+	const math::vec3 bitangent = normal.Cross(tangent) * (encoded[3] < 0 ? -1.0f : 1.0f);
+	return { tangent, bitangent, normal };
+}
+
+
+float halfToFloat(uint16_t half)
+{
+	const uint32_t sign = (half & 0x8000u) << 16;
+	const uint32_t exponent = (half >> 10) & 0x1f;
+	const uint32_t mantissa = half & 0x3ff;
+	if (exponent == 0x1f)
+	{
+		return std::bit_cast<float>(sign | 0x7f800000u | (mantissa << 13));
+	}
+
+	const float magnitude = exponent == 0 ? std::ldexp(static_cast<float>(mantissa), -24)
+		: std::ldexp(static_cast<float>(mantissa | 0x400), static_cast<int>(exponent) - 25);
+	return sign ? -magnitude : magnitude;
+}
+
+
+//-- Whether the half is the nearest one to the value, ties go to the even one. Values past the largest half go to infinity.
+bool isNearestHalf(float value, uint16_t half)
+{
+	if (std::isnan(value))
+	{
+		return (half & 0x7c00) == 0x7c00 && (half & 0x3ff) != 0;
+	}
+	if ((half & 0x8000) != (std::signbit(value) ? 0x8000 : 0))
+	{
+		return false;
+	}
+
+	const float magnitude = std::abs(value);
+	const uint16_t bits = half & 0x7fff;
+	if (magnitude >= 65520.0f)
+	{
+		return bits == 0x7c00;
+	}
+	if (bits >= 0x7c00)
+	{
+		return false;
+	}
+
+	const double error = std::abs(static_cast<double>(halfToFloat(bits)) - magnitude);
+	const double below = bits > 0 ? std::abs(static_cast<double>(halfToFloat(bits - 1)) - magnitude) : INFINITY;
+	const double above = std::abs(static_cast<double>(halfToFloat(bits + 1)) - magnitude);
+	const bool even = (bits & 1) == 0;
+	return (error < below || (error == below && even)) && (error < above || (error == above && even));
+}
+
+} //-- unnamed.
+
+
+TEST_CASE(halfConversionRoundsToNearestEven)
+{
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> value(-70000.0f, 70000.0f);
+
+	std::vector<float> values = { 0.0f, -0.0f, 1.0f, -2.5f, 65504.0f, 65519.0f, 65520.0f, -1e9f, 6e-8f, -3e-8f, 2.98e-8f, 6.1e-5f,
+		1.0f + 1.0f / 2048.0f, 1.0f + 3.0f / 2048.0f, INFINITY, -INFINITY, NAN };
+	for (size_t i = 0; i < 20000; ++i)
+	{
+		//-- Random bits cover subnormals and every exponent, the uniform values the range of halves.
+		values.push_back(i % 2 ? std::bit_cast<float>(static_cast<uint32_t>(random())) : value(random));
+	}
+
+	std::vector<uint16_t> halves(values.size());
+	convertToHalf(halves.data(), values);
+	size_t numWrong = 0;
+	for (size_t i = 0; i < values.size(); ++i)
+	{
+		numWrong += !isNearestHalf(values[i], halves[i]);
+	}
+	CHECK(numWrong == 0);
+
+	for (size_t size : kSizes)
+	{
+		std::vector<uint16_t> batch(size);
+		convertToHalf(batch.data(), { values.data(), size });
+		CHECK(std::equal(batch.begin(), batch.end(), halves.begin()));
+	}
+}
+
+
+TEST_CASE(quantizedPositionsRoundTrip)
+{
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> value(-5.0f, 7.0f);
+
+	//-- The corners of the AABB take the ends of the range, which are packed with the bias.
+	std::vector<math::vec3> positions = { math::vec3(-5.0f, -0.5f, -5.0f), math::vec3(7.0f, 0.7f, 7.0f) };
+	for (size_t i = 0; i < 1025; ++i)
+	{
+		positions.emplace_back(value(random), value(random) * 0.1f, value(random));
+	}
+	const math::AABB aabb(math::vec3(-5.0f, -0.5f, -5.0f), math::vec3(7.0f, 0.7f, 7.0f));
+	const math::vec3 extent = aabb.m_max - aabb.m_min;
+
+	std::vector<uint16_t> quantized(positions.size() * 4);
+	quantizePositions(quantized.data(), positions, aabb);
+	CHECK(quantized[0] == 0 && quantized[1] == 0 && quantized[2] == 0);
+	CHECK(quantized[4] == 65535 && quantized[5] == 65535 && quantized[6] == 65535);
+
+	float maxError = 0.0f;
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		const uint16_t* encoded = &quantized[i * 4];
+		maxError = std::max({ maxError,
+			std::abs(aabb.m_min.x + encoded[0] / 65535.0f * extent.x - positions[i].x) / extent.x,
+			std::abs(aabb.m_min.y + encoded[1] / 65535.0f * extent.y - positions[i].y) / extent.y,
+			std::abs(aabb.m_min.z + encoded[2] / 65535.0f * extent.z - positions[i].z) / extent.z });
+		CHECK(encoded[3] == 0);
+	}
+	CHECK(maxError <= 0.5f / 65535.0f + 1e-6f);
+
+	for (size_t size : kSizes)
+	{
+		std::vector<uint16_t> batch(size * 4);
+		quantizePositions(batch.data(), { positions.data(), size }, aabb);
+		CHECK(std::equal(batch.begin(), batch.end(), quantized.begin()));
+	}
+}
+
+
+TEST_CASE(quantizedPositionsOfFlatBounds)
+{
+	//-- A plane has no extent along y, which quantizes to zero instead of dividing by zero.
+	const std::vector<math::vec3> positions = {
+		math::vec3(0.0f, 2.0f, 0.0f), math::vec3(1.0f, 2.0f, 0.5f), math::vec3(0.5f, 2.0f, 1.0f), math::vec3(1.0f, 2.0f, 1.0f), math::vec3(0.25f, 2.0f, 0.75f)
+	};
+	const math::AABB aabb(math::vec3(0.0f, 2.0f, 0.0f), math::vec3(1.0f, 2.0f, 1.0f));
+
+	std::vector<uint16_t> quantized(positions.size() * 4);
+	quantizePositions(quantized.data(), positions, aabb);
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		CHECK(quantized[i * 4 + 1] == 0);
+		CHECK(quantized[i * 4] == static_cast<uint16_t>(std::lround(positions[i].x * 65535.0f)));
+		CHECK(quantized[i * 4 + 2] == static_cast<uint16_t>(std::lround(positions[i].z * 65535.0f)));
+	}
+
+	//-- A single point has no extent at all.
+	quantizePositions(quantized.data(), positions, math::AABB(positions[0], positions[0]));
+	CHECK(std::all_of(quantized.begin(), quantized.end(), [](uint16_t value) { return value == 0; }));
+}
+
+
+TEST_CASE(octahedralVectorsRoundTrip)
+{
+	std::mt19937 random(9);
+	std::vector<math::vec3> vectors = {
+		math::vec3(1.0f, 0.0f, 0.0f), math::vec3(-1.0f, 0.0f, 0.0f), math::vec3(0.0f, 1.0f, 0.0f), math::vec3(0.0f, -1.0f, 0.0f),
+		math::vec3(0.0f, 0.0f, 1.0f), math::vec3(0.0f, 0.0f, -1.0f)
+	};
+	for (size_t i = 0; i < 1021; ++i)
+	{
+		vectors.push_back(randomUnitVector(random));
+	}
+
+	std::vector<int16_t> encoded(vectors.size() * 2);
+	encodeOctahedral(encoded.data(), vectors);
+
+	//-- Distances, the cosines of such small angles are lost in float precision.
+	float maxError = 0.0f;
+	for (size_t i = 0; i < vectors.size(); ++i)
+	{
+		maxError = std::max(maxError, (octahedralDecode(encoded[i * 2], encoded[i * 2 + 1]) - vectors[i]).Length());
+	}
+	//-- 16 bits per component keep the vectors within a few thousandths of a degree.
+	CHECK(maxError < 1e-4f);
+
+	for (size_t size : kSizes)
+	{
+		std::vector<int16_t> batch(size * 2);
+		encodeOctahedral(batch.data(), { vectors.data(), size });
+		CHECK(std::equal(batch.begin(), batch.end(), encoded.begin()));
+	}
+
+	//-- Zero vectors decode to +Z.
+	const math::vec3 zero(0.0f, 0.0f, 0.0f);
+	int16_t zeroEncoded[2] = { 1, 1 };
+	encodeOctahedral(zeroEncoded, { &zero, 1 });
+	CHECK(zeroEncoded[0] == 0 && zeroEncoded[1] == 0);
+}
+
+
+TEST_CASE(qtangentFramesRoundTrip)
+{
+	std::mt19937 random(13);
+	std::vector<math::vec3> tangents;
+	std::vector<math::vec3> bitangents;
+	std::vector<math::vec3> normals;
+	for (size_t i = 0; i < 1027; ++i)
+	{
+		const math::vec3 normal = randomUnitVector(random);
+		const math::vec3 tangent = randomUnitVector(random);
+		//-- Every other frame is mirrored, as with mirrored UVs.
+		const math::vec3 bitangent = normal.Cross(tangent) * (i % 2 ? -1.0f : 1.0f);
+		tangents.push_back(tangent);
+		bitangents.push_back(bitangent);
+		normals.push_back(normal);
+	}
+
+	std::vector<int16_t> encoded(normals.size() * 4);
+	encodeQTangents(encoded.data(), tangents, bitangents, normals);
+
+	float maxNormalError = 0.0f;
+	float maxTangentError = 0.0f;
+	size_t numWrongHandedness = 0;
+	for (size_t i = 0; i < normals.size(); ++i)
+	{
+		const auto [tangent, bitangent, normal] = decodeQTangent(&encoded[i * 4]);
+		math::vec3 orthogonal = tangents[i] - normals[i] * tangents[i].Dot(normals[i]);
+		orthogonal = orthogonal / orthogonal.Length();
+
+		maxNormalError = std::max(maxNormalError, (normal - normals[i]).Length());
+		maxTangentError = std::max(maxTangentError, (tangent - orthogonal).Length());
+		numWrongHandedness += bitangent.Dot(bitangents[i]) < 0.0f;
+		numWrongHandedness += (encoded[i * 4 + 3] < 0) != (i % 2 == 1);
+	}
+	CHECK(maxNormalError < 2e-4f);
+	CHECK(maxTangentError < 2e-4f);
+	CHECK(numWrongHandedness == 0);
+
+	for (size_t size : kSizes)
+	{
+		std::vector<int16_t> batch(size * 4);
+		encodeQTangents(batch.data(), { tangents.data(), size }, { bitangents.data(), size }, { normals.data(), size });
+		CHECK(std::equal(batch.begin(), batch.end(), encoded.begin()));
+	}
+}
+
+
+TEST_CASE(qtangentEdgeCases)
+{
+	//-- A half turn around X has a zero w, which is kept at the smallest SNORM value so the handedness survives.
+	//-- The second frame is its mirror. The last two have a zero normal and a zero tangent.
+	const std::vector<math::vec3> tangents = { math::vec3(1.0f, 0.0f, 0.0f), math::vec3(1.0f, 0.0f, 0.0f), math::vec3(0.0f, 1.0f, 0.0f),
+		math::vec3(0.0f, 0.0f, 0.0f) };
+	const std::vector<math::vec3> bitangents = { math::vec3(0.0f, -1.0f, 0.0f), math::vec3(0.0f, 1.0f, 0.0f), math::vec3(1.0f, 0.0f, 0.0f),
+		math::vec3(0.0f, 0.0f, 0.0f) };
+	const std::vector<math::vec3> normals = { math::vec3(0.0f, 0.0f, -1.0f), math::vec3(0.0f, 0.0f, -1.0f), math::vec3(0.0f, 0.0f, 0.0f),
+		math::vec3(0.0f, 1.0f, 0.0f) };
+
+	std::vector<int16_t> encoded(normals.size() * 4);
+	encodeQTangents(encoded.data(), tangents, bitangents, normals);
+	CHECK(encoded[3] == 1);
+	CHECK(encoded[7] == -1);
+
+	//-- Degenerated inputs still give orthonormal frames around the normal, or around +Z if there is none.
+	const auto [tangent, bitangent, normal] = decodeQTangent(&encoded[8]);
+	CHECK(normal.z > 0.9999f && std::abs(tangent.Dot(normal)) < 1e-3f);
+	const auto [fallbackTangent, fallbackBitangent, fallbackNormal] = decodeQTangent(&encoded[12]);
+	CHECK(fallbackNormal.y > 0.9999f && std::abs(fallbackTangent.Dot(fallbackNormal)) < 1e-3f && std::abs(fallbackTangent.Length() - 1.0f) < 1e-3f);
+}
+
+
+TEST_CASE(decodersInvertEncoders)
+{
+	std::mt19937 random(17);
+	std::vector<math::vec3> tangents;
+	std::vector<math::vec3> bitangents;
+	std::vector<math::vec3> normals;
+	for (size_t i = 0; i < 257; ++i)
+	{
+		const math::vec3 normal = randomUnitVector(random);
+		math::vec3 tangent = randomUnitVector(random);
+		tangent = tangent - normal * tangent.Dot(normal);
+		tangent = tangent / tangent.Length();
+		tangents.push_back(tangent);
+		bitangents.push_back(normal.Cross(tangent) * (i % 3 ? 1.0f : -1.0f));
+		normals.push_back(normal);
+	}
+
+	std::vector<int16_t> octahedral(normals.size() * 2);
+	encodeOctahedral(octahedral.data(), normals);
+	std::vector<math::vec3> decodedNormals(normals.size());
+	decodeOctahedral(decodedNormals, octahedral.data());
+
+	std::vector<int16_t> qtangents(normals.size() * 4);
+	encodeQTangents(qtangents.data(), tangents, bitangents, normals);
+	std::vector<math::vec3> frameTangents(normals.size());
+	std::vector<math::vec3> frameBitangents(normals.size());
+	std::vector<math::vec3> frameNormals(normals.size());
+	decodeQTangents(frameTangents, frameBitangents, frameNormals, qtangents.data());
+
+	float maxError = 0.0f;
+	for (size_t i = 0; i < normals.size(); ++i)
+	{
+		maxError = std::max({ maxError, (decodedNormals[i] - normals[i]).Length(), (frameNormals[i] - normals[i]).Length(),
+			(frameTangents[i] - tangents[i]).Length(), (frameBitangents[i] - bitangents[i]).Length() });
+	}
+	CHECK(maxError < 2e-4f);
+}
@@ -0,0 +1,164 @@
+#include <tests/test.h>
+#include <engine/resources/mesh/vertex_welder.h>
+
+#include <map>
+#include <random>
+
+namespace
+{
+
+using namespace engine::resources::mesh;
+using engine::utils::LinearArena;
+
+inline constexpr float kTolerance = 1e-5f;
+
+//-- Corners of random unique vertices with positions off by less than the tolerance, exact UVs and integer materials.
+struct Corners
+{
+	Corners(size_t numUnique, size_t numCorners)
+	{
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+		std::uniform_real_distribution<float> noise(-1e-7f, 1e-7f);
+
+		std::vector<float> uniquePositions(numUnique * 3);
+		std::vector<float> uniqueUVs(numUnique * 2);
+		std::vector<uint32_t> uniqueMaterials(numUnique);
+		for (size_t i = 0; i < numUnique; ++i)
+		{
+			std::generate_n(uniquePositions.begin() + i * 3, 3, [&]() { return value(random); });
+			std::generate_n(uniqueUVs.begin() + i * 2, 2, [&]() { return value(random); });
+			uniqueMaterials[i] = random() % 4;
+		}
+
+		for (size_t i = 0; i < numCorners; ++i)
+		{
+			const size_t source = random() % numUnique;
+			for (size_t k = 0; k < 3; ++k)
+			{
+				positions.push_back(uniquePositions[source * 3 + k] + noise(random));
+			}
+			uvs.push_back(uniqueUVs[source * 2]);
+			uvs.push_back(uniqueUVs[source * 2 + 1]);
+			materials.push_back(uniqueMaterials[source]);
+		}
+	}
+
+	std::array<WeldStream, 3> streams()
+	{
+		return { {
+			{ .data = positions.data(), .numComponents = 3, .tolerance = kTolerance },
+			{ .data = uvs.data(), .numComponents = 2, .tolerance = kTolerance },
+			{ .data = materials.data(), .numComponents = 1, .floats = false }
+		} };
+	}
+
+	std::vector<float> positions;
+	std::vector<float> uvs;
+	std::vector<uint32_t> materials;
+};
+
+
+//-- Rounds like the welder, so values next to the middle of the grid cells land in the same cells.
+uint32_t gridKey(float value)
+{
+	return std::bit_cast<uint32_t>(std::nearbyint(value * (1.0f / kTolerance)) + 0.0f);
+}
+
+
+//-- Welds the corners and compares them with a map of the quantized values, including the values the unique vertices keep.
+void checkWeld(size_t numUnique, size_t numCorners)
+{
+	Corners corners(numUnique, numCorners);
+	const Corners original = corners;
+
+	std::map<std::array<uint32_t, 6>, uint32_t> uniqueIds;
+	std::vector<uint32_t> expected(numCorners);
+	std::vector<size_t> firstCorners;
+	for (size_t i = 0; i < numCorners; ++i)
+	{
+		const std::array<uint32_t, 6> key = {
+			gridKey(original.positions[i * 3]), gridKey(original.positions[i * 3 + 1]), gridKey(original.positions[i * 3 + 2]),
+			gridKey(original.uvs[i * 2]), gridKey(original.uvs[i * 2 + 1]), original.materials[i]
+		};
+		const auto [it, inserted] = uniqueIds.emplace(key, static_cast<uint32_t>(uniqueIds.size()));
+		if (inserted)
+		{
+			firstCorners.push_back(i);
+		}
+		expected[i] = it->second;
+	}
+
+	LinearArena scratch(weldScratchSize(numCorners));
+	std::vector<uint32_t> indices(numCorners);
+	const auto streams = corners.streams();
+	const size_t numWelded = weldVertices(streams, indices, scratch);
+
+	CHECK(numWelded == uniqueIds.size());
+	CHECK(indices == expected);
+	CHECK(scratch.statistics().heapAllocations <= 1);
+	for (size_t i = 0; i < std::min(numWelded, firstCorners.size()); ++i)
+	{
+		const size_t first = firstCorners[i];
+		CHECK(memcmp(&corners.positions[i * 3], &original.positions[first * 3], 3 * sizeof(float)) == 0);
+		CHECK(memcmp(&corners.uvs[i * 2], &original.uvs[first * 2], 2 * sizeof(float)) == 0);
+		CHECK(corners.materials[i] == original.materials[first]);
+	}
+}
+
+} //-- unnamed.
+
+
+TEST_CASE(weldMergesVerticesWithinTolerance)
+{
+	checkWeld(1, 30);
+	checkWeld(10, 30);
+	checkWeld(1000, 6000);
+}
+
+
+TEST_CASE(parallelWeldMatchesReference)
+{
+	//-- Above the parallel threshold, so the vertices are hashed and welded in shards.
+	checkWeld(30000, 200000);
+}
+
+
+TEST_CASE(weldKeepsFarVerticesApart)
+{
+	//-- Millions of steps away from the origin the quantized values don't fit 32-bit integers anymore.
+	std::vector<float> positions = { 1e6f, 1e6f + 0.5f, -1e6f, 3e9f, -3e9f, 0.0f, -0.0f, 1e6f, std::numeric_limits<float>::infinity(),
+		std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::quiet_NaN() };
+	const WeldStream stream = { .data = positions.data(), .numComponents = 1, .tolerance = kTolerance };
+
+	LinearArena scratch(weldScratchSize(positions.size()));
+	std::vector<uint32_t> indices(positions.size());
+	CHECK(weldVertices({ &stream, 1 }, indices, scratch) == 8);
+	CHECK(indices == std::vector<uint32_t>({ 0, 1, 2, 3, 4, 5, 5, 0, 6, 7, 7 }));
+}
+
+
+BENCHMARK(weldThroughput)
+{
+	for (const size_t numCorners : { 30000, 1800000 })
+	{
+		const Corners corners(numCorners / 6, numCorners);
+		Corners welded = corners;
+		LinearArena scratch(weldScratchSize(numCorners));
+		std::vector<uint32_t> indices(numCorners);
+
+		//-- The streams are compacted in place, so restoring them counts too.
+		size_t numUnique = 0;
+		const double time = tests::measure(10, [&]()
+			{
+				welded.positions = corners.positions;
+				welded.uvs = corners.uvs;
+				welded.materials = corners.materials;
+				scratch.reset();
+				const auto streams = welded.streams();
+				numUnique = weldVertices(streams, indices, scratch);
+			});
+
+		fmt::println("  {} corners into {} vertices: {:.2f} ms.", numCorners, numUnique, time);
+	}
+}
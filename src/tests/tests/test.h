@@ -0,0 +1,53 @@
+#pragma once
+
+#include <engine/helpers.h>
+
+#include <chrono>
+
+//-- A minimal test runner. Test cases register themselves, failed checks are logged and fail the run.
+namespace tests
+{
+
+struct TestCase
+{
+	std::string_view name;
+	void (*fn)() = nullptr;
+	bool benchmark = false; //-- Runs only with -bench.
+};
+
+std::vector<TestCase>& testCases();
+
+struct Registrar
+{
+	Registrar(std::string_view name, void (*fn)(), bool benchmark) { testCases().push_back({ name, fn, benchmark }); }
+};
+
+void fail(std::string_view expression, std::string_view file, int line);
+
+
+//-- The best of several runs in milliseconds, so warming up and noise don't count.
+template<typename Fn>
+double measure(size_t runs, Fn&& fn)
+{
+	double best = std::numeric_limits<double>::max();
+	for (size_t i = 0; i < runs; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		fn();
+		best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	return best;
+}
+
+} //-- tests.
+
+#define TESTS_REGISTER(name, benchmark) \
+	static void name(); \
+	static const ::tests::Registrar name##Registrar(#name, name, benchmark); \
+	static void name()
+
+#define TEST_CASE(name) TESTS_REGISTER(name, false)
+#define BENCHMARK(name) TESTS_REGISTER(name, true)
+
+#define CHECK(expression) ((expression) ? void(0) : ::tests::fail(#expression, __FILE__, __LINE__))